@@ -1,13 +1,27 @@
 #include "RST.h"
 
+thread_local std::chrono::steady_clock::time_point RSTApiDeadline::s_tDeadline = std::chrono::steady_clock::time_point::max();
+
+RSTApiDeadline::RSTApiDeadline(int nMilliSeconds)
+{
+    m_tPrevious = s_tDeadline;
+    s_tDeadline = std::min(m_tPrevious, std::chrono::steady_clock::now() + std::chrono::milliseconds(nMilliSeconds));
+}
+
+RSTApiDeadline::~RSTApiDeadline()
+{
+    s_tDeadline = m_tPrevious;
+}
+
 // Constructor for RST
 RST::RST()
 {
 
+    m_pSerx = NULL;
+    m_pHost = NULL;
 	m_bIsConnected = false;
-    m_bLimitCached = false;
-    m_dHoursEast = 8.0;
-    m_dHoursWest = 8.0;
+    m_dLastResumeTime = 0.0;
+    m_nResumeCount = 0;
 
     m_dRaRateArcSecPerSec = 0.0;
     m_dDecRateArcSecPerSec = 0.0;
@@ -29,8 +43,91 @@ RST::RST()
     m_bUnparking = false;
     m_bSlewing = false;
     m_bStopTrackingOnDisconnect = true;
-    
+
+    m_RaAxisMove.bMoving = false;
+    m_RaAxisMove.nDir = MOVE_EAST;
+    m_RaAxisMove.nMoveId = 0;
+    m_DecAxisMove.bMoving = false;
+    m_DecAxisMove.nDir = MOVE_NORTH;
+    m_DecAxisMove.nMoveId = 0;
+    m_nLastMoveId = 0;
+    forgetMountShadow();
+    m_nShadowSkipped = 0;
+    m_nShadowSleepSavedMs = 0;
+
+    m_bTrackingEngineRunning = false;
+    m_bTrackingEngineRetarget = false;
+    m_dEngineRaRate = 0.0;
+    m_dEngineDecRate = 0.0;
+    m_dEngineInterval = TRACKING_ENGINE_MAX_INTERVAL;
+    m_dEngineGuideRate = DEFAULT_GUIDE_SPEED * SIDEREAL_RATE_ARCSEC_PER_SEC;
+    m_dEngineOriginRa = 0.0;
+    m_dEngineOriginDec = 0.0;
+    m_dEngineAppliedRa = 0.0;
+    m_dEngineAppliedDec = 0.0;
+    m_dEngineErrRa = 0.0;
+    m_dEngineErrDec = 0.0;
+
     m_commandDelayTimer.Reset();
+    m_dCommandPacing = 0.0;
+    m_dLastConnectTime = 0.0;
+
+    m_bTimeSynced = false;
+    m_dLinkOneWayDelay = 0.0;
+    m_dTimeSyncResidualMs = 0.0;
+    m_dLastClockOffsetMs = 0.0;
+    m_dClockDriftMsPerHour = 0.0;
+
+    m_bWarmupRunning = false;
+    m_nWarmupDone = 0;
+    m_bWarmHomingValid = false;
+    m_bAlignOffsetValid = false;
+    m_dAlignOffset = 0.0;
+    m_bFirstRaDecDone = false;
+    m_dTimeToFirstRaDec = 0.0;
+
+    m_bLinkProbeRunning = false;
+    m_nBreakerState = BREAKER_CLOSED;
+    m_nBreakerTripCount = 0;
+    m_nConsecutiveTimeouts = 0;
+
+    m_bTelemetryRunning = false;
+    m_bTelemetryRefresh = false;
+    m_bTelemetrySiteStale = true;
+    m_nTelemetryInterval = TELEMETRY_DEFAULT_INTERVAL;
+    m_bTelemetryValid = false;
+    m_bTelemetrySiteValid = false;
+    m_dTelemetrySeconds = 0.0;
+    m_dTelemetryVolts = 0.0;
+
+    m_nFlightGeneration = 0;
+    m_nQueryFreshnessMs = QUERY_FRESHNESS_DEFAULT;
+    m_nQueriesSent = 0;
+    m_nQueriesShared = 0;
+    m_nWireLocks = 0;
+    m_nWireLockContended = 0;
+    m_nWireLockWaitUs = 0;
+    m_nWireLockMaxWaitUs = 0;
+    for(std::atomic<unsigned long> &nEvents : m_nWatchdogEvents)
+        nEvents = 0;
+    m_nWatchdogRecovered = 0;
+    m_bPierGoto = false;
+    m_dPierGotoHourAngle = 0.0;
+    m_dPierGotoDec = 0.0;
+    m_bSlewModelSpeed = false;
+    m_bSlewTimed = false;
+    m_dSlewTravel = 0.0;
+    m_dSlewPredicted = 0.0;
+    m_dSlewLastPoll = 0.0;
+    m_dSlewDoneNotice = -1.0;
+    m_nSlewPollsSkipped = 0;
+    m_nWatchdogRecoveryUs = 0;
+    m_nWatchdogMaxRecoveryUs = 0;
+    m_nTrackingState = STATUS_TRACKING_UNKNOWN;
+
+    memset(&m_Status, 0, sizeof(m_Status));
+    m_Status.nTrackingMode = STATUS_TRACKING_UNKNOWN;
+    m_Status.nPierSide = STATUS_PIER_UNKNOWN;
     
 #ifdef PLUGIN_DEBUG
 #if defined(SB_WIN_BUILD)
@@ -57,6 +154,11 @@ RST::RST()
 
 RST::~RST(void)
 {
+    m_MetricsServer.stop();
+    stopWarmup();
+    stopTelemetry();
+    stopNonSiderealTracking();
+    stopLinkProbe();
 #ifdef    PLUGIN_DEBUG
     // Close LogFile
     if(m_sLogFile.is_open())
@@ -75,8 +177,13 @@ int RST::Connect(char *pszPort)
     m_sLogFile.flush();
 #endif
 
+    stopWarmup();
+    m_ConnectTimer.Reset();
+    axesMoved();
+    m_bSlewModelSpeed = false;
+
     // 115.2K 8N1
-    if(m_pSerx->open(pszPort, 115200, SerXInterface::B_NOPARITY, "-DTR_CONTROL 1") == 0)
+    if(m_pSerx->open(pszPort, 115200, "-DTR_CONTROL 1") == 0)
         m_bIsConnected = true;
     else
         m_bIsConnected = false;
@@ -84,12 +191,19 @@ int RST::Connect(char *pszPort)
     if(!m_bIsConnected)
         return ERR_COMMNOLINK;
 
+    m_sPortName.assign(pszPort);
+    m_sFirmwareVersion.clear();
+    m_nResumeCount = 0;
+
+    // new link, start with a clean breaker
+    stopLinkProbe();
+    m_nBreakerTripCount = 0;
+
     // usb mode on
     // sendCommand(":AU#", sResp, 0);
     // std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
     // request protocol Rainbow
-    nErr = sendCommand(":AR#", sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_AR>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] :AR# error " << nErr << std::endl;
@@ -99,20 +213,55 @@ int RST::Connect(char *pszPort)
         return nErr;
     }
 
-    if(m_bSyncLocationDataConnect) {
-        nErr = setSiteData(m_pTsx->longitude(),
-                    m_pTsx->latitude(),
-                    m_pTsx->timeZone());
-    }
-    if(nErr) {
+    // :AR# has no answer, make sure there is a mount at the other end. We need the firmware version anyway.
+    nErr = sendCommand<CMD_AV>(sResp);
+    if(nErr || sResp.size() == 0) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] error " << nErr << ", response = " << sResp << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] no answer from the mount, error " << nErr << ", response = " << sResp << std::endl;
         m_sLogFile.flush();
 #endif
+        m_pSerx->close();
         m_bIsConnected = false;
-        return nErr;
+        return nErr?nErr:ERR_CMDFAILED;
     }
+    m_sFirmwareVersion.assign(sResp);
+    // what this firmware answers, from the ini when we've seen it before
+    if(m_Caps.reset(m_sFirmwareVersion)) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] capabilities of " << m_sFirmwareVersion << " from the settings." << std::endl;
+        m_sLogFile.flush();
+#endif
+    }
+
+    // we don't know what the mount was doing before we connected
+    m_RaAxisMove.bMoving = false;
+    m_DecAxisMove.bMoving = false;
+    forgetMountShadow();
+    m_nShadowSkipped = 0;
+    m_nShadowSleepSavedMs = 0;
     m_bSyncDone = false;
+    m_bFirstRaDecDone = false;
+
+    if(!m_sStatusName.empty() && !m_StatusPublisher.isOpen()) {
+        nErr = m_StatusPublisher.open(m_sStatusName);
+#if defined PLUGIN_DEBUG
+        if(nErr) {
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] can't publish the status as " << m_sStatusName << ", error " << nErr << std::endl;
+            m_sLogFile.flush();
+        }
+#endif
+    }
+    publishFlag(STATUS_CONNECTED, true);
+
+    // homing state, alignment offset, speeds and site data are fetched in the background
+    startWarmup();
+    startTelemetry();
+
+    m_dLastConnectTime = m_ConnectTimer.GetElapsedSeconds();
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Connect] connected in " << std::fixed << std::setprecision(3) << m_dLastConnectTime << " s" << std::endl;
+    m_sLogFile.flush();
+#endif
 
     return SB_OK;
 }
@@ -124,6 +273,10 @@ int RST::Disconnect(void)
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Disconnect] Disconnect Called." << std::endl;
     m_sLogFile.flush();
 #endif
+    stopWarmup();
+    stopTelemetry();
+    stopNonSiderealTracking();
+    stopLinkProbe();
 	if (m_bIsConnected) {
         if(m_bStopTrackingOnDisconnect)
             setTrackingRates( false, true, 0.0, 0.0); // stop tracking on disconnect.
@@ -132,6 +285,10 @@ int RST::Disconnect(void)
             m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Disconnect] closing serial port." << std::endl;
             m_sLogFile.flush();
 #endif
+            // queries don't go through the X2 lock anymore, one could still be on the wire
+            std::unique_lock<std::recursive_mutex> wireLock(m_DevMutex, std::defer_lock);
+            lockWire(wireLock);
+            std::lock_guard<std::mutex> txLock(m_TxMutex);
             m_pSerx->flushTx();
             m_pSerx->purgeTxRx();
             m_pSerx->close();
@@ -140,27 +297,392 @@ int RST::Disconnect(void)
 	m_bIsConnected = false;
     m_bSyncDone = false;
 
+    publishFlag(STATUS_CONNECTED, false);
+    {
+        std::lock_guard<std::mutex> lock(m_StatusMutex);
+        m_StatusPublisher.close();
+    }
+
 	return SB_OK;
 }
 
+int RST::resumeLink()
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+    CStopWatch resumeTimer;
+
+#if defined PLUGIN_DEBUG
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [resumeLink] reopening " << m_sPortName << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    if(!m_bIsConnected || m_sPortName.empty())
+        return NOT_CONNECTED;
+
+    std::lock_guard<std::recursive_mutex> opLock(m_OpMutex);
+    {
+        std::unique_lock<std::recursive_mutex> wireLock(m_DevMutex, std::defer_lock);
+        lockWire(wireLock);
+        std::lock_guard<std::mutex> txLock(m_TxMutex);     // after the wire, like sendCommandOnWire
+
+        if(m_pSerx->isConnected()) {
+            m_pSerx->purgeTxRx();
+            m_pSerx->close();
+        }
+        if(m_pSerx->open(m_sPortName.c_str(), 115200, "-DTR_CONTROL 1"))
+            return ERR_COMMNOLINK;
+    }
+
+    nErr = sendCommandOnWire(":AR#", sResp, 0);
+    setCommandPacing(PROTOCOL_SWITCH_PACING);
+    if(nErr)
+        return nErr;
+
+    nErr = resumeSession();
+    if(nErr)
+        return nErr;
+
+    m_nResumeCount++;
+    m_dLastResumeTime = resumeTimer.GetElapsedSeconds();
+    m_Recorder.record(REC_RESUME, 0, (int32_t)(m_dLastResumeTime * 1000));
+#if defined PLUGIN_DEBUG
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [resumeLink] resumed in " << std::fixed << std::setprecision(3) << m_dLastResumeTime << " s" << std::endl;
+    m_sLogFile.flush();
+#endif
+    return PLUGIN_OK;
+}
+
+int RST::resumeSession()
+{
+    int nErr = PLUGIN_OK;
+    std::vector<std::string> svResps;
+    bool bMountReset = false;
+    bool bIsHomed;
+
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
+    // who are you, are you homed, are you still slewing ?
+    nErr = sendCommandBurstOnWire({":AV#", ":AH#", ":CL#"}, svResps, MAX_TIMEOUT);
+    if(nErr || svResps.size() < 3) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [resumeSession] status burst failed, error " << nErr << std::endl;
+        m_sLogFile.flush();
+#endif
+        return nErr?nErr:ERR_CMDFAILED;
+    }
+
+    // the link is good, let the normal traffic through.
+    if(m_nBreakerState != BREAKER_CLOSED)
+        m_Recorder.record(REC_BREAKER, BREAKER_CLOSED, 0);
+    m_nBreakerState = BREAKER_CLOSED;
+    m_nConsecutiveTimeouts = 0;
+
+    bIsHomed = (rstReplyValue(CMD_AH, svResps[1])[0] == '0');
+    if(!m_sFirmwareVersion.empty() && svResps[0] != m_sFirmwareVersion) {
+        bMountReset = true;
+        m_Caps.reset(svResps[0]);   // a new firmware, back to probing
+    }
+    if(m_bIsHomed && !bIsHomed)     // a power cycle loses the homing
+        bMountReset = true;
+    m_sFirmwareVersion.assign(svResps[0]);
+    m_bIsHomed = bIsHomed;
+    if(m_bSlewing && rstReplyValue(CMD_CL, svResps[2])[0] == '0')
+        m_bSlewing = false;
+    publishFlag(STATUS_HOMED, bIsHomed);
+
+    if(bMountReset) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [resumeSession] the mount was reset, forgetting what we knew." << std::endl;
+        m_sLogFile.flush();
+#endif
+        m_bSyncDone = false;
+        m_bSlewing = false;
+        publishFlag(STATUS_SLEWING, false);
+        m_bUnparking = false;
+        m_Limits.clearSite();
+        axesMoved();
+        m_bTimeSynced = false;
+        m_RaAxisMove.bMoving = false;
+        m_DecAxisMove.bMoving = false;
+        forgetMountShadow();
+        if(m_bSyncLocationDataConnect)
+            syncSiteDataOnConnect(m_pHost->longitude(), m_pHost->latitude(), m_pHost->timeZone());
+    }
+
+    return PLUGIN_OK;
+}
+
 
 #pragma mark - RST communication
-int RST::sendCommand(const std::string sCmd, std::string &sResp, int nTimeout)
+// built once per command
+template<int nCmd> const std::string &RST::commandString()
+{
+    static_assert(rstIsFixed(nCmd), "this command takes an argument");
+    static const std::string sCmd(RSTCommands[nCmd].pszOpcode);
+    return sCmd;
+}
+
+template<int nCmd> int RST::sendCommand(std::string &sResp)
+{
+    return sendCommand<nCmd>(commandString<nCmd>(), sResp);
+}
+
+// everything that depends on nCmd is a constant, the branches that don't apply go away
+template<int nCmd> int RST::sendCommand(const std::string &sCmd, std::string &sResp)
+{
+    int nErr;
+
+    nErr = sendCommandOnce<nCmd>(sCmd, sResp);
+    if((RSTCommands[nCmd].nRetry == RETRY_ONCE && nErr) || (RSTCommands[nCmd].nRetry == RETRY_SLOW && nErr == COMMAND_TIMEOUT)) {
+        m_Metrics.addCommandRetry();
+        if(RSTCommands[nCmd].nRetry == RETRY_SLOW)
+            std::this_thread::sleep_for(std::chrono::milliseconds(COMMAND_RETRY_DELAY)); // need to give time to the mount to process the command
+        nErr = sendCommandOnce<nCmd>(sCmd, sResp);
+    }
+    return nErr;
+}
+
+template<int nCmd> int RST::sendCommandOnce(const std::string &sCmd, std::string &sResp)
+{
+    int nErr;
+
+    nErr = sendCommandOnce<nCmd>(sCmd, sResp, std::integral_constant<bool, RSTCommands[nCmd].bShared>());
+    // the answers without a '#' end on the timeout, and silence is what :MS# says when all is well
+    if(nErr == COMMAND_TIMEOUT && ((RSTCommands[nCmd].nReply == REPLY_NO_HASH && sResp.size()) || (RSTCommands[nCmd].nReply == REPLY_ON_ERROR && sResp.empty())))
+        nErr = PLUGIN_OK;
+    return nErr;
+}
+
+// a status query, its flight is m_Flights[nCmd]
+template<int nCmd> int RST::sendCommandOnce(const std::string &sCmd, std::string &sResp, std::true_type)
+{
+    return sendQuery(nCmd, sCmd, sResp, rstTimeoutMs(RSTCommands[nCmd].nTimeout), rstPacingMs(RSTCommands[nCmd].nPacing));
+}
+
+template<int nCmd> int RST::sendCommandOnce(const std::string &sCmd, std::string &sResp, std::false_type)
+{
+    return sendWrite(sCmd, sResp, RSTCommands[nCmd].nReply, rstTimeoutMs(RSTCommands[nCmd].nTimeout), rstPacingMs(RSTCommands[nCmd].nPacing));
+}
+
+int RST::sendQuery(int nCmd, const std::string &sCmd, std::string &sResp, int nTimeout, int nPacingMs)
+{
+    // don't block everybody waiting for an answer that won't come
+    if(nTimeout && isLinkBreakerOpen()) {
+        sResp.clear();
+        return COMMAND_TIMEOUT;
+    }
+
+    if(m_nQueryFreshnessMs != QUERY_SHARING_OFF)
+        return sendQueryShared(nCmd, sCmd, sResp, nTimeout, nPacingMs);
+    m_nQueriesSent++;
+    return sendCommandRecorded(sCmd, sResp, REPLY_HASH, nTimeout, nPacingMs);
+}
+
+int RST::sendWrite(const std::string &sCmd, std::string &sResp, int nReply, int nTimeout, int nPacingMs)
 {
     int nErr = PLUGIN_OK;
-    unsigned long  ulBytesWrite;
-    std::vector<std::string> vFieldsData;
 
-    m_pSerx->purgeTxRx();
+    // same as for a query, but writes that don't answer still go out (:Q# must always be tried).
+    if(nTimeout && isLinkBreakerOpen()) {
+        sResp.clear();
+        return COMMAND_TIMEOUT;
+    }
+
+    // whatever this changes, the answers from before don't say
+    invalidateQueryFlights();
+    nErr = sendCommandRecorded(sCmd, sResp, nReply, nTimeout, nPacingMs);
+    invalidateQueryFlights();
+    return nErr;
+}
+
+int RST::sendCommandRecorded(const std::string &sCmd, std::string &sResp, int nReply, int nTimeout, int nPacingMs)
+{
+    int nErr = PLUGIN_OK;
+
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    nErr = sendCommandOnWire(sCmd, sResp, nTimeout);
+    // a command the mount didn't take has nothing to process, whoever tries again shouldn't wait more.
+    // The ones that don't answer with a '#' always end on their timeout, it says nothing about that.
+    if(nPacingMs && (nErr == PLUGIN_OK || sResp.size() || nReply != REPLY_HASH))
+        setCommandPacing(nPacingMs); // need to give time to the mount to process the command
+    // :Sr/:Sd answer without a '#' and :MS# only answers on error (RSTCommands nReply).
+    // Anything coming back proves the link is alive, their silence doesn't prove anything.
+    if(nErr == COMMAND_TIMEOUT && sResp.size())
+        updateLinkBreaker(PLUGIN_OK);
+    else if(nReply == REPLY_HASH || nErr != COMMAND_TIMEOUT)
+        updateLinkBreaker(nErr);
+
+    int nCode = REC_CMD_OK;
+    int32_t nLatencyUs = (int32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tStart).count();
+    if(nErr == COMMAND_TIMEOUT && !sResp.size() && nReply == REPLY_HASH)
+        nCode = REC_CMD_TIMEOUT;
+    else if(nErr && nErr != COMMAND_TIMEOUT)
+        nCode = REC_CMD_ERROR;
+    m_Metrics.addCommand(sCmd, nCode, nLatencyUs);
+    m_Recorder.recordCommand(sCmd, nCode, nLatencyUs);
+    return nErr;
+}
+
+int RST::sendQueryShared(int nCmd, const std::string &sCmd, std::string &sResp, int nTimeout, int nPacingMs)
+{
+    int nErr;
+    bool bInFlight;
+    std::shared_ptr<QueryFlight> pFlight;
+    std::chrono::steady_clock::time_point tDeadline = RSTApiDeadline::current();
+    std::chrono::steady_clock::time_point tWait;
+
+    {
+        std::unique_lock<std::mutex> lock(m_FlightMutex);
+        if(m_Flights[nCmd] && m_Flights[nCmd]->nGeneration == m_nFlightGeneration) {
+            pFlight = m_Flights[nCmd];
+            bInFlight = !pFlight->bDone;
+            // the one asking has its own deadline, ours may be shorter. Without one we still don't wait longer
+            // than a command can take : a flight stuck past that is asked again on the wire.
+            tWait = std::min(tDeadline, std::chrono::steady_clock::now() + std::chrono::milliseconds(QUERY_FLIGHT_MAX_WAIT));
+            if(bInFlight && !m_FlightCond.wait_until(lock, tWait, [&pFlight]() { return pFlight->bDone; })) {
+                if(tWait == tDeadline) {
+                    sResp.clear();
+                    return ERR_CMDFAILED;
+                }
+            }
+            else if(bInFlight || std::chrono::steady_clock::now() - pFlight->tDone <= std::chrono::milliseconds(m_nQueryFreshnessMs)) {
+                sResp.assign(pFlight->sResp);
+                m_nQueriesShared++;
+                return pFlight->nErr;
+            }
+        }
+        pFlight = std::make_shared<QueryFlight>();
+        pFlight->nGeneration = m_nFlightGeneration;
+        pFlight->bDone = false;
+        pFlight->nErr = PLUGIN_OK;
+        m_Flights[nCmd] = pFlight;
+    }
+
+    nErr = sendCommandRecorded(sCmd, sResp, REPLY_HASH, nTimeout, nPacingMs);
+    m_nQueriesSent++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_FlightMutex);
+        pFlight->nErr = nErr;
+        pFlight->sResp.assign(sResp);
+        pFlight->tDone = std::chrono::steady_clock::now();
+        pFlight->bDone = true;
+        // a failure only goes to the ones already waiting for it, the next caller asks again
+        if(nErr && m_Flights[nCmd] == pFlight)
+            m_Flights[nCmd].reset();
+    }
+    m_FlightCond.notify_all();
+    return nErr;
+}
+
+void RST::invalidateQueryFlights()
+{
+    std::lock_guard<std::mutex> lock(m_FlightMutex);
+    m_nFlightGeneration++;
+}
+
+void RST::getQuerySharingStats(unsigned long &nSent, unsigned long &nShared)
+{
+    nSent = m_nQueriesSent;
+    nShared = m_nQueriesShared;
+}
+
+// what rstproxyd forwards comes as a string, the driver's own commands go through sendCommand<CMD_xx>
+int RST::forwardCommand(const std::string sCmd, std::string &sResp)
+{
+    int nErr = PLUGIN_OK;
+    int nCmd;
+    int nReply;
+    int nTimeout;
+
+    // one we don't know is asked like a query, with a '#' framed answer
+    nCmd = rstFindCommand(sCmd);
+    nReply = nCmd < 0 ? REPLY_HASH : RSTCommands[nCmd].nReply;
+    nTimeout = nCmd < 0 ? MAX_TIMEOUT : rstTimeoutMs(RSTCommands[nCmd].nTimeout);
+    if(nCmd >= 0 && RSTCommands[nCmd].bShared)
+        nErr = sendQuery(nCmd, sCmd, sResp, nTimeout, 0);
+    else
+        nErr = sendWrite(sCmd, sResp, nReply, nTimeout, 0);
+
+    switch(nReply) {
+        case REPLY_HASH :
+            if(!nErr)
+                sResp += "#";   // sendCommandOnWire strips it
+            break;
+        case REPLY_ON_ERROR :
+            if(!nErr)
+                sResp += "#";
+            else if(nErr == COMMAND_TIMEOUT && sResp.empty())
+                nErr = PLUGIN_OK;   // all is well
+            break;
+        case REPLY_NO_HASH :
+            if(nErr == COMMAND_TIMEOUT && sResp.size())
+                nErr = PLUGIN_OK;
+            break;
+        default :
+            break;
+    }
+    return nErr;
+}
+
+int RST::forwardCommandBurst(const std::vector<std::string> &svCmds, std::vector<std::string> &svResps)
+{
+    int nErr = PLUGIN_OK;
+
+    // only for commands with a normal '#' terminated answer
+    nErr = sendCommandBurst(svCmds, svResps);
+    for(std::string &sResp : svResps)
+        sResp += "#";
+    return nErr;
+}
+
+int RST::commandReplyTimeout(const std::string &sCmd)
+{
+    return rstCommandTimeout(sCmd);
+}
+
+int RST::sendCommandOnWire(const std::string sCmd, std::string &sResp, int nTimeout)
+{
+    int nErr = PLUGIN_OK;
+    unsigned long  ulBytesWrite;
+    int nNotices = 0;
+    std::chrono::steady_clock::time_point tDeadline;
+    std::chrono::steady_clock::time_point tWrite;
+    std::chrono::steady_clock::time_point tNow;
+    int nDeadlineEvent;
+    std::unique_lock<std::recursive_mutex> lock(m_DevMutex, std::defer_lock);
+
+    lockWire(lock);
+    waitCommandPacing(lock);
     sResp.clear();
+    // the wait for the lock may have used up what was left of the call
+    tDeadline = commandDeadline(nDeadlineEvent);
+    if(nTimeout && std::chrono::steady_clock::now() >= tDeadline) {
+        m_nWatchdogEvents[WATCHDOG_API_DEADLINE]++;
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommand] API deadline passed, '" << sCmd << "' not sent." << std::endl;
+        m_sLogFile.flush();
+#endif
+        return ERR_CMDFAILED;
+    }
+    // the end of a goto may be waiting in what we are about to purge
+    if(m_bSlewTimed)
+        peekSlewDone();
+    m_pSerx->purgeTxRx();
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommand] sending '" << sCmd << "'" << std::endl;
     m_sLogFile.flush();
 #endif
 
-    nErr = m_pSerx->writeFile((void *)sCmd.c_str(), sCmd.size(), ulBytesWrite);
-    m_pSerx->flushTx();
+    {
+        std::lock_guard<std::mutex> txLock(m_TxMutex);
+        nErr = m_pSerx->writeFile((void *)sCmd.c_str(), sCmd.size(), ulBytesWrite);
+        m_pSerx->flushTx();
+    }
+    tWrite = std::chrono::steady_clock::now();
+    m_Metrics.addBytesSent(ulBytesWrite);
     if(nErr)
         return nErr;
 
@@ -169,44 +691,150 @@ int RST::sendCommand(const std::string sCmd, std::string &sResp, int nTimeout)
         return nErr;
 
     while(true) {
-        nErr = readResponse(sResp, nTimeout);
+        nErr = readResponse(sResp, nTimeout, tDeadline);
         if(nErr) {
     #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
             m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommand] ***** ERROR READING RESPONSE **** error = " << nErr << " , response : '" << sResp << "'" << std::endl;
             m_sLogFile.flush();
     #endif
+            if(std::chrono::steady_clock::now() >= tDeadline)
+                return watchdogRecover(nDeadlineEvent);
             return nErr;
         }
     #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommand] response : '" << sResp << "'" <<  std::endl;
         m_sLogFile.flush();
     #endif
-        // do we have a :MM0# in the response as this come async after a slew and get mixed with normal response.
-        if (sResp.find("#")!= -1) { // if there is a # in the response then we have 2 responses and need to extract the right one
-            parseFields(sResp, vFieldsData, '#');
-            if(vFieldsData.size() >1) {
-                if(vFieldsData[0].find("MM0") != -1 ) {
-                    sResp.assign(vFieldsData[1]);
-                }
-                else if(vFieldsData[1].find("MM0") != -1 ) {
-                    sResp.assign(vFieldsData[0]);
-                }
-                else { // some more weirdness, only take the last one.
-                    sResp.assign(vFieldsData[1]);
-                }
-            }
+        if(splitNotices(sResp, nNotices))
+            break;
+        m_Metrics.addReadRetry();
+        // a mount (or a link) repeating notices forever doesn't get to keep the caller
+        if(nNotices > WATCHDOG_MAX_NOTICES)
+            return watchdogRecover(WATCHDOG_NOTICE_FLOOD);
+        // notices don't give the answer more time than silence would
+        tNow = std::chrono::steady_clock::now();
+        if(tNow - tWrite >= std::chrono::milliseconds(nTimeout)) {
+            sResp.clear();
+            return COMMAND_TIMEOUT;
         }
-        if(sResp.find("CHO") != -1 )    // another async response on homing
+        if(sResp.find("MM0") == std::string::npos)    // another async response on homing
             continue;
-        if(sResp.find("MM0") == -1 )
-            break;
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if(tNow >= tDeadline)
+            return watchdogRecover(nDeadlineEvent);
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(std::chrono::milliseconds(100), tDeadline - tNow));
     }
     return nErr;
 }
 
+// :MM0# (slew done) and :CHO# (homing done) come async and get mixed with the answer, keep the last field that isn't one of them.
+// false when there were only notices.
+bool RST::splitNotices(std::string &sResp, int &nNotices)
+{
+    bool bAnswer;
+    bool bSlewDone = false;
+
+    bAnswer = rstSplitNotices(sResp, nNotices, bSlewDone);
+    if(bSlewDone)
+        noticeSlewDone();
+    return bAnswer;
+}
+
+std::chrono::steady_clock::time_point RST::commandDeadline(int &nEvent)
+{
+    std::chrono::steady_clock::time_point tCommand = std::chrono::steady_clock::now() + std::chrono::milliseconds(WATCHDOG_COMMAND_DEADLINE);
+    std::chrono::steady_clock::time_point tApi = RSTApiDeadline::current();
+
+    nEvent = WATCHDOG_STALLED;
+    if(tApi == std::chrono::steady_clock::time_point::max())
+        return tCommand;
+    tApi -= std::chrono::milliseconds(WATCHDOG_RESYNC_RESERVE);
+    if(tApi < tCommand) {
+        nEvent = WATCHDOG_API_DEADLINE;
+        return tApi;
+    }
+    return tCommand;
+}
+
+int RST::watchdogRecover(int nEvent)
+{
+    int nErr;
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point tResync;
+    unsigned long nRecoveryUs;
+    unsigned long nMaxUs;
+
+    m_nWatchdogEvents[nEvent]++;
+    // we can't tell what the mount made of it, the next write checks again
+    m_bShadowValid = false;
+    // whatever is still in flight belongs to the command we gave up on
+    m_pSerx->purgeTxRx();
+    tResync = tStart + std::chrono::milliseconds(MAX_TIMEOUT);
+    if(RSTApiDeadline::current() != std::chrono::steady_clock::time_point::max())
+        tResync = std::min(tResync, RSTApiDeadline::current() - std::chrono::milliseconds(WATCHDOG_RETURN_MARGIN));
+    nErr = resyncFraming(tResync);
+
+    nRecoveryUs = (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tStart).count();
+    if(!nErr)
+        m_nWatchdogRecovered++;
+    m_nWatchdogRecoveryUs += nRecoveryUs;
+    nMaxUs = m_nWatchdogMaxRecoveryUs;
+    while(nRecoveryUs > nMaxUs && !m_nWatchdogMaxRecoveryUs.compare_exchange_weak(nMaxUs, nRecoveryUs))
+        ;
+    m_Recorder.record(REC_WATCHDOG, nEvent, (int32_t)(nRecoveryUs / 1000));
+
+#if defined PLUGIN_DEBUG
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [watchdogRecover] command stopped (" << (nEvent == WATCHDOG_STALLED ? "command deadline" : (nEvent == WATCHDOG_NOTICE_FLOOD ? "notice flood" : "API deadline"))
+               << "), framing " << (nErr ? "not re-synced" : "re-synced") << " in " << nRecoveryUs / 1000.0 << " ms" << std::endl;
+    m_sLogFile.flush();
+#endif
+    // a stalled link is a timeout for the breaker, the other two say nothing about the link
+    return nEvent == WATCHDOG_STALLED ? COMMAND_TIMEOUT : ERR_CMDFAILED;
+}
+
+int RST::resyncFraming(std::chrono::steady_clock::time_point tDeadline)
+{
+    int nErr = PLUGIN_OK;
+    unsigned long  ulBytesWrite;
+    std::string sResp;
+    std::vector<std::string> vFieldsData;
+    std::chrono::steady_clock::time_point tNow = std::chrono::steady_clock::now();
+
+    if(tNow >= tDeadline)
+        return COMMAND_TIMEOUT;
+
+    {
+        std::lock_guard<std::mutex> txLock(m_TxMutex);
+        nErr = m_pSerx->writeFile((void *)":AT#", 4, ulBytesWrite);
+        m_pSerx->flushTx();
+    }
+    m_Metrics.addBytesSent(ulBytesWrite);
+    if(nErr)
+        return nErr;
+
+    // the answer to :AT# is "AT..." , anything before it is noise from the command we dropped
+    while((tNow = std::chrono::steady_clock::now()) < tDeadline) {
+        nErr = readResponse(sResp, (int)std::chrono::duration_cast<std::chrono::milliseconds>(tDeadline - tNow).count() + 1, tDeadline);
+        if(nErr)
+            return nErr;
+        if(parseFields(sResp, vFieldsData, '#'))
+            continue;
+        for(const std::string &sField : vFieldsData)
+            if(sField.find("AT") != std::string::npos)
+                return PLUGIN_OK;
+    }
+    return COMMAND_TIMEOUT;
+}
+
+void RST::getWatchdogStats(unsigned long *pnEvents, unsigned long &nRecovered, double &dTotalRecoveryMs, double &dMaxRecoveryMs)
+{
+    for(int i = 0; i < WATCHDOG_EVENT_COUNT; i++)
+        pnEvents[i] = m_nWatchdogEvents[i];
+    nRecovered = m_nWatchdogRecovered;
+    dTotalRecoveryMs = m_nWatchdogRecoveryUs / 1000.0;
+    dMaxRecoveryMs = m_nWatchdogMaxRecoveryUs / 1000.0;
+}
 
-int RST::readResponse(std::string &sResp, int nTimeout)
+int RST::readResponse(std::string &sResp, int nTimeout, std::chrono::steady_clock::time_point tDeadline)
 {
     int nErr = PLUGIN_OK;
     char pszBuf[SERIAL_BUFFER_SIZE];
@@ -226,6 +854,15 @@ int RST::readResponse(std::string &sResp, int nTimeout)
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readResponse] nBytesWaiting nErr : " << nErr << std::endl;
         m_sLogFile.flush();
 #endif
+        // bytes trickling in reset the timeout, the deadline doesn't move
+        if(std::chrono::steady_clock::now() >= tDeadline) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readResponse] deadline reached after " << ulTotalBytesRead << " bytes" << std::endl;
+            m_sLogFile.flush();
+#endif
+            nErr = COMMAND_TIMEOUT;
+            break;
+        }
         if(!nBytesWaiting) {
             nbTimeouts += MAX_READ_WAIT_TIMEOUT;
             if(nbTimeouts >= nTimeout) {
@@ -255,7 +892,7 @@ int RST::readResponse(std::string &sResp, int nTimeout)
             return nErr;
         }
 
-        if (ulBytesRead != nBytesWaiting) { // timeout
+        if (ulBytesRead != (unsigned long)nBytesWaiting) { // timeout
 #if defined PLUGIN_DEBUG
             m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readResponse] rreadFile Timeout Error." << std::endl;
             m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readResponse] readFile nBytesWaiting : " << nBytesWaiting << std::endl;
@@ -267,6 +904,7 @@ int RST::readResponse(std::string &sResp, int nTimeout)
         ulTotalBytesRead += ulBytesRead;
         pszBufPtr+=ulBytesRead;
     }  while (ulTotalBytesRead < SERIAL_BUFFER_SIZE  && *(pszBufPtr-1) != '#');
+    m_Metrics.addBytesReceived(ulTotalBytesRead);
 
     if(!ulTotalBytesRead) {
         nErr = COMMAND_TIMEOUT; // we didn't get an answer.. so timeout
@@ -287,32 +925,813 @@ int RST::readResponse(std::string &sResp, int nTimeout)
     return nErr;
 }
 
-int RST::getFirmwareVersion(std::string &sFirmware)
+int RST::sendCommandBurst(const std::vector<std::string> &svCmds, std::vector<std::string> &svResps, int nTimeout)
 {
     int nErr = PLUGIN_OK;
-    std::string sResp;
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getFirmwareVersion] Called." << std::endl;
-    m_sLogFile.flush();
-#endif
 
-    nErr = sendCommand(":AV#", sResp);
-    if(sResp.size() == 0)
-        return ERR_CMDFAILED;
-    sFirmware.assign(sResp);
+    if(isLinkBreakerOpen()) {
+        svResps.clear();
+        return COMMAND_TIMEOUT;
+    }
+
+    // a forwarded burst can carry anything
+    invalidateQueryFlights();
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    nErr = sendCommandBurstOnWire(svCmds, svResps, nTimeout);
+    invalidateQueryFlights();
+    updateLinkBreaker(nErr);
+
+    int32_t nLatencyUs = (int32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tStart).count();
+    // the commands that got their answer before it went wrong are fine
+    for(size_t i = 0; i < svCmds.size(); i++) {
+        int nCode = REC_CMD_BURST | (i < svResps.size() ? REC_CMD_OK : (nErr == COMMAND_TIMEOUT ? REC_CMD_TIMEOUT : REC_CMD_ERROR));
+        m_Metrics.addCommand(svCmds[i], nCode, nLatencyUs);
+        m_Recorder.recordCommand(svCmds[i], nCode, nLatencyUs);
+    }
     return nErr;
 }
 
-#pragma mark - Mount Coordinates
-int RST::getRaAndDec(double &dRa, double &dDec)
+int RST::sendCommandBurstOnWire(const std::vector<std::string> &svCmds, std::vector<std::string> &svResps, int nTimeout)
 {
     int nErr = PLUGIN_OK;
+    unsigned long  ulBytesWrite;
+    int nNotices = 0;
+    std::string sCmds;
     std::string sResp;
-
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] Called." << std::endl;
+    std::vector<std::string> vFieldsData;
+    std::chrono::steady_clock::time_point tDeadline;
+    int nDeadlineEvent;
+    std::unique_lock<std::recursive_mutex> lock(m_DevMutex, std::defer_lock);
+
+    svResps.clear();
+    for(const std::string &sCmd : svCmds)
+        sCmds += sCmd;
+
+    lockWire(lock);
+    waitCommandPacing(lock);
+    tDeadline = commandDeadline(nDeadlineEvent);
+    if(std::chrono::steady_clock::now() >= tDeadline) {
+        m_nWatchdogEvents[WATCHDOG_API_DEADLINE]++;
+        return ERR_CMDFAILED;
+    }
+    if(m_bSlewTimed)
+        peekSlewDone();
+    m_pSerx->purgeTxRx();
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommandBurst] sending '" << sCmds << "'" << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    {
+        std::lock_guard<std::mutex> txLock(m_TxMutex);
+        nErr = m_pSerx->writeFile((void *)sCmds.c_str(), sCmds.size(), ulBytesWrite);
+        m_pSerx->flushTx();
+    }
+    m_Metrics.addBytesSent(ulBytesWrite);
+    if(nErr)
+        return nErr;
+
+    // the responses can come in any number of reads, split them on #
+    while(svResps.size() < svCmds.size()) {
+        nErr = readResponse(sResp, nTimeout, tDeadline);
+        if(nErr) {
+#if defined PLUGIN_DEBUG
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommandBurst] error " << nErr << " after " << svResps.size() << " of " << svCmds.size() << " responses" << std::endl;
+            m_sLogFile.flush();
+#endif
+            if(std::chrono::steady_clock::now() >= tDeadline)
+                return watchdogRecover(nDeadlineEvent);
+            return nErr;
+        }
+        if(parseFields(sResp, vFieldsData, '#'))
+            continue;
+        for(const std::string &sField : vFieldsData) {
+            // drop the async notifications (slew and homing done)
+            if(sField.find("MM0") != std::string::npos || sField.find("CHO") != std::string::npos) {
+                if(sField.find("MM0") != std::string::npos)
+                    noticeSlewDone();
+                nNotices++;
+            }
+            else if(sField.size())
+                svResps.push_back(sField);
+        }
+        if(nNotices > WATCHDOG_MAX_NOTICES)
+            return watchdogRecover(WATCHDOG_NOTICE_FLOOD);
+    }
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
+    for(const std::string &sField : svResps)
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendCommandBurst] response : '" << sField << "'" << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    return nErr;
+}
+
+int RST::writeCommandBurst(const std::vector<std::string> &svCmds)
+{
+    int nErr = PLUGIN_OK;
+    unsigned long  ulBytesWrite;
+    std::string sCmds;
+    std::unique_lock<std::recursive_mutex> lock(m_DevMutex, std::defer_lock);
+
+    if(svCmds.empty())
+        return nErr;
+
+    for(const std::string &sCmd : svCmds)
+        sCmds += sCmd;
+
+    lockWire(lock);
+    waitCommandPacing(lock);
+    m_pSerx->purgeTxRx();
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [writeCommandBurst] sending '" << sCmds << "'" << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    std::lock_guard<std::mutex> txLock(m_TxMutex);
+    nErr = m_pSerx->writeFile((void *)sCmds.c_str(), sCmds.size(), ulBytesWrite);
+    m_pSerx->flushTx();
+    m_Metrics.addBytesSent(ulBytesWrite);
+    return nErr;
+}
+
+int RST::writeCommandNow(const std::string &sCmd)
+{
+    int nErr = PLUGIN_OK;
+    unsigned long  ulBytesWrite;
+    std::lock_guard<std::mutex> txLock(m_TxMutex);
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [writeCommandNow] sending '" << sCmd << "'" << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    // whoever holds the I/O lock might be waiting for an answer, the mount doesn't answer this one so it won't get in the way.
+    nErr = m_pSerx->writeFile((void *)sCmd.c_str(), sCmd.size(), ulBytesWrite);
+    m_pSerx->flushTx();
+    m_Metrics.addBytesSent(ulBytesWrite);
+    return nErr;
+}
+
+void RST::setCommandPacing(int nMilliSeconds)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_DevMutex);
+
+    m_commandDelayTimer.Reset();
+    m_dCommandPacing = nMilliSeconds / 1000.0;
+}
+
+void RST::waitCommandPacing(std::unique_lock<std::recursive_mutex> &wireLock)
+{
+    double dRemaining;
+
+    // someone else can use the link while we wait (they'll wait for the pacing too), so check again once we have the lock back
+    while(m_dCommandPacing > 0.0) {
+        dRemaining = m_dCommandPacing - m_commandDelayTimer.GetElapsedSeconds();
+        if(dRemaining <= 0.0) {
+            m_dCommandPacing = 0.0;
+            break;
+        }
+        wireLock.unlock();
+        std::this_thread::sleep_for(std::chrono::microseconds(int(dRemaining * 1000000.0)));
+        lockWire(wireLock);
+    }
+}
+
+void RST::lockWire(std::unique_lock<std::recursive_mutex> &wireLock)
+{
+    std::chrono::steady_clock::time_point tStart;
+    unsigned long nWaitUs;
+    unsigned long nMaxWaitUs;
+
+    m_nWireLocks++;
+    if(wireLock.try_lock())
+        return;
+
+    tStart = std::chrono::steady_clock::now();
+    wireLock.lock();
+    nWaitUs = (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tStart).count();
+    m_nWireLockContended++;
+    m_nWireLockWaitUs += nWaitUs;
+    nMaxWaitUs = m_nWireLockMaxWaitUs;
+    while(nWaitUs > nMaxWaitUs && !m_nWireLockMaxWaitUs.compare_exchange_weak(nMaxWaitUs, nWaitUs))
+        ;
+}
+
+void RST::getWireLockStats(unsigned long &nLocks, unsigned long &nContended, double &dTotalWaitMs, double &dMaxWaitMs)
+{
+    nLocks = m_nWireLocks;
+    nContended = m_nWireLockContended;
+    dTotalWaitMs = m_nWireLockWaitUs / 1000.0;
+    dMaxWaitMs = m_nWireLockMaxWaitUs / 1000.0;
+}
+
+#pragma mark - write shadow
+void RST::forgetMountShadow()
+{
+    int i;
+
+    m_nOpenLoopRate = -1;
+    m_nShadowTracking = -1;
+    m_nShadowTrackingMode = STATUS_TRACKING_UNKNOWN;
+    for(i = 0; i < PLUGIN_NB_SLEW_SPEEDS; i++)
+        m_nShadowSpeeds[i] = -1;
+    m_dShadowGuideSpeed = -1.0;
+    m_sShadowTargetRa.clear();
+    m_sShadowTargetDec.clear();
+    m_bShadowValid = true;
+}
+
+// the watchdog doesn't hold the operation lock, writers (who do) forget the shadow for it
+void RST::checkMountShadow()
+{
+    if(!m_bShadowValid)
+        forgetMountShadow();
+}
+
+void RST::shadowSkipped(int nSleepSavedMs)
+{
+    m_nShadowSkipped++;
+    m_nShadowSleepSavedMs += nSleepSavedMs;
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [shadowSkipped] write not sent, the mount already has it (" << m_nShadowSkipped << " so far)" << std::endl;
+    m_sLogFile.flush();
+#endif
+}
+
+void RST::getWriteShadowStats(unsigned long &nSkipped, double &dSleepSavedMs)
+{
+    nSkipped = m_nShadowSkipped;
+    dSleepSavedMs = m_nShadowSleepSavedMs;
+}
+
+#pragma mark - deferred initialization
+void RST::startWarmup()
+{
+    m_nWarmupDone = 0;
+    m_bWarmHomingValid = false;
+    m_bAlignOffsetValid = false;
+    for(std::string &sSpeed : m_sSpeedResps)
+        sSpeed.clear();
+
+    m_bWarmupRunning = true;
+    m_WarmupThread = std::thread(&RST::warmupThread, this);
+}
+
+void RST::stopWarmup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_WarmupMutex);
+        m_bWarmupRunning = false;
+    }
+    m_WarmupCond.notify_all();
+    if(m_WarmupThread.joinable())
+        m_WarmupThread.join();
+}
+
+void RST::setWarmupDone(int nItem)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_WarmupMutex);
+        m_nWarmupDone |= nItem;
+    }
+    m_WarmupCond.notify_all();
+}
+
+bool RST::waitWarmup(int nItem)
+{
+    std::unique_lock<std::mutex> lock(m_WarmupMutex);
+
+    // nothing running (not connected or warm-up aborted), the caller asks the mount itself.
+    if(!m_bWarmupRunning && !(m_nWarmupDone & nItem))
+        return false;
+
+    m_WarmupCond.wait_for(lock, std::chrono::milliseconds(WARMUP_WAIT_TIMEOUT), [this, nItem] {
+        return (m_nWarmupDone & nItem) || !m_bWarmupRunning;
+    });
+    return (m_nWarmupDone & nItem) != 0;
+}
+
+void RST::warmupThread()
+{
+    int nErr = PLUGIN_OK;
+    std::vector<std::string> svCmds = {":AH#", ":CU0#", ":CU1#", ":CU2#", ":CU3#"};
+    std::vector<std::string> svResps;
+    bool bAlignOffset;
+    int i;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [warmupThread] started." << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    // everything that doesn't need a write in one pipelined burst. :CG3# is optional, last so a firmware
+    // that doesn't answer it doesn't cost us the others.
+    bAlignOffset = !m_Caps.isUnsupported(CAP_ALIGN_OFFSET);
+    if(bAlignOffset)
+        svCmds.push_back(":CG3#");
+    nErr = sendCommandBurst(svCmds, svResps);
+    if(bAlignOffset && nErr == COMMAND_TIMEOUT && svResps.size() == svCmds.size() - 1 && m_Caps.get(CAP_ALIGN_OFFSET) == CAP_UNKNOWN) {
+        if(confirmUnsupported(CAP_ALIGN_OFFSET) == COMMAND_NOT_SUPPORTED)
+            nErr = PLUGIN_OK;
+    }
+    if(!nErr && svResps.size() >= 1 + PLUGIN_NB_SLEW_SPEEDS) {
+        {
+            std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+            m_bIsHomed = (rstReplyValue(CMD_AH, svResps[0])[0] == '0');
+            m_bWarmHomingValid = true;
+            for(i = 0; i < PLUGIN_NB_SLEW_SPEEDS; i++)
+                m_sSpeedResps[i] = svResps[1+i];
+            try {
+                if(svResps.size() > 1 + PLUGIN_NB_SLEW_SPEEDS && rstReplyValue(CMD_CG3, svResps.back()).size()) {
+                    m_dAlignOffset = std::stod(rstReplyValue(CMD_CG3, svResps.back()));
+                    m_bAlignOffsetValid = true;
+                    m_Caps.set(CAP_ALIGN_OFFSET, CAP_SUPPORTED);
+                }
+            }
+            catch(const std::exception& e) {
+#if defined PLUGIN_DEBUG
+                m_sLogFile << "["<<getTimeStamp()<<"]"<< " [warmupThread] :CG3# conversion exception : " << e.what() << std::endl;
+                m_sLogFile.flush();
+#endif
+            }
+        }
+    }
+#if defined PLUGIN_DEBUG
+    else {
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [warmupThread] status burst failed, error " << nErr << ", the first callers will ask the mount." << std::endl;
+        m_sLogFile.flush();
+    }
+#endif
+    setWarmupDone(WARMUP_HOMING | WARMUP_ALIGN_OFFSET | WARMUP_SPEEDS);
+
+    if(m_bWarmupRunning && m_bSyncLocationDataConnect) {
+        nErr = syncSiteDataOnConnect(m_pHost->longitude(),
+                    m_pHost->latitude(),
+                    m_pHost->timeZone());
+#if defined PLUGIN_DEBUG
+        if(nErr) {
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [warmupThread] site data sync error " << nErr << std::endl;
+            m_sLogFile.flush();
+        }
+#endif
+    }
+    setWarmupDone(WARMUP_SITE);
+
+    // whatever the stored table and the bursts didn't tell us, nobody waits on this
+    if(m_bWarmupRunning)
+        probeCapabilities();
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [warmupThread] done " << std::fixed << std::setprecision(3) << m_ConnectTimer.GetElapsedSeconds() << " s after connect." << std::endl;
     m_sLogFile.flush();
 #endif
+}
+
+#pragma mark - capabilities
+int RST::sendOptionalCommand(int nCap, std::string &sResp)
+{
+    int nErr;
+
+    sResp.clear();
+    if(m_Caps.isUnsupported(nCap)) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendOptionalCommand] " << RSTCapabilities::command(nCap) << " not supported by this firmware, not sent." << std::endl;
+        m_sLogFile.flush();
+#endif
+        return COMMAND_NOT_SUPPORTED;
+    }
+
+    nErr = sendCapabilityCommand(nCap, sResp);
+    // a command that was answered once is there, a timeout on it is the link's. Otherwise ask before the retry,
+    // so an old firmware costs one timeout and the answer to :AV# keeps the breaker closed.
+    if(nErr == COMMAND_TIMEOUT && sResp.empty() && m_Caps.get(nCap) == CAP_UNKNOWN) {
+        nErr = confirmUnsupported(nCap);
+        if(nErr == COMMAND_NOT_SUPPORTED)
+            return nErr;
+        nErr = COMMAND_TIMEOUT;
+    }
+    if(nErr == COMMAND_TIMEOUT) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(COMMAND_RETRY_DELAY)); // need to give time to the mount to process the command
+        nErr = sendCapabilityCommand(nCap, sResp);
+    }
+    if(!nErr && sResp.size())
+        m_Caps.set(nCap, CAP_SUPPORTED);
+    return nErr;
+}
+
+// sendOptionalCommand has its own retry
+int RST::sendCapabilityCommand(int nCap, std::string &sResp)
+{
+    switch(nCap) {
+        case CAP_ALIGN_OFFSET :
+            return sendCommandOnce<CMD_CG3>(commandString<CMD_CG3>(), sResp);
+        case CAP_PIER_SIDE :
+            return sendCommandOnce<CMD_CY>(commandString<CMD_CY>(), sResp);
+        case CAP_VOLTAGE :
+            return sendCommandOnce<CMD_Cv>(commandString<CMD_Cv>(), sResp);
+        default :
+            sResp.clear();
+            return COMMAND_NOT_SUPPORTED;
+    }
+}
+
+int RST::confirmUnsupported(int nCap)
+{
+    int nErr;
+    std::string sResp;
+
+    // a late answer to the command would show up here instead
+    nErr = sendCommand<CMD_AV>(sResp);
+    if(nErr || sResp.compare(0, 2, "AV") != 0)
+        return nErr?nErr:COMMAND_TIMEOUT;
+
+    m_Caps.set(nCap, CAP_UNSUPPORTED);
+#if defined PLUGIN_DEBUG
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [confirmUnsupported] " << RSTCapabilities::command(nCap) << " not answered by firmware " << sResp << ", it won't be sent again." << std::endl;
+    m_sLogFile.flush();
+#endif
+    return COMMAND_NOT_SUPPORTED;
+}
+
+void RST::probeCapabilities()
+{
+    int i;
+    std::string sResp;
+
+    for(i = 0; i < CAP_COUNT && m_bWarmupRunning; i++) {
+        if(m_Caps.get(i) == CAP_UNKNOWN)
+            sendOptionalCommand(i, sResp);
+    }
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_Caps.describe(sResp);
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [probeCapabilities] " << sResp << std::endl;
+    m_sLogFile.flush();
+#endif
+}
+
+#pragma mark - telemetry
+// The settings dialog shows the mount time, date, voltage and site. It used to ask the mount on every
+// timer tick, now it reads what this thread samples every m_nTelemetryInterval seconds.
+void RST::startTelemetry()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+        m_bTelemetryValid = false;
+        m_bTelemetrySiteValid = false;
+        m_bTelemetrySiteStale = true;
+        m_bTelemetryRefresh = false;
+    }
+    m_bTelemetryRunning = true;
+    m_TelemetryThread = std::thread(&RST::telemetryThread, this);
+}
+
+void RST::stopTelemetry()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+        m_bTelemetryRunning = false;
+    }
+    m_TelemetryCond.notify_all();
+    if(m_TelemetryThread.joinable())
+        m_TelemetryThread.join();
+}
+
+void RST::setTelemetryInterval(int nSeconds)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+        m_nTelemetryInterval = std::max(nSeconds, TELEMETRY_MIN_INTERVAL);
+    }
+    m_TelemetryCond.notify_all();
+}
+
+void RST::refreshTelemetry(bool bSite)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+        m_bTelemetryRefresh = true;
+        if(bSite)
+            m_bTelemetrySiteStale = true;
+    }
+    m_TelemetryCond.notify_all();
+}
+
+void RST::telemetryThread()
+{
+    bool bSite;
+
+    // the warm-up burst and the site sync go first
+    waitWarmup(WARMUP_SITE);
+
+    std::unique_lock<std::mutex> lock(m_TelemetryMutex);
+    while(m_bTelemetryRunning) {
+        // the slew poll needs the link more than the settings dialog does
+        if(m_bSlewing) {
+            m_TelemetryCond.wait_for(lock, std::chrono::milliseconds(TELEMETRY_SLEW_RETRY));
+            continue;
+        }
+        m_bTelemetryRefresh = false;
+        bSite = m_bTelemetrySiteStale;
+        lock.unlock();
+        sampleTelemetry(bSite);
+        lock.lock();
+        m_TelemetryCond.wait_for(lock, std::chrono::seconds(m_nTelemetryInterval), [this] {
+            return !m_bTelemetryRunning || m_bTelemetryRefresh;
+        });
+    }
+}
+
+int RST::sampleTelemetry(bool bSite)
+{
+    int nErr = PLUGIN_OK;
+    std::vector<std::string> svCmds = {":GL#", ":GC#"};
+    std::vector<std::string> svResps;
+    int nMountSeconds;
+    double dVolts = 0.0;
+    bool bVoltage;
+    CStopWatch sampleTimer;
+
+    if(bSite) {
+        svCmds.push_back(":Gg#");
+        svCmds.push_back(":Gt#");
+        svCmds.push_back(":GG#");
+    }
+    // optional, last so a firmware that doesn't answer it doesn't cost us the others
+    bVoltage = !m_Caps.isUnsupported(CAP_VOLTAGE);
+    if(bVoltage)
+        svCmds.push_back(":Cv#");
+
+    nErr = sendCommandBurst(svCmds, svResps);
+    if(bVoltage && nErr == COMMAND_TIMEOUT && svResps.size() == svCmds.size() - 1 && m_Caps.get(CAP_VOLTAGE) == CAP_UNKNOWN) {
+        if(confirmUnsupported(CAP_VOLTAGE) == COMMAND_NOT_SUPPORTED) {
+            svCmds.pop_back();
+            bVoltage = false;
+            nErr = PLUGIN_OK;
+        }
+    }
+    if(nErr || svResps.size() < svCmds.size()) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sampleTelemetry] burst failed, error " << nErr << std::endl;
+        m_sLogFile.flush();
+#endif
+        return nErr?nErr:ERR_CMDFAILED;
+    }
+    for(const std::string &sResp : svResps) {
+        if(sResp.size() < 4)
+            return ERR_CMDFAILED;
+    }
+    if(parseTimeHHMMSS(rstReplyValue(CMD_GL, svResps[0]), nMountSeconds))
+        return ERR_PARSE;
+    if(bVoltage) {
+        try {
+            dVolts = std::stod(rstReplyValue(CMD_Cv, svResps.back()));
+        }
+        catch(const std::exception& e) {
+#if defined PLUGIN_DEBUG
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sampleTelemetry] :Cv# conversion exception : " << e.what() << std::endl;
+            m_sLogFile.flush();
+#endif
+            return ERR_PARSE;
+        }
+        m_Caps.set(CAP_VOLTAGE, CAP_SUPPORTED);
+        publishVoltage(dVolts);
+    }
+
+    std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+    // we don't know where in the second the mount was, assume the middle, and it answered half a round trip ago.
+    m_dTelemetrySeconds = nMountSeconds + 0.5 + sampleTimer.GetElapsedSeconds() / 2.0;
+    m_TelemetryTimer.Reset();
+    m_sTelemetryDate.assign(rstReplyValue(CMD_GC, svResps[1]));
+    m_dTelemetryVolts = dVolts;
+    m_bTelemetryValid = true;
+    if(bSite) {
+        m_sTelemetryLongitude.assign(rstReplyValue(CMD_Gg, svResps[2]));
+        m_sTelemetryLatitude.assign(rstReplyValue(CMD_Gt, svResps[3]));
+        m_sTelemetryTimeZone.assign(rstReplyValue(CMD_GG, svResps[4]));
+        m_bTelemetrySiteValid = true;
+        m_bTelemetrySiteStale = false;
+    }
+    return PLUGIN_OK;
+}
+
+int RST::getTelemetry(std::string &sDate, std::string &sTime, double &dVolts)
+{
+    int nSeconds;
+    std::stringstream ssTmp;
+    std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+
+    if(!m_bTelemetryValid)
+        return ERR_CMDFAILED;
+
+    nSeconds = int(m_dTelemetrySeconds + m_TelemetryTimer.GetElapsedSeconds());
+    if(nSeconds >= 86400) {
+        // past midnight, the date we have is yesterday's
+        nSeconds %= 86400;
+        if(!m_bTelemetryRefresh) {
+            m_bTelemetryRefresh = true;
+            m_TelemetryCond.notify_all();
+        }
+    }
+    ssTmp << std::setfill('0') << std::setw(2) << nSeconds / 3600 << ":" << std::setfill('0') << std::setw(2) << (nSeconds % 3600) / 60 << ":" << std::setfill('0') << std::setw(2) << nSeconds % 60;
+    sTime.assign(ssTmp.str());
+    sDate.assign(m_sTelemetryDate);
+    dVolts = m_dTelemetryVolts;
+    return PLUGIN_OK;
+}
+
+int RST::getTelemetrySite(std::string &sLongitude, std::string &sLatitude, std::string &sTimeZone)
+{
+    std::lock_guard<std::mutex> lock(m_TelemetryMutex);
+
+    if(!m_bTelemetrySiteValid)
+        return ERR_CMDFAILED;
+    sLongitude.assign(m_sTelemetryLongitude);
+    sLatitude.assign(m_sTelemetryLatitude);
+    sTimeZone.assign(m_sTelemetryTimeZone);
+    return PLUGIN_OK;
+}
+
+#pragma mark - link circuit breaker
+bool RST::isLinkBreakerOpen()
+{
+    return m_nBreakerState == BREAKER_OPEN;
+}
+
+void RST::updateLinkBreaker(int nErr)
+{
+    if(nErr == PLUGIN_OK) {
+        m_nConsecutiveTimeouts = 0;
+        if(m_nBreakerState == BREAKER_HALF_OPEN) {
+            m_nBreakerState = BREAKER_CLOSED;
+            m_Recorder.record(REC_BREAKER, BREAKER_CLOSED, 0);
+#if defined PLUGIN_DEBUG
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [updateLinkBreaker] link is back, breaker closed." << std::endl;
+            m_sLogFile.flush();
+#endif
+        }
+        return;
+    }
+
+    if(nErr != COMMAND_TIMEOUT)
+        return;
+
+    m_nConsecutiveTimeouts++;
+    if(m_nBreakerState == BREAKER_HALF_OPEN || (m_nBreakerState == BREAKER_CLOSED && m_nConsecutiveTimeouts >= BREAKER_TRIP_TIMEOUTS)) {
+        if(m_nBreakerState == BREAKER_CLOSED)
+            m_nBreakerTripCount++;
+        m_nBreakerState = BREAKER_OPEN;
+        m_Recorder.record(REC_BREAKER, BREAKER_OPEN, m_nConsecutiveTimeouts);
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [updateLinkBreaker] " << m_nConsecutiveTimeouts << " consecutive timeouts, breaker open (trip " << m_nBreakerTripCount << ")." << std::endl;
+        m_sLogFile.flush();
+#endif
+        startLinkProbe();
+    }
+}
+
+void RST::startLinkProbe()
+{
+    std::lock_guard<std::mutex> lock(m_LinkProbeMutex);
+
+    // a running probe picks up the new state on its next pass
+    if(m_bLinkProbeRunning)
+        return;
+
+    // the previous probe is done (it cleared m_bLinkProbeRunning with the lock held), this doesn't wait.
+    if(m_LinkProbeThread.joinable())
+        m_LinkProbeThread.join();
+    m_bLinkProbeRunning = true;
+    m_LinkProbeThread = std::thread(&RST::linkProbeThread, this);
+}
+
+void RST::stopLinkProbe()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_LinkProbeMutex);
+        m_bLinkProbeRunning = false;
+    }
+    m_LinkProbeCond.notify_all();
+    if(m_LinkProbeThread.joinable())
+        m_LinkProbeThread.join();
+
+    m_nBreakerState = BREAKER_CLOSED;
+    m_nConsecutiveTimeouts = 0;
+}
+
+void RST::linkProbeThread()
+{
+    int nErr;
+    std::string sResp;
+    int nFailedProbes = 0;
+    std::unique_lock<std::mutex> lock(m_LinkProbeMutex);
+
+    while(m_bLinkProbeRunning) {
+        m_LinkProbeCond.wait_for(lock, std::chrono::milliseconds(BREAKER_PROBE_INTERVAL));
+        if(!m_bLinkProbeRunning)
+            break;
+        if(m_nBreakerState == BREAKER_CLOSED) { // a normal command already got through
+            m_bLinkProbeRunning = false;
+            break;
+        }
+        lock.unlock();
+        // the transport went away or doesn't recover by itself, reopen it.
+        if(!m_pSerx->isConnected() || nFailedProbes >= BREAKER_RESUME_PROBES) {
+            nFailedProbes = 0;
+            nErr = resumeLink();
+            lock.lock();
+            if(!nErr) {
+                m_bLinkProbeRunning = false;
+                break;
+            }
+            continue;
+        }
+        // cheap command with a short answer, straight to the wire as the breaker would refuse it.
+        nErr = sendCommandOnWire(":AT#", sResp, MAX_TIMEOUT);
+        lock.lock();
+        if(!m_bLinkProbeRunning)
+            break;
+
+        if(nErr || sResp.size() < 4) {
+            m_nBreakerState = BREAKER_OPEN;
+            nFailedProbes++;
+            continue;
+        }
+        nFailedProbes = 0;
+        // the mount answered, let the normal traffic try again while we check it's still the mount we knew.
+        if(m_nBreakerState == BREAKER_OPEN) {
+            m_nBreakerState = BREAKER_HALF_OPEN;
+            m_Recorder.record(REC_BREAKER, BREAKER_HALF_OPEN, 0);
+#if defined PLUGIN_DEBUG
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [linkProbeThread] mount answered, breaker half open." << std::endl;
+            m_sLogFile.flush();
+#endif
+        }
+        lock.unlock();
+        nErr = resumeSession();  // closes the breaker on success
+        lock.lock();
+        if(!m_bLinkProbeRunning)
+            break;
+        if(nErr)
+            m_nBreakerState = BREAKER_OPEN;
+        if(m_nBreakerState == BREAKER_CLOSED) {
+            m_bLinkProbeRunning = false;
+            break;
+        }
+    }
+}
+
+void RST::getLinkBreakerStatus(int &nState, int &nTripCount, int &nConsecutiveTimeouts)
+{
+    nState = m_nBreakerState;
+    nTripCount = m_nBreakerTripCount;
+    nConsecutiveTimeouts = m_nConsecutiveTimeouts;
+}
+
+int RST::getFirmwareVersion(std::string &sFirmware)
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getFirmwareVersion] Called." << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    // Connect (or a resume) already asked
+    if(m_sFirmwareVersion.size()) {
+        sFirmware.assign(m_sFirmwareVersion);
+        return nErr;
+    }
+
+    nErr = sendCommand<CMD_AV>(sResp);
+    if(sResp.size() == 0)
+        return ERR_CMDFAILED;
+    sFirmware.assign(sResp);
+    m_sFirmwareVersion.assign(sResp);
+    return nErr;
+}
+
+#pragma mark - Mount Coordinates
+int RST::getRaAndDec(double &dRa, double &dDec)
+{
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] Called." << std::endl;
+    m_sLogFile.flush();
+#endif
+    if(m_bIsParked)
+        m_Metrics.addPoll(POLL_STATE_PARKED);
+    else if(m_bSlewing)
+        m_Metrics.addPoll(POLL_STATE_SLEWING);
+    else
+        m_Metrics.addPoll(m_nTrackingState > STATUS_TRACKING_OFF ? POLL_STATE_TRACKING : POLL_STATE_IDLE);
+
     if(m_bUnparking) {
         dRa = m_dRa;
         dDec = m_dDec;
@@ -320,19 +1739,15 @@ int RST::getRaAndDec(double &dRa, double &dDec)
     }
 
     // get RA
-    nErr = sendCommand(":GR#", sResp);
+    nErr = sendCommand<CMD_GR>(sResp);   // retried once
     if(nErr) {
-        // retry
-        nErr = sendCommand(":GR#", sResp);
-        if(nErr) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GR# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GR# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            dRa = m_dRa;
-            dDec = m_dDec;
-            return PLUGIN_OK;
-        }
+        dRa = m_dRa;
+        dDec = m_dDec;
+        return PLUGIN_OK;
     }
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
@@ -342,10 +1757,10 @@ int RST::getRaAndDec(double &dRa, double &dDec)
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
 
-    nErr = convertHHMMSStToRa(sResp.substr(3), dRa);
+    nErr = convertHHMMSStToRa(rstReplyValue(CMD_GR, sResp), dRa);
     if(nErr) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GR# convertHHMMSStToRa error : " << nErr << " , sResp.substr(3) : " << sResp.substr(3) << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GR# convertHHMMSStToRa error : " << nErr << " , sResp : " << sResp << std::endl;
         m_sLogFile.flush();
 #endif
         dRa = m_dRa;
@@ -358,29 +1773,24 @@ int RST::getRaAndDec(double &dRa, double &dDec)
 #endif
     m_dRa = dRa;
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
     // get DEC
-    nErr = sendCommand(":GD#", sResp);
+    nErr = sendCommand<CMD_GD>(sResp);   // retried once
     if(nErr) {
-        // retry
-        nErr = sendCommand(":GD#", sResp);
-        if(nErr) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GD# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GD# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            dRa = m_dRa;
-            dDec = m_dDec;
-            return PLUGIN_OK;
-        }
+        dRa = m_dRa;
+        dDec = m_dDec;
+        return PLUGIN_OK;
     }
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
 
-    nErr = convertDDMMSSToDecDeg(sResp.substr(3), dDec);
+    nErr = convertDDMMSSToDecDeg(rstReplyValue(CMD_GD, sResp), dDec);
     if(nErr) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GD# convertDDMMSSToDecDeg error : " << nErr << " , sResp.substr(3) : " << sResp.substr(3) << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] :GD# convertDDMMSSToDecDeg error : " << nErr << " , sResp : " << sResp << std::endl;
         m_sLogFile.flush();
 #endif
         dRa = m_dRa;
@@ -389,16 +1799,31 @@ int RST::getRaAndDec(double &dRa, double &dDec)
     }
 
     m_dDec = dDec;
+    publishPosition(dRa, dDec);
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] dDec : " << std::fixed << std::setprecision(12) << dDec << std::endl;
     m_sLogFile.flush();
 #endif
 
+    if(!m_bFirstRaDecDone) {
+        m_bFirstRaDecDone = true;
+        m_dTimeToFirstRaDec = m_ConnectTimer.GetElapsedSeconds();
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getRaAndDec] first position " << std::fixed << std::setprecision(3) << m_dTimeToFirstRaDec << " s after connect." << std::endl;
+        m_sLogFile.flush();
+#endif
+    }
+
+    // TheSkyX polls this all the time, piggyback the occasional mount clock check on it.
+    if(!m_bSlewing)
+        checkMountClockDrift();
+
     return nErr;
 }
 
 int RST::getAltAndAz(double &dAlt, double &dAz)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     std::string sResp;
 
@@ -408,19 +1833,15 @@ int RST::getAltAndAz(double &dAlt, double &dAz)
 #endif
 
     // get Az
-    nErr = sendCommand(":GZ#", sResp);
+    nErr = sendCommand<CMD_GZ>(sResp);   // retried once
     if(nErr) {
-        // retry
-        nErr = sendCommand(":GZ#", sResp);
-        if(nErr) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GZ# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GZ# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            dAlt = m_dAlt;
-            dAz = m_dAz;
-            return PLUGIN_OK;
-        }
+        dAlt = m_dAlt;
+        dAz = m_dAz;
+        return PLUGIN_OK;
     }
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
@@ -430,10 +1851,10 @@ int RST::getAltAndAz(double &dAlt, double &dAz)
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
 
-    nErr = convertDDMMSSToDecDeg(sResp.substr(3), dAz);
+    nErr = convertDDMMSSToDecDeg(rstReplyValue(CMD_GZ, sResp), dAz);
     if(nErr) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GZ# convertDDMMSSToDecDeg error : " << nErr << " , sResp.substr(3) : " << sResp.substr(3) << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GZ# convertDDMMSSToDecDeg error : " << nErr << " , sResp : " << sResp << std::endl;
         m_sLogFile.flush();
 #endif
         dAlt = m_dAlt;
@@ -447,29 +1868,23 @@ int RST::getAltAndAz(double &dAlt, double &dAz)
     m_sLogFile.flush();
 #endif
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
-
     // get Alt
-    nErr = sendCommand(":GA#", sResp);
+    nErr = sendCommand<CMD_GA>(sResp);   // retried once
     if(nErr) {
-        // retry
-        nErr = sendCommand(":GA#", sResp);
-        if(nErr) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GA# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GA# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            dAlt = m_dAlt;
-            dAz = m_dAz;
-            return PLUGIN_OK;
-        }
+        dAlt = m_dAlt;
+        dAz = m_dAz;
+        return PLUGIN_OK;
     }
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
-    nErr = convertDDMMSSToDecDeg(sResp.substr(3), dAlt);
+    nErr = convertDDMMSSToDecDeg(rstReplyValue(CMD_GA, sResp), dAlt);
     if(nErr) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GA# convertDDMMSSToDecDeg error : " << nErr << " , sResp.substr(3) : " << sResp.substr(3) << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] :GA# convertDDMMSSToDecDeg error : " << nErr << " , sResp : " << sResp << std::endl;
         m_sLogFile.flush();
 #endif
         dAlt = m_dAlt;
@@ -478,6 +1893,7 @@ int RST::getAltAndAz(double &dAlt, double &dAz)
     }
 
     m_dAlt = dAlt;
+    publishAltAz(dAlt, dAz);
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAltAndAz] dAlt : " << std::fixed << std::setprecision(12) << dAlt << std::endl;
     m_sLogFile.flush();
@@ -490,7 +1906,7 @@ int RST::getAltAndAz(double &dAlt, double &dAz)
 
 int RST::setTarget(double dRa, double dDec)
 {
-    int nErr;
+    int nErr = PLUGIN_OK;
     std::stringstream ssTmp;
     std::string sResp;
     std::string sTemp;
@@ -508,19 +1924,26 @@ int RST::setTarget(double dRa, double dDec)
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTarget] Converted Ra : " << sTemp << std::endl;
     m_sLogFile.flush();
 #endif
-    // set target Ra
-    ssTmp<<":Sr"<<sTemp<<"#";
-    nErr = sendCommand(ssTmp.str(), sResp, 100); // need a fast error as this command doesn't follow the usual format and doesn't end with #
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
-    if(sResp.size() && sResp.at(0)=='1') {
-        nErr = PLUGIN_OK;
-    }
-    else if(nErr) {
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    checkMountShadow();
+
+    // set target Ra, unless the mount already has it (a goto retried, a re-slew to the same object)
+    if(sTemp == m_sShadowTargetRa)
+        shadowSkipped(rstPacingMs(RSTCommands[CMD_Sr].nPacing));
+    else {
+        m_sShadowTargetRa.clear();
+        ssTmp<<":Sr"<<sTemp<<"#";
+        nErr = sendCommand<CMD_Sr>(ssTmp.str(), sResp);
+        if(!nErr && sResp.size() && sResp.at(0) != '1')
+            nErr = ERR_CMDFAILED;
+        if(nErr) {
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTarget] Error setting target Ra, response : " << sResp << std::endl;
-        m_sLogFile.flush();
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTarget] Error setting target Ra, response : " << sResp << std::endl;
+            m_sLogFile.flush();
 #endif
-        return nErr;
+            return nErr;
+        }
+        m_sShadowTargetRa.assign(sTemp);
     }
 
     // convert target dec to sDD*MM:SS.S
@@ -530,19 +1953,24 @@ int RST::setTarget(double dRa, double dDec)
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTarget] Converted Dec : " <<sTemp << std::endl;
     m_sLogFile.flush();
 #endif
-    std::stringstream().swap(ssTmp);
     // set target Dec
-    ssTmp<<":Sd"<<sTemp<<"#";
-    nErr = sendCommand(ssTmp.str(), sResp, 100); // need a fast error as this command doesn't follow the usual format and doesn't end with #
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
-    if(sResp.size() && sResp.at(0)=='1')
-        nErr = PLUGIN_OK;
-    else if(nErr) {
+    if(sTemp == m_sShadowTargetDec)
+        shadowSkipped(rstPacingMs(RSTCommands[CMD_Sd].nPacing));
+    else {
+        m_sShadowTargetDec.clear();
+        std::stringstream().swap(ssTmp);
+        ssTmp<<":Sd"<<sTemp<<"#";
+        nErr = sendCommand<CMD_Sd>(ssTmp.str(), sResp);
+        if(!nErr && sResp.size() && sResp.at(0) != '1')
+            nErr = ERR_CMDFAILED;
+        if(nErr) {
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTarget] Error setting target Dec, response : " << sResp << std::endl;
-        m_sLogFile.flush();
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTarget] Error setting target Dec, response : " << sResp << std::endl;
+            m_sLogFile.flush();
 #endif
-        return nErr;
+            return nErr;
+        }
+        m_sShadowTargetDec.assign(sTemp);
     }
 
     return nErr;
@@ -561,6 +1989,13 @@ int RST::setTargetAltAz(double dAlt, double dAz)
     m_sLogFile.flush();
 #endif
 
+    // :Sz / :Sa replace the RA/Dec target
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+        m_sShadowTargetRa.clear();
+        m_sShadowTargetDec.clear();
+    }
+
     // convert Az value to DDD*MM:SS.S
     convertDecAzToDDMMSSs(dAz, sTemp);
 
@@ -570,8 +2005,7 @@ int RST::setTargetAltAz(double dAlt, double dAz)
 #endif
     // set target Az
     ssTmp<<":Sz"<<sTemp<<"#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_Sz>(ssTmp.str(), sResp);
     if(nErr)
         return nErr;
 
@@ -586,8 +2020,7 @@ int RST::setTargetAltAz(double dAlt, double dAz)
     // set target Alt
     std::stringstream().swap(ssTmp);
     ssTmp<<":Sa"<<sTemp<<"#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_Sa>(ssTmp.str(), sResp);
     if(nErr)
         return nErr;
 
@@ -597,6 +2030,9 @@ int RST::setTargetAltAz(double dAlt, double dAz)
 #pragma mark - Sync and Cal
 int RST::syncTo(double dRa, double dDec)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+    // the mount may see its side differently after a sync, ask it again
+    axesMoved();
     int nErr = PLUGIN_OK;
     std::stringstream ssTmp;
     std::string sResp;
@@ -622,12 +2058,16 @@ int RST::syncTo(double dRa, double dDec)
     else
         ssTmp << ":CN" << std::setfill('0') << std::setw(7) << std::fixed << std::setprecision(3) << dRa*15.0 << cSign << std::setfill('0') << std::setw(6)<< std::fixed << std::setprecision(3) << dDec << "#";
 
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
+    if(!m_bSyncDone)
+        nErr = sendCommand<CMD_Ck>(ssTmp.str(), sResp);
+    else
+        nErr = sendCommand<CMD_CN>(ssTmp.str(), sResp);
 
     if(!nErr && !m_bSyncDone)
         m_bSyncDone = true;
 
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    if(!nErr)
+        resetNonSiderealTrackingOrigin();
 
     return nErr;
 }
@@ -648,8 +2088,10 @@ int RST::isAligned(bool &bAligned)
 #pragma mark - tracking rates
 int RST::setTrackingRates(bool bSiderialTrackingOn, bool bIgnoreRates, double dRaRateArcSecPerSec, double dDecRateArcSecPerSec)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
     int nErr = PLUGIN_OK;
     std::string sResp;
+    int nTrackingMode = STATUS_TRACKING_SIDEREAL;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] Called." << std::endl;
@@ -660,12 +2102,31 @@ int RST::setTrackingRates(bool bSiderialTrackingOn, bool bIgnoreRates, double dR
     m_sLogFile.flush();
 #endif
 
+    bool bLunar = (0.30 < dRaRateArcSecPerSec && dRaRateArcSecPerSec < 0.83 && -0.25 < dDecRateArcSecPerSec && dDecRateArcSecPerSec < 0.25);
+    bool bSolar = (0.037 < dRaRateArcSecPerSec && dRaRateArcSecPerSec < 0.043 && -0.017 < dDecRateArcSecPerSec && dDecRateArcSecPerSec < 0.017);
+    bool bNonSidereal = !bIgnoreRates && !bLunar && !bSolar && (dRaRateArcSecPerSec != 0.0 || dDecRateArcSecPerSec != 0.0);
+
+    // the engine thread needs the operation lock to stop, so stop it before we take it.
+    stopNonSiderealTracking();
+    // same for the warm-up thread, the engine needs the guide speed.
+    if(bNonSidereal)
+        waitWarmup(WARMUP_SPEEDS);
+
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
     if(!bSiderialTrackingOn && bIgnoreRates) { // stop tracking
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] setting to stopped" << std::endl;
         m_sLogFile.flush();
 #endif
-        nErr = sendCommand(":CtL#", sResp); // tracking off
+        checkMountShadow();
+        if(m_nShadowTracking == 0)
+            shadowSkipped(0);
+        else {
+            nErr = sendCommand<CMD_CtL>(sResp); // tracking off
+            m_nShadowTracking = nErr ? -1 : 0;
+        }
+        nTrackingMode = STATUS_TRACKING_OFF;
         m_dRaRateArcSecPerSec = 15.0410681;
         m_dDecRateArcSecPerSec = 0.0;
     }
@@ -675,33 +2136,42 @@ int RST::setTrackingRates(bool bSiderialTrackingOn, bool bIgnoreRates, double dR
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] setting to Sidereal" << std::endl;
         m_sLogFile.flush();
 #endif
-        nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-        std::this_thread::sleep_for(std::chrono::milliseconds(250)); // need to give time to the mount to process the command
-        nErr = sendCommand(":CtR#", sResp);
+        nErr = setMountTracking<CMD_CtR>(STATUS_TRACKING_SIDEREAL);
         m_dRaRateArcSecPerSec = 0.0;
         m_dDecRateArcSecPerSec = 0.0;
     }
     // Lunar
-    else if (0.30 < dRaRateArcSecPerSec && dRaRateArcSecPerSec < 0.83 && -0.25 < dDecRateArcSecPerSec && dDecRateArcSecPerSec < 0.25) {
+    else if (bLunar) {
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] setting to Lunar" << std::endl;
         m_sLogFile.flush();
 #endif
-        nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-        std::this_thread::sleep_for(std::chrono::milliseconds(250)); // need to give time to the mount to process the command
-        nErr = sendCommand(":CtM#", sResp);
+        nErr = setMountTracking<CMD_CtM>(STATUS_TRACKING_LUNAR);
+        nTrackingMode = STATUS_TRACKING_LUNAR;
         m_dRaRateArcSecPerSec = dRaRateArcSecPerSec;
         m_dDecRateArcSecPerSec = dDecRateArcSecPerSec;
     }
     // solar
-    else if (0.037 < dRaRateArcSecPerSec && dRaRateArcSecPerSec < 0.043 && -0.017 < dDecRateArcSecPerSec && dDecRateArcSecPerSec < 0.017) {
+    else if (bSolar) {
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] setting to Solar" << std::endl;
         m_sLogFile.flush();
 #endif
-        nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-        std::this_thread::sleep_for(std::chrono::milliseconds(250)); // need to give time to the mount to process the command
-        nErr = sendCommand(":CtS#", sResp);
+        nErr = setMountTracking<CMD_CtS>(STATUS_TRACKING_SOLAR);
+        nTrackingMode = STATUS_TRACKING_SOLAR;
+        m_dRaRateArcSecPerSec = dRaRateArcSecPerSec;
+        m_dDecRateArcSecPerSec = dDecRateArcSecPerSec;
+    }
+    // any other rate : sidereal plus our own corrections
+    else if (bNonSidereal) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] setting to sidereal + non-sidereal tracking engine" << std::endl;
+        m_sLogFile.flush();
+#endif
+        nErr = setMountTracking<CMD_CtR>(STATUS_TRACKING_SIDEREAL);
+        if(!nErr)
+            nErr = startNonSiderealTracking(dRaRateArcSecPerSec, dDecRateArcSecPerSec);
+        nTrackingMode = STATUS_TRACKING_CUSTOM;
         m_dRaRateArcSecPerSec = dRaRateArcSecPerSec;
         m_dDecRateArcSecPerSec = dDecRateArcSecPerSec;
     }
@@ -711,21 +2181,49 @@ int RST::setTrackingRates(bool bSiderialTrackingOn, bool bIgnoreRates, double dR
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setTrackingRates] default to sidereal" << std::endl;
         m_sLogFile.flush();
 #endif
-        nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-        std::this_thread::sleep_for(std::chrono::milliseconds(250)); // need to give time to the mount to process the command
-        nErr = sendCommand(":CtR#", sResp);
+        nErr = setMountTracking<CMD_CtR>(STATUS_TRACKING_SIDEREAL);
         m_dRaRateArcSecPerSec = 0.0;
         m_dDecRateArcSecPerSec = 0.0;
     }
 
+    if(!nErr)
+        publishTracking(nTrackingMode, nTrackingMode == STATUS_TRACKING_OFF?0.0:m_dRaRateArcSecPerSec, m_dDecRateArcSecPerSec);
+    return nErr;
+}
+
+// :CtA# then the rate command, what the mount already does isn't sent again. m_OpMutex is held.
+template<int nModeCmd> int RST::setMountTracking(int nMode)
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+    bool bWasOn;
+
+    checkMountShadow();
+    bWasOn = (m_nShadowTracking == 1);
+    if(bWasOn)
+        shadowSkipped(rstPacingMs(RSTCommands[CMD_CtA].nPacing));
+    else {
+        nErr = sendCommand<CMD_CtA>(sResp); // unpark, tracking on
+        m_nShadowTracking = nErr ? -1 : 1;
+    }
+
+    // we don't know what rate :CtA# resumes at, only skip the rate when tracking was already on
+    if(bWasOn && m_nShadowTrackingMode == nMode) {
+        shadowSkipped(0);
+        return PLUGIN_OK;
+    }
+    nErr = sendCommand<nModeCmd>(sResp);
+    m_nShadowTrackingMode = nErr ? STATUS_TRACKING_UNKNOWN : nMode;
     return nErr;
 }
 
 int RST::getTrackRates(bool &bSiderialTrackingOn, double &dRaRateArcSecPerSec, double &dDecRateArcSecPerSec)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     std::string sResp;
     bool bTrackingOn;
+    int nTrackingMode;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getTrackRates] Called." << std::endl;
@@ -737,10 +2235,11 @@ int RST::getTrackRates(bool &bSiderialTrackingOn, double &dRaRateArcSecPerSec, d
         dRaRateArcSecPerSec = 15.0410681; // Convention to say tracking is off - see TSX documentation
         dDecRateArcSecPerSec = 0;
         bSiderialTrackingOn = false;
+        publishTracking(STATUS_TRACKING_OFF, 0.0, 0.0);
         return nErr;
     }
 
-    nErr = sendCommand(":Ct?#", sResp);
+    nErr = sendCommand<CMD_Ct_QUERY>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getTrackRates] Error getting tracking rate, response : " << sResp << std::endl;
@@ -752,33 +2251,52 @@ int RST::getTrackRates(bool &bSiderialTrackingOn, double &dRaRateArcSecPerSec, d
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
 
-    switch(sResp.at(3)) {
+    switch(rstReplyValue(CMD_Ct_QUERY, sResp)[0]) {
         case '0' :  // Sidereal
-            dRaRateArcSecPerSec = 0.0;
-            dDecRateArcSecPerSec = 0.0;
-            bSiderialTrackingOn = true;
+            m_nShadowTrackingMode = STATUS_TRACKING_SIDEREAL;
+            if(m_bTrackingEngineRunning) { // sidereal + our corrections
+                dRaRateArcSecPerSec = m_dEngineRaRate;
+                dDecRateArcSecPerSec = m_dEngineDecRate;
+                bSiderialTrackingOn = false;
+                nTrackingMode = STATUS_TRACKING_CUSTOM;
+            }
+            else {
+                dRaRateArcSecPerSec = 0.0;
+                dDecRateArcSecPerSec = 0.0;
+                bSiderialTrackingOn = true;
+                nTrackingMode = STATUS_TRACKING_SIDEREAL;
+            }
             break;
         case '1' :  // Solar
+            m_nShadowTrackingMode = STATUS_TRACKING_SOLAR;
             dRaRateArcSecPerSec = m_dRaRateArcSecPerSec;
             dDecRateArcSecPerSec = m_dDecRateArcSecPerSec;
             bSiderialTrackingOn = false;
+            nTrackingMode = STATUS_TRACKING_SOLAR;
             break;
         case '2' :  // Lunar
+            m_nShadowTrackingMode = STATUS_TRACKING_LUNAR;
             dRaRateArcSecPerSec = m_dRaRateArcSecPerSec;
             dDecRateArcSecPerSec = m_dDecRateArcSecPerSec;
             bSiderialTrackingOn = false;
+            nTrackingMode = STATUS_TRACKING_LUNAR;
             break;
         case '3' :  //  Guide
+            m_nShadowTrackingMode = STATUS_TRACKING_UNKNOWN;
             dRaRateArcSecPerSec = m_dRaRateArcSecPerSec;
             dDecRateArcSecPerSec = m_dDecRateArcSecPerSec;
             bSiderialTrackingOn = false;
+            nTrackingMode = STATUS_TRACKING_CUSTOM;
             break;
         default:
+            m_nShadowTrackingMode = STATUS_TRACKING_UNKNOWN;
             dRaRateArcSecPerSec = 15.0410681; // Convention to say tracking is off - see TSX documentation
             dDecRateArcSecPerSec = 0;
             bSiderialTrackingOn = false;
+            nTrackingMode = STATUS_TRACKING_UNKNOWN;
             break;
     }
+    publishTracking(nTrackingMode, dRaRateArcSecPerSec, dDecRateArcSecPerSec);
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getTrackRates] bSiderialTrackingOn  : " << (bSiderialTrackingOn?"Yes":"No") << std::endl;
@@ -791,6 +2309,289 @@ int RST::getTrackRates(bool &bSiderialTrackingOn, double &dRaRateArcSecPerSec, d
 }
 
 
+#pragma mark - non-sidereal tracking engine
+// The RST only knows sidereal, lunar and solar rates. For anything else we track at sidereal
+// and add the requested RA/Dec offset rates ourselves from a background thread,
+// either as guide rate pulses (slow movers) or as small re-targets (fast movers).
+int RST::startNonSiderealTracking(double dRaRateArcSecPerSec, double dDecRateArcSecPerSec)
+{
+    int nErr = PLUGIN_OK;
+    double dGuideSpeed = DEFAULT_GUIDE_SPEED;
+    double dFastest;
+
+    stopNonSiderealTracking();
+
+    if(getGuideSpeed(dGuideSpeed) || dGuideSpeed <= 0.0)
+        dGuideSpeed = DEFAULT_GUIDE_SPEED;
+
+    m_dEngineGuideRate = dGuideSpeed * SIDEREAL_RATE_ARCSEC_PER_SEC;
+    m_dEngineRaRate = dRaRateArcSecPerSec;
+    m_dEngineDecRate = dDecRateArcSecPerSec;
+
+    // correct often enough that each correction is about TRACKING_ENGINE_STEP_ARCSEC
+    dFastest = std::max(std::fabs(m_dEngineRaRate), std::fabs(m_dEngineDecRate));
+    m_dEngineInterval = TRACKING_ENGINE_STEP_ARCSEC / dFastest;
+    m_dEngineInterval = std::min(std::max(m_dEngineInterval, TRACKING_ENGINE_MIN_INTERVAL), TRACKING_ENGINE_MAX_INTERVAL);
+
+    // pulses can't keep up with fast movers, re-target instead.
+    m_bTrackingEngineRetarget = (dFastest > m_dEngineGuideRate * TRACKING_ENGINE_RETARGET_RATIO);
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startNonSiderealTracking] Ra rate    : " << std::fixed << std::setprecision(6) << m_dEngineRaRate << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startNonSiderealTracking] Dec rate   : " << std::fixed << std::setprecision(6) << m_dEngineDecRate << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startNonSiderealTracking] guide rate : " << std::fixed << std::setprecision(6) << m_dEngineGuideRate << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startNonSiderealTracking] interval   : " << std::fixed << std::setprecision(3) << m_dEngineInterval << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startNonSiderealTracking] mode       : " << (m_bTrackingEngineRetarget?"re-target":"guide pulses") << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    resetNonSiderealTrackingOrigin();
+    m_bTrackingEngineRunning = true;
+    {
+        std::lock_guard<std::mutex> lock(m_TrackingThreadMutex);
+        m_TrackingThread = std::thread(&RST::trackingEngineThread, this);
+    }
+
+    return nErr;
+}
+
+bool RST::stopNonSiderealTracking()
+{
+    std::thread engineThread;
+
+    requestStopNonSiderealTracking();
+    // Abort stops the engine without the operation lock, only one of us gets to join the thread
+    {
+        std::lock_guard<std::mutex> lock(m_TrackingThreadMutex);
+        engineThread.swap(m_TrackingThread);
+    }
+    if(!engineThread.joinable())
+        return false;
+    engineThread.join();
+    return true;
+}
+
+void RST::requestStopNonSiderealTracking()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TrackingEngineMutex);
+        m_bTrackingEngineRunning = false;
+    }
+    m_TrackingEngineCond.notify_all();
+}
+
+// the offsets start over from where the mount points now
+void RST::resetNonSiderealTrackingOrigin()
+{
+    double dRa, dDec;
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
+    dRa = m_dRa;
+    dDec = m_dDec;
+    if(m_bTrackingEngineRetarget && m_bIsConnected && !m_bSlewing) {
+        getRaAndDec(dRa, dDec);
+    }
+    resetNonSiderealTrackingOrigin(dRa, dDec);
+}
+
+// or from a goto target, the engine waits for the goto to be over and catches up from there
+void RST::resetNonSiderealTrackingOrigin(double dRa, double dDec)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
+    m_dEngineAppliedRa = 0.0;
+    m_dEngineAppliedDec = 0.0;
+    m_dEngineErrRa = 0.0;
+    m_dEngineErrDec = 0.0;
+    m_dEngineOriginRa = dRa;
+    m_dEngineOriginDec = dDec;
+    m_EngineTimer.Reset();
+}
+
+void RST::getNonSiderealTrackingError(double &dRaErrArcSec, double &dDecErrArcSec)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    dRaErrArcSec = m_dEngineErrRa;
+    dDecErrArcSec = m_dEngineErrDec;
+}
+
+void RST::trackingEngineThread()
+{
+    std::unique_lock<std::mutex> lock(m_TrackingEngineMutex);
+
+    while(m_bTrackingEngineRunning) {
+        m_TrackingEngineCond.wait_for(lock, std::chrono::milliseconds(int(m_dEngineInterval * 1000)));
+        if(!m_bTrackingEngineRunning)
+            break;
+        lock.unlock();
+        if(m_bTrackingEngineRetarget)
+            trackingEngineRetarget();
+        else
+            trackingEngineCorrect();
+        lock.lock();
+    }
+}
+
+void RST::trackingEngineCorrect()
+{
+    double dElapsed;
+    double dRaPulse, dDecPulse;
+    double dFirst, dSecond;
+    RSTMoveDir nRaDir, nDecDir;
+    unsigned long nRaMove = 0;
+    unsigned long nDecMove = 0;
+    bool bRaPulse, bDecPulse;
+    CStopWatch pulseTimer;
+
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+        // the mount is busy with something else, we'll catch up on the next pass.
+        if(m_bSlewing || m_bUnparking || m_RaAxisMove.bMoving || m_DecAxisMove.bMoving)
+            return;
+
+        dElapsed = m_EngineTimer.GetElapsedSeconds();
+        m_dEngineErrRa = m_dEngineRaRate * dElapsed - m_dEngineAppliedRa;
+        m_dEngineErrDec = m_dEngineDecRate * dElapsed - m_dEngineAppliedDec;
+
+        bRaPulse = std::fabs(m_dEngineErrRa) >= TRACKING_ENGINE_MIN_CORRECTION;
+        bDecPulse = std::fabs(m_dEngineErrDec) >= TRACKING_ENGINE_MIN_CORRECTION;
+        if(!bRaPulse && !bDecPulse)
+            return;
+
+        // never pulse longer than the interval, the rest will be picked up next time
+        dRaPulse = bRaPulse ? std::min(std::fabs(m_dEngineErrRa) / m_dEngineGuideRate, m_dEngineInterval) : 0.0;
+        dDecPulse = bDecPulse ? std::min(std::fabs(m_dEngineErrDec) / m_dEngineGuideRate, m_dEngineInterval) : 0.0;
+        nRaDir = m_dEngineErrRa > 0 ? MOVE_EAST : MOVE_WEST;
+        nDecDir = m_dEngineErrDec > 0 ? MOVE_NORTH : MOVE_SOUTH;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 3
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [trackingEngineCorrect] Ra error  : " << std::fixed << std::setprecision(3) << m_dEngineErrRa << " , pulse " << dRaPulse << " s" << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [trackingEngineCorrect] Dec error : " << std::fixed << std::setprecision(3) << m_dEngineErrDec << " , pulse " << dDecPulse << " s" << std::endl;
+        m_sLogFile.flush();
+#endif
+        // both axis pulse at the same time
+        if(bRaPulse && startAxisMove(nRaDir, 0))
+            bRaPulse = false;
+        if(bDecPulse && startAxisMove(nDecDir, 0))
+            bDecPulse = false;
+        nRaMove = m_RaAxisMove.nMoveId;
+        nDecMove = m_DecAxisMove.nMoveId;
+        pulseTimer.Reset();
+    }
+
+    // stop the shortest pulse first, then the other one.
+    dFirst = (bRaPulse && bDecPulse) ? std::min(dRaPulse, dDecPulse) : (bRaPulse ? dRaPulse : dDecPulse);
+    dSecond = std::max(bRaPulse ? dRaPulse : 0.0, bDecPulse ? dDecPulse : 0.0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(int(dFirst * 1000)));
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+        if(bRaPulse && dRaPulse <= dFirst) {
+            trackingEnginePulseDone(nRaDir, nRaMove, pulseTimer.GetElapsedSeconds());
+            bRaPulse = false;
+        }
+        if(bDecPulse && dDecPulse <= dFirst) {
+            trackingEnginePulseDone(nDecDir, nDecMove, pulseTimer.GetElapsedSeconds());
+            bDecPulse = false;
+        }
+        // what's left after this correction
+        dElapsed = m_EngineTimer.GetElapsedSeconds();
+        m_dEngineErrRa = m_dEngineRaRate * dElapsed - m_dEngineAppliedRa;
+        m_dEngineErrDec = m_dEngineDecRate * dElapsed - m_dEngineAppliedDec;
+    }
+    if(!bRaPulse && !bDecPulse)
+        return;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(int((dSecond - dFirst) * 1000)));
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+        if(bRaPulse)
+            trackingEnginePulseDone(nRaDir, nRaMove, pulseTimer.GetElapsedSeconds());
+        if(bDecPulse)
+            trackingEnginePulseDone(nDecDir, nDecMove, pulseTimer.GetElapsedSeconds());
+        dElapsed = m_EngineTimer.GetElapsedSeconds();
+        m_dEngineErrRa = m_dEngineRaRate * dElapsed - m_dEngineAppliedRa;
+        m_dEngineErrDec = m_dEngineDecRate * dElapsed - m_dEngineAppliedDec;
+    }
+}
+
+// with m_OpMutex held. A hand pad move (or a guider) that took the axis during the pulse moved the mount
+// somewhere we don't know : leave it alone and start the offsets over once it's done.
+void RST::trackingEnginePulseDone(const RSTMoveDir Dir, unsigned long nMoveId, double dSeconds)
+{
+    if(!stopAxisMove(Dir, nMoveId)) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [trackingEnginePulseDone] dir " << Dir << " taken over during the pulse, starting over" << std::endl;
+        m_sLogFile.flush();
+#endif
+        resetNonSiderealTrackingOrigin();
+        return;
+    }
+    if(Dir == MOVE_EAST || Dir == MOVE_WEST)
+        m_dEngineAppliedRa += (Dir == MOVE_EAST ? 1.0 : -1.0) * m_dEngineGuideRate * dSeconds;
+    else
+        m_dEngineAppliedDec += (Dir == MOVE_NORTH ? 1.0 : -1.0) * m_dEngineGuideRate * dSeconds;
+}
+
+void RST::trackingEngineRetarget()
+{
+    int nErr;
+    int nLimit;
+    double dElapsed;
+    double dRa, dDec;
+    double dLst;
+    int nSide;
+
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    if(m_bSlewing || m_bUnparking || m_RaAxisMove.bMoving || m_DecAxisMove.bMoving)
+        return;
+
+    // where the object is now, and how far behind it the last hop left us
+    dElapsed = m_EngineTimer.GetElapsedSeconds();
+    m_dEngineErrRa = m_dEngineRaRate * dElapsed - m_dEngineAppliedRa;
+    m_dEngineErrDec = m_dEngineDecRate * dElapsed - m_dEngineAppliedDec;
+
+    dRa = m_dEngineOriginRa + (m_dEngineRaRate * dElapsed) / 54000.0; // arcsec -> hours
+    dDec = m_dEngineOriginDec + (m_dEngineDecRate * dElapsed) / 3600.0;
+    dRa = std::fmod(dRa + 24.0, 24.0);
+    dDec = std::min(std::max(dDec, -90.0), 90.0);
+
+    // each hop is a goto : past a limit we stop following, and a hop must never flip the mount mid-exposure
+    checkLimits(dRa, dDec, nLimit);
+    if(nLimit != LIMIT_OK && nLimit != LIMIT_NO_SITE) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [trackingEngineRetarget] object reached a limit, " << RSTLimits::resultName(nLimit) << ", back to sidereal" << std::endl;
+        m_sLogFile.flush();
+#endif
+        requestStopNonSiderealTracking();
+        return;
+    }
+    dLst = limitsSiderealTime();
+    nSide = westOfPierNow(dLst) ? STATUS_PIER_WEST : STATUS_PIER_EAST;
+    if(m_PierSide.predict(dRa, dDec, dLst, nSide) != nSide) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [trackingEngineRetarget] hop would change the pier side, not sent" << std::endl;
+        m_sLogFile.flush();
+#endif
+        return;
+    }
+
+    nErr = setTarget(dRa, dDec);
+    if(!nErr)
+        nErr = slewTargetRA_DecEpochNow();
+    if(nErr) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [trackingEngineRetarget] error " << nErr << std::endl;
+        m_sLogFile.flush();
+#endif
+        return;
+    }
+    // short hop, we don't flag it as a slew so TheSkyX doesn't see it. What we commanded, Dec may stop at the pole.
+    m_dEngineAppliedRa = m_dEngineRaRate * dElapsed;
+    m_dEngineAppliedDec = (dDec - m_dEngineOriginDec) * 3600.0;
+}
+
+
 #pragma mark - Limits
 int RST::getLimits(double &dHoursEast, double &dHoursWest)
 {
@@ -800,16 +2601,116 @@ int RST::getLimits(double &dHoursEast, double &dHoursWest)
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getLimits] Called." << std::endl;
     m_sLogFile.flush();
 #endif
+    m_Limits.getHourAngleLimits(dHoursEast, dHoursWest);
+    return nErr;
+
+}
+
+void RST::setLimits(double dHoursEast, double dHoursWest, double dMinAltitude)
+{
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setLimits] hours east : " << dHoursEast << " , hours west : " << dHoursWest << " , min altitude : " << dMinAltitude << std::endl;
+    m_sLogFile.flush();
+#endif
+    m_Limits.setHourAngleLimits(dHoursEast, dHoursWest);
+    m_Limits.setMinAltitude(dMinAltitude);
+}
+
+int RST::setHorizon(const std::string &sHorizon)
+{
+    int nErr;
+
+    nErr = m_Limits.setHorizon(sHorizon);
+#if defined PLUGIN_DEBUG
+    if(nErr) {
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setHorizon] can't parse '" << sHorizon << "', keeping the previous profile" << std::endl;
+        m_sLogFile.flush();
+    }
+#endif
+    return nErr;
+}
+
+int RST::checkLimits(double dRa, double dDec, int &nResult)
+{
+    int nErr = PLUGIN_OK;
+    double dAlt = 0.0;
+
+    nErr = loadLimitSite();
+    nResult = m_Limits.check(dRa, dDec, limitsSiderealTime(), &dAlt);
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [checkLimits] Ra " << std::fixed << std::setprecision(5) << dRa << " Dec " << dDec << " , altitude " << dAlt << " : " << RSTLimits::resultName(nResult) << std::endl;
+    m_sLogFile.flush();
+#endif
+    return nErr;
+}
+
+int RST::checkLimits(const std::vector<RSTTarget> &vTargets, std::vector<int> &vResults)
+{
+    int nErr = PLUGIN_OK;
+
+    nErr = loadLimitSite();
+    m_Limits.check(vTargets, limitsSiderealTime(), vResults);
+    return nErr;
+}
+
+// TheSkyX knows where we are, the mount too when we run without it (tools)
+int RST::loadLimitSite()
+{
+    int nErr = PLUGIN_OK;
+    std::string sLongitude;
+    std::string sLatitude;
+    double dLongitude;
+    double dLatitude;
+
+    if(m_Limits.hasSite())
+        return nErr;
+
+    if(m_pHost) {
+        m_Limits.setSite(m_pHost->latitude(), m_pHost->longitude());
+        m_PierSide.setLatitude(m_pHost->latitude());
+        m_SlewModel.setLatitude(m_pHost->latitude());
+        return nErr;
+    }
+    if(!m_bIsConnected)
+        return ERR_NOLINK;
+
+    nErr = getSiteLongitude(sLongitude);
+    if(!nErr)
+        nErr = getSiteLatitude(sLatitude);
+    if(!nErr)
+        nErr = convertDDMMSSToDecDeg(sLongitude, dLongitude);
+    if(!nErr)
+        nErr = convertDDMMSSToDecDeg(sLatitude, dLatitude);
+    if(nErr) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [loadLimitSite] can't get the site, error " << nErr << std::endl;
+        m_sLogFile.flush();
+#endif
+        return nErr;
+    }
+    m_Limits.setSite(dLatitude, dLongitude);
+    m_PierSide.setLatitude(dLatitude);
+    m_SlewModel.setLatitude(dLatitude);
     return nErr;
+}
 
+double RST::limitsSiderealTime()
+{
+    if(m_pHost)
+        return m_pHost->lst();
+    return RSTLimits::localSiderealTime(m_Limits.getLongitude());
 }
 
 #pragma mark - Slew
 
 int RST::startSlewTo(double dRa, double dDec)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
     int nErr = PLUGIN_OK;
     bool bAligned;
+    int nLimit;
+    double dTravel;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startSlewTo] Called." << std::endl;
@@ -820,6 +2721,29 @@ int RST::startSlewTo(double dRa, double dDec)
     if(nErr)
         return nErr;
 
+    // don't bother the mount with a target it will refuse, without a site we let the mount decide
+    checkLimits(dRa, dDec, nLimit);
+    if(nLimit != LIMIT_OK && nLimit != LIMIT_NO_SITE) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startSlewTo] target refused, " << RSTLimits::resultName(nLimit) << std::endl;
+        m_sLogFile.flush();
+#endif
+        return ERR_MKS_SLEW_PAST_LIMIT;
+    }
+
+    // measured before the move forgets which side we start from
+    loadSlewSpeed();
+    dTravel = slewTravel(dRa, dDec);
+
+    // the target and the goto as one operation, a tracking engine hop can't slip its own target in between
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
+    // the side the mount picks for this goto teaches the pier side model
+    axesMoved();
+    m_dPierGotoHourAngle = RSTPierSideModel::hourAngle(dRa, limitsSiderealTime());
+    m_dPierGotoDec = dDec;
+    m_bPierGoto = true;
+
     // set sync target coordinate
     nErr = setTarget(dRa, dDec);
     if(nErr)
@@ -834,6 +2758,23 @@ int RST::startSlewTo(double dRa, double dDec)
 
     }
     m_bSlewing = true;
+    publishFlag(STATUS_SLEWING, true);
+    // new target, the non-sidereal offsets start over from there. m_dRa/m_dDec are still where we come from.
+    if(!nErr)
+        resetNonSiderealTrackingOrigin(dRa, dDec);
+
+    if(!nErr) {
+        m_dSlewTravel = dTravel;
+        m_dSlewPredicted = m_SlewModel.estimate(dTravel);
+        m_dSlewLastPoll = 0.0;
+        m_dSlewDoneNotice = -1.0;
+        m_SlewTimer.Reset();
+        m_bSlewTimed = true;
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startSlewTo] travel " << dTravel << " deg, ETA " << m_dSlewPredicted << " s" << std::endl;
+        m_sLogFile.flush();
+#endif
+    }
 
     return nErr;
 }
@@ -848,24 +2789,20 @@ int RST::slewTargetRA_DecEpochNow()
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":MS#", sResp, 200);
-    if(nErr == COMMAND_TIMEOUT) // normal if the command succeed
-        nErr = PLUGIN_OK;
-    else if(nErr) {
+    nErr = sendCommand<CMD_MS>(sResp);  // no answer is the normal one
+    if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [slewTargetRA_DecEpochNow] Error slewing, response : " << sResp << std::endl;
         m_sLogFile.flush();
 #endif
         return ERR_CMDFAILED;
     }
-    if(sResp.size()>=4) {
-        if(sResp.at(3) == 'L') {
+    if(!rstReplyValue(CMD_MS, sResp).compare(0, 1, "L")) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [slewTargetRA_DecEpochNow] Limit error ? => " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [slewTargetRA_DecEpochNow] Limit error ? => " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            nErr = ERR_MKS_SLEW_PAST_LIMIT;
-        }
+        nErr = ERR_MKS_SLEW_PAST_LIMIT;
     }
     return nErr;
 }
@@ -894,11 +2831,10 @@ int RST::getRateName(int nZeroBasedIndex, std::string &sOut)
     return PLUGIN_OK;
 }
 
-int RST::startOpenLoopMove(const MountDriverInterface::MoveDir Dir, unsigned int nRate)
+int RST::startOpenLoopMove(const RSTMoveDir Dir, unsigned int nRate)
 {
-    int nErr = PLUGIN_OK;
-    std::string sResp;
-    m_nOpenLoopDir = Dir;
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+    axesMoved();
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startOpenLoopMove] setting dir to  : " << Dir << std::endl;
@@ -906,77 +2842,194 @@ int RST::startOpenLoopMove(const MountDriverInterface::MoveDir Dir, unsigned int
     m_sLogFile.flush();
 #endif
 
-    // select rate
-    m_nOpenLoopDir = Dir;
-    switch(nRate) {
-        case 0:
-            nErr = sendCommand(":RG#", sResp, 0);
-            break;
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    return startAxisMove(Dir, nRate);
+}
 
-        case 1:
-            nErr = sendCommand(":RC#", sResp, 0);
-            break;
+int RST::startAxisMove(const RSTMoveDir Dir, unsigned int nRate)
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
 
-        case 2:
-            nErr = sendCommand(":RM#", sResp, 0);
+    if(nRate > 3)
+        return COMMAND_FAILED;
+
+    AxisMoveState &Axis = axisMoveState(Dir);
+    checkMountShadow();
+
+    // already moving this way, nothing to send. It's our move now.
+    if(Axis.bMoving && Axis.nDir == Dir && m_nOpenLoopRate == int(nRate)) {
+        Axis.nMoveId = ++m_nLastMoveId;
+        return nErr;
+    }
+
+    // the rate is shared by both axis and the mount remembers it, only send it when it changes
+    if(m_nOpenLoopRate != int(nRate)) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        if(m_RaAxisMove.bMoving || m_DecAxisMove.bMoving) {
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [startOpenLoopMove] rate change while an axis is moving, both axis will use the new rate" << std::endl;
+            m_sLogFile.flush();
+        }
+#endif
+        nErr = sendMoveRate(nRate);
+        if(nErr) {
+            m_nOpenLoopRate = -1;
+            return nErr;
+        }
+        m_nOpenLoopRate = int(nRate);
+    }
+    else
+        shadowSkipped(0);
+
+    // reversing on the same axis, stop the current move first
+    if(Axis.bMoving && Axis.nDir != Dir) {
+        nErr = sendAxisStop(Axis);
+        if(nErr)
+            return nErr;
+    }
+
+    // figure out direction
+    switch(Dir){
+        case MOVE_NORTH:
+            nErr = sendCommand<CMD_Mn>(sResp);
             break;
+        case MOVE_SOUTH:
+            nErr = sendCommand<CMD_Ms>(sResp);
+            break;
+        case MOVE_EAST:
+            nErr = sendCommand<CMD_Me>(sResp);
+            break;
+        case MOVE_WEST:
+            nErr = sendCommand<CMD_Mw>(sResp);
+            break;
+    }
+    if(nErr)
+        return nErr;
+
+    Axis.bMoving = true;
+    Axis.nDir = Dir;
+    Axis.nMoveId = ++m_nLastMoveId;
+    Axis.moveTimer.Reset();
+
+    return nErr;
+}
+
+int RST::stopOpenLoopMove()
+{
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+    int nErr = PLUGIN_OK;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [stopOpenLoopMove] Ra axis moving  : " << (m_RaAxisMove.bMoving?"Yes":"No") << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [stopOpenLoopMove] Dec axis moving : " << (m_DecAxisMove.bMoving?"Yes":"No") << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
+    // stop both axis, each one independently of the other
+    nErr = sendAxisStop(m_RaAxisMove);
+    nErr |= sendAxisStop(m_DecAxisMove);
+
+    return nErr;
+}
+
+int RST::stopOpenLoopMove(const RSTMoveDir Dir)
+{
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [stopOpenLoopMove] stopping axis for dir : " << Dir << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    return sendAxisStop(axisMoveState(Dir));
+}
+
+bool RST::isOpenLoopMoving(const RSTMoveDir Dir)
+{
+    return axisMoveState(Dir).bMoving;
+}
+
+double RST::getOpenLoopMoveElapsed(const RSTMoveDir Dir)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    AxisMoveState &Axis = axisMoveState(Dir);
+
+    if(!Axis.bMoving)
+        return 0.0;
+    return Axis.moveTimer.GetElapsedSeconds();
+}
 
-        case 3:
-            nErr = sendCommand(":RS#", sResp, 0);
-            break;
+bool RST::stopAxisMove(const RSTMoveDir Dir, unsigned long nMoveId)
+{
+    AxisMoveState &Axis = axisMoveState(Dir);
 
-        default :
-            return COMMAND_FAILED;
-            break;
-    }
-    
-    // figure out direction
-    switch(Dir){
-        case MountDriverInterface::MD_NORTH:
-            nErr = sendCommand(":Mn#", sResp, 0);
-            break;
-        case MountDriverInterface::MD_SOUTH:
-            nErr = sendCommand(":Ms#", sResp, 0);
-            break;
-        case MountDriverInterface::MD_EAST:
-            nErr = sendCommand(":Me#", sResp, 0);
-            break;
-        case MountDriverInterface::MD_WEST:
-            nErr = sendCommand(":Mw#", sResp, 0);
-            break;
-    }
+    if(!Axis.bMoving || Axis.nMoveId != nMoveId)
+        return false;
+    sendAxisStop(Axis);
+    return true;
+}
 
-    return nErr;
+RST::AxisMoveState &RST::axisMoveState(const RSTMoveDir Dir)
+{
+    if(Dir == MOVE_EAST || Dir == MOVE_WEST)
+        return m_RaAxisMove;
+    return m_DecAxisMove;
 }
 
-int RST::stopOpenLoopMove()
+int RST::sendAxisStop(AxisMoveState &Axis)
 {
     int nErr = PLUGIN_OK;
     std::string sResp;
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [stopOpenLoopMove] dir was  : " << m_nOpenLoopDir << std::endl;
-    m_sLogFile.flush();
-#endif
+    if(!Axis.bMoving)
+        return nErr;
 
-    switch(m_nOpenLoopDir){
-        case MountDriverInterface::MD_NORTH:
-            nErr = sendCommand(":Qn#", sResp, 0);
+    switch(Axis.nDir){
+        case MOVE_NORTH:
+            nErr = sendCommand<CMD_Qn>(sResp);
             break;
-        case MountDriverInterface::MD_SOUTH:
-            nErr = sendCommand(":Qs#", sResp, 0);
+        case MOVE_SOUTH:
+            nErr = sendCommand<CMD_Qs>(sResp);
             break;
-        case MountDriverInterface::MD_EAST:
-            nErr = sendCommand(":Qe#", sResp, 0);
+        case MOVE_EAST:
+            nErr = sendCommand<CMD_Qe>(sResp);
             break;
-        case MountDriverInterface::MD_WEST:
-            nErr = sendCommand(":Qw#", sResp, 0);
+        case MOVE_WEST:
+            nErr = sendCommand<CMD_Qw>(sResp);
             break;
     }
 
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [sendAxisStop] dir " << Axis.nDir << " stopped after " << std::fixed << std::setprecision(3) << Axis.moveTimer.GetElapsedSeconds() << " s" << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    if(!nErr)
+        Axis.bMoving = false;
+
     return nErr;
 }
 
+int RST::sendMoveRate(unsigned int nRate)
+{
+    std::string sResp;
+
+    switch(nRate) {
+        case 0:
+            return sendCommand<CMD_RG>(sResp);
+        case 1:
+            return sendCommand<CMD_RC>(sResp);
+        case 2:
+            return sendCommand<CMD_RM>(sResp);
+        case 3:
+            return sendCommand<CMD_RS>(sResp);
+        default :
+            return COMMAND_FAILED;
+    }
+}
+
 
 int RST::setSpeed(const int nSpeedId, const int nSpeed)
 {
@@ -990,25 +3043,56 @@ int RST::setSpeed(const int nSpeedId, const int nSpeed)
 #endif
 
 
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    checkMountShadow();
+    if(nSpeedId > 0 && nSpeedId < PLUGIN_NB_SLEW_SPEEDS && m_nShadowSpeeds[nSpeedId] == nSpeed) {
+        shadowSkipped(0);
+        return nErr;
+    }
+
     ssTmp << ":Cu" << nSpeedId << "=" << std::setfill('0') << std::setw(4) << nSpeed << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
+    nErr = sendCommand<CMD_Cu>(ssTmp.str(), sResp);
+    if(nSpeedId >= 0 && nSpeedId < PLUGIN_NB_SLEW_SPEEDS) {
+        m_sSpeedResps[nSpeedId].clear();
+        m_nShadowSpeeds[nSpeedId] = nErr ? -1 : nSpeed;
+    }
+    if(nSpeedId == 0)
+        m_dShadowGuideSpeed = -1.0;
+    if(nSpeedId == PLUGIN_NB_SLEW_SPEEDS - 1)
+        m_bSlewModelSpeed = false;
     return nErr;
 }
 
 int RST::getSpeed(const int nSpeedId, int &nSpeed)
 {
     int nErr = PLUGIN_OK;
-    std::stringstream ssTmp;
     std::string sResp;
-    std::vector<std::string> vFieldsData;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getSpeed] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    ssTmp << ":CU" << nSpeedId << "#";
-    nErr = sendCommand(ssTmp.str(), sResp);
+    if(nSpeedId < 0 || nSpeedId >= PLUGIN_NB_SLEW_SPEEDS)
+        return ERR_CMDFAILED;
+    if(waitWarmup(WARMUP_SPEEDS) && m_sSpeedResps[nSpeedId].size())
+        sResp.assign(m_sSpeedResps[nSpeedId]);
+    else {
+        switch(nSpeedId) {
+            case 0:
+                nErr = sendCommand<CMD_CU0>(sResp);
+                break;
+            case 1:
+                nErr = sendCommand<CMD_CU1>(sResp);
+                break;
+            case 2:
+                nErr = sendCommand<CMD_CU2>(sResp);
+                break;
+            default :
+                nErr = sendCommand<CMD_CU3>(sResp);
+                break;
+        }
+    }
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getSpeed] Error getting Speed, response : " << sResp << std::endl;
@@ -1019,17 +3103,15 @@ int RST::getSpeed(const int nSpeedId, int &nSpeed)
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
 
-    parseFields(sResp, vFieldsData, '=');
-    if(vFieldsData.size() >1) {
-        try {
-            nSpeed = std::stoi(vFieldsData[1]);
-        }
-        catch(const std::exception& e) {
+    // CU0=0500, the :CU entries are in speed order
+    try {
+        nSpeed = std::stoi(rstReplyValue(CMD_CU0 + nSpeedId, sResp));
+    }
+    catch(const std::exception& e) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getSpeed] conversion exception : " << e.what() << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getSpeed] conversion exception : " << e.what() << std::endl;
+        m_sLogFile.flush();
 #endif
-        }
     }
     return nErr;
 }
@@ -1045,8 +3127,19 @@ int RST::setGuideSpeed(const double dSpeed)
     m_sLogFile.flush();
 #endif
 
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+    checkMountShadow();
+    // the mount takes a tenth of sidereal
+    if(m_dShadowGuideSpeed >= 0.0 && std::fabs(m_dShadowGuideSpeed - dSpeed) < 0.05) {
+        shadowSkipped(0);
+        return nErr;
+    }
+
     ssTmp << ":Cu0=" << std::fixed << std::setprecision(1) << dSpeed << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
+    nErr = sendCommand<CMD_Cu>(ssTmp.str(), sResp);
+    m_sSpeedResps[0].clear();
+    m_nShadowSpeeds[0] = -1;
+    m_dShadowGuideSpeed = nErr ? -1.0 : dSpeed;
     return nErr;
 }
 
@@ -1061,7 +3154,10 @@ int RST::getGuideSpeed(double &dSpeed)
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":CU0#", sResp);
+    if(waitWarmup(WARMUP_SPEEDS) && m_sSpeedResps[0].size())
+        sResp.assign(m_sSpeedResps[0]);
+    else
+        nErr = sendCommand<CMD_CU0>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getGuideSpeed] Error getting Guide Speed, response : " << sResp << std::endl;
@@ -1089,8 +3185,14 @@ int RST::getGuideSpeed(double &dSpeed)
 
 int RST::isSlewToComplete(bool &bComplete)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     std::string sResp;
+    double dElapsed = 0.0;
+    double dDone;
+    unsigned long nSlews;
+    double dMeanAbsError;
+    double dMeanError;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isSlewToComplete] Called." << std::endl;
@@ -1103,7 +3205,23 @@ int RST::isSlewToComplete(bool &bComplete)
         return nErr;
     }
 
-    nErr = sendCommand(":CL#", sResp);
+    // no point asking until the goto is about to end, unless the mount already told us it did
+    if(m_bSlewTimed) {
+        dElapsed = m_SlewTimer.GetElapsedSeconds();
+        m_SlewModel.getStats(nSlews, dMeanAbsError, dMeanError);
+        if(dElapsed < m_dSlewPredicted - SLEW_ETA_POLL_LEAD - 2.0 * dMeanAbsError && dElapsed - m_dSlewLastPoll < SLEW_ETA_IDLE_POLL) {
+            // a MM0 may be waiting, looking costs nothing on the wire. Not if someone has the link, they'll see it.
+            std::unique_lock<std::recursive_mutex> lock(m_DevMutex, std::try_to_lock);
+            if(m_dSlewDoneNotice < 0.0 && lock.owns_lock())
+                peekSlewDone();
+            if(m_dSlewDoneNotice < 0.0) {
+                m_nSlewPollsSkipped++;
+                return nErr;
+            }
+        }
+    }
+
+    nErr = sendCommand<CMD_CL>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isSlewToComplete] error " << nErr <<" response : " << sResp << std::endl;
@@ -1117,10 +3235,22 @@ int RST::isSlewToComplete(bool &bComplete)
     m_sLogFile.flush();
 #endif
 
-    if(sResp.size()>2 && sResp.at(3)=='0') {
+    if(rstReplyValue(CMD_CL, sResp)[0] == '0') {
         bComplete = true;
         m_bSlewing = false;
+        publishFlag(STATUS_SLEWING, false);
+        if(m_bSlewTimed.exchange(false)) {
+            // the MM0 time when we got it, else somewhere between the last two polls
+            dDone = m_dSlewDoneNotice >= 0.0 ? (double)m_dSlewDoneNotice : (m_dSlewLastPoll + dElapsed) / 2.0;
+            m_SlewModel.learn(m_dSlewTravel, dDone, m_dSlewPredicted);
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isSlewToComplete] goto took " << dDone << " s, predicted " << m_dSlewPredicted << " s" << std::endl;
+            m_sLogFile.flush();
+#endif
+        }
     }
+    else if(m_bSlewTimed)
+        m_dSlewLastPoll = dElapsed;
     return nErr;
 }
 
@@ -1164,6 +3294,8 @@ void RST::setParkPosition(int nParkPos)
 
 int RST::gotoPark(double dAlt, double dAz)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+    axesMoved();
     int nErr = PLUGIN_OK;
     std::string sResp;
 
@@ -1172,21 +3304,34 @@ int RST::gotoPark(double dAlt, double dAz)
     m_sLogFile.flush();
 #endif
 
+    // the target and the goto as one operation, like startSlewTo
+    std::lock_guard<std::recursive_mutex> lock(m_OpMutex);
+
     // set target
     nErr = setTargetAltAz(dAlt, dAz);
     if(nErr)
         return nErr;
 
     // goto in Az mode
-    nErr = sendCommand(":MA#", sResp, 0);   // AltAz
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_MA>(sResp);   // AltAz
+    m_nShadowTracking = -1; // the mount stops tracking once parked
+    if(!nErr) {
+        m_bSlewing = true;  // so isSlewToComplete actually checks
+        publishFlag(STATUS_SLEWING, true);
+    }
 
     return nErr;
 }
 
+int RST::gotoParkPosition()
+{
+    return gotoPark(m_dParkAlt, m_dParkAz);
+}
+
 
 int RST::getAtPark(bool &bParked)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     double dAlt, dAz;
     bool bTrackingOn = true;
@@ -1203,11 +3348,13 @@ int RST::getAtPark(bool &bParked)
     isHomingDone(bIsHomed);
     if(!bIsHomed) {
         bParked = true;
+        publishFlag(STATUS_PARKED, bParked);
         return nErr;
     }
 
     isTrackingOn(bTrackingOn);
     if(bTrackingOn) {
+        publishFlag(STATUS_PARKED, bParked);
         return nErr;
     }
 
@@ -1250,6 +3397,7 @@ int RST::getAtPark(bool &bParked)
     if(bAltOk && bAzOk) { // At Alt and Az park position and not tracking.. parked
         bParked = true;
     }
+    publishFlag(STATUS_PARKED, bParked);
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getAtPark] bParked   " << (bParked?"Yes":"No") << std::endl;
@@ -1261,6 +3409,8 @@ int RST::getAtPark(bool &bParked)
 
 int RST::unPark()
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+    axesMoved();
     int nErr = PLUGIN_OK;
     std::string sResp;
     bool bIsHomed;
@@ -1271,8 +3421,8 @@ int RST::unPark()
 #endif
     m_bUnparking = true;
 
-    nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-    std::this_thread::sleep_for(std::chrono::milliseconds(250)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_CtA>(sResp); // unpark, tracking on
+    m_nShadowTracking = nErr ? -1 : 1;
 
     nErr = isHomingDone(bIsHomed);
     if(nErr) {
@@ -1290,15 +3440,20 @@ int RST::unPark()
 void RST::setMountIsParked(bool bIsParked)
 {
     m_bIsParked = bIsParked;
+    publishFlag(STATUS_PARKED, bIsParked);
 }
 
 int RST::isUnparkDone(bool &bComplete)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     bool bAtPArk;
     // double dRa, dDec;
     std::string sResp;
     bool bTrackingOn = false;
+    bool bIsHomed = m_bIsHomed;
+    bool bTwice;
+    double dAlt;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isUnparkDone] Called." << std::endl;
@@ -1326,7 +3481,8 @@ int RST::isUnparkDone(bool &bComplete)
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isUnparkDone] Checking if homing is done" << std::endl;
     m_sLogFile.flush();
 #endif
-    nErr = isHomingDone(m_bIsHomed);
+    nErr = isHomingDone(bIsHomed);
+    m_bIsHomed = bIsHomed;
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isUnparkDone] error " << nErr << std::endl;
@@ -1352,12 +3508,19 @@ int RST::isUnparkDone(bool &bComplete)
     m_sLogFile.flush();
 #endif
 
-    // enabling tracking twice to bypass tracking prevention if Alt is at 0 or bellow. If parked at patk1 this is needed or tracking doesn't start
+    // enabling tracking twice to bypass tracking prevention if Alt is at 0 or bellow. If parked at patk1 this is needed or tracking doesn't start.
+    // Above that the first one takes and the second would only cost its pacing. Without an Alt we send both.
+    bTwice = sendCommand<CMD_GA>(sResp) || convertDDMMSSToDecDeg(rstReplyValue(CMD_GA, sResp), dAlt) || dAlt <= 0.0;
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isUnparkDone] Alt " << sResp << ", :CtA# " << (bTwice?"twice":"once") << std::endl;
+    m_sLogFile.flush();
+#endif
 
-    nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // need to give time to the mount to process the command
-    nErr = sendCommand(":CtA#", sResp); // unpark, tracking on
-    std::this_thread::sleep_for(std::chrono::milliseconds(50)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_CtA>(sResp); // unpark, tracking on
+    if(bTwice)
+        nErr = sendCommand<CMD_CtA>(sResp); // unpark, tracking on
+    // tracking is on now, only the rate goes out
+    m_nShadowTracking = nErr ? -1 : 1;
     setTrackingRates(true, true, 0.0, 0.0);
     std::this_thread::sleep_for(std::chrono::milliseconds(50)); // need to give time to the mount to process the command
 
@@ -1368,12 +3531,15 @@ int RST::isUnparkDone(bool &bComplete)
 #endif
 
     m_bIsParked = false;
+    publishFlag(STATUS_PARKED, false);
     return nErr;
 }
 
 
 int RST::homeMount()
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
+    axesMoved();
     int nErr = PLUGIN_OK;
     std::string sResp;
 
@@ -1382,7 +3548,10 @@ int RST::homeMount()
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":Ch#", sResp, 0);
+    nErr = sendCommand<CMD_Ch>(sResp);
+    // homing moves the axes its own way, we don't know how it leaves tracking
+    m_nShadowTracking = -1;
+    m_nShadowTrackingMode = STATUS_TRACKING_UNKNOWN;
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [homeMount] error " << nErr << " , response :" << sResp << std::endl;
@@ -1396,6 +3565,7 @@ int RST::homeMount()
 
 int RST::isHomingDone(bool &bIsHomed)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     std::string sResp;
 
@@ -1405,7 +3575,13 @@ int RST::isHomingDone(bool &bIsHomed)
 #endif
     bIsHomed = false;
 
-    nErr = sendCommand(":AH#", sResp);
+    // the first caller after connect gets the warm-up answer
+    if(waitWarmup(WARMUP_HOMING) && m_bWarmHomingValid) {
+        m_bWarmHomingValid = false;
+        sResp.assign(m_bIsHomed?"AH:0":"AH:1");
+    }
+    else
+        nErr = sendCommand<CMD_AH>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isHomingDone] AH error " << nErr <<" , response : " << sResp << std::endl;
@@ -1413,9 +3589,13 @@ int RST::isHomingDone(bool &bIsHomed)
 #endif
     }
 
-    if(sResp.size() >= 3 && sResp.at(3) == '0') {
+    if(rstReplyValue(CMD_AH, sResp)[0] == '0') {
             bIsHomed = true;
     }
+    if(!nErr) {
+        m_bIsHomed = bIsHomed;  // resumeLink uses this to spot a mount reset
+        publishFlag(STATUS_HOMED, bIsHomed);
+    }
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isHomingDone] bIsHomed : " << (bIsHomed?"Yes":"No") <<  std::endl;
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isHomingDone] m_bUnparking : " << (m_bUnparking?"Yes":"No") <<  std::endl;
@@ -1424,14 +3604,14 @@ int RST::isHomingDone(bool &bIsHomed)
 
     // check status
     if (bIsHomed && m_bUnparking) {
-        nErr = sendCommand(":GH#", sResp);
+        nErr = sendCommand<CMD_GH>(sResp);
         if(nErr) {
 #if defined PLUGIN_DEBUG
             m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isHomingDone] GH error " << nErr << ", response : " << sResp << std::endl;
             m_sLogFile.flush();
 #endif
         }
-        if(sResp.size() >= 3 && sResp.at(3) != 'O') {
+        if(rstReplyValue(CMD_GH, sResp).size() && rstReplyValue(CMD_GH, sResp)[0] != 'O') {
             if(m_nNbHomingTries == 0) {
                 m_nNbHomingTries++;
                 homeMount();
@@ -1452,6 +3632,7 @@ int RST::isHomingDone(bool &bIsHomed)
 
 int RST::isTrackingOn(bool &bTrackOn)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
     std::string sResp;
 
@@ -1461,7 +3642,7 @@ int RST::isTrackingOn(bool &bTrackOn)
 #endif
     bTrackOn = false;
 
-    nErr = sendCommand(":AT#", sResp, 2000);
+    nErr = sendCommand<CMD_AT>(sResp);
     if(nErr) {
         bTrackOn = true; // let's not break this because of an error, we're kind of ignoring the error here
 #if defined PLUGIN_DEBUG
@@ -1473,10 +3654,14 @@ int RST::isTrackingOn(bool &bTrackOn)
 
     if(sResp.size()==0) // there was a timeout probably
         bTrackOn = true;
-    else if(sResp.size() >= 3 && sResp.at(3) == '1')
+    else if(rstReplyValue(CMD_AT, sResp)[0] == '1') {
         bTrackOn = true;
-    else if(sResp.size() >= 3 && sResp.at(3) == '0')
+        m_nShadowTracking = 1;
+    }
+    else if(rstReplyValue(CMD_AT, sResp)[0] == '0') {
         bTrackOn = false;
+        m_nShadowTracking = 0;  // a limit or the hand pad can stop it behind our back
+    }
 
 #if defined PLUGIN_DEBUG
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [isTrackingOn] bTrackOn : " << (bTrackOn?"Yes":"No")<< std::endl;
@@ -1488,45 +3673,293 @@ int RST::isTrackingOn(bool &bTrackOn)
 
 int RST::Abort()
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_ACTION_DEADLINE);
     int nErr = PLUGIN_OK;
-    std::string sResp;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [Abort] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":Q#", sResp, 0);
+    // stop first, tidy up after. We don't wait for the I/O lock, a poll could hold it for a full timeout.
+    requestStopNonSiderealTracking();
+    nErr = writeCommandNow(":Q#");
+    m_Recorder.record(REC_ABORT, 0, nErr);
 
+    // the engine may have sent a pulse or a hop before it saw the stop request, that one needs its own :Q#
+    if(stopNonSiderealTracking())
+        nErr = writeCommandNow(":Q#");
+
+    // all atomics, nothing here waits for whoever holds m_OpMutex
     m_bUnparking = false;
-    
+    axesMoved();
+    m_nShadowTracking = -1;
+    // :Q# stops all motion
+    m_RaAxisMove.bMoving = false;
+    m_DecAxisMove.bMoving = false;
+
     return nErr;
 }
 
 #pragma mark - time and site methods
 int RST::syncTime()
+{
+    double dResidualMs;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncTime] Called." << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    return syncTimeCompensated(true, dResidualMs);
+}
+
+// Send :SL so that it reaches the mount right on a second boundary, the mount only takes whole seconds.
+int RST::syncTimeCompensated(bool bVerify, double &dResidualMs)
 {
     int nErr = PLUGIN_OK;
     int yy, mm, dd, h, min, dst;
     double sec;
+    double dWait;
+    int nTarget;
+    int nTry;
+    CStopWatch waitTimer;
     std::string sResp;
     std::stringstream ssTmp;
 
+    dResidualMs = 0.0;
+
+    nErr = measureLinkDelay(m_dLinkOneWayDelay);
+    if(nErr)
+        m_dLinkOneWayDelay = 0.0;
+
+    std::lock_guard<std::recursive_mutex> opLock(m_OpMutex);
+    // we wait for the second boundary without the I/O lock, if a poll makes us miss it we try the next one.
+    for(nTry = 0; nTry < TIME_SYNC_MAX_TRIES; nTry++) {
+        {
+            std::unique_lock<std::recursive_mutex> wireLock(m_DevMutex, std::defer_lock);
+            lockWire(wireLock);
+            waitCommandPacing(wireLock);
+        }
+
+        m_pHost->localDateTime(yy, mm, dd, h, min, sec, dst);
+        waitTimer.Reset();
+        // next second boundary the command can still make, keep a little margin for the write itself
+        nTarget = int(sec) + 1;
+        dWait = (nTarget - sec) - m_dLinkOneWayDelay;
+        if(dWait < 0.010) {
+            nTarget++;
+            dWait += 1.0;
+        }
+        nTarget += h * 3600 + min * 60;
+        nTarget %= 86400;
+
+        ssTmp.str("");
+        ssTmp << ":SL" << std::setfill('0') << std::setw(2) << nTarget / 3600 << ":" << std::setfill('0') << std::setw(2) << (nTarget % 3600) / 60 << ":" << std::setfill('0') << std::setw(2) << nTarget % 60 << "#";
+
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncTime] Called." << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncTimeCompensated] one way delay : " << std::fixed << std::setprecision(1) << m_dLinkOneWayDelay * 1000.0 << " ms" << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncTimeCompensated] sending " << ssTmp.str() << " in " << std::fixed << std::setprecision(1) << dWait * 1000.0 << " ms" << std::endl;
+        m_sLogFile.flush();
+#endif
+        std::this_thread::sleep_for(std::chrono::microseconds(int(dWait * 1000000.0)));
+
+        std::unique_lock<std::recursive_mutex> wireLock(m_DevMutex, std::defer_lock);
+        lockWire(wireLock);
+        waitCommandPacing(wireLock);
+        if(waitTimer.GetElapsedSeconds() - dWait > TIME_SYNC_LATE_TOLERANCE) {
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncTimeCompensated] the link was busy, missed the second by " << std::fixed << std::setprecision(1) << (waitTimer.GetElapsedSeconds() - dWait) * 1000.0 << " ms" << std::endl;
+            m_sLogFile.flush();
+#endif
+            nErr = ERR_CMDFAILED;
+            continue;
+        }
+        nErr = sendCommand<CMD_SL>(ssTmp.str(), sResp);
+        break;
+    }
+    if(nErr)
+        return nErr;
+
+    m_sTime.assign(ssTmp.str().substr(3, 8));
+    m_bTimeSynced = true;
+    m_TimeSyncTimer.Reset();
+    m_TimeDriftCheckTimer.Reset();
+    m_dClockDriftMsPerHour = 0.0;
+
+    if(!bVerify)
+        return nErr;
+
+    nErr = measureMountClockOffset(dResidualMs);
+    if(!nErr) {
+        m_dTimeSyncResidualMs = dResidualMs;
+        m_dLastClockOffsetMs = dResidualMs;
+    }
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncTimeCompensated] residual offset : " << std::fixed << std::setprecision(1) << dResidualMs << " ms" << std::endl;
+    m_sLogFile.flush();
+#endif
+    return nErr;
+}
+
+// cheap check (one :GL#), only pay for a precise measurement and a resync if it looks off.
+int RST::checkMountClockDrift()
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+    int nMountSeconds;
+    double dLocal;
+    double dOffsetMs;
+    double dHours;
+    double dResidualMs;
+    CStopWatch rttTimer;
+
+    if(!m_bTimeSynced || m_TimeDriftCheckTimer.GetElapsedSeconds() < TIME_DRIFT_CHECK_INTERVAL)
+        return nErr;
+    m_TimeDriftCheckTimer.Reset();
+
+    dLocal = localSecondsOfDay();
+    rttTimer.Reset();
+    nErr = sendCommand<CMD_GL>(sResp);
+    if(nErr || sResp.size() < 4)
+        return nErr;
+    dLocal += rttTimer.GetElapsedSeconds() / 2.0;
+    if(parseTimeHHMMSS(rstReplyValue(CMD_GL, sResp), nMountSeconds))
+        return ERR_PARSE;
+
+    // we don't know where in the second the mount is, assume the middle.
+    dOffsetMs = (nMountSeconds + 0.5 - dLocal) * 1000.0;
+    if(dOffsetMs > 43200000.0)
+        dOffsetMs -= 86400000.0;
+    else if(dOffsetMs < -43200000.0)
+        dOffsetMs += 86400000.0;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [checkMountClockDrift] coarse offset : " << std::fixed << std::setprecision(1) << dOffsetMs << " ms" << std::endl;
     m_sLogFile.flush();
 #endif
+    if(std::fabs(dOffsetMs) < TIME_DRIFT_CHECK_THRESHOLD)
+        return nErr;
 
-    m_pTsx->localDateTime(yy, mm, dd, h, min, sec, dst);
+    nErr = measureMountClockOffset(dOffsetMs);
+    if(nErr)
+        return nErr;
+
+    dHours = m_TimeSyncTimer.GetElapsedSeconds() / 3600.0;
+    if(dHours > 0.0)
+        m_dClockDriftMsPerHour = (dOffsetMs - m_dTimeSyncResidualMs) / dHours;
+    m_dLastClockOffsetMs = dOffsetMs;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [checkMountClockDrift] offset : " << std::fixed << std::setprecision(1) << dOffsetMs << " ms, drift : " << m_dClockDriftMsPerHour << " ms/h" << std::endl;
+    m_sLogFile.flush();
+#endif
 
-    ssTmp << ":SL" << std::setfill('0') << std::setw(2) << h << ":" << std::setfill('0') << std::setw(2) << min << ":" << std::setfill('0') << std::setw(2) << int(sec) << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
-    getLocalTime(m_sTime);
+    if(std::fabs(dOffsetMs) > TIME_DRIFT_RESYNC_THRESHOLD)
+        nErr = syncTimeCompensated(true, dResidualMs);
 
     return nErr;
 }
 
+void RST::getTimeSyncStatus(double &dResidualMs, double &dDriftMsPerHour, double &dLinkDelayMs)
+{
+    dResidualMs = m_dLastClockOffsetMs;
+    dDriftMsPerHour = m_dClockDriftMsPerHour;
+    dLinkDelayMs = m_dLinkOneWayDelay * 1000.0;
+}
+
+int RST::measureLinkDelay(double &dOneWayDelay)
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+    double dRtt;
+    double dBestRtt = -1.0;
+    CStopWatch rttTimer;
+
+    for(int i = 0; i < LINK_DELAY_SAMPLES; i++) {
+        rttTimer.Reset();
+        nErr = sendCommand<CMD_GL>(sResp);
+        dRtt = rttTimer.GetElapsedSeconds();
+        if(nErr)
+            continue;
+        if(dBestRtt < 0 || dRtt < dBestRtt)
+            dBestRtt = dRtt;
+    }
+    if(dBestRtt < 0)
+        return nErr;
+
+    // the fastest round trip has the least queuing in it
+    dOneWayDelay = dBestRtt / 2.0;
+    return PLUGIN_OK;
+}
+
+// Poll :GL# until the mount's second changes, the change tells us where the mount's second boundary is.
+int RST::measureMountClockOffset(double &dOffsetMs)
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+    int nMountSeconds;
+    int nPrevMountSeconds = -1;
+    double dPrevMid = 0.0;
+    double dSend, dMid;
+    double dLocal0;
+    double dEdge;
+    CStopWatch clock;
+
+    dOffsetMs = 0.0;
+    dLocal0 = localSecondsOfDay();
+    clock.Reset();
+
+    while(clock.GetElapsedSeconds() < 1.5) {
+        dSend = clock.GetElapsedSeconds();
+        nErr = sendCommand<CMD_GL>(sResp);
+        if(nErr)
+            return nErr;
+        dMid = (dSend + clock.GetElapsedSeconds()) / 2.0;
+        if(parseTimeHHMMSS(rstReplyValue(CMD_GL, sResp), nMountSeconds))
+            return ERR_PARSE;
+
+        if(nPrevMountSeconds >= 0 && nMountSeconds != nPrevMountSeconds) {
+            dEdge = dLocal0 + (dPrevMid + dMid) / 2.0;
+            dOffsetMs = (nMountSeconds - dEdge) * 1000.0;
+            if(dOffsetMs > 43200000.0)
+                dOffsetMs -= 86400000.0;
+            else if(dOffsetMs < -43200000.0)
+                dOffsetMs += 86400000.0;
+            return PLUGIN_OK;
+        }
+        nPrevMountSeconds = nMountSeconds;
+        dPrevMid = dMid;
+    }
+    return COMMAND_TIMEOUT;
+}
+
+double RST::localSecondsOfDay()
+{
+    int yy, mm, dd, h, min, dst;
+    double sec;
+
+    m_pHost->localDateTime(yy, mm, dd, h, min, sec, dst);
+    return h * 3600.0 + min * 60.0 + sec;
+}
+
+int RST::parseTimeHHMMSS(const std::string sTime, int &nSecondsOfDay)
+{
+    std::vector<std::string> vFieldsData;
+
+    nSecondsOfDay = 0;
+    if(parseFields(sTime, vFieldsData, ':') || vFieldsData.size() < 3)
+        return ERR_PARSE;
+
+    try {
+        nSecondsOfDay = std::stoi(vFieldsData[0]) * 3600 + std::stoi(vFieldsData[1]) * 60 + std::stoi(vFieldsData[2]);
+    }
+    catch(const std::exception& e) {
+        return ERR_PARSE;
+    }
+    return PLUGIN_OK;
+}
+
 
 int RST::syncDate()
 {
@@ -1541,13 +3974,12 @@ int RST::syncDate()
     m_sLogFile.flush();
 #endif
 
-    m_pTsx->localDateTime(yy, mm, dd, h, min, sec, dst);
+    m_pHost->localDateTime(yy, mm, dd, h, min, sec, dst);
     // yy is actually yyyy, need conversion to yy, 2017 -> 17
     yy = yy - (int(yy / 1000) * 1000);
 
     ssTmp << ":SC" << std::setfill('0') << std::setw(2) << mm << "/" << std::setfill('0') << std::setw(2) << dd << "/" << std::setfill('0') << std::setw(2) << yy << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_SC>(ssTmp.str(), sResp);
     getLocalDate(m_sDate);
     return nErr;
 }
@@ -1565,8 +3997,7 @@ int RST::setSiteLongitude(const std::string sLongitude)
 
     // :SgsDDD*MM'SS#
     ssTmp << ":Sg" << sLongitude << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_Sg>(ssTmp.str(), sResp);
 
     if(nErr) {
 #if defined PLUGIN_DEBUG
@@ -1590,8 +4021,7 @@ int RST::setSiteLatitude(const std::string sLatitude)
 
     // :StsDD*MM'SS#
     ssTmp << ":St" << sLatitude << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_St>(ssTmp.str(), sResp);
 
     if(nErr) {
 #if defined PLUGIN_DEBUG
@@ -1615,8 +4045,7 @@ int RST::setSiteTimezone(const std::string sTimezone)
     m_sLogFile.flush();
 #endif
     ssTmp << ":SG" << sTimezone << "#";
-    nErr = sendCommand(ssTmp.str(), sResp, 0);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    nErr = sendCommand<CMD_SG>(ssTmp.str(), sResp);
 
     if(nErr) {
 #if defined PLUGIN_DEBUG
@@ -1638,9 +4067,9 @@ int RST::getSiteLongitude(std::string &sLongitude)
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":Gg#", sResp);
+    nErr = sendCommand<CMD_Gg>(sResp);
     if(!nErr) {
-        sLongitude.assign(sResp.substr(3));
+        sLongitude.assign(rstReplyValue(CMD_Gg, sResp));
     }
 
     if(nErr) {
@@ -1663,9 +4092,9 @@ int RST::getSiteLatitude(std::string &sLatitude)
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":Gt#", sResp);
+    nErr = sendCommand<CMD_Gt>(sResp);
     if(!nErr) {
-        sLatitude.assign(sResp.substr(3));
+        sLatitude.assign(rstReplyValue(CMD_Gt, sResp));
     }
 
     if(nErr) {
@@ -1688,11 +4117,11 @@ int RST::getSiteTZ(std::string &sTimeZone)
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":GG#", sResp);
+    nErr = sendCommand<CMD_GG>(sResp);
     if(!nErr) {
         if(sResp.size() == 0)
             return ERR_CMDFAILED;
-        sTimeZone.assign(sResp.substr(3));
+        sTimeZone.assign(rstReplyValue(CMD_GG, sResp));
         if(sTimeZone.size() && sTimeZone.at(0) == '-') {
             sTimeZone[0] = '+';
         }
@@ -1716,12 +4145,7 @@ int RST::setSiteData(double dLongitude, double dLatitute, double dTimeZone)
     int nErr = PLUGIN_OK;
     std::string sLong;
     std::string sLat;
-    std::stringstream ssTimeZone;
-    std::stringstream  ssHH, ssMM;
-    int yy, mm, dd, h, min, dst;
-    double sec;
-    char cSign;
-    double dTimeZoneNew;
+    std::string sTimeZone;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] Called." << std::endl;
@@ -1736,12 +4160,47 @@ int RST::setSiteData(double dLongitude, double dLatitute, double dTimeZone)
     m_sLogFile.flush();
 #endif
 
+    formatSiteData(dLongitude, dLatitute, dTimeZone, sLong, sLat, sTimeZone);
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] sLong      : " << sLong << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] sLat       : " << sLat<< std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] sTimeZone  : " << sTimeZone << std::endl;
+    m_sLogFile.flush();
+#endif
+    // each write paces the next one (see rstprotocol.h)
+    nErr = setSiteLongitude(sLong);
+    nErr |= setSiteLatitude(sLat);
+    nErr |= setSiteTimezone(sTimeZone);
+    nErr |= syncDate();
+    nErr |= syncTime();
+
+    if(nErr) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] error " << nErr  << std::endl;
+        m_sLogFile.flush();
+#endif
+    }
+    // the limits pick up the new site on their next check
+    m_Limits.clearSite();
+
+    return nErr;
+}
+
+void RST::formatSiteData(double dLongitude, double dLatitute, double dTimeZone, std::string &sLong, std::string &sLat, std::string &sTimeZone)
+{
+    std::stringstream ssTimeZone;
+    int yy, mm, dd, h, min, dst;
+    double sec;
+    char cSign;
+    double dTimeZoneNew;
+
     convertDecDegToDDMMSS(dLongitude, sLong);
     convertDecDegToDDMMSS(dLatitute, sLat);
 
-    m_pTsx->localDateTime(yy, mm, dd, h, min, sec, dst);
+    m_pHost->localDateTime(yy, mm, dd, h, min, sec, dst);
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] dst        : " << (dst != 0 ?"Yes":"No") << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [formatSiteData] dst        : " << (dst != 0 ?"Yes":"No") << std::endl;
     m_sLogFile.flush();
 #endif
 
@@ -1752,43 +4211,116 @@ int RST::setSiteData(double dLongitude, double dLatitute, double dTimeZone)
     cSign = dTimeZoneNew>=0?'+':'-';
     dTimeZoneNew=std::fabs(dTimeZone);
 
-    ssTimeZone << cSign << std::setfill('0') << std::setw(2) << dTimeZoneNew;
+    ssTimeZone << cSign << std::setfill('0') << std::setw(2) << dTimeZoneNew;
+    sTimeZone.assign(ssTimeZone.str());
+}
+
+// Read what the mount has in one pipelined burst and only write back what differs, in one write.
+int RST::syncSiteDataOnConnect(double dLongitude, double dLatitute, double dTimeZone)
+{
+    int nErr = PLUGIN_OK;
+    std::string sLong;
+    std::string sLat;
+    std::string sTimeZone;
+    std::vector<std::string> svResps;
+    std::vector<std::string> svWrites;
+    std::stringstream ssTmp;
+    int yy, mm, dd, h, min, dst;
+    double sec;
+    double dMountValue;
+    double dWantedValue;
+    int nDeltaSeconds;
+    bool bSyncTime = false;
+    double dResidualMs;
+
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncSiteDataOnConnect] Called." << std::endl;
+    m_sLogFile.flush();
+#endif
+
+    formatSiteData(dLongitude, dLatitute, dTimeZone, sLong, sLat, sTimeZone);
+
+    nErr = sendCommandBurst({":Gg#", ":Gt#", ":GG#", ":GC#", ":GL#"}, svResps);
+    if(nErr || svResps.size() < 5) {
+#if defined PLUGIN_DEBUG
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncSiteDataOnConnect] burst read failed (" << nErr << "), doing a full site sync" << std::endl;
+        m_sLogFile.flush();
+#endif
+        return setSiteData(dLongitude, dLatitute, dTimeZone);
+    }
+
+    m_pHost->localDateTime(yy, mm, dd, h, min, sec, dst);
 
-    sLong.assign(sLong);
+    // longitude and latitude, compared as decimal degrees as the mount might not format them like we do.
+    convertDDMMSSToDecDeg(sLong, dWantedValue);
+    if(rstReplyValue(CMD_Gg, svResps[0]).empty() || convertDDMMSSToDecDeg(rstReplyValue(CMD_Gg, svResps[0]), dMountValue) || std::fabs(dMountValue - dWantedValue) > (1.5/3600.0))
+        svWrites.push_back(":Sg" + sLong + "#");
 
-    sLat.assign(sLat);
+    convertDDMMSSToDecDeg(sLat, dWantedValue);
+    if(rstReplyValue(CMD_Gt, svResps[1]).empty() || convertDDMMSSToDecDeg(rstReplyValue(CMD_Gt, svResps[1]), dMountValue) || std::fabs(dMountValue - dWantedValue) > (1.5/3600.0))
+        svWrites.push_back(":St" + sLat + "#");
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] sLong      : " << sLong << std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] sLat       : " << sLat<< std::endl;
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] ssTimeZone : " << ssTimeZone.str() << std::endl;
-    m_sLogFile.flush();
-#endif
-    nErr = setSiteLongitude(sLong);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    try {
+        if(rstReplyValue(CMD_GG, svResps[2]).empty() || std::fabs(std::stod(rstReplyValue(CMD_GG, svResps[2])) - std::stod(sTimeZone)) > 0.01)
+            svWrites.push_back(":SG" + sTimeZone + "#");
+    }
+    catch(const std::exception& e) {
+        svWrites.push_back(":SG" + sTimeZone + "#");
+    }
 
-    nErr |= setSiteLatitude(sLat);
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    // date is MM/DD/YY
+    ssTmp << std::setfill('0') << std::setw(2) << mm << "/" << std::setfill('0') << std::setw(2) << dd << "/" << std::setfill('0') << std::setw(2) << (yy % 100);
+    if(rstReplyValue(CMD_GC, svResps[3]) != ssTmp.str())
+        svWrites.push_back(":SC" + ssTmp.str() + "#");
+    m_sDate.assign(ssTmp.str());
 
-    nErr |= setSiteTimezone(ssTimeZone.str());
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    // time is HH:MM:SS, it's sent on its own below so it lands on a second boundary
+    if(rstReplyValue(CMD_GL, svResps[4]).empty() || compareTimeHHMMSS(rstReplyValue(CMD_GL, svResps[4]), h, min, int(sec), nDeltaSeconds) || std::abs(nDeltaSeconds) > SITE_SYNC_TIME_TOLERANCE)
+        bSyncTime = true;
+    else
+        m_sTime.assign(rstReplyValue(CMD_GL, svResps[4]));
 
-    nErr |= syncDate();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncSiteDataOnConnect] " << svWrites.size() << " field(s) to update, time " << (bSyncTime?"needs":"doesn't need") << " a sync" << std::endl;
+    for(const std::string &sCmd : svWrites)
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncSiteDataOnConnect] writing " << sCmd << std::endl;
+    m_sLogFile.flush();
+#endif
 
-    nErr |= syncTime();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
+    if(!svWrites.empty()) {
+        nErr = writeCommandBurst(svWrites);
+        setCommandPacing(SITE_DATA_PACING); // need to give time to the mount to process the commands
+    }
+    if(!nErr && bSyncTime)
+        nErr = syncTimeCompensated(false, dResidualMs);
 
     if(nErr) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setSiteData] error " << nErr  << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [syncSiteDataOnConnect] error " << nErr << std::endl;
         m_sLogFile.flush();
 #endif
     }
-
     return nErr;
 }
 
+int RST::compareTimeHHMMSS(const std::string sTime, int h, int min, int sec, int &nDeltaSeconds)
+{
+    int nMountSeconds;
+
+    nDeltaSeconds = 0;
+    if(parseTimeHHMMSS(sTime, nMountSeconds))
+        return ERR_PARSE;
+
+    nDeltaSeconds = nMountSeconds - (h * 3600 + min * 60 + sec);
+    // around midnight
+    if(nDeltaSeconds > 43200)
+        nDeltaSeconds -= 86400;
+    else if(nDeltaSeconds < -43200)
+        nDeltaSeconds += 86400;
+
+    return PLUGIN_OK;
+}
+
 int RST::getSiteData(std::string &sLongitude, std::string &sLatitude, std::string &sTimeZone)
 {
     int nErr = PLUGIN_OK;
@@ -1821,7 +4353,7 @@ int RST::getLocalTime(std::string &sTime)
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":GL#", sResp);
+    nErr = sendCommand<CMD_GL>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getLocalTime] error " << nErr << ", response : " << sResp << std::endl;
@@ -1831,7 +4363,7 @@ int RST::getLocalTime(std::string &sTime)
     }
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
-    sTime.assign(sResp.substr(3));
+    sTime.assign(rstReplyValue(CMD_GL, sResp));
 
     return nErr;
 }
@@ -1846,7 +4378,7 @@ int RST::getLocalDate(std::string &sDate)
     m_sLogFile.flush();
 #endif
 
-    nErr = sendCommand(":GC#", sResp);
+    nErr = sendCommand<CMD_GC>(sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getLocalDate] error " << nErr << ", response : " << sResp << std::endl;
@@ -1856,18 +4388,19 @@ int RST::getLocalDate(std::string &sDate)
     }
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
-    sDate.assign(sResp.substr(3));
+    sDate.assign(rstReplyValue(CMD_GC, sResp));
     return nErr;
 }
 
 int RST::getInputVoltage(double &dVolts)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr;
     std::string sResp;
 
     dVolts = 0.0;
 
-    nErr = sendCommand(":Cv#", sResp);
+    nErr = sendOptionalCommand(CAP_VOLTAGE, sResp);
     if(nErr) {
 #if defined PLUGIN_DEBUG
         m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getInputVoltage] error " << nErr << ", response : " << sResp << std::endl;
@@ -1879,7 +4412,8 @@ int RST::getInputVoltage(double &dVolts)
     try {
         if(sResp.size() == 0)
             return ERR_CMDFAILED;
-        dVolts = std::stod(sResp.substr(3));
+        dVolts = std::stod(rstReplyValue(CMD_Cv, sResp));
+        publishVoltage(dVolts);
     }
     catch(const std::exception& e) {
 #if defined PLUGIN_DEBUG
@@ -1896,203 +4430,86 @@ int RST::getInputVoltage(double &dVolts)
 
 void RST::convertDecDegToDDMMSS(double dDeg, std::string &sResult)
 {
-    int DD, MM, SS;
-    double mm, ss;
-    double dNewDeg;
-    std::stringstream ssTmp;
-    char cSign;
-
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDecDegToDDMMSS] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    sResult.clear();
-    // convert dDeg decimal value to sDD:MM:SS
-    dNewDeg = std::fabs(dDeg);
-    cSign = dDeg>=0?'+':'-';
-    DD = int(dNewDeg);
-    mm = dNewDeg - DD;
-    MM = int(mm*60);
-    ss = (mm*60) - MM;
-    SS = int(std::round(ss*60));
-
-    ssTmp << cSign << DD << "*" << std::setfill('0') << std::setw(2) << MM << "'" << std::setfill('0') << std::setw(2) << SS;
-    sResult.assign(ssTmp.str());
+    rstFormatDeg(dDeg, sResult);
 }
 
 void RST::convertDecAzToDDMMSSs(double dDeg, std::string &sResult)
 {
-    int DD, MM;
-    double mm, ss, SS;
-    double dNewDeg;
-    std::stringstream ssTmp;
-
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDecAzToDDMMSSs] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    sResult.clear();
-    // convert dDeg decimal value to DDD*MM:SS.S 
-    dNewDeg = std::fabs(dDeg);
-    DD = int(dNewDeg);
-    mm = dNewDeg - DD;
-    MM = int(mm*60);
-    ss = (mm*60) - MM;
-    SS = ss*60;
-
-    ssTmp << std::setfill('0') << std::setw(3) << DD << "*" << std::setfill('0') << std::setw(2) << MM << "'" << std::setfill('0') << std::setw(4) << std::fixed << std::setprecision(1) << SS;
-    sResult.assign(ssTmp.str());
+    rstFormatAz(dDeg, sResult);
 }
 
 void RST::convertDecDegToDDMMSS_ForDecl(double dDeg, std::string &sResult)
 {
-    int DD, MM;
-    double mm, ss, SS;
-    double dNewDeg;
-    char cSign;
-    std::stringstream ssTmp;
-
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDecDegToDDMMSS_ForDecl] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    sResult.clear();
-    // convert dDeg decimal value to sDD*MM:SS.S
-    dNewDeg = std::fabs(dDeg);
-    cSign = dDeg>=0?'+':'-';
-    DD = int(dNewDeg);
-    mm = dNewDeg - DD;
-    MM = int(mm*60);
-    ss = (mm*60) - MM;
-    SS = ss*60;
-
-    ssTmp << cSign << std::setfill('0') << std::setw(2) << DD << "*" << std::setfill('0') << std::setw(2) << MM << ":" << std::setfill('0') << std::setw(4) << std::fixed << std::setprecision(1)<< SS;
-    sResult.assign(ssTmp.str());
+    rstFormatDec(dDeg, sResult);
 }
 
 int RST::convertDDMMSSToDecDeg(const std::string sStrDeg, double &dDecDeg)
 {
-    int nErr = PLUGIN_OK;
-    std::vector<std::string> vFieldsData;
-    std::string newDec;
-
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    dDecDeg = 0;
-    // dec is in a weird format.
-    newDec.assign(sStrDeg);
-
-    std::replace(newDec.begin(), newDec.end(), '*', ':' );
-    std::replace(newDec.begin(), newDec.end(), '\'', ':' );
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] newDec = " << newDec << std::endl;
-    m_sLogFile.flush();
-#endif
-
-    nErr = parseFields(newDec, vFieldsData, ':');
-    if(nErr) {
+    if(!rstParseDeg(sStrDeg, dDecDeg)) {
 #if defined PLUGIN_DEBUG
-        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] parseFields error " << nErr << std::endl;
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] can't parse '" << sStrDeg << "'" << std::endl;
         m_sLogFile.flush();
 #endif
-        return nErr;
+        return ERR_PARSE;
     }
-    if(vFieldsData.size() >= 3) {
-        try {
-            dDecDeg = std::stod(vFieldsData[0]);
-            if(dDecDeg <0) {
-                dDecDeg = dDecDeg - std::stod(vFieldsData[1])/60.0 - std::stod(vFieldsData[2])/3600.0;
-            }
-            else {
-                dDecDeg = dDecDeg + std::stod(vFieldsData[1])/60.0 + std::stod(vFieldsData[2])/3600.0;
-            }
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] dDecDeg = " << std::fixed << std::setprecision(12) << dDecDeg << std::endl;
-            m_sLogFile.flush();
-#endif
-        }
-        catch(const std::exception& e) {
-#if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] conversion exception : " << e.what() << std::endl;
-            m_sLogFile.flush();
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] dDecDeg = " << std::fixed << std::setprecision(12) << dDecDeg << std::endl;
+    m_sLogFile.flush();
 #endif
-            return ERR_PARSE;
-        }
-
-    }
-    else
-        nErr = ERR_PARSE;
-
-    return nErr;
+    return PLUGIN_OK;
 }
 
 void RST::convertRaToHHMMSSt(double dRa, std::string &sResult)
 {
-    int HH, MM;
-    double hh, mm, SSt;
-    std::stringstream ssTmp;
-
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertRaToHHMMSSt] Called." << std::endl;
     m_sLogFile.flush();
 #endif
 
-    sResult.clear();
-    // convert Ra value to HH:MM:SS.S
-    HH = int(dRa);
-    hh = dRa - HH;
-    MM = int(hh*60);
-    mm = (hh*60) - MM;
-    SSt = mm * 60;
-
-    ssTmp << std::setfill('0') << std::setw(2) << HH << ":" << std::setfill('0') << std::setw(2) << MM << ":" << std::setfill('0') << std::setw(4) << std::fixed << std::setprecision(1) << SSt;
-    sResult.assign(ssTmp.str());
+    rstFormatRa(dRa, sResult);
 }
 
 
 int RST::convertHHMMSStToRa(const std::string szStrRa, double &dRa)
 {
-    int nErr = PLUGIN_OK;
-    std::vector<std::string> vFieldsData;
-
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertHHMMSStToRa] Called." << std::endl;
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertHHMMSStToRa] szStrRa = '" <<  szStrRa << "'" << std::endl;
     m_sLogFile.flush();
 #endif
 
-    dRa = 0;
-
-    nErr = parseFields(szStrRa, vFieldsData, ':');
-    if(nErr)
-        return nErr;
-
-    if(vFieldsData.size() >= 3) {
-        try {
-            dRa = std::stod(vFieldsData[0]) + std::stod(vFieldsData[1])/60.0 + std::stod(vFieldsData[2])/3600.0;
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertDDMMSSToDecDeg] dRa = " << std::fixed << std::setprecision(12) << dRa << std::endl;
-            m_sLogFile.flush();
-#endif
-        }
-        catch(const std::exception& e) {
+    if(!rstParseRa(szStrRa, dRa)) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertHHMMSStToRa] conversion exception : " << e.what() << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertHHMMSStToRa] can't parse '" << szStrRa << "'" << std::endl;
+        m_sLogFile.flush();
 #endif
-            return ERR_PARSE;
-        }
+        return ERR_PARSE;
     }
-    else
-        nErr = ERR_PARSE;
-
-    return nErr;
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [convertHHMMSStToRa] dRa = " << std::fixed << std::setprecision(12) << dRa << std::endl;
+    m_sLogFile.flush();
+#endif
+    return PLUGIN_OK;
 }
 
 
@@ -2109,20 +4526,19 @@ int RST::getDecAxisAlignmentOffset(double &dOffset)
     m_sLogFile.flush();
 #endif
 
+    if(waitWarmup(WARMUP_ALIGN_OFFSET) && m_bAlignOffsetValid) {
+        dOffset = m_dAlignOffset;
+        return nErr;
+    }
+
     // get Dec Axis Alignment Offset
-    nErr = sendCommand(":CG3#", sResp);
+    nErr = sendOptionalCommand(CAP_ALIGN_OFFSET, sResp);
     if(nErr) {
-        if(nErr == COMMAND_TIMEOUT) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
-            nErr = sendCommand(":CG3#", sResp);
-        }
-        if(nErr) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getDecAxisAlignmentOffset] :CG3# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [getDecAxisAlignmentOffset] :CG3# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            return nErr;
-        }
+        return nErr;
     }
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
@@ -2134,7 +4550,9 @@ int RST::getDecAxisAlignmentOffset(double &dOffset)
         if(sResp.size() == 0)
             return ERR_CMDFAILED;
 
-        dOffset = std::stod(sResp.substr(3));
+        dOffset = std::stod(rstReplyValue(CMD_CG3, sResp));
+        m_dAlignOffset = dOffset;
+        m_bAlignOffsetValid = true;
     }
     catch(const std::exception& e) {
 #if defined PLUGIN_DEBUG
@@ -2148,12 +4566,9 @@ int RST::getDecAxisAlignmentOffset(double &dOffset)
 
 int RST::IsBeyondThePole(bool &bBeyondPole)
 {
+    RSTApiDeadline apiDeadline(WATCHDOG_QUERY_DEADLINE);
     int nErr = PLUGIN_OK;
-    std::string sResp;
-    std::vector<std::string> vFieldsData;
-    double dDecAxis = 0;
-    double dDecAxisForSideOfPier = 0;
-    double dOffset = 0;
+    bool bGoto;
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
     m_sLogFile << "["<<getTimeStamp()<<"]"<< " [IsBeyondThePole] Called." << std::endl;
@@ -2166,35 +4581,174 @@ int RST::IsBeyondThePole(bool &bBeyondPole)
         return nErr;
     }
 
+    // tracking doesn't change the side, only the moves do
+    if(m_PierSide.getSide(bBeyondPole))
+        return nErr;
+
+    nErr = readPierSide(bBeyondPole);
+    if(nErr == COMMAND_NOT_SUPPORTED || nErr == ERR_PARSE)
+        return PLUGIN_OK; // not on this firmware (m_Caps), nothing to read
+    if(nErr)
+        return ERR_CMDFAILED;   // no answer, or a timeout
+    // the side isn't settled until the goto is over
+    if(!m_bSlewing) {
+        bGoto = m_bPierGoto.exchange(false);
+        m_PierSide.anchor(bBeyondPole, bGoto, m_dPierGotoHourAngle, m_dPierGotoDec);
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [IsBeyondThePole] anchored, flip hour angle : " << m_PierSide.getFlipHourAngle() << std::endl;
+        m_sLogFile.flush();
+#endif
+    }
+    return nErr;
+}
+
+int RST::predictPierSide(double dRa, double dDec, int &nPierSide)
+{
+    int nErr;
+
+    nErr = loadLimitSite();
+    nPierSide = m_PierSide.predict(dRa, dDec, limitsSiderealTime());
+    return nErr;
+}
+
+int RST::predictPierSide(const std::vector<RSTTarget> &vTargets, std::vector<int> &vPierSides)
+{
+    int nErr;
+
+    nErr = loadLimitSite();
+    m_PierSide.predict(vTargets, limitsSiderealTime(), vPierSides);
+    return nErr;
+}
+
+int RST::estimateSlewDuration(double dRa, double dDec, double &dSeconds)
+{
+    int nErr;
+
+    nErr = loadLimitSite();
+    loadSlewSpeed();
+    dSeconds = m_SlewModel.estimate(slewTravel(dRa, dDec));
+    return nErr;
+}
+
+void RST::getSlewTimeStats(unsigned long &nSlews, double &dMeanAbsError, double &dMeanError, unsigned long &nPollsSkipped)
+{
+    m_SlewModel.getStats(nSlews, dMeanAbsError, dMeanError);
+    nPollsSkipped = m_nSlewPollsSkipped;
+}
+
+// the max speed setting is the model's starting guess, once per connection (or after it changes)
+void RST::loadSlewSpeed()
+{
+    int nSpeed = 0;
+
+    if(m_bSlewModelSpeed)
+        return;
+    if(getSpeed(PLUGIN_NB_SLEW_SPEEDS - 1, nSpeed) == PLUGIN_OK && nSpeed > 0) {
+        m_SlewModel.setMaxSpeed(nSpeed);
+        m_bSlewModelSpeed = true;
+    }
+}
+
+int RST::optimizeSequence(const std::vector<RSTSequenceTarget> &vTargets, RSTSequence &Sequence, double dNightEnd, int nBudgetMs)
+{
+    int nErr;
+    double dLst;
+    RSTSequenceOptimizer Optimizer(m_SlewModel, m_PierSide, m_Limits);
+
+    nErr = loadLimitSite();
+    loadSlewSpeed();
+    dLst = limitsSiderealTime();
+    Optimizer.optimize(vTargets, dLst, m_dRa, m_dDec, westOfPierNow(dLst), dNightEnd, Sequence, nBudgetMs);
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [optimizeSequence] " << Sequence.vOrder.size() << " of " << vTargets.size() << " targets, slews " << Sequence.dSlewSeconds << " s, "
+               << Sequence.nFlips << " flips, in " << Sequence.dElapsedMs << " ms" << std::endl;
+    m_sLogFile.flush();
+#endif
+    return nErr;
+}
+
+// from the last known position, on the side we are now to the side the goto will pick
+double RST::slewTravel(double dRa, double dDec)
+{
+    double dLst = limitsSiderealTime();
+    bool bFromWest = westOfPierNow(dLst);
+    int nToSide = m_PierSide.predict(dRa, dDec, dLst, bFromWest ? STATUS_PIER_WEST : STATUS_PIER_EAST);
+
+    return m_SlewModel.axisTravel(RSTPierSideModel::hourAngle(m_dRa, dLst), m_dDec, bFromWest,
+                                  RSTPierSideModel::hourAngle(dRa, dLst), dDec, nToSide == STATUS_PIER_WEST);
+}
+
+bool RST::westOfPierNow(double dLst)
+{
+    bool bWest;
+
+    if(!m_PierSide.getSide(bWest))
+        bWest = (m_PierSide.predict(m_dRa, m_dDec, dLst) == STATUS_PIER_WEST);
+    return bWest;
+}
+
+// a MM0 seen on the wire, the goto being timed ended about now
+void RST::noticeSlewDone()
+{
+    double dNotYet = -1.0;
+
+    if(m_bSlewTimed)
+        m_dSlewDoneNotice.compare_exchange_strong(dNotYet, m_SlewTimer.GetElapsedSeconds());
+}
+
+// with the I/O lock held, look for a MM0 in what came in since the last command
+void RST::peekSlewDone()
+{
+    char szBuf[SERIAL_BUFFER_SIZE];
+    unsigned long ulBytesRead = 0;
+    int nBytesWaiting = 0;
+
+    if(m_pSerx->bytesWaitingRx(nBytesWaiting) || nBytesWaiting <= 0)
+        return;
+    if(nBytesWaiting >= SERIAL_BUFFER_SIZE)
+        nBytesWaiting = SERIAL_BUFFER_SIZE - 1;
+    if(m_pSerx->readFile(szBuf, nBytesWaiting, ulBytesRead, MAX_READ_WAIT_TIMEOUT))
+        return;
+    szBuf[ulBytesRead] = 0;
+    m_Metrics.addBytesReceived(ulBytesRead);
+    if(strstr(szBuf, "MM0"))
+        noticeSlewDone();
+}
+
+int RST::readPierSide(bool &bBeyondPole)
+{
+    int nErr = PLUGIN_OK;
+    std::string sResp;
+    std::vector<std::string> vFieldsData;
+    double dDecAxis = 0;
+    double dDecAxisForSideOfPier = 0;
+    double dOffset = 0;
+
+    bBeyondPole = false;
+
     nErr = getDecAxisAlignmentOffset(dOffset);
     if(nErr) {
-        return PLUGIN_OK; // might not be supported by this firmware.
+        return nErr; // might not be supported by this firmware, see m_Caps
     }
 
     // get Side of pier
-    nErr = sendCommand(":CY#", sResp);
+    nErr = sendOptionalCommand(CAP_PIER_SIDE, sResp);
     if(nErr) {
-        if(nErr == COMMAND_TIMEOUT) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100)); // need to give time to the mount to process the command
-            nErr = sendCommand(":CY#", sResp);
-        }
-        if(nErr) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [IsBeyondThePole] :CY# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
-            m_sLogFile.flush();
+        m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readPierSide] :CY# ERROR : " << nErr << " , sResp : " << sResp << std::endl;
+        m_sLogFile.flush();
 #endif
-            return PLUGIN_OK; // might not be supported by this firmware.
-        }
+        return nErr; // COMMAND_NOT_SUPPORTED by this firmware, or no answer
     }
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [IsBeyondThePole]  sResp : " << sResp << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readPierSide]  sResp : " << sResp << std::endl;
     m_sLogFile.flush();
 #endif
     if(sResp.size() == 0)
         return ERR_CMDFAILED;
 
-    parseFields(sResp.substr(3), vFieldsData, '/');
+    parseFields(rstReplyValue(CMD_CY, sResp), vFieldsData, '/');
     if(vFieldsData.size() >1) {
         try {
             dDecAxis = std::stoi(vFieldsData[0]);
@@ -2202,19 +4756,22 @@ int RST::IsBeyondThePole(bool &bBeyondPole)
         }
         catch(const std::exception& e) {
 #if defined PLUGIN_DEBUG
-            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [IsBeyondThePole] conversion exception : " << e.what() << std::endl;
+            m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readPierSide] conversion exception : " << e.what() << std::endl;
             m_sLogFile.flush();
 #endif
-            return PLUGIN_OK; // might not be supported by this firmware.
+            return ERR_PARSE; // might not be supported by this firmware.
         }
     }
+    else
+        return ERR_PARSE;
 
     // “beyond the pole” =  “telescope west of the pier”,
     if (dDecAxisForSideOfPier > 90)
         bBeyondPole = true;
+    publishPierSide(bBeyondPole);
 
 #if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [IsBeyondThePole]  bBeyondPole : " << (bBeyondPole?"Yes":"No") << std::endl;
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [readPierSide]  bBeyondPole : " << (bBeyondPole?"Yes":"No") << std::endl;
     m_sLogFile.flush();
 #endif
 
@@ -2226,34 +4783,253 @@ void RST::setStopTrackingOnDisconnect(bool bStop)
     m_bStopTrackingOnDisconnect = bStop;
 }
 
+#pragma mark - shared memory status
+void RST::setStatusPublishing(const std::string &sName)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+
+    if(sName == m_sStatusName)
+        return;
+    m_StatusPublisher.close();
+    m_sStatusName = sName;
+    if(m_bIsConnected && !m_sStatusName.empty() && m_StatusPublisher.open(m_sStatusName) == SB_OK)
+        m_StatusPublisher.publish(m_Status);
+}
 
-#pragma mark - Parse result
-int RST::parseFields(const std::string sIn, std::vector<std::string> &svFields, char cSeparator)
+void RST::getStatusSnapshot(RSTStatusSnapshot &Snapshot)
 {
-    int nErr = PLUGIN_OK;
-    std::string sSegment;
-    std::stringstream ssTmp(sIn);
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+    Snapshot = m_Status;
+}
 
-#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
-    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] Called." << std::endl;
+#pragma mark - metrics
+int RST::setMetricsPort(int nPort)
+{
+    int nErr;
+
+    if(nPort <= 0) {
+        m_MetricsServer.stop();
+        return PLUGIN_OK;
+    }
+    if(nPort == m_MetricsServer.getPort())
+        return PLUGIN_OK;
+    nErr = m_MetricsServer.start(nPort, [this](std::string &sOut) { formatMetrics(sOut); });
+#if defined PLUGIN_DEBUG
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setMetricsPort] 127.0.0.1:" << nPort << (nErr?" failed, error ":" listening") << (nErr?std::to_string(nErr):"") << std::endl;
     m_sLogFile.flush();
 #endif
-    if(sIn.size() == 0)
-        return ERR_PARSE;
-    
-    svFields.clear();
-    // split the string into vector elements
-    while(std::getline(ssTmp, sSegment, cSeparator))
-    {
-        svFields.push_back(sSegment);
+    return nErr;
+}
+
+// Runs on the listener thread. Counters, atomics and the status snapshot only : nothing here waits for the link.
+void RST::formatMetrics(std::string &sOut)
+{
+    RSTStatusSnapshot Snap;
+    char szLine[512];
+    int nState;
+    int nTrips;
+    int nTimeouts;
+    unsigned long nLocks;
+    unsigned long nContended;
+    double dTotalWaitMs;
+    double dMaxWaitMs;
+    unsigned long nWatchdogEvents[WATCHDOG_EVENT_COUNT];
+    unsigned long nRecovered;
+    double dTotalRecoveryMs;
+    double dMaxRecoveryMs;
+    unsigned long nSlews;
+    double dSlewAbsError;
+    double dSlewError;
+    unsigned long nPollsSkipped;
+    unsigned long nWritesSkipped;
+    double dSleepSavedMs;
+    unsigned long nQueriesSent;
+    unsigned long nQueriesShared;
+    int nMode;
+    int nEvent;
+    const char *pszModes[] = {"off", "sidereal", "solar", "lunar", "custom"};
+    const char *pszWatchdogEvents[] = {"api_deadline", "command_deadline", "notice_flood"};
+
+    getStatusSnapshot(Snap);
+    getLinkBreakerStatus(nState, nTrips, nTimeouts);
+    getWireLockStats(nLocks, nContended, dTotalWaitMs, dMaxWaitMs);
+    getWatchdogStats(nWatchdogEvents, nRecovered, dTotalRecoveryMs, dMaxRecoveryMs);
+
+    sOut.reserve(16384);
+    m_Metrics.format(sOut);
+
+    snprintf(szLine, sizeof(szLine), "# HELP rst_link_breaker_state Link circuit breaker, 0 closed, 1 open, 2 half open.\n# TYPE rst_link_breaker_state gauge\nrst_link_breaker_state %d\n", nState);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_link_breaker_trips_total Times the breaker opened.\n# TYPE rst_link_breaker_trips_total counter\nrst_link_breaker_trips_total %d\n", nTrips);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_link_consecutive_timeouts Timeouts since the last answer.\n# TYPE rst_link_consecutive_timeouts gauge\nrst_link_consecutive_timeouts %d\n", nTimeouts);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_link_resumes_total Times the port was reopened and the session resumed.\n# TYPE rst_link_resumes_total counter\nrst_link_resumes_total %d\n", getResumeCount());
+    sOut += szLine;
+
+    snprintf(szLine, sizeof(szLine), "# HELP rst_io_lock_acquisitions_total I/O lock acquisitions.\n# TYPE rst_io_lock_acquisitions_total counter\nrst_io_lock_acquisitions_total %lu\n", nLocks);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_io_lock_contended_total I/O lock acquisitions that had to wait.\n# TYPE rst_io_lock_contended_total counter\nrst_io_lock_contended_total %lu\n", nContended);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_io_lock_wait_seconds_total Time spent waiting for the I/O lock.\n# TYPE rst_io_lock_wait_seconds_total counter\nrst_io_lock_wait_seconds_total %.6f\n", dTotalWaitMs / 1000.0);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_io_lock_wait_max_seconds Longest wait for the I/O lock.\n# TYPE rst_io_lock_wait_max_seconds gauge\nrst_io_lock_wait_max_seconds %.6f\n", dMaxWaitMs / 1000.0);
+    sOut += szLine;
+
+    sOut += "# HELP rst_watchdog_events_total Commands stopped by the watchdog.\n# TYPE rst_watchdog_events_total counter\n";
+    for(nEvent = WATCHDOG_API_DEADLINE; nEvent < WATCHDOG_EVENT_COUNT; nEvent++) {
+        snprintf(szLine, sizeof(szLine), "rst_watchdog_events_total{reason=\"%s\"} %lu\n", pszWatchdogEvents[nEvent], nWatchdogEvents[nEvent]);
+        sOut += szLine;
     }
+    snprintf(szLine, sizeof(szLine), "# HELP rst_watchdog_resyncs_total Watchdog recoveries that got a clean answer back.\n# TYPE rst_watchdog_resyncs_total counter\nrst_watchdog_resyncs_total %lu\n", nRecovered);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_watchdog_recovery_seconds_total Time spent purging and re-syncing after a watchdog event.\n# TYPE rst_watchdog_recovery_seconds_total counter\nrst_watchdog_recovery_seconds_total %.6f\n", dTotalRecoveryMs / 1000.0);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_watchdog_recovery_max_seconds Longest watchdog recovery.\n# TYPE rst_watchdog_recovery_max_seconds gauge\nrst_watchdog_recovery_max_seconds %.6f\n", dMaxRecoveryMs / 1000.0);
+    sOut += szLine;
+
+    getSlewTimeStats(nSlews, dSlewAbsError, dSlewError, nPollsSkipped);
+    snprintf(szLine, sizeof(szLine), "# HELP rst_slew_timed_total Gotos the slew time model learned from.\n# TYPE rst_slew_timed_total counter\nrst_slew_timed_total %lu\n", nSlews);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_slew_eta_error_seconds Recent mean absolute error of the goto duration predictions.\n# TYPE rst_slew_eta_error_seconds gauge\nrst_slew_eta_error_seconds %.3f\n", dSlewAbsError);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_slew_polls_skipped_total Completion polls answered from the ETA without asking the mount.\n# TYPE rst_slew_polls_skipped_total counter\nrst_slew_polls_skipped_total %lu\n", nPollsSkipped);
+    sOut += szLine;
+
+    getQuerySharingStats(nQueriesSent, nQueriesShared);
+    snprintf(szLine, sizeof(szLine), "# HELP rst_status_queries_sent_total Status queries that went to the mount.\n# TYPE rst_status_queries_sent_total counter\nrst_status_queries_sent_total %lu\n", nQueriesSent);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_status_queries_shared_total Status queries answered with the answer to an identical one in flight or just done.\n# TYPE rst_status_queries_shared_total counter\nrst_status_queries_shared_total %lu\n", nQueriesShared);
+    sOut += szLine;
+
+    getWriteShadowStats(nWritesSkipped, dSleepSavedMs);
+    snprintf(szLine, sizeof(szLine), "# HELP rst_writes_skipped_total Setting writes not sent because the mount already had the value, this connection.\n# TYPE rst_writes_skipped_total counter\nrst_writes_skipped_total %lu\n", nWritesSkipped);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_write_pacing_saved_seconds_total Pacing the skipped writes would have cost, this connection.\n# TYPE rst_write_pacing_saved_seconds_total counter\nrst_write_pacing_saved_seconds_total %.3f\n", dSleepSavedMs / 1000.0);
+    sOut += szLine;
+
+    snprintf(szLine, sizeof(szLine), "# HELP rst_supply_volts Mount supply voltage, last sample.\n# TYPE rst_supply_volts gauge\nrst_supply_volts %.2f\n", Snap.dVolts);
+    sOut += szLine;
+    sOut += "# HELP rst_tracking_mode Current tracking mode, 1 for the active one.\n# TYPE rst_tracking_mode gauge\n";
+    for(nMode = STATUS_TRACKING_OFF; nMode <= STATUS_TRACKING_CUSTOM; nMode++) {
+        snprintf(szLine, sizeof(szLine), "rst_tracking_mode{mode=\"%s\"} %d\n", pszModes[nMode], Snap.nTrackingMode == nMode?1:0);
+        sOut += szLine;
+    }
+    snprintf(szLine, sizeof(szLine), "# HELP rst_pier_side_west 1 when the mount is beyond the pole, -1 when unknown.\n# TYPE rst_pier_side_west gauge\nrst_pier_side_west %d\n",
+             Snap.nPierSide == STATUS_PIER_UNKNOWN?-1:(Snap.nPierSide == STATUS_PIER_WEST?1:0));
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_connected Link to the mount is open.\n# TYPE rst_connected gauge\nrst_connected %d\n", (Snap.nFlags & STATUS_CONNECTED)?1:0);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_slewing Mount is slewing.\n# TYPE rst_slewing gauge\nrst_slewing %d\n", (Snap.nFlags & STATUS_SLEWING)?1:0);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_parked Mount is parked.\n# TYPE rst_parked gauge\nrst_parked %d\n", (Snap.nFlags & STATUS_PARKED)?1:0);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_homed Mount is homed.\n# TYPE rst_homed gauge\nrst_homed %d\n", (Snap.nFlags & STATUS_HOMED)?1:0);
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_metrics_scrapes_total Scrapes served, this one included.\n# TYPE rst_metrics_scrapes_total counter\nrst_metrics_scrapes_total %llu\n",
+             (unsigned long long)m_MetricsServer.getScrapeCount() + 1);
+    sOut += szLine;
+}
 
-    if(svFields.size()==0) {
-        nErr = ERR_PARSE;
+#pragma mark - history recorder
+int RST::setRecording(const std::string &sPath, int nSizeMB)
+{
+    int nErr;
+
+    if(sPath.empty()) {
+        m_Recorder.close();
+        return PLUGIN_OK;
     }
+    nErr = m_Recorder.open(sPath, nSizeMB);
+#if defined PLUGIN_DEBUG
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [setRecording] " << sPath << " (" << nSizeMB << " MB) : " << (nErr?"not recording, error ":"recording") << (nErr?std::to_string(nErr):"") << std::endl;
+    m_sLogFile.flush();
+#endif
     return nErr;
 }
 
+void RST::publishPosition(double dRa, double dDec)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+
+    m_Status.dRa = dRa;
+    m_Status.dDec = dDec;
+    m_Status.nRaDecTime = RSTStatusPublisher::now();
+    m_StatusPublisher.publish(m_Status);
+}
+
+void RST::publishAltAz(double dAlt, double dAz)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+
+    m_Status.dAlt = dAlt;
+    m_Status.dAz = dAz;
+    m_Status.nAltAzTime = RSTStatusPublisher::now();
+    m_StatusPublisher.publish(m_Status);
+}
+
+void RST::publishTracking(int nMode, double dRaRate, double dDecRate)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+
+    if(m_Status.nTrackingMode != nMode)
+        m_Recorder.record(REC_TRACKING, nMode, 0);
+    m_nTrackingState = nMode;
+    m_Status.nTrackingMode = nMode;
+    m_Status.dRaRate = dRaRate;
+    m_Status.dDecRate = dDecRate;
+    m_Status.nTrackingTime = RSTStatusPublisher::now();
+    m_StatusPublisher.publish(m_Status);
+}
+
+void RST::publishPierSide(bool bBeyondPole)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+    int nPierSide = bBeyondPole?STATUS_PIER_WEST:STATUS_PIER_EAST;
+
+    if(m_Status.nPierSide != nPierSide)
+        m_Recorder.record(REC_PIER_SIDE, nPierSide, 0);
+    m_Status.nPierSide = nPierSide;
+    m_Status.nPierSideTime = RSTStatusPublisher::now();
+    m_StatusPublisher.publish(m_Status);
+}
+
+void RST::publishFlag(uint32_t nFlag, bool bSet)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+
+    if(((m_Status.nFlags & nFlag) != 0) != bSet)
+        m_Recorder.record(REC_FLAG, nFlag, bSet?1:0);
+    if(bSet)
+        m_Status.nFlags |= nFlag;
+    else
+        m_Status.nFlags &= ~nFlag;
+    m_Status.nFlagsTime = RSTStatusPublisher::now();
+    m_StatusPublisher.publish(m_Status);
+}
+
+void RST::publishVoltage(double dVolts)
+{
+    std::lock_guard<std::mutex> lock(m_StatusMutex);
+
+    // every sample, that's the trend we want to see after the night
+    m_Recorder.record(REC_VOLTAGE, 0, (int32_t)lround(dVolts * 1000.0));
+    m_Status.dVolts = dVolts;
+    m_Status.nVoltageTime = RSTStatusPublisher::now();
+    m_StatusPublisher.publish(m_Status);
+}
+
+
+#pragma mark - Parse result
+int RST::parseFields(const std::string sIn, std::vector<std::string> &svFields, char cSeparator)
+{
+#if defined PLUGIN_DEBUG && PLUGIN_DEBUG >= 2
+    m_sLogFile << "["<<getTimeStamp()<<"]"<< " [parseFields] Called." << std::endl;
+    m_sLogFile.flush();
+#endif
+    return rstParseFields(sIn, svFields, cSeparator) ? PLUGIN_OK : ERR_PARSE;
+}
+
 #ifdef PLUGIN_DEBUG
 void RST::log(std::string sLogEntry)
 {
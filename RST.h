@@ -15,30 +15,94 @@
 #include <ctime>
 #include <cmath>
 #include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <type_traits>
+#include <memory>
 
-#include "../../licensedinterfaces/sberrorx.h"
-#include "../../licensedinterfaces/theskyxfacadefordriversinterface.h"
-#include "../../licensedinterfaces/serxinterface.h"
-#include "../../licensedinterfaces/mountdriverinterface.h"
-#include "../../licensedinterfaces/mount/asymmetricalequatorialinterface.h"
-
+#include "rsttransport.h"
 #include "StopWatch.h"
+#include "rststatus.h"
+#include "rstrecorder.h"
+#include "rstmetrics.h"
+#include "rstlimits.h"
+#include "rstpierside.h"
+#include "rstslewmodel.h"
+#include "rstsequence.h"
+#include "rstcaps.h"
+#include "rstprotocol.h"
 
 #define PLUGIN_VERSION 1.93
 
 // #define PLUGIN_DEBUG 2   // define this to have log files, 1 = bad stuff only, 2 and up.. full debug
 
-enum RSTErrors {PLUGIN_OK=0, NOT_CONNECTED, PLUGIN_CANT_CONNECT, PLUGIN_BAD_CMD_RESPONSE, COMMAND_FAILED, PLUGIN_ERROR, COMMAND_TIMEOUT};
+enum RSTErrors {PLUGIN_OK=0, NOT_CONNECTED, PLUGIN_CANT_CONNECT, PLUGIN_BAD_CMD_RESPONSE, COMMAND_FAILED, PLUGIN_ERROR, COMMAND_TIMEOUT, COMMAND_NOT_SUPPORTED};
+enum RSTLinkBreaker {BREAKER_CLOSED=0, BREAKER_OPEN, BREAKER_HALF_OPEN};
+// what the background warm-up fetches after connect, bit mask
+enum RSTWarmupItems {WARMUP_HOMING=1, WARMUP_ALIGN_OFFSET=2, WARMUP_SPEEDS=4, WARMUP_SITE=8, WARMUP_ALL=15};
+// why the watchdog stopped a command
+enum RSTWatchdogEvents {WATCHDOG_API_DEADLINE=0, WATCHDOG_STALLED, WATCHDOG_NOTICE_FLOOD, WATCHDOG_EVENT_COUNT};
+// same values as MountDriverInterface::MoveDir (checked in x2mount.cpp)
+enum RSTMoveDir {MOVE_NORTH=0, MOVE_SOUTH, MOVE_EAST, MOVE_WEST};
 
 #define SERIAL_BUFFER_SIZE 256
-#define MAX_TIMEOUT 2000            // WiFi  on tht RST can take up to 1600 ms to respond !!!
 #define MAX_READ_WAIT_TIMEOUT 25
+#define SITE_SYNC_TIME_TOLERANCE 2          // seconds, don't re-send the time for less than this
+#define LINK_DELAY_SAMPLES      5           // round trips used to estimate the one way delay
+#define TIME_DRIFT_CHECK_INTERVAL   600     // seconds between cheap mount clock checks
+#define TIME_DRIFT_CHECK_THRESHOLD  1500    // ms, a single :GL# is only good to +/- 500 ms
+#define TIME_DRIFT_RESYNC_THRESHOLD 500     // ms, resync if the precise measurement is above this
+#define BREAKER_TRIP_TIMEOUTS   3           // consecutive timeouts before we stop talking to the mount
+#define BREAKER_PROBE_INTERVAL  2000        // ms between link probes while the breaker is open
+#define BREAKER_RESUME_PROBES   3           // failed probes before we reopen the port and resume the session
+#define WARMUP_WAIT_TIMEOUT     5000        // ms an early call waits for the warm-up item it needs
+#define TELEMETRY_DEFAULT_INTERVAL  60  // seconds between background time/date/voltage samples for the settings dialog
+#define TELEMETRY_MIN_INTERVAL      5
+#define TELEMETRY_SLEW_RETRY        1000    // ms, we don't sample while a slew is being polled
+#define TIME_SYNC_LATE_TOLERANCE    0.010   // seconds, :SL# going out later than this gets retried on the next second
+#define TIME_SYNC_MAX_TRIES         3
+#define WATCHDOG_COMMAND_DEADLINE   5000    // ms one command may spend reading, async notices and trickling bytes included
+#define WATCHDOG_MAX_NOTICES        20      // async notices (MM0/CHO) read for one command before the loop counts as stuck
+#define WATCHDOG_RESYNC_RESERVE     500     // ms kept from an API deadline to purge and re-sync the framing
+#define WATCHDOG_RETURN_MARGIN      200     // ms of the API deadline the recovery leaves to the caller
+#define WATCHDOG_QUERY_DEADLINE     6000    // ms, status queries TheSkyX polls
+#define WATCHDOG_ACTION_DEADLINE    12000   // ms, calls that change the mount state
+#define SLEW_ETA_POLL_LEAD          1.0     // seconds before the predicted end of a goto we start asking the mount
+#define SLEW_ETA_IDLE_POLL          5.0     // seconds, until then we still ask this often in case the prediction is way off
+#define QUERY_FRESHNESS_DEFAULT     100     // ms an answer to a status query is shared with callers asking the same thing
+#define QUERY_SHARING_OFF           -1
+#define QUERY_FLIGHT_MAX_WAIT       (WATCHDOG_COMMAND_DEADLINE + WATCHDOG_RESYNC_RESERVE)   // ms a caller without a deadline waits for someone else's query
 #define ND_LOG_BUFFER_SIZE 256
 #define ERR_PARSE   1
 
 #define PLUGIN_NB_SLEW_SPEEDS 4
 #define INTER_COMMAND_DELAY_SECONDS     0.150
 
+#define SIDEREAL_RATE_ARCSEC_PER_SEC    15.0410681
+// non-sidereal tracking engine
+#define TRACKING_ENGINE_STEP_ARCSEC     1.0     // aim for corrections of about this size
+#define TRACKING_ENGINE_MIN_CORRECTION  0.25    // don't bother the mount for less than this (arcsec)
+#define TRACKING_ENGINE_MIN_INTERVAL    0.5     // seconds
+#define TRACKING_ENGINE_MAX_INTERVAL    10.0    // seconds
+#define TRACKING_ENGINE_RETARGET_RATIO  0.5     // above this fraction of the guide rate we re-target instead of pulsing
+#define DEFAULT_GUIDE_SPEED             0.5     // x sidereal
+
+// Hard deadline for one API call. The commands sent from this thread while it's in scope give up in time for
+// the call to return by then. Nested deadlines can only make it earlier.
+class RSTApiDeadline
+{
+public:
+    explicit RSTApiDeadline(int nMilliSeconds);
+    ~RSTApiDeadline();
+    // time_point::max() when the thread isn't in an API call
+    static std::chrono::steady_clock::time_point current() { return s_tDeadline; }
+
+private:
+    std::chrono::steady_clock::time_point m_tPrevious;
+    static thread_local std::chrono::steady_clock::time_point s_tDeadline;
+};
+
 // Define Class for Astrometric Instruments RST controller.
 class RST
 {
@@ -49,9 +113,15 @@ public:
 	int Connect(char *pszPort);
 	int Disconnect();
 	bool isConnected() const { return m_bIsConnected; }
+    // reopen the port after a transient link loss and keep what we know about the mount
+    int resumeLink();
+    double getLastResumeTime() const { return m_dLastResumeTime; }
+    int getResumeCount() const { return m_nResumeCount; }
+    // commands the watchdog stopped (per RSTWatchdogEvents) and how long the framing re-syncs took
+    void getWatchdogStats(unsigned long *pnEvents, unsigned long &nRecovered, double &dTotalRecoveryMs, double &dMaxRecoveryMs);
 
-    void setSerxPointer(SerXInterface *p) { m_pSerx = p; }
-    void setTSX(TheSkyXFacadeForDriversInterface *pTSX) { m_pTsx = pTSX;};
+    void setTransport(RSTTransport *p) { m_pSerx = p; }
+    void setHost(RSTHost *pHost) { m_pHost = pHost;};
 
     int getFirmwareVersion(std::string &sFirmware);
 
@@ -62,12 +132,17 @@ public:
     
     int setTrackingRates(bool bSiderialTrackingOn, bool bIgnoreRates, double dRaRateArcSecPerSec, double dDecRateArcSecPerSec);
     int getTrackRates(bool &bSiderialTrackingOn, double &dRaRateArcSecPerSec, double &dDecRateArcSecPerSec);
+    bool isNonSiderealTrackingActive() const { return m_bTrackingEngineRunning; }
+    void getNonSiderealTrackingError(double &dRaErrArcSec, double &dDecErrArcSec);
 
     int startSlewTo(double dRa, double dDec);
     int isSlewToComplete(bool &bComplete);
 
-    int startOpenLoopMove(const MountDriverInterface::MoveDir Dir, unsigned int nRate);
+    int startOpenLoopMove(const RSTMoveDir Dir, unsigned int nRate);
     int stopOpenLoopMove();
+    int stopOpenLoopMove(const RSTMoveDir Dir);
+    bool isOpenLoopMoving(const RSTMoveDir Dir);
+    double getOpenLoopMoveElapsed(const RSTMoveDir Dir);
     int getNbSlewRates();
     int getRateName(int nZeroBasedIndex, std::string &sOut);
     
@@ -79,6 +154,7 @@ public:
 
     void setParkPosition(int nParkPos);
     int gotoPark(double dAlt, double dAz);
+    int gotoParkPosition();     // the one set with setParkPosition
     int getAtPark(bool &bParked);
     int unPark();
     void setMountIsParked(bool bIsParked);
@@ -86,50 +162,120 @@ public:
     int isTrackingOn(bool &bTrakOn);
 
     int getLimits(double &dHoursEast, double &dHoursWest);
+    // local slew limits (rstlimits.h), startSlewTo refuses a target outside of them before sending anything
+    void setLimits(double dHoursEast, double dHoursWest, double dMinAltitude);
+    int setHorizon(const std::string &sHorizon);
+    void getHorizon(std::string &sHorizon) { m_Limits.getHorizon(sHorizon); }
+    // nResult is a RSTLimitResult. Only the first call after connect may read the site from the mount.
+    int checkLimits(double dRa, double dDec, int &nResult);
+    int checkLimits(const std::vector<RSTTarget> &vTargets, std::vector<int> &vResults);
 
     int Abort();
 
     int setSiteData(double dLongitude, double dLatitute, double dTimeZone);
     int getSiteData(std::string &sLongitude, std::string &sLatitude, std::string &sTimeZone);
     void setSyncLocationDataConnect(bool bSync);
+    double getLastConnectTime() const { return m_dLastConnectTime; }
+    double getTimeToFirstRaDec() const { return m_dTimeToFirstRaDec; }
+    bool isWarmupDone() const { return m_nWarmupDone == WARMUP_ALL; }
 
     int getLocalTime(std::string &sTime);
     int getLocalDate(std::string &sDate);
     int syncTime();
     int syncDate();
+    int syncTimeCompensated(bool bVerify, double &dResidualMs);
+    int checkMountClockDrift();
+    void getTimeSyncStatus(double &dResidualMs, double &dDriftMsPerHour, double &dLinkDelayMs);
 
     int homeMount();
     int isHomingDone(bool &bIsHomed);
 
     int getInputVoltage(double &dVolts);
 
+    // settings dialog data, sampled in the background while connected. The getters don't do any I/O,
+    // the mount time is extrapolated from the last sample.
+    void    setTelemetryInterval(int nSeconds);
+    void    refreshTelemetry(bool bSite);   // sample again as soon as possible, after a time or site change
+    int     getTelemetry(std::string &sDate, std::string &sTime, double &dVolts);
+    int     getTelemetrySite(std::string &sLongitude, std::string &sLatitude, std::string &sTimeZone);
+
     int     IsBeyondThePole(bool &bBeyondPole);
+    // pier side model (rstpierside.h), no wire traffic. nPierSide is STATUS_PIER_EAST/WEST after a goto to the target now.
+    double  getFlipHourAngle() { return m_PierSide.getFlipHourAngle(); }
+    void    setFlipHourAngle(double dHours) { m_PierSide.setFlipHourAngle(dHours); }
+    int     predictPierSide(double dRa, double dDec, int &nPierSide);
+    int     predictPierSide(const std::vector<RSTTarget> &vTargets, std::vector<int> &vPierSides);
+    void    getPierSideStats(unsigned long &nGotos, unsigned long &nMispredicted) { m_PierSide.getStats(nGotos, nMispredicted); }
+    // goto duration model (rstslewmodel.h), seconds for a goto from where the mount is now. No wire traffic once the max speed is known.
+    int     estimateSlewDuration(double dRa, double dDec, double &dSeconds);
+    // gotos timed, mean absolute and mean signed error of the predictions (s), :CL# polls the ETA saved
+    void    getSlewTimeStats(unsigned long &nSlews, double &dMeanAbsError, double &dMeanError, unsigned long &nPollsSkipped);
+    // order targets for the least slew time from where the mount is now (rstsequence.h), no wire traffic once the site is known.
+    // dNightEnd is seconds from now every exposure has to be over by.
+    int     optimizeSequence(const std::vector<RSTSequenceTarget> &vTargets, RSTSequence &Sequence,
+                             double dNightEnd = SEQUENCE_DEFAULT_NIGHT, int nBudgetMs = SEQUENCE_DEFAULT_BUDGET);
+
+    // link circuit breaker diagnostics
+    void    getLinkBreakerStatus(int &nState, int &nTripCount, int &nConsecutiveTimeouts);
+    // how often and how long callers waited for the I/O lock
+    void    getWireLockStats(unsigned long &nLocks, unsigned long &nContended, double &dTotalWaitMs, double &dMaxWaitMs);
+    // identical status queries in flight, or answered less than nMilliSeconds ago, share one trip to the mount.
+    // 0 only shares the ones in flight, QUERY_SHARING_OFF sends every one of them.
+    void    setQueryFreshness(int nMilliSeconds) { m_nQueryFreshnessMs = nMilliSeconds; }
+    void    getQuerySharingStats(unsigned long &nSent, unsigned long &nShared);
+    // writes not sent because the mount already had that setting, and the pacing they would have cost, this connection
+    void    getWriteShadowStats(unsigned long &nSkipped, double &dSleepSavedMs);
+    // optional commands this firmware answers (rstcaps.h). The stored table comes from the ini before connecting,
+    // getCapabilityCache is true when it changed and should be written back.
+    void    setCapabilityCache(const std::string &sStored) { m_Caps.setStored(sStored); }
+    bool    getCapabilityCache(std::string &sStored) { return m_Caps.getStored(sStored); }
+    void    getCapabilityText(std::string &sText) const { m_Caps.describe(sText); }
+    bool    isCapabilityUnsupported(int nCap) const { return m_Caps.isUnsupported(nCap); }
+
+    // raw protocol pass-through for rstproxyd, sResp is what the mount sent (with the '#' when there is one).
+    int     forwardCommand(const std::string sCmd, std::string &sResp);
+    int     forwardCommandBurst(const std::vector<std::string> &svCmds, std::vector<std::string> &svResps);
+    static int commandReplyTimeout(const std::string &sCmd);
 
     void    setStopTrackingOnDisconnect(bool bLeaveOn);
+
+    // publish the status snapshot in shared memory under this name while connected, empty to stop publishing
+    void    setStatusPublishing(const std::string &sName);
+    void    getStatusSnapshot(RSTStatusSnapshot &Snapshot);
+
+    // history of commands, voltage and state changes in a ring file (rstrecorder.h), empty path to stop recording
+    int     setRecording(const std::string &sPath, int nSizeMB = RST_RECORDER_DEFAULT_SIZE);
+    // Prometheus text format on http://127.0.0.1:<nPort>/metrics (rstmetrics.h), 0 to stop
+    int     setMetricsPort(int nPort);
+    void    formatMetrics(std::string &sOut);
     
 #ifdef PLUGIN_DEBUG
     void log(std::string sLogEntry);
 #endif
 private:
 
-    SerXInterface                       *m_pSerx;
-    TheSkyXFacadeForDriversInterface    *m_pTsx;
+    RSTTransport                        *m_pSerx;
+    RSTHost                             *m_pHost;
 
 	bool    m_bIsConnected;                               // Connected to the mount?
+    std::string m_sPortName;                              // so we can reopen it on resume
+    double  m_dLastResumeTime;                            // seconds
+    std::atomic<int>    m_nResumeCount;
     std::string m_sFirmwareVersion;
-    double  m_dRa;
-    double  m_dDec;
-    double  m_dAlt;
-    double  m_dAz;
+    // the queries read these without a lock while a mutator (or an abort) changes them
+    std::atomic<double> m_dRa;
+    std::atomic<double> m_dDec;
+    std::atomic<double> m_dAlt;
+    std::atomic<double> m_dAz;
 
     bool    m_bSyncLocationDataConnect;
     bool    m_bHomeOnUnpark;
-    bool    m_bUnparking;
+    std::atomic<bool>   m_bUnparking;
     int     m_nNbHomingTries;
-    bool    m_bSyncDone;
-    bool    m_bIsHomed;
-    bool    m_bIsParked;
-    bool    m_bSlewing;
+    std::atomic<bool>   m_bSyncDone;
+    std::atomic<bool>   m_bIsHomed;
+    std::atomic<bool>   m_bIsParked;
+    std::atomic<bool>   m_bSlewing;
     bool    m_bStopTrackingOnDisconnect;
     
     double m_dRaRateArcSecPerSec;
@@ -144,15 +290,118 @@ private:
 	double  m_dGotoRATarget;						  // Current Target RA;
 	double  m_dGotoDECTarget;                      // Current Goto Target Dec;
 	
-    MountDriverInterface::MoveDir      m_nOpenLoopDir;
-
-    // limits don't change mid-course so we cache them
-    bool    m_bLimitCached;
-    double  m_dHoursEast;
-    double  m_dHoursWest;
-
-    int     sendCommand(const std::string sCmd, std::string &sResp, int nTimeout = MAX_TIMEOUT);
-    int     readResponse(std::string &sResp, int nTimeout = MAX_TIMEOUT);
+    // open loop moves are tracked per axis so RA and Dec can move (and stop) independently.
+    // They change under m_OpMutex, bMoving and nDir are also read without it (isOpenLoopMoving, logs).
+    typedef struct {
+        std::atomic<bool>       bMoving;
+        std::atomic<RSTMoveDir> nDir;
+        unsigned long   nMoveId;    // the startAxisMove call the move is from, a new one takes it over
+        CStopWatch      moveTimer;
+    } AxisMoveState;
+
+    AxisMoveState   m_RaAxisMove;   // East / West
+    AxisMoveState   m_DecAxisMove;  // North / South
+    int             m_nOpenLoopRate; // last rate sent to the mount, -1 if unknown
+    unsigned long   m_nLastMoveId;
+
+    // What the mount was last told and acknowledged, a write that wouldn't change it isn't sent.
+    // Forgotten on connect and mount reset, and once the watchdog had to step in (m_bShadowValid).
+    std::atomic<int>    m_nShadowTracking;      // -1 unknown, 0 off, 1 on
+    std::atomic<int>    m_nShadowTrackingMode;  // :CtR/:CtS/:CtM#, STATUS_TRACKING_UNKNOWN if we don't know
+    std::atomic<bool>   m_bShadowValid;
+    int         m_nShadowSpeeds[PLUGIN_NB_SLEW_SPEEDS];    // :Cu1= .. :Cu3=, -1 unknown
+    double      m_dShadowGuideSpeed;            // :Cu0=, < 0 unknown
+    std::string m_sShadowTargetRa;              // :Sr and :Sd arguments, empty if unknown
+    std::string m_sShadowTargetDec;
+    std::atomic<unsigned long>  m_nShadowSkipped;
+    std::atomic<unsigned long>  m_nShadowSleepSavedMs;
+    void    forgetMountShadow();
+    void    checkMountShadow();
+    void    shadowSkipped(int nSleepSavedMs);
+    template<int nModeCmd> int setMountTracking(int nMode);
+
+    AxisMoveState   &axisMoveState(const RSTMoveDir Dir);
+    int             sendAxisStop(AxisMoveState &Axis);
+    int             sendMoveRate(unsigned int nRate);     // :RG# :RC# :RM# :RS#, shared by both axis
+    // with m_OpMutex held. startOpenLoopMove without the API deadline and without forgetting the pier side and
+    // the goto timing, for the tracking engine's guide pulses : they don't move the mount anywhere.
+    int             startAxisMove(const RSTMoveDir Dir, unsigned int nRate);
+    // stops the move only if it is still the one nMoveId started, false if somebody else took the axis since
+    bool            stopAxisMove(const RSTMoveDir Dir, unsigned long nMoveId);
+
+    // limits don't change mid-course so we cache them, with the site
+    RSTLimits   m_Limits;
+    int     loadLimitSite();
+    double  limitsSiderealTime();
+
+    // the side from the last :CY#, good until the axes move. m_bPierGoto when that move is a goto to m_dPierGotoHourAngle, m_dPierGotoDec
+    RSTPierSideModel    m_PierSide;
+    std::atomic<bool>   m_bPierGoto;
+    std::atomic<double> m_dPierGotoHourAngle;
+    std::atomic<double> m_dPierGotoDec;
+    int     readPierSide(bool &bBeyondPole);
+
+    // per session, from the ini when the firmware is the same. An optional command gets its retry like before,
+    // then the mount has to answer :AV# for it to be marked unsupported : a dead link isn't a missing command.
+    RSTCapabilities     m_Caps;
+    int     sendOptionalCommand(int nCap, std::string &sResp);
+    int     sendCapabilityCommand(int nCap, std::string &sResp);
+    int     confirmUnsupported(int nCap);
+    void    probeCapabilities();
+    void    axesMoved() { m_bPierGoto = false; m_bSlewTimed = false; m_PierSide.invalidate(); }
+
+    // m_bSlewTimed while the goto in progress has an ETA (seconds on m_SlewTimer), isSlewToComplete waits for it
+    // or for a MM0 before asking the mount.
+    RSTSlewTimeModel    m_SlewModel;
+    std::atomic<bool>   m_bSlewModelSpeed;      // the model has the :CU3# speed of this connection
+    std::atomic<bool>   m_bSlewTimed;
+    CStopWatch          m_SlewTimer;
+    double              m_dSlewTravel;          // degrees
+    double              m_dSlewPredicted;       // seconds
+    double              m_dSlewLastPoll;        // seconds, last :CL# that said it's still moving
+    std::atomic<double> m_dSlewDoneNotice;      // seconds, when a MM0 came for this goto, < 0 if none yet
+    std::atomic<unsigned long>  m_nSlewPollsSkipped;
+    void    loadSlewSpeed();
+    double  slewTravel(double dRa, double dDec);
+    bool    westOfPierNow(double dLst);     // the anchored side, else the side a goto to where we are would pick
+    void    noticeSlewDone();
+    void    peekSlewDone();
+
+    // one command of rstprotocol.h, its timeout, retry, pacing and sharing are fixed at compile time.
+    // The second form is for the ones with an argument, sCmd is the whole command.
+    template<int nCmd> int sendCommand(std::string &sResp);
+    template<int nCmd> int sendCommand(const std::string &sCmd, std::string &sResp);
+    // without the retry, for the callers that decide on their own when to ask again. A timeout that is the
+    // command's normal end (nReply REPLY_NO_HASH with an answer, REPLY_ON_ERROR without one) comes back as PLUGIN_OK.
+    template<int nCmd> int sendCommandOnce(const std::string &sCmd, std::string &sResp);
+    template<int nCmd> int sendCommandOnce(const std::string &sCmd, std::string &sResp, std::true_type bShared);
+    template<int nCmd> int sendCommandOnce(const std::string &sCmd, std::string &sResp, std::false_type bShared);
+    template<int nCmd> static const std::string &commandString();
+    int     sendQuery(int nCmd, const std::string &sCmd, std::string &sResp, int nTimeout, int nPacingMs);
+    int     sendWrite(const std::string &sCmd, std::string &sResp, int nReply, int nTimeout, int nPacingMs);
+    // sendCommand without the query sharing : the wire, the link breaker, metrics and history.
+    // nReply (RSTReply) says what a timeout means, nPacingMs is what the mount needs before the next command, only when it took this one.
+    int     sendCommandRecorded(const std::string &sCmd, std::string &sResp, int nReply, int nTimeout, int nPacingMs = 0);
+    int     sendCommandOnWire(const std::string sCmd, std::string &sResp, int nTimeout);
+    bool    splitNotices(std::string &sResp, int &nNotices);
+    int     readResponse(std::string &sResp, int nTimeout = MAX_TIMEOUT, std::chrono::steady_clock::time_point tDeadline = std::chrono::steady_clock::time_point::max());
+    // when the read loop for a command has to give up and why (RSTWatchdogEvents), the API deadline keeps some time for the recovery
+    std::chrono::steady_clock::time_point commandDeadline(int &nEvent);
+    // with the I/O lock held : purge, then a known good query until its answer comes back whole
+    int     watchdogRecover(int nEvent);
+    int     resyncFraming(std::chrono::steady_clock::time_point tDeadline);
+    // pipelined commands : one write, then one response per command
+    int     sendCommandBurst(const std::vector<std::string> &svCmds, std::vector<std::string> &svResps, int nTimeout = MAX_TIMEOUT);
+    int     sendCommandBurstOnWire(const std::vector<std::string> &svCmds, std::vector<std::string> &svResps, int nTimeout);
+    // coalesced commands that don't answer : one write
+    int     writeCommandBurst(const std::vector<std::string> &svCmds);
+    // give the mount time to process what we just sent without blocking the caller
+    void    setCommandPacing(int nMilliSeconds);
+    // with the I/O lock held, the lock is released while we sleep
+    void    waitCommandPacing(std::unique_lock<std::recursive_mutex> &wireLock);
+    void    lockWire(std::unique_lock<std::recursive_mutex> &wireLock);
+    // straight to the port, no I/O lock and no pacing, for the :Q# that can't wait behind a poll
+    int     writeCommandNow(const std::string &sCmd);
 
     int     setSiteLongitude(const std::string sLongitude);
     int     setSiteLatitude(const std::string sLatitude);
@@ -161,6 +410,13 @@ private:
     int     getSiteLongitude(std::string &sLongitude);
     int     getSiteLatitude(std::string &sLatitude);
     int     getSiteTZ(std::string &sTimeZone);
+    int     syncSiteDataOnConnect(double dLongitude, double dLatitute, double dTimeZone);
+    void    formatSiteData(double dLongitude, double dLatitute, double dTimeZone, std::string &sLong, std::string &sLat, std::string &sTimeZone);
+    int     compareTimeHHMMSS(const std::string sTime, int h, int min, int sec, int &nDeltaSeconds);
+    int     parseTimeHHMMSS(const std::string sTime, int &nSecondsOfDay);
+    int     measureLinkDelay(double &dOneWayDelay);
+    int     measureMountClockOffset(double &dOffsetMs);
+    double  localSecondsOfDay();
 
     int     setTarget(double dRa, double dDec);
     int     setTargetAltAz(double dAlt, double dAz);
@@ -178,9 +434,166 @@ private:
 
     int     parseFields(const std::string sIn, std::vector<std::string> &svFields, char cSeparator);
 
+    // Lock order is m_OpMutex -> m_DevMutex -> m_TxMutex.
+    // m_OpMutex : multi-command operations and the state they change (tracking rates, moves, engine, resume).
+    // m_DevMutex : I/O lock, only held while a command and its answer are on the wire, never while pacing.
+    // m_TxMutex : only held around a write, so an abort can go out while someone else waits for an answer.
+    std::recursive_mutex    m_OpMutex;
+    std::recursive_mutex    m_DevMutex;
+    std::mutex              m_TxMutex;
+    std::atomic<unsigned long>  m_nWireLocks;
+    std::atomic<unsigned long>  m_nWireLockContended;
+    std::atomic<unsigned long>  m_nWireLockWaitUs;
+    std::atomic<unsigned long>  m_nWireLockMaxWaitUs;
+
+    // Single flight status queries : the first caller asks the mount, the others asking the same thing get its answer.
+    // Any other command moves m_nFlightGeneration on, before and after, so nobody gets an answer from before a write.
+    typedef struct {
+        unsigned long   nGeneration;
+        bool            bDone;
+        int             nErr;
+        std::string     sResp;
+        std::chrono::steady_clock::time_point   tDone;
+    } QueryFlight;
+
+    std::mutex              m_FlightMutex;
+    std::condition_variable m_FlightCond;
+    std::shared_ptr<QueryFlight>    m_Flights[CMD_COUNT];   // by RSTCommandId
+    unsigned long           m_nFlightGeneration;
+    std::atomic<int>        m_nQueryFreshnessMs;
+    std::atomic<unsigned long>  m_nQueriesSent;
+    std::atomic<unsigned long>  m_nQueriesShared;
+    int     sendQueryShared(int nCmd, const std::string &sCmd, std::string &sResp, int nTimeout, int nPacingMs);
+    void    invalidateQueryFlights();
+
+    std::atomic<unsigned long>  m_nWatchdogEvents[WATCHDOG_EVENT_COUNT];
+    std::atomic<unsigned long>  m_nWatchdogRecovered;
+    std::atomic<unsigned long>  m_nWatchdogRecoveryUs;
+    std::atomic<unsigned long>  m_nWatchdogMaxRecoveryUs;
+
+    // non-sidereal tracking engine, applies the RA/Dec offset rates on top of sidereal tracking
+    int     startNonSiderealTracking(double dRaRateArcSecPerSec, double dDecRateArcSecPerSec);
+    bool    stopNonSiderealTracking();      // true when the engine was running
+    void    requestStopNonSiderealTracking();   // doesn't wait for the thread
+    void    resetNonSiderealTrackingOrigin();
+    void    resetNonSiderealTrackingOrigin(double dRa, double dDec);
+    void    trackingEngineThread();
+    void    trackingEngineCorrect();
+    void    trackingEnginePulseDone(const RSTMoveDir Dir, unsigned long nMoveId, double dSeconds);
+    void    trackingEngineRetarget();
+
+    std::thread             m_TrackingThread;
+    std::mutex              m_TrackingThreadMutex;  // m_TrackingThread itself, never held while joining
+    std::mutex              m_TrackingEngineMutex;
+    std::condition_variable m_TrackingEngineCond;
+    std::atomic<bool>       m_bTrackingEngineRunning;
+    bool                    m_bTrackingEngineRetarget;
+    double  m_dEngineRaRate;            // arcsec/s on top of sidereal
+    double  m_dEngineDecRate;           // arcsec/s
+    double  m_dEngineInterval;          // seconds between corrections
+    double  m_dEngineGuideRate;         // arcsec/s
+    double  m_dEngineOriginRa;          // hours, used in re-target mode
+    double  m_dEngineOriginDec;         // degrees, used in re-target mode
+    double  m_dEngineAppliedRa;         // arcsec commanded since origin
+    double  m_dEngineAppliedDec;        // arcsec commanded since origin
+    double  m_dEngineErrRa;             // arcsec, requested - commanded at last correction
+    double  m_dEngineErrDec;            // arcsec
+    CStopWatch  m_EngineTimer;
+
+    // link circuit breaker : after BREAKER_TRIP_TIMEOUTS consecutive timeouts commands that expect an answer
+    // fail immediately and a background thread probes the link until the mount answers again.
+    bool    isLinkBreakerOpen();
+    void    updateLinkBreaker(int nErr);
+    void    startLinkProbe();
+    void    stopLinkProbe();
+    void    linkProbeThread();
+    int     resumeSession();
+
+    std::thread             m_LinkProbeThread;
+    std::mutex              m_LinkProbeMutex;
+    std::condition_variable m_LinkProbeCond;
+    std::atomic<bool>       m_bLinkProbeRunning;
+    std::atomic<int>        m_nBreakerState;
+    std::atomic<int>        m_nBreakerTripCount;
+    std::atomic<int>        m_nConsecutiveTimeouts;
+
+    // deferred initialization : Connect only proves the link is alive, the rest is fetched in the background.
+    // Early calls wait for the item they need (and then use the cached answer once) instead of paying a cold round trip.
+    void    startWarmup();
+    void    stopWarmup();
+    void    warmupThread();
+    void    setWarmupDone(int nItem);
+    bool    waitWarmup(int nItem);
+
+    std::thread             m_WarmupThread;
+    std::mutex              m_WarmupMutex;
+    std::condition_variable m_WarmupCond;
+    std::atomic<bool>       m_bWarmupRunning;
+    std::atomic<int>        m_nWarmupDone;
+    bool        m_bWarmHomingValid;     // m_bIsHomed came from the warm-up and wasn't used yet
+    bool        m_bAlignOffsetValid;
+    double      m_dAlignOffset;         // :CG3#, doesn't change while we're connected
+    std::string m_sSpeedResps[PLUGIN_NB_SLEW_SPEEDS];  // :CU0# .. :CU3# answers, empty if not cached
+    CStopWatch  m_ConnectTimer;
+    std::atomic<bool>   m_bFirstRaDecDone;
+    double      m_dTimeToFirstRaDec;    // seconds from the start of Connect to the first good getRaAndDec
+
+    // background telemetry for the settings dialog
+    void    startTelemetry();
+    void    stopTelemetry();
+    void    telemetryThread();
+    int     sampleTelemetry(bool bSite);
+
+    std::thread             m_TelemetryThread;
+    std::mutex              m_TelemetryMutex;
+    std::condition_variable m_TelemetryCond;
+    std::atomic<bool>       m_bTelemetryRunning;
+    bool        m_bTelemetryRefresh;
+    bool        m_bTelemetrySiteStale;
+    int         m_nTelemetryInterval;   // seconds
+    bool        m_bTelemetryValid;
+    bool        m_bTelemetrySiteValid;
+    double      m_dTelemetrySeconds;    // mount seconds of day when m_TelemetryTimer was reset
+    CStopWatch  m_TelemetryTimer;
+    std::string m_sTelemetryDate;
+    double      m_dTelemetryVolts;
+    std::string m_sTelemetryLongitude;
+    std::string m_sTelemetryLatitude;
+    std::string m_sTelemetryTimeZone;
+
+    // shared memory status, updated every time we read something from the mount
+    void    publishPosition(double dRa, double dDec);
+    void    publishAltAz(double dAlt, double dAz);
+    void    publishTracking(int nMode, double dRaRate, double dDecRate);
+    void    publishPierSide(bool bBeyondPole);
+    void    publishFlag(uint32_t nFlag, bool bSet);
+    void    publishVoltage(double dVolts);
+
+    std::mutex          m_StatusMutex;
+    RSTStatusSnapshot   m_Status;
+    RSTStatusPublisher  m_StatusPublisher;
+    std::string         m_sStatusName;
+
+    RSTRecorder         m_Recorder;
+
+    RSTCommandMetrics   m_Metrics;
+    RSTMetricsServer    m_MetricsServer;
+    std::atomic<int>    m_nTrackingState;   // last published tracking mode, for the poll counters
+
     std::vector<std::string>    m_svSlewRateNames = {"Guide", "Centering", "Find", "Max"};
 
     CStopWatch  m_commandDelayTimer;
+    double      m_dCommandPacing;       // seconds to wait after m_commandDelayTimer was reset before the next write
+    double      m_dLastConnectTime;     // seconds
+
+    // mount clock
+    bool        m_bTimeSynced;
+    double      m_dLinkOneWayDelay;     // seconds
+    double      m_dTimeSyncResidualMs;  // mount - local right after the last sync
+    double      m_dLastClockOffsetMs;   // last measured mount - local
+    double      m_dClockDriftMsPerHour;
+    CStopWatch  m_TimeSyncTimer;        // since last sync
+    CStopWatch  m_TimeDriftCheckTimer;  // since last drift check
 
 #ifdef PLUGIN_DEBUG
     // timestamp for logs
@@ -0,0 +1,114 @@
+#include "rstcaps.h"
+
+#include <cstring>
+
+static const char *pszCapCommands[CAP_COUNT] = {":CG3#", ":CY#", ":Cv#"};
+static const char *pszCapKeys[CAP_COUNT] = {"CG3", "CY", "Cv"};
+static const char *pszCapNames[CAP_COUNT] = {"Dec offset", "pier side", "voltage"};
+
+RSTCapabilities::RSTCapabilities()
+{
+    for(int i = 0; i < CAP_COUNT; i++)
+        m_nStates[i] = CAP_UNKNOWN;
+}
+
+const char *RSTCapabilities::command(int nCap)
+{
+    return pszCapCommands[nCap];
+}
+
+const char *RSTCapabilities::name(int nCap)
+{
+    return pszCapNames[nCap];
+}
+
+void RSTCapabilities::setStored(const std::string &sStored)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_sStored.assign(sStored);
+}
+
+bool RSTCapabilities::reset(const std::string &sFirmware)
+{
+    size_t nSep;
+    size_t nPos;
+    size_t nEnd;
+    std::string sField;
+    int i;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_sFirmware.assign(sFirmware);
+    for(i = 0; i < CAP_COUNT; i++)
+        m_nStates[i] = CAP_UNKNOWN;
+
+    // the firmware string is the mount's, the table starts after the last '|'
+    nSep = m_sStored.rfind('|');
+    if(nSep == std::string::npos || sFirmware.empty() || m_sStored.compare(0, nSep, sFirmware) != 0)
+        return false;
+
+    for(nPos = nSep + 1; nPos < m_sStored.size(); nPos = nEnd + 1) {
+        nEnd = m_sStored.find(',', nPos);
+        if(nEnd == std::string::npos)
+            nEnd = m_sStored.size();
+        sField = m_sStored.substr(nPos, nEnd - nPos);
+        for(i = 0; i < CAP_COUNT; i++) {
+            if(sField.size() == strlen(pszCapKeys[i]) + 2 && !sField.compare(0, sField.size() - 2, pszCapKeys[i]) && sField[sField.size() - 2] == '=')
+                m_nStates[i] = (sField.back() == '1' ? CAP_SUPPORTED : CAP_UNSUPPORTED);
+        }
+    }
+    return true;
+}
+
+void RSTCapabilities::set(int nCap, int nState)
+{
+    m_nStates[nCap] = nState;
+}
+
+bool RSTCapabilities::getStored(std::string &sStored)
+{
+    std::string sTable;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    format(sTable);
+    // nothing learned this session, keep what the ini has
+    if(m_sFirmware.empty() || sTable.size() == m_sFirmware.size() + 1)
+        return false;
+    if(sTable == m_sStored)
+        return false;
+    m_sStored.assign(sTable);
+    sStored.assign(sTable);
+    return true;
+}
+
+void RSTCapabilities::describe(std::string &sText) const
+{
+    int i;
+    int nState;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    sText.clear();
+    if(m_sFirmware.empty())
+        return;
+    // "AV:" + the version
+    sText = "Firmware " + (m_sFirmware.size() > 3 ? m_sFirmware.substr(3) : m_sFirmware) + " :";
+    for(i = 0; i < CAP_COUNT; i++) {
+        nState = m_nStates[i];
+        sText += std::string(i ? ", " : " ") + pszCapNames[i] + (nState == CAP_SUPPORTED ? " yes" : (nState == CAP_UNSUPPORTED ? " no" : " ?"));
+    }
+}
+
+void RSTCapabilities::format(std::string &sStored) const
+{
+    int i;
+    int nState;
+    bool bFirst = true;
+
+    sStored = m_sFirmware + "|";
+    for(i = 0; i < CAP_COUNT; i++) {
+        nState = m_nStates[i];
+        if(nState == CAP_UNKNOWN)
+            continue;
+        sStored += std::string(bFirst ? "" : ",") + pszCapKeys[i] + "=" + (nState == CAP_SUPPORTED ? "1" : "0");
+        bFirst = false;
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef __RST_CAPS__
+#define __RST_CAPS__
+
+#pragma once
+
+// What this firmware answers. Some commands came with later firmwares and an older one just doesn't answer them,
+// which used to cost a timeout (and its retry) on every call. Each optional command is probed once per session,
+// one that gets no answer while the mount answers :AV# is never sent again.
+// The table is keyed by the :AV# firmware string and kept in the ini (see X2Mount), so the next connect with
+// the same firmware starts with it and only probes what it doesn't know.
+
+#include <string>
+#include <mutex>
+#include <atomic>
+
+#define CAPS_MAX_STRING     256
+
+enum RSTCapability {CAP_ALIGN_OFFSET=0, CAP_PIER_SIDE, CAP_VOLTAGE, CAP_COUNT};
+enum RSTCapabilityState {CAP_UNKNOWN=0, CAP_SUPPORTED, CAP_UNSUPPORTED};
+
+class RSTCapabilities
+{
+public:
+    RSTCapabilities();
+
+    static const char  *command(int nCap);
+    static const char  *name(int nCap);
+
+    // what the ini had, "<firmware>|CG3=1,CY=0,Cv=1"
+    void    setStored(const std::string &sStored);
+    // a new session with this firmware, true when the stored table was for it
+    bool    reset(const std::string &sFirmware);
+
+    int     get(int nCap) const { return m_nStates[nCap]; }
+    bool    isUnsupported(int nCap) const { return m_nStates[nCap] == CAP_UNSUPPORTED; }
+    void    set(int nCap, int nState);
+
+    // the table to store, false if the ini already has it
+    bool    getStored(std::string &sStored);
+    // one line for the settings dialog
+    void    describe(std::string &sText) const;
+
+private:
+    void    format(std::string &sStored) const;     // with m_Mutex held
+
+    mutable std::mutex  m_Mutex;
+    std::string         m_sFirmware;
+    std::string         m_sStored;
+    std::atomic<int>    m_nStates[CAP_COUNT];
+};
+
+#endif // __RST_CAPS__
@@ -0,0 +1,23 @@
+#ifndef __RST_ERRORS__
+#define __RST_ERRORS__
+
+#pragma once
+
+// The TheSkyX error codes the driver returns. The plugin takes them from the X2 SDK, the headless core
+// (RST_HEADLESS, the Makefile "core" target) builds without the SDK and has its own copy of the few it uses.
+// Same values, so a code reads the same in a log, in the metrics and through rstproxyd.
+
+#if defined RST_HEADLESS
+#define SB_OK                   0
+#define ERR_NOT_IMPL            11
+#define ERR_COMMNOLINK          200
+#define ERR_CMDFAILED           206
+#define ERR_RXTIMEOUT           213
+#define ERR_NOLINK              215
+#define ERR_ABORTEDPROCESS      217
+#define ERR_MKS_SLEW_PAST_LIMIT 1102
+#else
+#include "../../licensedinterfaces/sberrorx.h"
+#endif
+
+#endif // __RST_ERRORS__
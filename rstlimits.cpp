@@ -0,0 +1,233 @@
+#include "rstlimits.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
+#include <algorithm>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+#define DEG_TO_RAD  (M_PI / 180.0)
+
+RSTLimits::RSTLimits()
+{
+    m_bSiteValid = false;
+    m_dLatitude = 0.0;
+    m_dLongitude = 0.0;
+    m_dSinLat = 0.0;
+    m_dCosLat = 1.0;
+    m_dHoursEast = LIMITS_DEFAULT_HOURS_EAST;
+    m_dHoursWest = LIMITS_DEFAULT_HOURS_WEST;
+    m_dMinAltitude = LIMITS_DEFAULT_MIN_ALTITUDE;
+    buildHorizonBins();
+}
+
+void RSTLimits::setSite(double dLatitude, double dLongitude)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_dLatitude = dLatitude;
+    m_dLongitude = dLongitude;
+    m_dSinLat = std::sin(dLatitude * DEG_TO_RAD);
+    m_dCosLat = std::cos(dLatitude * DEG_TO_RAD);
+    m_bSiteValid = true;
+}
+
+void RSTLimits::clearSite()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bSiteValid = false;
+}
+
+bool RSTLimits::hasSite() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_bSiteValid;
+}
+
+double RSTLimits::getLongitude() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_dLongitude;
+}
+
+void RSTLimits::setHourAngleLimits(double dHoursEast, double dHoursWest)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_dHoursEast = std::min(std::max(dHoursEast, 0.0), 12.0);
+    m_dHoursWest = std::min(std::max(dHoursWest, 0.0), 12.0);
+}
+
+void RSTLimits::getHourAngleLimits(double &dHoursEast, double &dHoursWest) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    dHoursEast = m_dHoursEast;
+    dHoursWest = m_dHoursWest;
+}
+
+void RSTLimits::setMinAltitude(double dAltitude)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_dMinAltitude = std::min(std::max(dAltitude, -90.0), 90.0);
+    buildHorizonBins();
+}
+
+double RSTLimits::getMinAltitude() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_dMinAltitude;
+}
+
+int RSTLimits::setHorizon(const std::string &sHorizon)
+{
+    std::vector<std::pair<double, double>> vPoints;
+    const char *pszPos = sHorizon.c_str();
+    char *pszEnd;
+    double dAz;
+    double dAlt;
+
+    while(*pszPos) {
+        while(*pszPos == ' ' || *pszPos == ',')
+            pszPos++;
+        if(!*pszPos)
+            break;
+        dAz = strtod(pszPos, &pszEnd);
+        if(pszEnd == pszPos || *pszEnd != ':')
+            return ERR_CMDFAILED;
+        pszPos = pszEnd + 1;
+        dAlt = strtod(pszPos, &pszEnd);
+        if(pszEnd == pszPos)
+            return ERR_CMDFAILED;
+        pszPos = pszEnd;
+        vPoints.push_back(std::make_pair(std::fmod(std::fmod(dAz, 360.0) + 360.0, 360.0), std::min(std::max(dAlt, -90.0), 90.0)));
+    }
+    std::sort(vPoints.begin(), vPoints.end());
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_vHorizon.swap(vPoints);
+    buildHorizonBins();
+    return SB_OK;
+}
+
+void RSTLimits::getHorizon(std::string &sHorizon) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    char szPoint[64];
+
+    sHorizon.clear();
+    for(const std::pair<double, double> &Point : m_vHorizon) {
+        snprintf(szPoint, sizeof(szPoint), "%s%g:%g", sHorizon.empty()?"":",", Point.first, Point.second);
+        sHorizon += szPoint;
+    }
+}
+
+// with m_Mutex held
+void RSTLimits::buildHorizonBins()
+{
+    size_t nNext;
+    double dAz;
+    double dAlt;
+    double dAz0, dAlt0, dAz1, dAlt1;
+    int i;
+
+    for(i = 0; i < LIMITS_HORIZON_BINS; i++) {
+        dAlt = m_dMinAltitude;
+        if(!m_vHorizon.empty()) {
+            dAz = (i + 0.5) * 360.0 / LIMITS_HORIZON_BINS;
+            // the points on each side, wrapping around north
+            nNext = std::upper_bound(m_vHorizon.begin(), m_vHorizon.end(), std::make_pair(dAz, 90.0)) - m_vHorizon.begin();
+            dAz1 = nNext < m_vHorizon.size() ? m_vHorizon[nNext].first : m_vHorizon[0].first + 360.0;
+            dAlt1 = nNext < m_vHorizon.size() ? m_vHorizon[nNext].second : m_vHorizon[0].second;
+            dAz0 = nNext > 0 ? m_vHorizon[nNext - 1].first : m_vHorizon.back().first - 360.0;
+            dAlt0 = nNext > 0 ? m_vHorizon[nNext - 1].second : m_vHorizon.back().second;
+            if(dAz1 - dAz0 > 0.0)
+                dAlt = std::max(dAlt, dAlt0 + (dAlt1 - dAlt0) * (dAz - dAz0) / (dAz1 - dAz0));
+            else
+                dAlt = std::max(dAlt, dAlt0);
+        }
+        m_dHorizonBins[i] = dAlt;
+    }
+}
+
+int RSTLimits::check(double dRa, double dDec, double dLst, double *pdAlt) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return checkLocked(dRa, dDec, dLst, pdAlt);
+}
+
+void RSTLimits::check(const std::vector<RSTTarget> &vTargets, double dLst, std::vector<int> &vResults) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    vResults.resize(vTargets.size());
+    for(size_t i = 0; i < vTargets.size(); i++)
+        vResults[i] = checkLocked(vTargets[i].dRa, vTargets[i].dDec, dLst, NULL);
+}
+
+int RSTLimits::checkLocked(double dRa, double dDec, double dLst, double *pdAlt) const
+{
+    double dHa;
+    double dSinDec, dCosDec, dSinHa, dCosHa;
+    double dSinAlt;
+    double dAlt;
+    double dAz;
+    int nBin;
+
+    if(!m_bSiteValid)
+        return LIMIT_NO_SITE;
+
+    // -12..12 hours, negative east of the meridian
+    dHa = std::fmod(dLst - dRa + 36.0, 24.0) - 12.0;
+    if(dHa < -m_dHoursEast)
+        return LIMIT_PAST_EAST;
+    if(dHa > m_dHoursWest)
+        return LIMIT_PAST_WEST;
+
+    dSinDec = std::sin(dDec * DEG_TO_RAD);
+    dCosDec = std::cos(dDec * DEG_TO_RAD);
+    dSinHa = std::sin(dHa * 15.0 * DEG_TO_RAD);
+    dCosHa = std::cos(dHa * 15.0 * DEG_TO_RAD);
+    dSinAlt = m_dSinLat * dSinDec + m_dCosLat * dCosDec * dCosHa;
+    dAlt = std::asin(std::min(std::max(dSinAlt, -1.0), 1.0)) / DEG_TO_RAD;
+    if(pdAlt)
+        *pdAlt = dAlt;
+    if(dAlt < m_dMinAltitude)
+        return LIMIT_BELOW_ALTITUDE;
+    if(m_vHorizon.empty())
+        return LIMIT_OK;
+
+    // azimuth from north through east
+    dAz = std::atan2(-dCosDec * dSinHa, dSinDec * m_dCosLat - dCosDec * dCosHa * m_dSinLat) / DEG_TO_RAD;
+    dAz = std::fmod(dAz + 360.0, 360.0);
+    nBin = std::min((int)(dAz * LIMITS_HORIZON_BINS / 360.0), LIMITS_HORIZON_BINS - 1);
+    if(dAlt < m_dHorizonBins[nBin])
+        return LIMIT_BELOW_HORIZON;
+    return LIMIT_OK;
+}
+
+double RSTLimits::localSiderealTime(double dLongitude)
+{
+    double dUnixSeconds = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    double dDays = dUnixSeconds / 86400.0 + 2440587.5 - 2451545.0;    // since J2000.0
+    double dGmst = 18.697374558 + 24.06570982441908 * dDays;
+
+    return std::fmod(std::fmod(dGmst - dLongitude / 15.0, 24.0) + 24.0, 24.0);
+}
+
+const char *RSTLimits::resultName(int nResult)
+{
+    switch(nResult) {
+        case LIMIT_OK :             return "ok";
+        case LIMIT_PAST_EAST :      return "past the east hour angle limit";
+        case LIMIT_PAST_WEST :      return "past the west hour angle limit";
+        case LIMIT_BELOW_ALTITUDE : return "below the minimum altitude";
+        case LIMIT_BELOW_HORIZON :  return "below the horizon profile";
+        default :                   return "site unknown";
+    }
+}
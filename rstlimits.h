@@ -0,0 +1,77 @@
+#ifndef __RST_LIMITS__
+#define __RST_LIMITS__
+
+#pragma once
+
+// Local slew limits : hour angle east and west of the meridian, a minimum altitude and a horizon profile.
+// They are set once (from the ini, see X2Mount) with the site position and a target is checked with a bit
+// of spherical trigonometry, no wire traffic. The horizon profile is resampled to one degree azimuth bins
+// so a check costs the same whatever the number of points.
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <utility>
+
+#include "rsterrors.h"
+
+#define LIMITS_DEFAULT_HOURS_EAST   8.0
+#define LIMITS_DEFAULT_HOURS_WEST   8.0
+#define LIMITS_DEFAULT_MIN_ALTITUDE 0.0     // degrees
+#define LIMITS_HORIZON_BINS         360
+#define LIMITS_MAX_HORIZON_STRING   4096
+
+enum RSTLimitResult {LIMIT_OK=0, LIMIT_PAST_EAST, LIMIT_PAST_WEST, LIMIT_BELOW_ALTITUDE, LIMIT_BELOW_HORIZON, LIMIT_NO_SITE};
+
+typedef struct {
+    double  dRa;    // hours
+    double  dDec;   // degrees
+} RSTTarget;
+
+class RSTLimits
+{
+public:
+    RSTLimits();
+
+    // degrees, longitude positive west like TheSkyX and :Gg#
+    void    setSite(double dLatitude, double dLongitude);
+    void    clearSite();
+    bool    hasSite() const;
+    double  getLongitude() const;
+
+    void    setHourAngleLimits(double dHoursEast, double dHoursWest);
+    void    getHourAngleLimits(double &dHoursEast, double &dHoursWest) const;
+    void    setMinAltitude(double dAltitude);
+    double  getMinAltitude() const;
+    // "az:alt,az:alt,..." in degrees, az from north through east, linear in between and around 360.
+    // An empty string removes the profile.
+    int     setHorizon(const std::string &sHorizon);
+    void    getHorizon(std::string &sHorizon) const;
+
+    // RSTLimitResult for a target at local sidereal time dLst (hours), its altitude in pdAlt if not NULL
+    int     check(double dRa, double dDec, double dLst, double *pdAlt = NULL) const;
+    // same for a list, one lock for the whole batch
+    void    check(const std::vector<RSTTarget> &vTargets, double dLst, std::vector<int> &vResults) const;
+
+    // from the system clock, for when TheSkyX isn't there to ask
+    static double localSiderealTime(double dLongitude);
+    static const char *resultName(int nResult);
+
+private:
+    int     checkLocked(double dRa, double dDec, double dLst, double *pdAlt) const;
+    void    buildHorizonBins();
+
+    mutable std::mutex  m_Mutex;
+    bool    m_bSiteValid;
+    double  m_dLatitude;
+    double  m_dLongitude;
+    double  m_dSinLat;
+    double  m_dCosLat;
+    double  m_dHoursEast;
+    double  m_dHoursWest;
+    double  m_dMinAltitude;
+    std::vector<std::pair<double, double>>  m_vHorizon;     // sorted on azimuth
+    double  m_dHorizonBins[LIMITS_HORIZON_BINS];            // max(horizon, min altitude)
+};
+
+#endif // __RST_LIMITS__
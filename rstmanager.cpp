@@ -0,0 +1,338 @@
+#include "rstmanager.h"
+
+RSTManager &RSTManager::instance()
+{
+    static RSTManager manager;
+    return manager;
+}
+
+RSTManager::RSTManager()
+{
+    m_nMaxWorkers = MANAGER_MAX_WORKERS;
+    m_bStopping = false;
+    m_nAbortGeneration = 0;
+    m_bParkAllRunning = false;
+}
+
+RSTManager::~RSTManager()
+{
+    m_nAbortGeneration++;
+    if(m_ParkAllThread.joinable())
+        m_ParkAllThread.join();
+    stopWorkers();
+}
+
+void RSTManager::setMaxWorkers(int nWorkers)
+{
+    stopWorkers();
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nMaxWorkers = std::max(1, nWorkers);
+}
+
+#pragma mark - links
+void RSTManager::registerMount(RST *pMount, int nIndex)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::shared_ptr<Link> link = std::make_shared<Link>();
+
+    link->pMount = pMount;
+    link->nIndex = nIndex;
+    link->bReady = false;
+    link->bRunning = false;
+    link->nAborting = 0;
+    m_Links[pMount] = link;
+}
+
+void RSTManager::unregisterMount(RST *pMount)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    std::map<RST *, std::shared_ptr<Link>>::iterator it = m_Links.find(pMount);
+    std::shared_ptr<Link> link;
+
+    if(it == m_Links.end())
+        return;
+    link = it->second;
+    m_Links.erase(it);
+
+    while(!link->Jobs.empty()) {
+        link->Jobs.front()->promise.set_value(ERR_ABORTEDPROCESS);
+        link->Jobs.pop_front();
+    }
+    if(link->bReady) {
+        m_Ready.erase(std::remove(m_Ready.begin(), m_Ready.end(), link), m_Ready.end());
+        link->bReady = false;
+    }
+    // the mount is about to go away, its running job and an abortAll on it must be done first
+    m_IdleCond.wait(lock, [&link]{ return !link->bRunning && !link->nAborting; });
+}
+
+int RSTManager::getMountCount()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return (int)m_Links.size();
+}
+
+void RSTManager::getLinks(std::vector<std::shared_ptr<Link>> &vLinks)
+{
+    vLinks.clear();
+    for(std::map<RST *, std::shared_ptr<Link>>::iterator it = m_Links.begin(); it != m_Links.end(); ++it)
+        vLinks.push_back(it->second);
+    std::sort(vLinks.begin(), vLinks.end(), [](const std::shared_ptr<Link> &a, const std::shared_ptr<Link> &b) { return a->nIndex < b->nIndex; });
+}
+
+#pragma mark - scheduler
+std::future<int> RSTManager::submit(RST *pMount, std::function<int(RST &)> fJob)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::map<RST *, std::shared_ptr<Link>>::iterator it = m_Links.find(pMount);
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    std::future<int> result = job->promise.get_future();
+
+    if(it == m_Links.end()) {
+        job->promise.set_value(ERR_NOLINK);
+        return result;
+    }
+
+    job->fJob = fJob;
+    it->second->Jobs.push_back(job);
+    if(!it->second->bReady && !it->second->bRunning) {
+        it->second->bReady = true;
+        m_Ready.push_back(it->second);
+    }
+    // one worker per link at most, and never more than m_nMaxWorkers
+    if(m_Workers.size() < std::min((size_t)m_nMaxWorkers, m_Links.size()))
+        m_Workers.push_back(std::thread(&RSTManager::workerThread, this));
+    m_WorkCond.notify_one();
+    return result;
+}
+
+void RSTManager::workerThread()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    std::shared_ptr<Link> link;
+    std::shared_ptr<Job> job;
+    int nErr;
+
+    while(true) {
+        m_WorkCond.wait(lock, [this]{ return m_bStopping || !m_Ready.empty(); });
+        if(m_Ready.empty())
+            break;  // stopping and nothing left to do
+
+        link = m_Ready.front();
+        m_Ready.pop_front();
+        link->bReady = false;
+        if(link->Jobs.empty())
+            continue;
+        job = link->Jobs.front();
+        link->Jobs.pop_front();
+        link->bRunning = true;
+
+        lock.unlock();
+        nErr = job->fJob(*link->pMount);
+        job->promise.set_value(nErr);
+        job.reset();
+        lock.lock();
+
+        link->bRunning = false;
+        // one job per turn, the link goes to the back of the line if it has more
+        if(!link->Jobs.empty()) {
+            link->bReady = true;
+            m_Ready.push_back(link);
+            m_WorkCond.notify_one();
+        }
+        m_IdleCond.notify_all();
+    }
+}
+
+void RSTManager::stopWorkers()
+{
+    std::vector<std::thread> vWorkers;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStopping = true;
+        vWorkers.swap(m_Workers);
+    }
+    m_WorkCond.notify_all();
+    for(size_t i = 0; i < vWorkers.size(); i++)
+        if(vWorkers[i].joinable())
+            vWorkers[i].join();
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bStopping = false;
+}
+
+int RSTManager::waitAll(std::vector<std::future<int>> &vFutures, std::vector<int> &vErrors)
+{
+    int nErr = PLUGIN_OK;
+
+    vErrors.resize(vFutures.size());
+    for(size_t i = 0; i < vFutures.size(); i++) {
+        vErrors[i] = vFutures[i].get();
+        if(vErrors[i] && !nErr)
+            nErr = vErrors[i];
+    }
+    return nErr;
+}
+
+#pragma mark - coordinated operations
+void RSTManager::getStatusAll(std::vector<RSTManagedStatus> &vStatus)
+{
+    std::vector<std::shared_ptr<Link>> vLinks;
+    RSTManagedStatus status;
+    std::lock_guard<std::mutex> lock(m_Mutex);  // the mounts can't go away while we read them
+
+    getLinks(vLinks);
+    vStatus.clear();
+    for(size_t i = 0; i < vLinks.size(); i++) {
+        status.nIndex = vLinks[i]->nIndex;
+        status.bConnected = vLinks[i]->pMount->isConnected();
+        vLinks[i]->pMount->getStatusSnapshot(status.Status);
+        vStatus.push_back(status);
+    }
+}
+
+int RSTManager::parkAll(bool bWait, std::vector<int> &vErrors)
+{
+    std::vector<std::shared_ptr<Link>> vLinks;
+    std::vector<std::future<int>> vFutures;
+    std::vector<int> vStepErrors;
+    std::vector<size_t> vPending;
+    std::vector<size_t> vStillPending;
+    std::vector<std::shared_ptr<bool>> vComplete;
+    int nGeneration = m_nAbortGeneration;
+    CStopWatch parkTimer;
+    size_t i;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        getLinks(vLinks);
+        for(i = 0; i < vLinks.size(); i++)
+            if(vLinks[i]->pMount->isConnected())
+                vPending.push_back(i);
+    }
+    vErrors.assign(vLinks.size(), ERR_NOLINK);
+
+    // all the gotos go out at once
+    for(i = 0; i < vPending.size(); i++)
+        vFutures.push_back(submit(vLinks[vPending[i]]->pMount, [](RST &mount) { return mount.gotoParkPosition(); }));
+    waitAll(vFutures, vStepErrors);
+    vStillPending.clear();
+    for(i = 0; i < vPending.size(); i++) {
+        vErrors[vPending[i]] = vStepErrors[i];
+        if(!vStepErrors[i])
+            vStillPending.push_back(vPending[i]);
+    }
+    vPending.swap(vStillPending);
+
+    // then we watch them all, a mount that is done gets its tracking stopped and is marked parked
+    while(bWait && !vPending.empty()) {
+        if(m_nAbortGeneration != nGeneration) {
+            for(i = 0; i < vPending.size(); i++)
+                vErrors[vPending[i]] = ERR_ABORTEDPROCESS;
+            break;
+        }
+        if(parkTimer.GetElapsedSeconds() > MANAGER_PARK_TIMEOUT) {
+            for(i = 0; i < vPending.size(); i++)
+                vErrors[vPending[i]] = COMMAND_TIMEOUT;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(MANAGER_POLL_INTERVAL));
+
+        vFutures.clear();
+        vComplete.clear();
+        for(i = 0; i < vPending.size(); i++) {
+            std::shared_ptr<bool> bComplete = std::make_shared<bool>(false);
+            vComplete.push_back(bComplete);
+            vFutures.push_back(submit(vLinks[vPending[i]]->pMount, [bComplete](RST &mount) {
+                int nErr = mount.isSlewToComplete(*bComplete);
+                if(nErr || !*bComplete)
+                    return nErr;
+                nErr = mount.setTrackingRates(false, true, 0.0, 0.0);
+                mount.setMountIsParked(true);
+                return nErr;
+            }));
+        }
+        waitAll(vFutures, vStepErrors);
+        vStillPending.clear();
+        for(i = 0; i < vPending.size(); i++) {
+            vErrors[vPending[i]] = vStepErrors[i];
+            if(!vStepErrors[i] && !*vComplete[i])
+                vStillPending.push_back(vPending[i]);
+        }
+        vPending.swap(vStillPending);
+    }
+
+    for(i = 0; i < vErrors.size(); i++)
+        if(vErrors[i] && vErrors[i] != ERR_NOLINK)
+            return vErrors[i];
+    return PLUGIN_OK;
+}
+
+bool RSTManager::startParkAll()
+{
+    if(m_bParkAllRunning)
+        return false;
+    if(m_ParkAllThread.joinable())
+        m_ParkAllThread.join();
+    m_bParkAllRunning = true;
+    m_ParkAllThread = std::thread([this]() {
+        std::vector<int> vErrors;
+        parkAll(true, vErrors);
+        m_bParkAllRunning = false;
+    });
+    return true;
+}
+
+int RSTManager::abortAll(std::vector<int> &vErrors)
+{
+    std::vector<std::shared_ptr<Link>> vLinks;
+    std::vector<std::future<int>> vFutures;
+    std::vector<size_t> vAborted;
+    std::vector<int> vStepErrors;
+    size_t i;
+
+    m_nAbortGeneration++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        getLinks(vLinks);
+        vErrors.assign(vLinks.size(), ERR_NOLINK);
+        for(i = 0; i < vLinks.size(); i++) {
+            std::shared_ptr<Link> &link = vLinks[i];
+            // whatever was queued is moot now
+            while(!link->Jobs.empty()) {
+                link->Jobs.front()->promise.set_value(ERR_ABORTEDPROCESS);
+                link->Jobs.pop_front();
+            }
+            if(link->bReady) {
+                m_Ready.erase(std::remove(m_Ready.begin(), m_Ready.end(), link), m_Ready.end());
+                link->bReady = false;
+            }
+            if(!link->pMount->isConnected())
+                continue;
+            link->nAborting++;
+            vAborted.push_back(i);
+        }
+    }
+
+    // not through the queue : Abort writes its :Q# directly, it doesn't wait for the job running on the link
+    // nor for a free worker. One thread per mount so they all stop at once.
+    for(i = 0; i < vAborted.size(); i++) {
+        std::shared_ptr<Link> link = vLinks[vAborted[i]];
+        vFutures.push_back(std::async(std::launch::async, [this, link]() {
+            int nErr = link->pMount->Abort();
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            link->nAborting--;
+            m_IdleCond.notify_all();
+            return nErr;
+        }));
+    }
+
+    waitAll(vFutures, vStepErrors);
+    for(i = 0; i < vAborted.size(); i++)
+        vErrors[vAborted[i]] = vStepErrors[i];
+
+    for(i = 0; i < vErrors.size(); i++)
+        if(vErrors[i] && vErrors[i] != ERR_NOLINK)
+            return vErrors[i];
+    return PLUGIN_OK;
+}
@@ -0,0 +1,96 @@
+#ifndef __RST_MANAGER__
+#define __RST_MANAGER__
+
+#pragma once
+
+// Shared scheduler for all the RST mounts driven from one process (one X2 instance per mount).
+// Coordinated operations (park all) run on a small bounded pool of I/O threads instead of one
+// thread per mount. Jobs for one link run one at a time and in order, links take turns on the pool, so a slow
+// (WiFi) mount only ever holds one worker and can't delay the others. Abort all goes around the pool.
+// The combined status comes from each mount's status snapshot and costs no I/O.
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <future>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "RST.h"
+
+#define MANAGER_MAX_WORKERS     4       // I/O threads shared by all the links
+#define MANAGER_POLL_INTERVAL   250     // ms between slew complete checks while waiting for park all
+#define MANAGER_PARK_TIMEOUT    300     // seconds
+
+typedef struct {
+    int                 nIndex;     // X2 instance index
+    bool                bConnected;
+    RSTStatusSnapshot   Status;
+} RSTManagedStatus;
+
+class RSTManager
+{
+public:
+    static RSTManager &instance();
+    ~RSTManager();
+
+    void    registerMount(RST *pMount, int nIndex);
+    // drops the mount's queued jobs and waits for the running one
+    void    unregisterMount(RST *pMount);
+    int     getMountCount();
+
+    // run fJob on pMount's link, jobs for one link are serialized, the future holds the job's return code
+    std::future<int> submit(RST *pMount, std::function<int(RST &)> fJob);
+
+    void    getStatusAll(std::vector<RSTManagedStatus> &vStatus);
+    // start parking all connected mounts in parallel and optionally wait until they are all done.
+    // vErrors gets one error code per mount, in instance index order.
+    int     parkAll(bool bWait, std::vector<int> &vErrors);
+    // parkAll(true) in the background so a UI thread doesn't block, false if one is already running
+    bool    startParkAll();
+    bool    isParkAllRunning() const { return m_bParkAllRunning; }
+    // stop all connected mounts now, in parallel and without waiting for their running job. Anything queued is dropped.
+    int     abortAll(std::vector<int> &vErrors);
+
+    void    setMaxWorkers(int nWorkers);
+
+private:
+    RSTManager();
+
+    typedef struct {
+        std::function<int(RST &)>   fJob;
+        std::promise<int>           promise;
+    } Job;
+
+    typedef struct {
+        RST                                 *pMount;
+        int                                 nIndex;
+        std::deque<std::shared_ptr<Job>>    Jobs;
+        bool                                bReady;     // in m_Ready
+        bool                                bRunning;   // a worker is running one of its jobs
+        int                                 nAborting;  // abortAll calls on the mount, outside the queue
+    } Link;
+
+    void    stopWorkers();
+    void    workerThread();
+    void    getLinks(std::vector<std::shared_ptr<Link>> &vLinks);   // with m_Mutex held, sorted by instance index
+    int     waitAll(std::vector<std::future<int>> &vFutures, std::vector<int> &vErrors);
+
+    std::mutex                              m_Mutex;
+    std::condition_variable                 m_WorkCond;
+    std::condition_variable                 m_IdleCond;
+    std::map<RST *, std::shared_ptr<Link>>  m_Links;
+    std::deque<std::shared_ptr<Link>>       m_Ready;        // links with queued jobs and nothing running, served in turn
+    std::vector<std::thread>                m_Workers;
+    int                                     m_nMaxWorkers;
+    bool                                    m_bStopping;
+    std::atomic<int>                        m_nAbortGeneration;  // bumped by abortAll so a park all wait gives up
+    std::thread                             m_ParkAllThread;
+    std::atomic<bool>                       m_bParkAllRunning;
+};
+
+#endif // __RST_MANAGER__
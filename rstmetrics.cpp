@@ -0,0 +1,338 @@
+#include "rstmetrics.h"
+#include "rstrecorder.h"
+
+#include <cstdio>
+#include <cstring>
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#if !defined(MSG_NOSIGNAL)
+#define MSG_NOSIGNAL 0  // macOS, SO_NOSIGPIPE is set on the socket instead
+#endif
+#endif
+
+const double RSTCommandMetrics::dLatencyBuckets[METRICS_LATENCY_BUCKETS - 1] = {0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0};
+
+static const char *pollStateName(int nState)
+{
+    switch(nState) {
+        case POLL_STATE_TRACKING :  return "tracking";
+        case POLL_STATE_SLEWING :   return "slewing";
+        case POLL_STATE_PARKED :    return "parked";
+        default :                   return "idle";
+    }
+}
+
+// the opcode goes in a label value, keep it to plain characters
+static void opLabel(uint32_t nOp, char *pszOp)
+{
+    int i;
+
+    memcpy(pszOp, &nOp, sizeof(nOp));
+    pszOp[RST_RECORDER_OP_SIZE] = 0;
+    for(i = 0; pszOp[i]; i++)
+        if(pszOp[i] < '0' || pszOp[i] > 'z' || pszOp[i] == '\\')
+            pszOp[i] = '_';
+}
+
+#pragma mark - counters
+
+RSTCommandMetrics::RSTCommandMetrics()
+{
+    int i, j;
+
+    for(i = 0; i < METRICS_MAX_OPS; i++) {
+        m_Ops[i].nOp = 0;
+        m_Ops[i].nTimeouts = 0;
+        m_Ops[i].nErrors = 0;
+        m_Ops[i].nSumUs = 0;
+        for(j = 0; j < METRICS_LATENCY_BUCKETS; j++)
+            m_Ops[i].nBuckets[j] = 0;
+    }
+    for(i = 0; i < POLL_STATE_COUNT; i++)
+        m_nPolls[i] = 0;
+    m_nDroppedOps = 0;
+    m_nBytesSent = 0;
+    m_nBytesReceived = 0;
+    m_nReadRetries = 0;
+    m_nCommandRetries = 0;
+}
+
+void RSTCommandMetrics::addCommand(const std::string &sCmd, int nCode, uint32_t nLatencyUs)
+{
+    char szOp[RST_RECORDER_OP_SIZE];
+    uint32_t nOp;
+    uint32_t nExpected;
+    int nSlot;
+    int nBucket;
+
+    RSTRecorder::opcode(sCmd, szOp);
+    memcpy(&nOp, szOp, sizeof(nOp));
+    if(!nOp)
+        return;
+
+    // slots are never given back, so the first one holding our opcode (or free) is ours
+    for(nSlot = 0; nSlot < METRICS_MAX_OPS; nSlot++) {
+        nExpected = m_Ops[nSlot].nOp.load(std::memory_order_acquire);
+        if(nExpected == nOp)
+            break;
+        if(!nExpected) {
+            if(m_Ops[nSlot].nOp.compare_exchange_strong(nExpected, nOp, std::memory_order_acq_rel) || nExpected == nOp)
+                break;
+        }
+    }
+    if(nSlot == METRICS_MAX_OPS) {
+        m_nDroppedOps.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    OpCounters &Op = m_Ops[nSlot];
+    for(nBucket = 0; nBucket < METRICS_LATENCY_BUCKETS - 1; nBucket++)
+        if(nLatencyUs <= dLatencyBuckets[nBucket] * 1e6)
+            break;
+    Op.nBuckets[nBucket].fetch_add(1, std::memory_order_relaxed);
+    Op.nSumUs.fetch_add(nLatencyUs, std::memory_order_relaxed);
+    switch(nCode & ~REC_CMD_BURST) {
+        case REC_CMD_TIMEOUT :  Op.nTimeouts.fetch_add(1, std::memory_order_relaxed); break;
+        case REC_CMD_ERROR :    Op.nErrors.fetch_add(1, std::memory_order_relaxed); break;
+        default :               break;
+    }
+}
+
+void RSTCommandMetrics::format(std::string &sOut) const
+{
+    char szLine[256];
+    char szOp[RST_RECORDER_OP_SIZE + 1];
+    uint32_t nOp;
+    uint64_t nCumulative;
+    int nSlot;
+    int i;
+
+    // one pass per family, the text format wants a family's samples together
+    sOut += "# HELP rst_command_latency_seconds Time from sending a command to its answer (or timeout).\n";
+    sOut += "# TYPE rst_command_latency_seconds histogram\n";
+    for(nSlot = 0; nSlot < METRICS_MAX_OPS; nSlot++) {
+        nOp = m_Ops[nSlot].nOp.load(std::memory_order_acquire);
+        if(!nOp)
+            break;
+        opLabel(nOp, szOp);
+        nCumulative = 0;
+        for(i = 0; i < METRICS_LATENCY_BUCKETS - 1; i++) {
+            nCumulative += m_Ops[nSlot].nBuckets[i].load(std::memory_order_relaxed);
+            snprintf(szLine, sizeof(szLine), "rst_command_latency_seconds_bucket{op=\"%s\",le=\"%g\"} %llu\n", szOp, dLatencyBuckets[i], (unsigned long long)nCumulative);
+            sOut += szLine;
+        }
+        nCumulative += m_Ops[nSlot].nBuckets[METRICS_LATENCY_BUCKETS - 1].load(std::memory_order_relaxed);
+        snprintf(szLine, sizeof(szLine), "rst_command_latency_seconds_bucket{op=\"%s\",le=\"+Inf\"} %llu\n", szOp, (unsigned long long)nCumulative);
+        sOut += szLine;
+        snprintf(szLine, sizeof(szLine), "rst_command_latency_seconds_sum{op=\"%s\"} %.6f\n", szOp, m_Ops[nSlot].nSumUs.load(std::memory_order_relaxed) / 1e6);
+        sOut += szLine;
+        // the buckets are read one by one while commands keep coming, the count has to match them
+        snprintf(szLine, sizeof(szLine), "rst_command_latency_seconds_count{op=\"%s\"} %llu\n", szOp, (unsigned long long)nCumulative);
+        sOut += szLine;
+    }
+
+    sOut += "# HELP rst_command_timeouts_total Commands that expected an answer and got none.\n";
+    sOut += "# TYPE rst_command_timeouts_total counter\n";
+    for(nSlot = 0; nSlot < METRICS_MAX_OPS && (nOp = m_Ops[nSlot].nOp.load(std::memory_order_acquire)); nSlot++) {
+        opLabel(nOp, szOp);
+        snprintf(szLine, sizeof(szLine), "rst_command_timeouts_total{op=\"%s\"} %llu\n", szOp, (unsigned long long)m_Ops[nSlot].nTimeouts.load(std::memory_order_relaxed));
+        sOut += szLine;
+    }
+
+    sOut += "# HELP rst_command_errors_total Commands that failed on the link for another reason than a timeout.\n";
+    sOut += "# TYPE rst_command_errors_total counter\n";
+    for(nSlot = 0; nSlot < METRICS_MAX_OPS && (nOp = m_Ops[nSlot].nOp.load(std::memory_order_acquire)); nSlot++) {
+        opLabel(nOp, szOp);
+        snprintf(szLine, sizeof(szLine), "rst_command_errors_total{op=\"%s\"} %llu\n", szOp, (unsigned long long)m_Ops[nSlot].nErrors.load(std::memory_order_relaxed));
+        sOut += szLine;
+    }
+
+    snprintf(szLine, sizeof(szLine), "# HELP rst_command_ops_dropped_total Commands not counted because the opcode table is full.\n# TYPE rst_command_ops_dropped_total counter\nrst_command_ops_dropped_total %llu\n",
+             (unsigned long long)m_nDroppedOps.load(std::memory_order_relaxed));
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_read_retries_total Extra reads because an async notification came before the answer.\n# TYPE rst_read_retries_total counter\nrst_read_retries_total %llu\n",
+             (unsigned long long)m_nReadRetries.load(std::memory_order_relaxed));
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_command_retries_total Queries sent again after a failure.\n# TYPE rst_command_retries_total counter\nrst_command_retries_total %llu\n",
+             (unsigned long long)m_nCommandRetries.load(std::memory_order_relaxed));
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_link_sent_bytes_total Bytes written to the link.\n# TYPE rst_link_sent_bytes_total counter\nrst_link_sent_bytes_total %llu\n",
+             (unsigned long long)m_nBytesSent.load(std::memory_order_relaxed));
+    sOut += szLine;
+    snprintf(szLine, sizeof(szLine), "# HELP rst_link_received_bytes_total Bytes read from the link.\n# TYPE rst_link_received_bytes_total counter\nrst_link_received_bytes_total %llu\n",
+             (unsigned long long)m_nBytesReceived.load(std::memory_order_relaxed));
+    sOut += szLine;
+
+    sOut += "# HELP rst_polls_total Position polls by mount state, rate() gives the poll rate.\n";
+    sOut += "# TYPE rst_polls_total counter\n";
+    for(i = 0; i < POLL_STATE_COUNT; i++) {
+        snprintf(szLine, sizeof(szLine), "rst_polls_total{state=\"%s\"} %llu\n", pollStateName(i), (unsigned long long)m_nPolls[i].load(std::memory_order_relaxed));
+        sOut += szLine;
+    }
+}
+
+#pragma mark - HTTP listener
+
+RSTMetricsServer::RSTMetricsServer()
+{
+    m_nListenSocket = -1;
+    m_nPort = 0;
+    m_bRunning = false;
+    m_nScrapes = 0;
+}
+
+RSTMetricsServer::~RSTMetricsServer()
+{
+    stop();
+}
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+
+int RSTMetricsServer::start(int nPort, std::function<void(std::string &)> fFormat)
+{
+    struct sockaddr_in addr;
+    int nOn = 1;
+
+    stop();
+    if(nPort <= 0 || nPort > 65535)
+        return ERR_CMDFAILED;
+
+    m_nListenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(m_nListenSocket < 0)
+        return ERR_COMMNOLINK;
+    setsockopt(m_nListenSocket, SOL_SOCKET, SO_REUSEADDR, &nOn, sizeof(nOn));
+
+    // local only, the monitoring agent runs on this machine
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)nPort);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(m_nListenSocket, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(m_nListenSocket, 4) < 0) {
+        ::close(m_nListenSocket);
+        m_nListenSocket = -1;
+        return ERR_COMMNOLINK;
+    }
+
+    m_nPort = nPort;
+    m_fFormat = fFormat;
+    m_bRunning = true;
+    m_Thread = std::thread(&RSTMetricsServer::serverThread, this);
+    return SB_OK;
+}
+
+void RSTMetricsServer::stop()
+{
+    m_bRunning = false;
+    if(m_Thread.joinable())
+        m_Thread.join();
+    if(m_nListenSocket >= 0) {
+        ::close(m_nListenSocket);
+        m_nListenSocket = -1;
+    }
+    m_nPort = 0;
+}
+
+void RSTMetricsServer::serverThread()
+{
+    struct pollfd pfd;
+    int nClientSocket;
+
+    pfd.fd = m_nListenSocket;
+    pfd.events = POLLIN;
+    while(m_bRunning) {
+        if(poll(&pfd, 1, METRICS_ACCEPT_TIMEOUT) <= 0 || !(pfd.revents & POLLIN))
+            continue;
+        nClientSocket = accept(m_nListenSocket, NULL, NULL);
+        if(nClientSocket < 0)
+            continue;
+        // one scrape at a time is plenty, they come every few seconds
+        handleClient(nClientSocket);
+        ::close(nClientSocket);
+    }
+}
+
+void RSTMetricsServer::handleClient(int nSocket)
+{
+    char szRequest[2048];
+    char szHeader[256];
+    struct timeval tv;
+    size_t nLen = 0;
+    ssize_t nRead;
+    std::string sBody;
+    std::string sStatus;
+
+    tv.tv_sec = METRICS_REQUEST_TIMEOUT / 1000;
+    tv.tv_usec = (METRICS_REQUEST_TIMEOUT % 1000) * 1000;
+    setsockopt(nSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(nSocket, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#if defined(SO_NOSIGPIPE)
+    int nOn = 1;
+    setsockopt(nSocket, SOL_SOCKET, SO_NOSIGPIPE, &nOn, sizeof(nOn));
+#endif
+
+    // we only look at the request line, read until the end of the headers
+    while(nLen < sizeof(szRequest) - 1) {
+        nRead = recv(nSocket, szRequest + nLen, sizeof(szRequest) - 1 - nLen, 0);
+        if(nRead <= 0)
+            break;
+        nLen += nRead;
+        szRequest[nLen] = 0;
+        if(strstr(szRequest, "\r\n\r\n") || strstr(szRequest, "\n\n"))
+            break;
+    }
+    szRequest[nLen] = 0;
+    if(!nLen)
+        return;
+
+    if(!strncmp(szRequest, "GET /metrics ", 13) || !strncmp(szRequest, "GET /metrics?", 13)) {
+        sStatus = "200 OK";
+        m_fFormat(sBody);
+        m_nScrapes++;
+    }
+    else if(strncmp(szRequest, "GET ", 4)) {
+        sStatus = "405 Method Not Allowed";
+        sBody = "GET only\n";
+    }
+    else {
+        sStatus = "404 Not Found";
+        sBody = "try /metrics\n";
+    }
+
+    snprintf(szHeader, sizeof(szHeader), "HTTP/1.1 %s\r\nContent-Type: " METRICS_CONTENT_TYPE "\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n", sStatus.c_str(), sBody.size());
+    sBody.insert(0, szHeader);
+    for(size_t nSent = 0; nSent < sBody.size(); ) {
+        ssize_t nWritten = send(nSocket, sBody.c_str() + nSent, sBody.size() - nSent, MSG_NOSIGNAL);
+        if(nWritten <= 0)
+            break;
+        nSent += nWritten;
+    }
+}
+
+#else
+
+// no BSD sockets in the Windows build, the metrics stay internal
+
+int RSTMetricsServer::start(int nPort, std::function<void(std::string &)> fFormat)
+{
+    return ERR_NOT_IMPL;
+}
+
+void RSTMetricsServer::stop()
+{
+}
+
+void RSTMetricsServer::serverThread()
+{
+}
+
+void RSTMetricsServer::handleClient(int nSocket)
+{
+}
+
+#endif
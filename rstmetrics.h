@@ -0,0 +1,88 @@
+#ifndef __RST_METRICS__
+#define __RST_METRICS__
+
+#pragma once
+
+// Counters for the observatory monitoring, served in the Prometheus text exposition format by a small HTTP
+// listener on 127.0.0.1 (off unless a port is set).
+// Per opcode command counts and latency histograms live in a fixed table of atomic counters, a slot is claimed
+// with a compare and swap the first time an opcode is seen. Updating them is a handful of relaxed atomic adds
+// on the command path and the scrape only reads them, nobody takes a lock and the scrape never touches the link.
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+
+#include "rsterrors.h"
+
+#define METRICS_MAX_OPS             64      // distinct opcodes, the RST protocol uses about 50
+#define METRICS_LATENCY_BUCKETS     11      // the last one is +Inf
+#define METRICS_ACCEPT_TIMEOUT      250     // ms, how often the listener checks it should stop
+#define METRICS_REQUEST_TIMEOUT     1000    // ms a client gets to send its request
+#define METRICS_CONTENT_TYPE        "text/plain; version=0.0.4"
+
+enum RSTMetricsPollState {POLL_STATE_IDLE=0, POLL_STATE_TRACKING, POLL_STATE_SLEWING, POLL_STATE_PARKED, POLL_STATE_COUNT};
+
+class RSTCommandMetrics
+{
+public:
+    RSTCommandMetrics();
+
+    // nCode is one of the REC_CMD_xxx codes (rstrecorder.h), the burst bit is ignored
+    void    addCommand(const std::string &sCmd, int nCode, uint32_t nLatencyUs);
+    void    addBytesSent(unsigned long nBytes)      { m_nBytesSent.fetch_add(nBytes, std::memory_order_relaxed); }
+    void    addBytesReceived(unsigned long nBytes)  { m_nBytesReceived.fetch_add(nBytes, std::memory_order_relaxed); }
+    void    addReadRetry()                          { m_nReadRetries.fetch_add(1, std::memory_order_relaxed); }
+    void    addCommandRetry()                       { m_nCommandRetries.fetch_add(1, std::memory_order_relaxed); }
+    void    addPoll(int nState)                     { m_nPolls[nState].fetch_add(1, std::memory_order_relaxed); }
+
+    // appends the command, poll and link families to sOut
+    void    format(std::string &sOut) const;
+
+    static const double dLatencyBuckets[METRICS_LATENCY_BUCKETS - 1];   // seconds
+
+private:
+    typedef struct {
+        std::atomic<uint32_t>   nOp;        // opcode packed in 4 bytes, 0 for a free slot
+        std::atomic<uint64_t>   nTimeouts;
+        std::atomic<uint64_t>   nErrors;
+        std::atomic<uint64_t>   nSumUs;
+        std::atomic<uint64_t>   nBuckets[METRICS_LATENCY_BUCKETS];   // not cumulative, the scrape adds them up
+    } OpCounters;
+
+    OpCounters              m_Ops[METRICS_MAX_OPS];
+    std::atomic<uint64_t>   m_nDroppedOps;      // commands we had no slot for
+    std::atomic<uint64_t>   m_nBytesSent;
+    std::atomic<uint64_t>   m_nBytesReceived;
+    std::atomic<uint64_t>   m_nReadRetries;     // extra reads because an async notification came first
+    std::atomic<uint64_t>   m_nCommandRetries;  // queries sent again after a failure
+    std::atomic<uint64_t>   m_nPolls[POLL_STATE_COUNT];
+};
+
+// the HTTP side, GET /metrics answers with whatever the callback puts in the string
+class RSTMetricsServer
+{
+public:
+    RSTMetricsServer();
+    ~RSTMetricsServer();
+
+    int     start(int nPort, std::function<void(std::string &)> fFormat);
+    void    stop();
+    int     getPort() const { return m_nPort; }
+    uint64_t getScrapeCount() const { return m_nScrapes; }
+
+private:
+    void    serverThread();
+    void    handleClient(int nSocket);
+
+    int                                 m_nListenSocket;
+    int                                 m_nPort;
+    std::function<void(std::string &)>  m_fFormat;
+    std::thread                         m_Thread;
+    std::atomic<bool>                   m_bRunning;
+    std::atomic<uint64_t>               m_nScrapes;
+};
+
+#endif // __RST_METRICS__
@@ -0,0 +1,115 @@
+#include "rstpierside.h"
+
+#include <cmath>
+#include <algorithm>
+
+RSTPierSideModel::RSTPierSideModel()
+{
+    m_bAnchored = false;
+    m_bBeyondPole = false;
+    m_dFlipHourAngle = PIER_DEFAULT_FLIP_HOUR_ANGLE;
+    m_bLatitude = false;
+    m_dLatitude = 0.0;
+    m_nGotos = 0;
+    m_nMispredicted = 0;
+}
+
+void RSTPierSideModel::setFlipHourAngle(double dHours)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_dFlipHourAngle = std::min(std::max(dHours, -PIER_FLIP_MAX_HOUR_ANGLE), PIER_FLIP_MAX_HOUR_ANGLE);
+}
+
+double RSTPierSideModel::getFlipHourAngle() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_dFlipHourAngle;
+}
+
+void RSTPierSideModel::setLatitude(double dLatitude)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_dLatitude = dLatitude;
+    m_bLatitude = true;
+}
+
+void RSTPierSideModel::anchor(bool bBeyondPole, bool bGoto, double dGotoHourAngle, double dGotoDec)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_bAnchored = true;
+    m_bBeyondPole = bBeyondPole;
+    if(!bGoto || keepsSide(dGotoHourAngle, dGotoDec))
+        return;
+
+    m_nGotos++;
+    if((dGotoHourAngle < m_dFlipHourAngle) == bBeyondPole)
+        return;
+    // the mount flips later (or earlier) than we thought, move the flip just past this goto
+    m_nMispredicted++;
+    m_dFlipHourAngle = bBeyondPole ? dGotoHourAngle + PIER_FLIP_LEARN_MARGIN : dGotoHourAngle - PIER_FLIP_LEARN_MARGIN;
+    m_dFlipHourAngle = std::min(std::max(m_dFlipHourAngle, -PIER_FLIP_MAX_HOUR_ANGLE), PIER_FLIP_MAX_HOUR_ANGLE);
+}
+
+void RSTPierSideModel::invalidate()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_bAnchored = false;
+}
+
+bool RSTPierSideModel::getSide(bool &bBeyondPole) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    bBeyondPole = m_bBeyondPole;
+    return m_bAnchored;
+}
+
+int RSTPierSideModel::predict(double dRa, double dDec, double dLst, int nFromSide) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return predictSide(dRa, dDec, dLst, nFromSide);
+}
+
+void RSTPierSideModel::predict(const std::vector<RSTTarget> &vTargets, double dLst, std::vector<int> &vPierSides) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    vPierSides.resize(vTargets.size());
+    for(size_t i = 0; i < vTargets.size(); i++)
+        vPierSides[i] = predictSide(vTargets[i].dRa, vTargets[i].dDec, dLst, STATUS_PIER_UNKNOWN);
+}
+
+void RSTPierSideModel::getStats(unsigned long &nGotos, unsigned long &nMispredicted) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    nGotos = m_nGotos;
+    nMispredicted = m_nMispredicted;
+}
+
+int RSTPierSideModel::predictSide(double dRa, double dDec, double dLst, int nFromSide) const
+{
+    double dHourAngle = hourAngle(dRa, dLst);
+
+    if(nFromSide == STATUS_PIER_UNKNOWN && m_bAnchored)
+        nFromSide = m_bBeyondPole ? STATUS_PIER_WEST : STATUS_PIER_EAST;
+    if(nFromSide != STATUS_PIER_UNKNOWN && keepsSide(dHourAngle, dDec))
+        return nFromSide;
+    return dHourAngle < m_dFlipHourAngle ? STATUS_PIER_WEST : STATUS_PIER_EAST;
+}
+
+// close to the pole, or circumpolar and below the pole (more than 6 hours from the upper meridian)
+bool RSTPierSideModel::keepsSide(double dHourAngle, double dDec) const
+{
+    if(std::fabs(dDec) > 90.0 - PIER_POLE_MARGIN)
+        return true;
+    if(!m_bLatitude || std::fabs(dHourAngle) <= 6.0)
+        return false;
+    return m_dLatitude >= 0.0 ? dDec > 90.0 - m_dLatitude : dDec < -90.0 - m_dLatitude;
+}
+
+double RSTPierSideModel::hourAngle(double dRa, double dLst)
+{
+    return std::fmod(std::fmod(dLst - dRa, 24.0) + 36.0, 24.0) - 12.0;
+}
@@ -0,0 +1,66 @@
+#ifndef __RST_PIER_SIDE__
+#define __RST_PIER_SIDE__
+
+#pragma once
+
+// Pier side model. The side only changes when the mount moves on its own axes (goto, sync, park, homing,
+// manual moves), tracking keeps it. So one :CY# reading after each of those anchors the side until the next
+// one, and IsBeyondThePole answers from the anchor.
+// For a goto the mount puts the telescope west of the pier (beyond the pole) when the target is east of the
+// flip hour angle. The flip hour angle starts at the configured value and moves to agree with what the mount
+// actually did after each goto.
+// The hour angle doesn't choose the side for a target close to the pole, nor for a circumpolar one below the pole
+// (the mount tracks it through the lower meridian without a flip) : the mount stays on the side it is, and gotos
+// there don't teach us anything about the flip.
+
+#include <vector>
+#include <mutex>
+
+#include "rstlimits.h"
+#include "rststatus.h"
+
+#define PIER_DEFAULT_FLIP_HOUR_ANGLE    0.0     // hours, the meridian
+#define PIER_FLIP_LEARN_MARGIN          0.05    // hours past the goto that proved the flip hour angle wrong
+#define PIER_FLIP_MAX_HOUR_ANGLE        6.0     // hours, either side
+#define PIER_POLE_MARGIN                1.0     // degrees from the pole where the hour angle doesn't choose the side
+
+class RSTPierSideModel
+{
+public:
+    RSTPierSideModel();
+
+    void    setFlipHourAngle(double dHours);
+    double  getFlipHourAngle() const;
+    // degrees, north positive. Until it's set only the targets close to the pole keep the side
+    void    setLatitude(double dLatitude);
+
+    // after a :CY# reading. bGoto with the hour angle and Dec of the goto target when the mount just finished one.
+    void    anchor(bool bBeyondPole, bool bGoto = false, double dGotoHourAngle = 0.0, double dGotoDec = 0.0);
+    // the axes moved, the next question goes to the mount
+    void    invalidate();
+    bool    getSide(bool &bBeyondPole) const;   // false when not anchored
+
+    // STATUS_PIER_EAST / STATUS_PIER_WEST after a goto to dRa/dDec at sidereal time dLst. nFromSide is the side the
+    // goto starts from, STATUS_PIER_UNKNOWN for the anchored one (if any)
+    int     predict(double dRa, double dDec, double dLst, int nFromSide = STATUS_PIER_UNKNOWN) const;
+    void    predict(const std::vector<RSTTarget> &vTargets, double dLst, std::vector<int> &vPierSides) const;
+
+    void    getStats(unsigned long &nGotos, unsigned long &nMispredicted) const;
+
+    static double hourAngle(double dRa, double dLst);  // -12..12
+
+private:
+    bool    keepsSide(double dHourAngle, double dDec) const;   // with m_Mutex held
+    int     predictSide(double dRa, double dDec, double dLst, int nFromSide) const;    // with m_Mutex held
+
+    mutable std::mutex  m_Mutex;
+    bool    m_bAnchored;
+    bool    m_bBeyondPole;
+    double  m_dFlipHourAngle;
+    bool    m_bLatitude;
+    double  m_dLatitude;
+    unsigned long   m_nGotos;
+    unsigned long   m_nMispredicted;
+};
+
+#endif // __RST_PIER_SIDE__
@@ -0,0 +1,192 @@
+#include "rstprotocol.h"
+
+#include <cstring>
+#include <cmath>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+int rstFindCommand(const std::string &sCmd)
+{
+    int i;
+    int nFound = -1;
+    size_t nLen;
+    size_t nFoundLen = 0;
+
+    for(i = 0; i < CMD_COUNT; i++) {
+        nLen = strlen(RSTCommands[i].pszOpcode);
+        if(rstIsFixed(i)) {
+            if(sCmd == RSTCommands[i].pszOpcode)
+                return i;
+        }
+        else if(nLen > nFoundLen && !sCmd.compare(0, nLen, RSTCommands[i].pszOpcode)) {
+            nFound = i;
+            nFoundLen = nLen;
+        }
+    }
+    return nFound;
+}
+
+int rstCommandTimeout(const std::string &sCmd)
+{
+    int nCmd;
+
+    nCmd = rstFindCommand(sCmd);
+    if(nCmd < 0)
+        return MAX_TIMEOUT;
+    return rstTimeoutMs(RSTCommands[nCmd].nTimeout);
+}
+
+void rstFormatRa(double dRa, std::string &sResult)
+{
+    int HH, MM;
+    double hh, mm, SSt;
+    std::stringstream ssTmp;
+
+    HH = int(dRa);
+    hh = dRa - HH;
+    MM = int(hh*60);
+    mm = (hh*60) - MM;
+    SSt = mm * 60;
+
+    ssTmp << std::setfill('0') << std::setw(2) << HH << ":" << std::setfill('0') << std::setw(2) << MM << ":" << std::setfill('0') << std::setw(4) << std::fixed << std::setprecision(1) << SSt;
+    sResult.assign(ssTmp.str());
+}
+
+void rstFormatDec(double dDec, std::string &sResult)
+{
+    int DD, MM;
+    double mm, ss, SS;
+    double dNewDeg;
+    char cSign;
+    std::stringstream ssTmp;
+
+    dNewDeg = std::fabs(dDec);
+    cSign = dDec>=0?'+':'-';
+    DD = int(dNewDeg);
+    mm = dNewDeg - DD;
+    MM = int(mm*60);
+    ss = (mm*60) - MM;
+    SS = ss*60;
+
+    ssTmp << cSign << std::setfill('0') << std::setw(2) << DD << "*" << std::setfill('0') << std::setw(2) << MM << ":" << std::setfill('0') << std::setw(4) << std::fixed << std::setprecision(1)<< SS;
+    sResult.assign(ssTmp.str());
+}
+
+void rstFormatAz(double dAz, std::string &sResult)
+{
+    int DD, MM;
+    double mm, ss, SS;
+    double dNewDeg;
+    std::stringstream ssTmp;
+
+    dNewDeg = std::fabs(dAz);
+    DD = int(dNewDeg);
+    mm = dNewDeg - DD;
+    MM = int(mm*60);
+    ss = (mm*60) - MM;
+    SS = ss*60;
+
+    ssTmp << std::setfill('0') << std::setw(3) << DD << "*" << std::setfill('0') << std::setw(2) << MM << "'" << std::setfill('0') << std::setw(4) << std::fixed << std::setprecision(1) << SS;
+    sResult.assign(ssTmp.str());
+}
+
+void rstFormatDeg(double dDeg, std::string &sResult)
+{
+    int DD, MM, SS;
+    double mm, ss;
+    double dNewDeg;
+    std::stringstream ssTmp;
+    char cSign;
+
+    dNewDeg = std::fabs(dDeg);
+    cSign = dDeg>=0?'+':'-';
+    DD = int(dNewDeg);
+    mm = dNewDeg - DD;
+    MM = int(mm*60);
+    ss = (mm*60) - MM;
+    SS = int(std::round(ss*60));
+
+    ssTmp << cSign << DD << "*" << std::setfill('0') << std::setw(2) << MM << "'" << std::setfill('0') << std::setw(2) << SS;
+    sResult.assign(ssTmp.str());
+}
+
+bool rstParseRa(const std::string &sRa, double &dRa)
+{
+    std::vector<std::string> vFieldsData;
+
+    dRa = 0;
+    if(!rstParseFields(sRa, vFieldsData, ':') || vFieldsData.size() < 3)
+        return false;
+    try {
+        dRa = std::stod(vFieldsData[0]) + std::stod(vFieldsData[1])/60.0 + std::stod(vFieldsData[2])/3600.0;
+    }
+    catch(const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool rstParseDeg(const std::string &sDeg, double &dDeg)
+{
+    std::vector<std::string> vFieldsData;
+    std::string newDec;
+
+    dDeg = 0;
+    // dec is in a weird format.
+    newDec.assign(sDeg);
+    std::replace(newDec.begin(), newDec.end(), '*', ':' );
+    std::replace(newDec.begin(), newDec.end(), '\'', ':' );
+
+    if(!rstParseFields(newDec, vFieldsData, ':') || vFieldsData.size() < 3)
+        return false;
+    try {
+        dDeg = std::stod(vFieldsData[0]);
+        if(dDeg <0)
+            dDeg = dDeg - std::stod(vFieldsData[1])/60.0 - std::stod(vFieldsData[2])/3600.0;
+        else
+            dDeg = dDeg + std::stod(vFieldsData[1])/60.0 + std::stod(vFieldsData[2])/3600.0;
+    }
+    catch(const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool rstParseFields(const std::string &sIn, std::vector<std::string> &svFields, char cSeparator)
+{
+    std::string sSegment;
+    std::stringstream ssTmp(sIn);
+
+    if(sIn.size() == 0)
+        return false;
+
+    svFields.clear();
+    // split the string into vector elements
+    while(std::getline(ssTmp, sSegment, cSeparator))
+        svFields.push_back(sSegment);
+    return svFields.size() != 0;
+}
+
+bool rstSplitNotices(std::string &sResp, int &nNotices, bool &bSlewDone)
+{
+    bool bAnswer = false;
+    std::vector<std::string> vFieldsData;
+
+    // the usual case, one answer and nothing else
+    if(sResp.find("#") == std::string::npos && sResp.find("MM0") == std::string::npos && sResp.find("CHO") == std::string::npos)
+        return true;
+    rstParseFields(sResp, vFieldsData, '#');
+    for(const std::string &sField : vFieldsData) {
+        if(sField.find("MM0") != std::string::npos || sField.find("CHO") != std::string::npos) {
+            if(sField.find("MM0") != std::string::npos)
+                bSlewDone = true;
+            nNotices++;
+        }
+        else if(sField.size()) {
+            sResp.assign(sField);
+            bAnswer = true;
+        }
+    }
+    return bAnswer;
+}
@@ -0,0 +1,190 @@
+#ifndef __RST_PROTOCOL__
+#define __RST_PROTOCOL__
+
+#pragma once
+
+// The commands the driver sends and how each of them behaves on the wire : is there an answer and how is it
+// framed, what comes before the value, how long to wait for it, do we ask again, how long the mount needs before
+// the next command and can callers share one answer. RST::sendCommand<CMD_xx> takes all of it from RSTCommands at
+// compile time, a status query's answer is shared by command id. Only what rstproxyd forwards comes as a string,
+// it is looked up once with rstFindCommand.
+// The static_asserts at the end keep the table in step with RSTCommandId and the entries consistent.
+
+#include <string>
+#include <vector>
+
+#define MAX_TIMEOUT 2000            // WiFi  on tht RST can take up to 1600 ms to respond !!!
+#define FAST_ERROR_TIMEOUT      100         // ms, :Sr/:Sd only answer in a way we can't frame
+#define STOP_ERROR_TIMEOUT      200         // ms, :MS# only answers on error
+#define COMMAND_PACING          100         // ms most writes need before the next command
+#define PROTOCOL_SWITCH_PACING  100         // ms the mount needs after :AR#
+#define SITE_DATA_PACING        100         // ms the mount needs after a site/time/date write
+#define TRACKING_ON_PACING      250         // ms the mount needs after :CtA# before the rate command
+#define TARGET_WRITE_PACING     100         // ms the mount needs after :Sr / :Sd
+#define COMMAND_RETRY_DELAY     100         // ms before asking again after a timeout (RETRY_SLOW)
+
+enum RSTReply {REPLY_NONE=0, REPLY_HASH, REPLY_NO_HASH, REPLY_ON_ERROR};
+enum RSTTimeoutClass {TIMEOUT_NONE=0, TIMEOUT_FAST, TIMEOUT_STOP, TIMEOUT_FULL};
+// RETRY_ONCE : any error, right away. RETRY_SLOW : a timeout, after COMMAND_RETRY_DELAY
+enum RSTRetry {RETRY_NONE=0, RETRY_ONCE, RETRY_SLOW};
+enum RSTPacingClass {PACING_NONE=0, PACING_COMMAND, PACING_PROTOCOL, PACING_TRACKING_ON, PACING_TARGET, PACING_SITE};
+
+enum RSTCommandId {
+    CMD_AR=0, CMD_AU, CMD_AV, CMD_AH, CMD_AT,
+    CMD_GR, CMD_GD, CMD_GZ, CMD_GA, CMD_GH, CMD_GL, CMD_GC, CMD_Gg, CMD_Gt, CMD_GG,
+    CMD_CL, CMD_CY, CMD_CG3, CMD_Cv, CMD_Ct_QUERY, CMD_CU0, CMD_CU1, CMD_CU2, CMD_CU3,
+    CMD_CtA, CMD_CtL, CMD_CtR, CMD_CtS, CMD_CtM,
+    CMD_MS, CMD_MA, CMD_Mn, CMD_Ms, CMD_Me, CMD_Mw,
+    CMD_Q, CMD_Qn, CMD_Qs, CMD_Qe, CMD_Qw,
+    CMD_RG, CMD_RC, CMD_RM, CMD_RS, CMD_Ch,
+    // with an argument
+    CMD_Sr, CMD_Sd, CMD_Sz, CMD_Sa, CMD_Ck, CMD_CN, CMD_Cu, CMD_SC, CMD_SL, CMD_Sg, CMD_St, CMD_SG,
+    // anything else of these families, for what rstproxyd forwards
+    CMD_ANY_SET, CMD_ANY_MOVE, CMD_ANY_STOP,
+    CMD_COUNT
+};
+
+typedef struct {
+    int         nId;
+    const char  *pszOpcode;     // the whole command when it ends with '#', else what comes before the argument
+    int         nReply;         // RSTReply
+    int         nPrefix;        // characters before the value in the answer ("GR:")
+    int         nTimeout;       // RSTTimeoutClass
+    int         nRetry;         // RSTRetry
+    int         nPacing;        // RSTPacingClass, time the mount needs before the next command
+    bool        bIdempotent;    // sending it twice does what sending it once does
+    bool        bShared;        // a status query, callers close together can share one answer
+} RSTCommandDesc;
+
+constexpr RSTCommandDesc RSTCommands[CMD_COUNT] = {
+    {CMD_AR,        ":AR#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_PROTOCOL,     true,  false},
+    {CMD_AU,        ":AU#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_PROTOCOL,     true,  false},
+    {CMD_AV,        ":AV#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_AH,        ":AH#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_AT,        ":AT#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_GR,        ":GR#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_ONCE, PACING_COMMAND,      true,  true },
+    {CMD_GD,        ":GD#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_ONCE, PACING_NONE,         true,  true },
+    {CMD_GZ,        ":GZ#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_ONCE, PACING_COMMAND,      true,  true },
+    {CMD_GA,        ":GA#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_ONCE, PACING_NONE,         true,  true },
+    {CMD_GH,        ":GH#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_GL,        ":GL#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_GC,        ":GC#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Gg,        ":Gg#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Gt,        ":Gt#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_GG,        ":GG#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_CL,        ":CL#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_CY,        ":CY#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_SLOW, PACING_NONE,         true,  true },
+    {CMD_CG3,       ":CG3#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_SLOW, PACING_NONE,         true,  true },
+    {CMD_Cv,        ":Cv#",     REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_Ct_QUERY,  ":Ct?#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_CU0,       ":CU0#",    REPLY_HASH,     4, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_CU1,       ":CU1#",    REPLY_HASH,     4, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_CU2,       ":CU2#",    REPLY_HASH,     4, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    {CMD_CU3,       ":CU3#",    REPLY_HASH,     4, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  true },
+    // sent twice in a row on some unparks to get past the tracking prevention, so not idempotent
+    {CMD_CtA,       ":CtA#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_TRACKING_ON,  false, false},
+    {CMD_CtL,       ":CtL#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_CtR,       ":CtR#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_CtS,       ":CtS#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_CtM,       ":CtM#",    REPLY_HASH,     3, TIMEOUT_FULL, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_MS,        ":MS#",     REPLY_ON_ERROR, 3, TIMEOUT_STOP, RETRY_NONE, PACING_NONE,         false, false},
+    {CMD_MA,        ":MA#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_COMMAND,      false, false},
+    {CMD_Mn,        ":Mn#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Ms,        ":Ms#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Me,        ":Me#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Mw,        ":Mw#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Q,         ":Q#",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Qn,        ":Qn#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Qs,        ":Qs#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Qe,        ":Qe#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Qw,        ":Qw#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_RG,        ":RG#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_RC,        ":RC#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_RM,        ":RM#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_RS,        ":RS#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_Ch,        ":Ch#",     REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         false, false},
+    // answers "1" without a '#', and only when it feels like it
+    {CMD_Sr,        ":Sr",      REPLY_NO_HASH,  0, TIMEOUT_FAST, RETRY_NONE, PACING_TARGET,       true,  false},
+    {CMD_Sd,        ":Sd",      REPLY_NO_HASH,  0, TIMEOUT_FAST, RETRY_NONE, PACING_TARGET,       true,  false},
+    {CMD_Sz,        ":Sz",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_COMMAND,      true,  false},
+    {CMD_Sa,        ":Sa",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_COMMAND,      true,  false},
+    {CMD_Ck,        ":Ck",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_COMMAND,      true,  false},
+    {CMD_CN,        ":CN",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_COMMAND,      true,  false},
+    {CMD_Cu,        ":Cu",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+    {CMD_SC,        ":SC",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_SITE,         true,  false},
+    {CMD_SL,        ":SL",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_SITE,         true,  false},
+    {CMD_Sg,        ":Sg",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_SITE,         true,  false},
+    {CMD_St,        ":St",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_SITE,         true,  false},
+    {CMD_SG,        ":SG",      REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_SITE,         true,  false},
+    {CMD_ANY_SET,   ":S",       REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         false, false},
+    {CMD_ANY_MOVE,  ":M",       REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         false, false},
+    {CMD_ANY_STOP,  ":Q",       REPLY_NONE,     0, TIMEOUT_NONE, RETRY_NONE, PACING_NONE,         true,  false},
+};
+
+constexpr int rstTimeoutMs(int nTimeout)
+{
+    return nTimeout == TIMEOUT_FULL ? MAX_TIMEOUT : (nTimeout == TIMEOUT_STOP ? STOP_ERROR_TIMEOUT : (nTimeout == TIMEOUT_FAST ? FAST_ERROR_TIMEOUT : 0));
+}
+
+constexpr int rstPacingMs(int nPacing)
+{
+    return nPacing == PACING_COMMAND ? COMMAND_PACING :
+           nPacing == PACING_PROTOCOL ? PROTOCOL_SWITCH_PACING :
+           nPacing == PACING_TRACKING_ON ? TRACKING_ON_PACING :
+           nPacing == PACING_TARGET ? TARGET_WRITE_PACING :
+           nPacing == PACING_SITE ? SITE_DATA_PACING : 0;
+}
+
+constexpr bool rstEndsWithHash(const char *pszOpcode)
+{
+    return pszOpcode[0] == '\0' ? false : (pszOpcode[1] == '\0' ? pszOpcode[0] == '#' : rstEndsWithHash(pszOpcode + 1));
+}
+
+// the whole command, no argument
+constexpr bool rstIsFixed(int nCmd)
+{
+    return rstEndsWithHash(RSTCommands[nCmd].pszOpcode);
+}
+
+// RSTCommandId of a command string, the longest opcode that matches. -1 if we don't know it.
+int rstFindCommand(const std::string &sCmd);
+// the reply timeout for a command string, MAX_TIMEOUT when we don't know it
+int rstCommandTimeout(const std::string &sCmd);
+
+// the coordinate formats on the wire, RST's convert* members call these and log around them
+void rstFormatRa(double dRa, std::string &sResult);         // HH:MM:SS.S
+void rstFormatDec(double dDec, std::string &sResult);       // sDD*MM:SS.S, for :Sd
+void rstFormatAz(double dAz, std::string &sResult);         // DDD*MM'SS.S
+void rstFormatDeg(double dDeg, std::string &sResult);       // sDD*MM'SS, the site
+// false when the string isn't one, the Dec, Alt, Az and site forms all parse as degrees
+bool rstParseRa(const std::string &sRa, double &dRa);
+bool rstParseDeg(const std::string &sDeg, double &dDeg);
+bool rstParseFields(const std::string &sIn, std::vector<std::string> &svFields, char cSeparator);
+// takes the async notices (MM0, CHO) out of what came back for a command and leaves the answer in sResp.
+// false when there were only notices, bSlewDone is set when one was a MM0.
+bool rstSplitNotices(std::string &sResp, int &nNotices, bool &bSlewDone);
+
+// the value in an answer, past the nPrefix characters
+inline std::string rstReplyValue(int nCmd, const std::string &sResp)
+{
+    return sResp.size() > (size_t)RSTCommands[nCmd].nPrefix ? sResp.substr(RSTCommands[nCmd].nPrefix) : std::string();
+}
+
+constexpr bool rstCommandValid(int nCmd)
+{
+    return RSTCommands[nCmd].nId == nCmd
+        && (RSTCommands[nCmd].nReply == REPLY_NONE) == (RSTCommands[nCmd].nTimeout == TIMEOUT_NONE)
+        && (RSTCommands[nCmd].nReply != REPLY_NONE || RSTCommands[nCmd].nRetry == RETRY_NONE)
+        && (RSTCommands[nCmd].bIdempotent || RSTCommands[nCmd].nRetry == RETRY_NONE)
+        && (!RSTCommands[nCmd].bShared || (RSTCommands[nCmd].bIdempotent && RSTCommands[nCmd].nReply == REPLY_HASH && rstIsFixed(nCmd)));
+}
+
+constexpr bool rstCommandsValid(int nCmd)
+{
+    return nCmd == CMD_COUNT || (rstCommandValid(nCmd) && rstCommandsValid(nCmd + 1));
+}
+
+static_assert(sizeof(RSTCommands) / sizeof(RSTCommands[0]) == CMD_COUNT, "RSTCommands needs one entry per RSTCommandId");
+static_assert(rstCommandsValid(0), "RSTCommands out of order with RSTCommandId, or an entry contradicts itself");
+
+#endif // __RST_PROTOCOL__
@@ -0,0 +1,194 @@
+#include "rstproxy.h"
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+
+#include <cstring>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/ioctl.h>
+
+
+// a dead proxy must not kill TheSkyX with a SIGPIPE
+#if defined(MSG_NOSIGNAL)
+#define PROXY_SEND_FLAGS    MSG_NOSIGNAL
+#else
+#define PROXY_SEND_FLAGS    0
+#endif
+
+RSTProxySerX::RSTProxySerX()
+{
+    m_nSocket = -1;
+}
+
+RSTProxySerX::~RSTProxySerX()
+{
+    close();
+}
+
+int RSTProxySerX::open(const char* pszPort, const unsigned long& /*dwBaudRate*/, const char* /*pszSession*/)
+{
+    struct sockaddr_un addr;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nSocket >= 0) {
+        ::close(m_nSocket);
+        m_nSocket = -1;
+    }
+
+    if(!pszPort || strlen(pszPort) >= sizeof(addr.sun_path))
+        return ERR_COMMNOLINK;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, pszPort, sizeof(addr.sun_path) - 1);
+
+    m_nSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(m_nSocket < 0)
+        return ERR_COMMNOLINK;
+#if defined(SO_NOSIGPIPE)
+    int nOn = 1;
+    setsockopt(m_nSocket, SOL_SOCKET, SO_NOSIGPIPE, &nOn, sizeof(nOn));
+#endif
+
+    if(connect(m_nSocket, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ::close(m_nSocket);
+        m_nSocket = -1;
+        return ERR_COMMNOLINK;
+    }
+    return SB_OK;
+}
+
+int RSTProxySerX::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nSocket >= 0)
+        ::close(m_nSocket);
+    m_nSocket = -1;
+    return SB_OK;
+}
+
+bool RSTProxySerX::isConnected() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nSocket >= 0;
+}
+
+int RSTProxySerX::flushTx()
+{
+    return SB_OK;   // writes go straight to the socket
+}
+
+int RSTProxySerX::purgeTxRx()
+{
+    char pszBuf[256];
+    ssize_t nRead;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nSocket < 0)
+        return ERR_NOLINK;
+
+    do {
+        nRead = recv(m_nSocket, pszBuf, sizeof(pszBuf), MSG_DONTWAIT);
+    } while(nRead > 0);
+
+    if(nRead == 0) { // the proxy went away
+        ::close(m_nSocket);
+        m_nSocket = -1;
+        return ERR_NOLINK;
+    }
+    return SB_OK;
+}
+
+int RSTProxySerX::waitForBytesRx(const int& nNumber, const int& nTimeOutMilli)
+{
+    int nBytesWaiting = 0;
+    struct pollfd pfd;
+    int nWaited = 0;
+
+    while(true) {
+        if(bytesWaitingRx(nBytesWaiting))
+            return ERR_NOLINK;
+        if(nBytesWaiting >= nNumber)
+            return SB_OK;
+        if(nWaited >= nTimeOutMilli)
+            return ERR_RXTIMEOUT;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            pfd.fd = m_nSocket;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+        }
+        poll(&pfd, 1, 10);
+        nWaited += 10;
+    }
+}
+
+int RSTProxySerX::readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut)
+{
+    struct pollfd pfd;
+    ssize_t nRead;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    lpNumberOfBytesRead = 0;
+    if(m_nSocket < 0)
+        return ERR_NOLINK;
+
+    while(lpNumberOfBytesRead < dwNumberOfBytesToRead) {
+        pfd.fd = m_nSocket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd, 1, (int)dwTimeOut) <= 0)
+            break;  // timeout, the caller checks the count
+        nRead = recv(m_nSocket, (char *)lpBuffer + lpNumberOfBytesRead, dwNumberOfBytesToRead - lpNumberOfBytesRead, 0);
+        if(nRead <= 0) {
+            if(nRead < 0 && errno == EINTR)
+                continue;
+            ::close(m_nSocket);
+            m_nSocket = -1;
+            return ERR_NOLINK;
+        }
+        lpNumberOfBytesRead += nRead;
+    }
+    return SB_OK;
+}
+
+int RSTProxySerX::writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten)
+{
+    ssize_t nWritten;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    lpNumberOfBytesWritten = 0;
+    if(m_nSocket < 0)
+        return ERR_NOLINK;
+
+    while(lpNumberOfBytesWritten < dwNumberOfBytesToWrite) {
+        nWritten = send(m_nSocket, (char *)lpBuffer + lpNumberOfBytesWritten, dwNumberOfBytesToWrite - lpNumberOfBytesWritten, PROXY_SEND_FLAGS);
+        if(nWritten < 0) {
+            if(errno == EINTR)
+                continue;
+            ::close(m_nSocket);
+            m_nSocket = -1;
+            return ERR_NOLINK;
+        }
+        lpNumberOfBytesWritten += nWritten;
+    }
+    return SB_OK;
+}
+
+int RSTProxySerX::bytesWaitingRx(int &nBytesWaitingRx)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    nBytesWaitingRx = 0;
+    if(m_nSocket < 0)
+        return ERR_NOLINK;
+    if(ioctl(m_nSocket, FIONREAD, &nBytesWaitingRx) < 0)
+        return ERR_NOLINK;
+    return SB_OK;
+}
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef __RST_PROXY__
+#define __RST_PROXY__
+
+#pragma once
+
+// rstproxyd owns the RST link and serves local clients over a Unix socket.
+// Clients talk the mount protocol as if they were on the serial port, the proxy adds a few commands of its own :
+//  :PXS#   subscribe to status pushes, the proxy then sends
+//          PXS:<age ms>;<:GR# answer>;<:GD# answer>;<:GA# answer>;<:GZ# answer>;<:AT# answer>;<:CL# answer>#
+//          every RST_PROXY_STATUS_INTERVAL ms, the answers are the mount's without their '#'
+//  :PXU#   unsubscribe
+// None of them are forwarded to the mount.
+// Identical queries from different clients in flight at the same time go to the mount once, and the status
+// queries the proxy polls anyway are answered from its last poll if it's fresh enough.
+
+#define RST_PROXY_DEFAULT_SOCKET    "/tmp/rstproxyd.sock"
+#define RST_PROXY_SUBSCRIBE         ":PXS#"
+#define RST_PROXY_UNSUBSCRIBE       ":PXU#"
+#define RST_PROXY_STATUS_PREFIX     "PXS:"
+#define RST_PROXY_STATUS_INTERVAL   500     // ms between status polls/pushes
+#define RST_PROXY_STATUS_FRESHNESS  250     // ms a polled status answer can be served to a client instead of a new query
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+
+#include <string>
+#include <mutex>
+
+#include "rsttransport.h"
+
+// RST link on top of the proxy socket, so the RST class works unchanged when the plugin goes through rstproxyd.
+class RSTProxySerX : public RSTTransport
+{
+public:
+    RSTProxySerX();
+    virtual ~RSTProxySerX();
+
+    // pszPort is the path of the proxy socket, the serial parameters are the proxy's business.
+    virtual int open(const char* pszPort, const unsigned long& dwBaudRate = 9600, const char* pszSession = 0);
+    virtual int close();
+    virtual bool isConnected() const;
+
+    virtual int flushTx();
+    virtual int purgeTxRx();
+    virtual int waitForBytesRx(const int& nNumber, const int& nTimeOutMilli);
+    virtual int readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut = 1000);
+    virtual int writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten);
+    virtual int bytesWaitingRx(int &nBytesWaitingRx);
+
+private:
+    int     m_nSocket;
+    mutable std::mutex m_Mutex;
+};
+
+#endif
+
+#endif // __RST_PROXY__
@@ -0,0 +1,338 @@
+#include "rstrecorder.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#endif
+
+uint64_t RSTRecorder::nowMs()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string RSTRecorder::defaultPath(int nInstance)
+{
+    std::string sPath;
+    const char *pszHome;
+    char szName[64];
+
+    if(nInstance > 0)
+        snprintf(szName, sizeof(szName), "RSTHistory-%d.rec", nInstance);
+    else
+        snprintf(szName, sizeof(szName), "RSTHistory.rec");
+
+#if defined(SB_WIN_BUILD)
+    const char *pszDrive = getenv("HOMEDRIVE");
+    pszHome = getenv("HOMEPATH");
+    if(pszDrive)
+        sPath = pszDrive;
+    if(pszHome)
+        sPath += pszHome;
+    sPath += "\\";
+#else
+    pszHome = getenv("HOME");
+    if(pszHome)
+        sPath = pszHome;
+    sPath += "/";
+#endif
+    sPath += szName;
+    return sPath;
+}
+
+// ":GR#" -> "GR", ":CtA#" -> "CtA", commands with arguments keep their first 2 letters (":Sr12:00:00#" -> "Sr")
+void RSTRecorder::opcode(const std::string &sCmd, char *pszOp)
+{
+    size_t nStart;
+    size_t nLen;
+
+    memset(pszOp, 0, RST_RECORDER_OP_SIZE);
+    nStart = (!sCmd.empty() && sCmd[0] == ':') ? 1 : 0;
+    nLen = sCmd.size() - nStart;
+    if(nLen && sCmd[sCmd.size() - 1] == '#')
+        nLen--;
+    if(nLen > 3)
+        nLen = 2;
+    memcpy(pszOp, sCmd.c_str() + nStart, nLen);
+}
+
+#pragma mark - recorder
+
+RSTRecorder::RSTRecorder()
+{
+    m_bOpen = false;
+    m_nFd = -1;
+    m_pHeader = NULL;
+    m_pRecords = NULL;
+    m_nMapSize = 0;
+    m_nCapacity = 0;
+    m_nLastTimeMs = 0;
+}
+
+RSTRecorder::~RSTRecorder()
+{
+    close();
+}
+
+void RSTRecorder::recordCommand(const std::string &sCmd, int nCode, int32_t nLatencyUs)
+{
+    RSTRecord Record;
+
+    if(!m_bOpen)
+        return;
+
+    memset(&Record, 0, sizeof(Record));
+    Record.nType = REC_COMMAND;
+    Record.nCode = (uint8_t)nCode;
+    Record.nValue = nLatencyUs;
+    opcode(sCmd, Record.szOp);
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    write(Record);
+}
+
+void RSTRecorder::record(int nType, int nCode, int32_t nValue)
+{
+    RSTRecord Record;
+
+    if(!m_bOpen)
+        return;
+
+    memset(&Record, 0, sizeof(Record));
+    Record.nType = (uint8_t)nType;
+    Record.nCode = (uint8_t)nCode;
+    Record.nValue = nValue;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    write(Record);
+}
+
+void RSTRecorder::write(RSTRecord &Record)
+{
+    uint64_t nNow;
+    uint64_t nRecords;
+
+    if(!m_pHeader)
+        return;
+
+    nNow = nowMs();
+    nRecords = m_pHeader->nRecords.load(std::memory_order_relaxed);
+    // a new block starts with the absolute time
+    if(nRecords % RST_RECORDER_BLOCK_RECORDS == 0) {
+        RSTRecord &Keyframe = m_pRecords[nRecords % m_nCapacity];
+        memset(&Keyframe, 0, sizeof(RSTRecord));
+        Keyframe.nType = REC_KEYFRAME;
+        Keyframe.nTimeDelta = (uint32_t)(nNow & 0xFFFFFFFF);
+        Keyframe.nValue = (int32_t)(nNow >> 32);
+        m_nLastTimeMs = nNow;
+        nRecords++;
+    }
+    // the system clock going back (NTP step) is recorded as no time passing
+    if(nNow > m_nLastTimeMs) {
+        Record.nTimeDelta = (uint32_t)std::min<uint64_t>(nNow - m_nLastTimeMs, 0xFFFFFFFF);
+        m_nLastTimeMs += Record.nTimeDelta;
+    }
+    else
+        Record.nTimeDelta = 0;
+    m_pRecords[nRecords % m_nCapacity] = Record;
+    m_pHeader->nRecords.store(nRecords + 1, std::memory_order_release);
+}
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+
+int RSTRecorder::open(const std::string &sPath, int nSizeMB)
+{
+    int nFd;
+    void *pMap;
+    struct stat st;
+    size_t nSize;
+    uint32_t nBlocks;
+    bool bReuse;
+
+    close();
+
+    if(nSizeMB < RST_RECORDER_MIN_SIZE)
+        nSizeMB = RST_RECORDER_MIN_SIZE;
+    nBlocks = (uint32_t)(((size_t)nSizeMB * 1024 * 1024 - RST_RECORDER_HEADER_SIZE) / (RST_RECORDER_BLOCK_RECORDS * sizeof(RSTRecord)));
+    nSize = RST_RECORDER_HEADER_SIZE + (size_t)nBlocks * RST_RECORDER_BLOCK_RECORDS * sizeof(RSTRecord);
+
+    nFd = ::open(sPath.c_str(), O_RDWR | O_CREAT, 0644);
+    if(nFd < 0)
+        return ERR_NOLINK;
+    // one writer per file, a second TheSkyX on the same instance index doesn't get to scribble over the first one's history
+    if(flock(nFd, LOCK_EX | LOCK_NB) < 0) {
+        ::close(nFd);
+        return ERR_CMDFAILED;
+    }
+    if(fstat(nFd, &st) < 0) {
+        ::close(nFd);
+        return ERR_NOLINK;
+    }
+    bReuse = (st.st_size == (off_t)nSize);
+    if(!bReuse && ftruncate(nFd, nSize) < 0) {
+        ::close(nFd);
+        return ERR_NOLINK;
+    }
+    pMap = mmap(NULL, nSize, PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+    if(pMap == MAP_FAILED) {
+        ::close(nFd);
+        return ERR_NOLINK;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nFd = nFd;
+    m_nMapSize = nSize;
+    m_pHeader = (RSTRecorderHeader *)pMap;
+    m_pRecords = (RSTRecord *)((char *)pMap + RST_RECORDER_HEADER_SIZE);
+    m_nCapacity = (uint64_t)nBlocks * RST_RECORDER_BLOCK_RECORDS;
+
+    if(bReuse && m_pHeader->nMagic == RST_RECORDER_MAGIC && m_pHeader->nVersion == RST_RECORDER_VERSION &&
+       m_pHeader->nRecordSize == sizeof(RSTRecord) && m_pHeader->nBlockRecords == RST_RECORDER_BLOCK_RECORDS && m_pHeader->nBlocks == nBlocks) {
+        // carry on in the next block so the first record after the restart gets a keyframe.
+        // The rest of the current block is zeroed, zeros decode as empty keyframes.
+        uint64_t nRecords = m_pHeader->nRecords.load(std::memory_order_relaxed);
+        uint64_t nNext = (nRecords + RST_RECORDER_BLOCK_RECORDS - 1) / RST_RECORDER_BLOCK_RECORDS * RST_RECORDER_BLOCK_RECORDS;
+        if(nNext > nRecords)
+            memset(&m_pRecords[nRecords % m_nCapacity], 0, (nNext - nRecords) * sizeof(RSTRecord));
+        m_pHeader->nRecords.store(nNext, std::memory_order_release);
+    }
+    else {
+        memset(pMap, 0, RST_RECORDER_HEADER_SIZE);
+        m_pHeader->nRecordSize = sizeof(RSTRecord);
+        m_pHeader->nBlockRecords = RST_RECORDER_BLOCK_RECORDS;
+        m_pHeader->nBlocks = nBlocks;
+        m_pHeader->nVersion = RST_RECORDER_VERSION;
+        m_pHeader->nRecords.store(0, std::memory_order_relaxed);
+        m_pHeader->nMagic = RST_RECORDER_MAGIC;
+    }
+    m_bOpen = true;
+    return SB_OK;
+}
+
+void RSTRecorder::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(!m_pHeader)
+        return;
+    // the pages go back to the file in the background, no msync on the way out
+    m_bOpen = false;
+    munmap(m_pHeader, m_nMapSize);
+    ::close(m_nFd);   // releases the flock
+    m_pHeader = NULL;
+    m_pRecords = NULL;
+    m_nFd = -1;
+}
+
+#else
+
+// no mmap, the driver simply doesn't record
+
+int RSTRecorder::open(const std::string &sPath, int nSizeMB)
+{
+    return ERR_NOT_IMPL;
+}
+
+void RSTRecorder::close()
+{
+}
+
+#endif
+
+#pragma mark - reader
+
+const char *RSTRecordReader::typeName(int nType)
+{
+    switch(nType) {
+        case REC_KEYFRAME :     return "keyframe";
+        case REC_COMMAND :      return "command";
+        case REC_VOLTAGE :      return "voltage";
+        case REC_TRACKING :     return "tracking";
+        case REC_PIER_SIDE :    return "pierside";
+        case REC_FLAG :         return "flag";
+        case REC_BREAKER :      return "breaker";
+        case REC_ABORT :        return "abort";
+        case REC_RESUME :       return "resume";
+        case REC_WATCHDOG :     return "watchdog";
+        default :               return "unknown";
+    }
+}
+
+// plain reads so it works on any platform and on a copy of the file
+int RSTRecordReader::read(const std::string &sPath, uint64_t nFromMs, uint64_t nToMs, std::vector<RSTRecordEntry> &vEntries)
+{
+    FILE *pFile;
+    RSTRecorderHeader Header;
+    std::vector<RSTRecord> vRing;
+    uint64_t nRecordsBefore;
+    uint64_t nRecordsAfter;
+    uint64_t nCapacity;
+    uint64_t nFirst;
+    uint64_t nIndex;
+    uint64_t nTimeMs = 0;
+    bool bHaveTime = false;
+    RSTRecordEntry Entry;
+
+    vEntries.clear();
+    pFile = fopen(sPath.c_str(), "rb");
+    if(!pFile)
+        return ERR_NOLINK;
+
+    if(fread(&Header, sizeof(Header), 1, pFile) != 1 || Header.nMagic != RST_RECORDER_MAGIC || Header.nVersion != RST_RECORDER_VERSION ||
+       Header.nRecordSize != sizeof(RSTRecord) || Header.nBlockRecords != RST_RECORDER_BLOCK_RECORDS || !Header.nBlocks) {
+        fclose(pFile);
+        return ERR_CMDFAILED;
+    }
+    nRecordsBefore = Header.nRecords.load();
+    nCapacity = (uint64_t)Header.nBlocks * RST_RECORDER_BLOCK_RECORDS;
+    vRing.resize(nCapacity);
+    if(fseek(pFile, RST_RECORDER_HEADER_SIZE, SEEK_SET) || fread(&vRing[0], sizeof(RSTRecord), nCapacity, pFile) != nCapacity) {
+        fclose(pFile);
+        return ERR_CMDFAILED;
+    }
+    // the writer may have moved on while we copied, whatever it overwrote is gone
+    rewind(pFile);
+    if(fread(&Header, sizeof(Header), 1, pFile) != 1) {
+        fclose(pFile);
+        return ERR_CMDFAILED;
+    }
+    nRecordsAfter = Header.nRecords.load();
+    fclose(pFile);
+
+    nFirst = nRecordsAfter > nCapacity ? nRecordsAfter - nCapacity : 0;
+    // decoding starts on a keyframe
+    nFirst = (nFirst + RST_RECORDER_BLOCK_RECORDS - 1) / RST_RECORDER_BLOCK_RECORDS * RST_RECORDER_BLOCK_RECORDS;
+
+    for(nIndex = nFirst; nIndex < nRecordsBefore; nIndex++) {
+        const RSTRecord &Record = vRing[nIndex % nCapacity];
+        if(Record.nType == REC_KEYFRAME) {
+            nTimeMs = ((uint64_t)(uint32_t)Record.nValue << 32) | Record.nTimeDelta;
+            bHaveTime = true;
+            continue;
+        }
+        if(!bHaveTime)
+            continue;
+        nTimeMs += Record.nTimeDelta;
+        if(nTimeMs < nFromMs || nTimeMs > nToMs)
+            continue;
+        Entry.nTimeMs = nTimeMs;
+        Entry.nType = Record.nType;
+        // mode and side can be -1 (unknown)
+        if(Record.nType == REC_TRACKING || Record.nType == REC_PIER_SIDE)
+            Entry.nCode = (int8_t)Record.nCode;
+        else
+            Entry.nCode = Record.nCode;
+        Entry.sOp.assign(Record.szOp, strnlen(Record.szOp, sizeof(Record.szOp)));
+        Entry.nValue = Record.nValue;
+        vEntries.push_back(Entry);
+    }
+    return SB_OK;
+}
@@ -0,0 +1,102 @@
+#ifndef __RST_RECORDER__
+#define __RST_RECORDER__
+
+#pragma once
+
+// Always-on history of what the mount did, for the post-mortem of a bad night.
+// Fixed size records (16 bytes) go into a ring of blocks in a memory mapped file, the disk use is the file size
+// and once it's full the oldest block gets overwritten. A record only holds the time since the previous record,
+// each block starts with a keyframe holding the absolute time so any block can be decoded on its own.
+// Writing a record is a copy into the mapping under an uncontended mutex, no system call.
+// tools/rstrecexport turns a file into CSV.
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <stdint.h>
+
+#include "rsterrors.h"
+
+#define RST_RECORDER_MAGIC          0x43455252  // "RREC"
+#define RST_RECORDER_VERSION        1
+#define RST_RECORDER_HEADER_SIZE    4096
+#define RST_RECORDER_BLOCK_RECORDS  256         // one 4 KB page per block
+#define RST_RECORDER_DEFAULT_SIZE   16          // MB, about a million records
+#define RST_RECORDER_MIN_SIZE       1           // MB
+#define RST_RECORDER_OP_SIZE        4
+
+enum RSTRecordType  {REC_KEYFRAME=0, REC_COMMAND, REC_VOLTAGE, REC_TRACKING, REC_PIER_SIDE, REC_FLAG, REC_BREAKER, REC_ABORT, REC_RESUME, REC_WATCHDOG, REC_TYPE_COUNT};
+// REC_COMMAND codes, REC_CMD_BURST is or'ed in when the command went out in a burst (the latency is the burst's)
+enum RSTRecordCommandCode {REC_CMD_OK=0, REC_CMD_TIMEOUT, REC_CMD_ERROR, REC_CMD_BURST=0x80};
+
+// fixed size types only, the file is read by tools built separately
+typedef struct {
+    uint32_t    nTimeDelta;     // ms since the previous record. Keyframe : low 32 bits of the absolute time
+    uint8_t     nType;          // RSTRecordType
+    uint8_t     nCode;          // command result, tracking mode, pier side, flag bit or breaker state (int8 for mode and side)
+    uint16_t    nReserved;
+    char        szOp[RST_RECORDER_OP_SIZE]; // command opcode without ':' and '#', 0 padded
+    int32_t     nValue;         // command latency (us), voltage (mV), flag state (1/0). Keyframe : high 32 bits of the absolute time
+} RSTRecord;
+
+typedef struct {
+    uint32_t                nMagic;
+    uint32_t                nVersion;
+    uint32_t                nRecordSize;    // sizeof(RSTRecord)
+    uint32_t                nBlockRecords;
+    uint32_t                nBlocks;
+    uint32_t                nPad;
+    std::atomic<uint64_t>   nRecords;       // written since the file was created, keyframes included
+} RSTRecorderHeader;
+
+typedef struct {
+    uint64_t    nTimeMs;        // UTC, ms since the epoch
+    int         nType;
+    int         nCode;
+    std::string sOp;
+    int32_t     nValue;
+} RSTRecordEntry;
+
+class RSTRecorder
+{
+public:
+    RSTRecorder();
+    ~RSTRecorder();
+
+    // creates the file, or carries on with an existing one of the same size. Fails if another process has it open.
+    int     open(const std::string &sPath, int nSizeMB = RST_RECORDER_DEFAULT_SIZE);
+    void    close();
+    bool    isOpen() const { return m_bOpen; }
+
+    void    record(int nType, int nCode, int32_t nValue);
+    // sCmd is the full command (":GR#"), the opcode is extracted from it
+    void    recordCommand(const std::string &sCmd, int nCode, int32_t nLatencyUs);
+
+    static uint64_t     nowMs();
+    static std::string  defaultPath(int nInstance);    // in the user's home directory, one file per X2 instance
+    // the opcode of a full command in RST_RECORDER_OP_SIZE bytes, 0 padded
+    static void         opcode(const std::string &sCmd, char *pszOp);
+
+private:
+    void    write(RSTRecord &Record);     // with m_Mutex held
+
+    std::mutex          m_Mutex;
+    std::atomic<bool>   m_bOpen;        // checked without the lock so a closed recorder costs nothing
+    int                 m_nFd;
+    RSTRecorderHeader   *m_pHeader;
+    RSTRecord           *m_pRecords;
+    size_t              m_nMapSize;
+    uint64_t            m_nCapacity;    // records
+    uint64_t            m_nLastTimeMs;
+};
+
+class RSTRecordReader
+{
+public:
+    // the records with nFromMs <= time <= nToMs, oldest first. Works on a file that is being written to.
+    static int  read(const std::string &sPath, uint64_t nFromMs, uint64_t nToMs, std::vector<RSTRecordEntry> &vEntries);
+    static const char *typeName(int nType);
+};
+
+#endif // __RST_RECORDER__
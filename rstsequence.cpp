@@ -0,0 +1,403 @@
+#include "rstsequence.h"
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#define SIDEREAL_HOURS_PER_SECOND   (1.00273790935 / 3600.0)
+
+RSTSequenceOptimizer::RSTSequenceOptimizer(const RSTSlewTimeModel &SlewModel, const RSTPierSideModel &PierSide, const RSTLimits &Limits)
+    : m_SlewModel(SlewModel), m_PierSide(PierSide), m_Limits(Limits)
+{
+    m_pTargets = NULL;
+    m_nTargets = 0;
+    m_dLst = 0.0;
+    m_dFromRa = 0.0;
+    m_dFromDec = 0.0;
+    m_bFromWest = false;
+    m_dNightEnd = SEQUENCE_DEFAULT_NIGHT;
+}
+
+void RSTSequenceOptimizer::optimize(const std::vector<RSTSequenceTarget> &vTargets, double dLst, double dFromRa, double dFromDec, bool bFromWest,
+                                    double dNightEnd, RSTSequence &Sequence, int nBudgetMs)
+{
+    std::chrono::steady_clock::time_point tStart = std::chrono::steady_clock::now();
+    std::vector<int> vOrder;
+    std::vector<int> vDropped;
+    double dDead;
+    int nFailed;
+
+    setup(vTargets, dLst, dFromRa, dFromDec, bFromWest, dNightEnd);
+    m_tBudget = tStart + std::chrono::milliseconds(nBudgetMs);
+
+    nearestNeighbour(vOrder, vDropped);
+    // the replay waits its own way, the odd target may not make it
+    while(!simulate(vOrder, dDead, NULL, &nFailed)) {
+        vDropped.push_back(vOrder[nFailed]);
+        vOrder.erase(vOrder.begin() + nFailed);
+    }
+    buildCosts(vOrder);
+    while(!overBudget()) {
+        if(!twoOpt(vOrder, dDead) && !orOpt(vOrder, dDead))
+            break;
+        buildCosts(vOrder);
+    }
+    if(!vDropped.empty() && !overBudget())
+        reinsert(vOrder, vDropped, dDead);
+
+    simulate(vOrder, dDead, &Sequence);
+    Sequence.vDropped = vDropped;
+    std::sort(Sequence.vDropped.begin(), Sequence.vDropped.end());
+    Sequence.dElapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - tStart).count();
+    m_pTargets = NULL;
+}
+
+bool RSTSequenceOptimizer::evaluate(const std::vector<RSTSequenceTarget> &vTargets, double dLst, double dFromRa, double dFromDec, bool bFromWest,
+                                    double dNightEnd, const std::vector<int> &vOrder, RSTSequence &Sequence)
+{
+    double dDead;
+    bool bOk;
+
+    setup(vTargets, dLst, dFromRa, dFromDec, bFromWest, dNightEnd);
+    bOk = simulate(vOrder, dDead, &Sequence);
+    Sequence.vDropped.clear();
+    Sequence.dElapsedMs = 0.0;
+    m_pTargets = NULL;
+    return bOk;
+}
+
+void RSTSequenceOptimizer::setup(const std::vector<RSTSequenceTarget> &vTargets, double dLst, double dFromRa, double dFromDec, bool bFromWest, double dNightEnd)
+{
+    m_pTargets = &vTargets;
+    m_nTargets = (int)vTargets.size();
+    m_dLst = dLst;
+    m_dFromRa = dFromRa;
+    m_dFromDec = dFromDec;
+    m_bFromWest = bFromWest;
+    m_dNightEnd = dNightEnd;
+}
+
+double RSTSequenceOptimizer::slewTime(double dLst, double dFromRa, double dFromDec, bool bFromWest, int nTo, bool &bToWest) const
+{
+    const RSTSequenceTarget &To = (*m_pTargets)[nTo];
+
+    bToWest = (m_PierSide.predict(To.dRa, To.dDec, dLst, bFromWest ? STATUS_PIER_WEST : STATUS_PIER_EAST) == STATUS_PIER_WEST);
+    return m_SlewModel.estimate(m_SlewModel.axisTravel(RSTPierSideModel::hourAngle(dFromRa, dLst), dFromDec, bFromWest,
+                                                       RSTPierSideModel::hourAngle(To.dRa, dLst), To.dDec, bToWest));
+}
+
+// the hour angle only grows during the exposure, and the altitude is lowest at one end or the other
+bool RSTSequenceOptimizer::inLimits(int nTarget, double dStart) const
+{
+    const RSTSequenceTarget &Target = (*m_pTargets)[nTarget];
+    int nResult;
+
+    nResult = m_Limits.check(Target.dRa, Target.dDec, std::fmod(m_dLst + dStart * SIDEREAL_HOURS_PER_SECOND, 24.0));
+    if(nResult != LIMIT_OK && nResult != LIMIT_NO_SITE)
+        return false;
+    nResult = m_Limits.check(Target.dRa, Target.dDec, std::fmod(m_dLst + (dStart + Target.dDuration) * SIDEREAL_HOURS_PER_SECOND, 24.0));
+    return nResult == LIMIT_OK || nResult == LIMIT_NO_SITE;
+}
+
+bool RSTSequenceOptimizer::visit(double &dTime, double dFromRa, double dFromDec, bool bFromWest, int nTo, double &dSlew, bool &bToWest) const
+{
+    const RSTSequenceTarget &To = (*m_pTargets)[nTo];
+    double dStart;
+
+    while(true) {
+        dSlew = slewTime(std::fmod(m_dLst + dTime * SIDEREAL_HOURS_PER_SECOND, 24.0), dFromRa, dFromDec, bFromWest, nTo, bToWest);
+        dStart = std::max(dTime + dSlew, To.dEarliest);
+        if(dStart > To.dLatest || dStart + To.dDuration > m_dNightEnd)
+            return false;
+        if(inLimits(nTo, dStart)) {
+            dTime = dStart;
+            return true;
+        }
+        // wait where we are and leave later
+        dTime = std::max(dTime, dStart - dSlew) + SEQUENCE_WAIT_STEP;
+    }
+}
+
+bool RSTSequenceOptimizer::simulate(const std::vector<int> &vOrder, double &dDead, RSTSequence *pSequence, int *pnFailed) const
+{
+    double dTime = 0.0;
+    double dRa = m_dFromRa;
+    double dDec = m_dFromDec;
+    bool bWest = m_bFromWest;
+    bool bToWest;
+    double dSlew;
+    double dSlewTotal = 0.0;
+    double dBusy = 0.0;
+    int nFlips = 0;
+
+    if(pSequence) {
+        pSequence->vOrder = vOrder;
+        pSequence->vStart.clear();
+    }
+    for(size_t i = 0; i < vOrder.size(); i++) {
+        const RSTSequenceTarget &Target = (*m_pTargets)[vOrder[i]];
+
+        if(!visit(dTime, dRa, dDec, bWest, vOrder[i], dSlew, bToWest)) {
+            if(pnFailed)
+                *pnFailed = (int)i;
+            return false;
+        }
+        if(pSequence)
+            pSequence->vStart.push_back(dTime);
+        if(bToWest != bWest)
+            nFlips++;
+        dSlewTotal += dSlew;
+        dBusy += Target.dDuration;
+        dTime += Target.dDuration;
+        dRa = Target.dRa;
+        dDec = Target.dDec;
+        bWest = bToWest;
+    }
+    dDead = dTime - dBusy;
+    if(pSequence) {
+        pSequence->dSlewSeconds = dSlewTotal;
+        pSequence->dWaitSeconds = dDead - dSlewTotal;
+        pSequence->nFlips = nFlips;
+    }
+    return true;
+}
+
+// the next target is the one whose exposure can start soonest
+void RSTSequenceOptimizer::nearestNeighbour(std::vector<int> &vOrder, std::vector<int> &vDropped) const
+{
+    std::vector<char> vDone(m_nTargets, 0);
+    std::vector<std::pair<double, int>> vCandidates;
+    double dTime = 0.0;
+    double dRa = m_dFromRa;
+    double dDec = m_dFromDec;
+    bool bWest = m_bFromWest;
+    bool bToWest;
+    double dSlew;
+    double dStart;
+    double dLst;
+    int nPick;
+
+    vOrder.clear();
+    vDropped.clear();
+    vCandidates.reserve(m_nTargets);
+    while(true) {
+        vCandidates.clear();
+        dLst = std::fmod(m_dLst + dTime * SIDEREAL_HOURS_PER_SECOND, 24.0);
+        for(int i = 0; i < m_nTargets; i++) {
+            if(vDone[i])
+                continue;
+            dStart = std::max(dTime + slewTime(dLst, dRa, dDec, bWest, i, bToWest), (*m_pTargets)[i].dEarliest);
+            // windows only close as the night goes on
+            if(dStart > (*m_pTargets)[i].dLatest || dStart + (*m_pTargets)[i].dDuration > m_dNightEnd) {
+                vDone[i] = 1;
+                vDropped.push_back(i);
+                continue;
+            }
+            vCandidates.push_back(std::make_pair(dStart, i));
+        }
+        if(vCandidates.empty())
+            break;
+        std::sort(vCandidates.begin(), vCandidates.end());
+
+        nPick = -1;
+        for(const std::pair<double, int> &Candidate : vCandidates) {
+            if(inLimits(Candidate.second, Candidate.first)) {
+                nPick = Candidate.second;
+                break;
+            }
+        }
+        // nothing is in the limits now, wait for the sky to turn
+        if(nPick < 0) {
+            dTime += SEQUENCE_WAIT_STEP;
+            continue;
+        }
+
+        visit(dTime, dRa, dDec, bWest, nPick, dSlew, bToWest);
+        dTime += (*m_pTargets)[nPick].dDuration;
+        dRa = (*m_pTargets)[nPick].dRa;
+        dDec = (*m_pTargets)[nPick].dDec;
+        bWest = bToWest;
+        vDone[nPick] = 1;
+        vOrder.push_back(nPick);
+    }
+}
+
+// each row at the time the tour leaves that target, from the side it is on
+void RSTSequenceOptimizer::buildCosts(const std::vector<int> &vOrder)
+{
+    std::vector<double> vLeave(m_nTargets + 1, 0.0);
+    std::vector<char> vWest(m_nTargets + 1, 0);
+    double dTime = 0.0;
+    double dRa = m_dFromRa;
+    double dDec = m_dFromDec;
+    bool bWest = m_bFromWest;
+    bool bToWest;
+    double dSlew;
+    double dLst;
+
+    vWest[m_nTargets] = m_bFromWest;
+    for(int nTarget : vOrder) {
+        if(!visit(dTime, dRa, dDec, bWest, nTarget, dSlew, bToWest))
+            break;
+        dTime += (*m_pTargets)[nTarget].dDuration;
+        vLeave[nTarget] = dTime;
+        vWest[nTarget] = bToWest;
+        dRa = (*m_pTargets)[nTarget].dRa;
+        dDec = (*m_pTargets)[nTarget].dDec;
+        bWest = bToWest;
+    }
+    // targets not in the tour leave from where a goto now would put them
+    for(int i = 0; i < m_nTargets; i++) {
+        if(vLeave[i] == 0.0)
+            vWest[i] = (m_PierSide.predict((*m_pTargets)[i].dRa, (*m_pTargets)[i].dDec, m_dLst) == STATUS_PIER_WEST);
+    }
+
+    m_vCosts.resize((size_t)(m_nTargets + 1) * m_nTargets);
+    for(int i = 0; i <= m_nTargets; i++) {
+        dLst = std::fmod(m_dLst + vLeave[i] * SIDEREAL_HOURS_PER_SECOND, 24.0);
+        dRa = i < m_nTargets ? (*m_pTargets)[i].dRa : m_dFromRa;
+        dDec = i < m_nTargets ? (*m_pTargets)[i].dDec : m_dFromDec;
+        for(int j = 0; j < m_nTargets; j++)
+            m_vCosts[(size_t)i * m_nTargets + j] = (i == j) ? 0.0 : slewTime(dLst, dRa, dDec, vWest[i], j, bToWest);
+    }
+}
+
+bool RSTSequenceOptimizer::tryTour(std::vector<int> &vOrder, const std::vector<int> &vCandidate, double &dDead) const
+{
+    double dCandidateDead;
+
+    if(!simulate(vCandidate, dCandidateDead, NULL) || dCandidateDead > dDead - SEQUENCE_MIN_GAIN)
+        return false;
+    vOrder = vCandidate;
+    dDead = dCandidateDead;
+    return true;
+}
+
+// reverse a run of the tour
+bool RSTSequenceOptimizer::twoOpt(std::vector<int> &vOrder, double &dDead)
+{
+    int nSize = (int)vOrder.size();
+    int nPrev;
+    int nNext;
+    double dDelta;
+    bool bImproved = false;
+    std::vector<int> vCandidate;
+
+    for(int p = 0; p < nSize - 1; p++) {
+        if(overBudget())
+            break;
+        nPrev = p ? vOrder[p - 1] : m_nTargets;
+        for(int q = p + 1; q < nSize; q++) {
+            nNext = q + 1 < nSize ? vOrder[q + 1] : -1;
+            dDelta = cost(nPrev, vOrder[q]) - cost(nPrev, vOrder[p]);
+            if(nNext >= 0)
+                dDelta += cost(vOrder[p], nNext) - cost(vOrder[q], nNext);
+            if(dDelta > -SEQUENCE_MIN_GAIN)
+                continue;
+            vCandidate = vOrder;
+            std::reverse(vCandidate.begin() + p, vCandidate.begin() + q + 1);
+            // the costs stay as they were for the rest of the pass, they only pick what is worth replaying
+            if(tryTour(vOrder, vCandidate, dDead)) {
+                bImproved = true;
+                nPrev = p ? vOrder[p - 1] : m_nTargets;
+            }
+        }
+    }
+    return bImproved;
+}
+
+// move a run of up to SEQUENCE_OR_OPT_SEGMENT targets elsewhere in the tour
+bool RSTSequenceOptimizer::orOpt(std::vector<int> &vOrder, double &dDead)
+{
+    int nSize = (int)vOrder.size();
+    int nPrev;
+    int nNext;
+    int nFirst;
+    int nLast;
+    int nBefore;
+    int nAfter;
+    double dRemoved;
+    double dDelta;
+    bool bImproved = false;
+    std::vector<int> vCandidate;
+
+    for(int nLength = 1; nLength <= SEQUENCE_OR_OPT_SEGMENT; nLength++) {
+        for(int p = 0; p + nLength <= nSize; p++) {
+            if(overBudget())
+                return bImproved;
+            nPrev = p ? vOrder[p - 1] : m_nTargets;
+            nNext = p + nLength < nSize ? vOrder[p + nLength] : -1;
+            nFirst = vOrder[p];
+            nLast = vOrder[p + nLength - 1];
+            dRemoved = cost(nPrev, nFirst);
+            if(nNext >= 0)
+                dRemoved += cost(nLast, nNext) - cost(nPrev, nNext);
+            // in front of vOrder[k], k == nSize for the end
+            for(int k = 0; k <= nSize; k++) {
+                if(k >= p && k <= p + nLength)
+                    continue;
+                nBefore = k ? vOrder[k - 1] : m_nTargets;
+                nAfter = k < nSize ? vOrder[k] : -1;
+                dDelta = cost(nBefore, nFirst) - dRemoved;
+                if(nAfter >= 0)
+                    dDelta += cost(nLast, nAfter) - cost(nBefore, nAfter);
+                if(dDelta > -SEQUENCE_MIN_GAIN)
+                    continue;
+                vCandidate.clear();
+                for(int i = 0; i <= nSize; i++) {
+                    if(i == k)
+                        vCandidate.insert(vCandidate.end(), vOrder.begin() + p, vOrder.begin() + p + nLength);
+                    if(i < nSize && (i < p || i >= p + nLength))
+                        vCandidate.push_back(vOrder[i]);
+                }
+                if(tryTour(vOrder, vCandidate, dDead)) {
+                    bImproved = true;
+                    break;
+                }
+            }
+        }
+    }
+    return bImproved;
+}
+
+// the dropped targets that fit somewhere after all, at the place that adds the least dead time
+void RSTSequenceOptimizer::reinsert(std::vector<int> &vOrder, std::vector<int> &vDropped, double &dDead)
+{
+    std::vector<std::pair<double, int>> vPlaces;
+    std::vector<int> vCandidate;
+    std::vector<int> vBest;
+    double dCandidateDead;
+    double dBestDead;
+    int nBefore;
+    int nAfter;
+    int nTries;
+
+    for(std::vector<int>::iterator it = vDropped.begin(); it != vDropped.end() && !overBudget(); ) {
+        vPlaces.clear();
+        for(int k = 0; k <= (int)vOrder.size(); k++) {
+            nBefore = k ? vOrder[k - 1] : m_nTargets;
+            nAfter = k < (int)vOrder.size() ? vOrder[k] : -1;
+            vPlaces.push_back(std::make_pair(cost(nBefore, *it) + (nAfter >= 0 ? cost(*it, nAfter) - cost(nBefore, nAfter) : 0.0), k));
+        }
+        nTries = std::min((int)vPlaces.size(), SEQUENCE_REINSERT_TRIES);
+        std::partial_sort(vPlaces.begin(), vPlaces.begin() + nTries, vPlaces.end());
+
+        vBest.clear();
+        dBestDead = std::numeric_limits<double>::max();
+        for(int i = 0; i < nTries; i++) {
+            vCandidate = vOrder;
+            vCandidate.insert(vCandidate.begin() + vPlaces[i].second, *it);
+            if(simulate(vCandidate, dCandidateDead, NULL) && dCandidateDead < dBestDead) {
+                dBestDead = dCandidateDead;
+                vBest.swap(vCandidate);
+            }
+        }
+        if(vBest.empty()) {
+            ++it;
+            continue;
+        }
+        vOrder.swap(vBest);
+        dDead = dBestDead;
+        it = vDropped.erase(it);
+    }
+}
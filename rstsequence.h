@@ -0,0 +1,99 @@
+#ifndef __RST_SEQUENCE__
+#define __RST_SEQUENCE__
+
+#pragma once
+
+// Target sequence optimizer. Orders a night's targets to spend the least time slewing, with the mount's own
+// slew time model (rstslewmodel.h), the side each goto will pick (rstpierside.h) and the local limits (rstlimits.h).
+// The sky turns while we work so every cost is taken at the sidereal time the goto would start : a target has to
+// be inside the limits for its whole exposure and start inside its time window, a flip costs what its slew costs.
+// A target that is out of the limits when we could get there is waited for, so what gets minimised is the dead time,
+// slews and waits, which is the slew time whenever the windows and limits leave nothing to wait for.
+// A nearest neighbour tour (the goto that lets the next exposure start soonest) is improved with 2-opt and Or-opt
+// moves until nothing gains or the time budget is spent. A move is judged on a cost table taken along the current
+// tour, the ones that look better are replayed in time before they are kept.
+
+#include <vector>
+#include <chrono>
+
+#include "rstlimits.h"
+#include "rstpierside.h"
+#include "rstslewmodel.h"
+
+#define SEQUENCE_DEFAULT_BUDGET     40      // ms, what is left of 50 ms once the tour is built and replayed
+#define SEQUENCE_NO_DEADLINE        1e9     // seconds, for a target that can start any time
+#define SEQUENCE_OR_OPT_SEGMENT     3       // longest run of targets an Or-opt move carries
+#define SEQUENCE_MIN_GAIN           0.05    // seconds, less isn't worth replaying the tour
+#define SEQUENCE_REINSERT_TRIES     5       // best looking places a dropped target is tried at
+#define SEQUENCE_WAIT_STEP          300.0   // seconds, waiting for a target to come into the limits
+#define SEQUENCE_DEFAULT_NIGHT      43200.0 // seconds from now everything must be done by
+
+typedef struct {
+    double  dRa;        // hours
+    double  dDec;       // degrees
+    double  dEarliest;  // seconds from now the exposure may start
+    double  dLatest;    // and must have started by, SEQUENCE_NO_DEADLINE for no limit
+    double  dDuration;  // seconds spent on the target
+} RSTSequenceTarget;
+
+typedef struct {
+    std::vector<int>    vOrder;     // indexes in the target list, in visiting order
+    std::vector<double> vStart;     // seconds from now each of them starts
+    std::vector<int>    vDropped;   // no room in their window, or out of the limits whenever we could be there
+    double  dSlewSeconds;           // total for the sequence
+    double  dWaitSeconds;           // for windows to open and targets to come into the limits
+    int     nFlips;
+    double  dElapsedMs;             // what the optimizer took
+} RSTSequence;
+
+class RSTSequenceOptimizer
+{
+public:
+    RSTSequenceOptimizer(const RSTSlewTimeModel &SlewModel, const RSTPierSideModel &PierSide, const RSTLimits &Limits);
+
+    // starting at dFromRa / dFromDec on the bFromWest side of the pier, dLst is the sidereal time now (hours).
+    // Every exposure ends before dNightEnd (seconds from now).
+    void    optimize(const std::vector<RSTSequenceTarget> &vTargets, double dLst, double dFromRa, double dFromDec, bool bFromWest,
+                     double dNightEnd, RSTSequence &Sequence, int nBudgetMs = SEQUENCE_DEFAULT_BUDGET);
+    // the same for an order given by the caller, false if one of its targets can't be visited
+    bool    evaluate(const std::vector<RSTSequenceTarget> &vTargets, double dLst, double dFromRa, double dFromDec, bool bFromWest,
+                     double dNightEnd, const std::vector<int> &vOrder, RSTSequence &Sequence);
+
+private:
+    // slew time to target nTo from a position at sidereal time dLst, bToWest is the side the goto picks
+    double  slewTime(double dLst, double dFromRa, double dFromDec, bool bFromWest, int nTo, bool &bToWest) const;
+    bool    inLimits(int nTarget, double dStart) const;
+    // goto nTo leaving at dTime, waiting there first if it isn't in the limits yet. dTime becomes the start of
+    // the exposure. False when its window closes (or the night ends) first.
+    bool    visit(double &dTime, double dFromRa, double dFromDec, bool bFromWest, int nTo, double &dSlew, bool &bToWest) const;
+    // replays the tour in time and gives its dead time. False if a target can't be visited, its place in pnFailed.
+    // Fills pSequence when not NULL.
+    bool    simulate(const std::vector<int> &vOrder, double &dDead, RSTSequence *pSequence, int *pnFailed = NULL) const;
+    void    setup(const std::vector<RSTSequenceTarget> &vTargets, double dLst, double dFromRa, double dFromDec, bool bFromWest, double dNightEnd);
+    void    nearestNeighbour(std::vector<int> &vOrder, std::vector<int> &vDropped) const;
+    // m_vCosts along the tour, row nTargets is the starting position
+    void    buildCosts(const std::vector<int> &vOrder);
+    double  cost(int nFrom, int nTo) const { return m_vCosts[(size_t)nFrom * m_nTargets + nTo]; }
+    // keeps vCandidate in vOrder if it replays with less dead time
+    bool    tryTour(std::vector<int> &vOrder, const std::vector<int> &vCandidate, double &dDead) const;
+    bool    twoOpt(std::vector<int> &vOrder, double &dDead);
+    bool    orOpt(std::vector<int> &vOrder, double &dDead);
+    void    reinsert(std::vector<int> &vOrder, std::vector<int> &vDropped, double &dDead);
+    bool    overBudget() const { return std::chrono::steady_clock::now() >= m_tBudget; }
+
+    const RSTSlewTimeModel  &m_SlewModel;
+    const RSTPierSideModel  &m_PierSide;
+    const RSTLimits         &m_Limits;
+
+    const std::vector<RSTSequenceTarget>    *m_pTargets;
+    int     m_nTargets;
+    double  m_dLst;
+    double  m_dFromRa;
+    double  m_dFromDec;
+    bool    m_bFromWest;
+    double  m_dNightEnd;
+    std::vector<double> m_vCosts;
+    std::chrono::steady_clock::time_point   m_tBudget;
+};
+
+#endif // __RST_SEQUENCE__
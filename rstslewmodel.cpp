@@ -0,0 +1,168 @@
+#include "rstslewmodel.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#define SIDEREAL_DEG_PER_SEC    (15.0410681 / 3600.0)
+
+RSTSlewTimeModel::RSTSlewTimeModel()
+{
+    m_nSlews = 0;
+    m_dAbsError = 0.0;
+    m_dError = 0.0;
+    m_dMaxSpeed = 0.0;
+    m_dLatitude = 0.0;
+    setMaxSpeed(SLEW_DEFAULT_SPEED);
+}
+
+void RSTSlewTimeModel::setLatitude(double dLatitude)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_dLatitude = dLatitude;
+}
+
+void RSTSlewTimeModel::setMaxSpeed(double dSpeed)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(dSpeed <= 0.0)
+        dSpeed = SLEW_DEFAULT_SPEED;
+    if(dSpeed == m_dMaxSpeed)
+        return;
+    m_dMaxSpeed = dSpeed;
+    m_dSpeed = std::min(std::max(dSpeed * SIDEREAL_DEG_PER_SEC, SLEW_MODEL_MIN_SPEED), SLEW_MODEL_MAX_SPEED);
+    m_dAccel = std::min(std::max(m_dSpeed / SLEW_DEFAULT_RAMP, SLEW_MODEL_MIN_ACCEL), SLEW_MODEL_MAX_ACCEL);
+    m_dSettle = SLEW_DEFAULT_SETTLE;
+    // the guess as two long gotos the fit starts from, it fades much faster than the real ones
+    memset(&m_Prior, 0, sizeof(m_Prior));
+    memset(&m_Gotos, 0, sizeof(m_Gotos));
+    addPoint(m_Prior, m_dSpeed * m_dSpeed / m_dAccel + 30.0, estimateLocked(m_dSpeed * m_dSpeed / m_dAccel + 30.0), SLEW_MODEL_PRIOR_WEIGHT);
+    addPoint(m_Prior, m_dSpeed * m_dSpeed / m_dAccel + 120.0, estimateLocked(m_dSpeed * m_dSpeed / m_dAccel + 120.0), SLEW_MODEL_PRIOR_WEIGHT);
+}
+
+double RSTSlewTimeModel::axisTravel(double dFromHa, double dFromDec, bool bFromWest, double dToHa, double dToDec, bool bToWest) const
+{
+    double dFromRa = dFromHa * 15.0 + (bFromWest ? 180.0 : 0.0);
+    double dToRa = dToHa * 15.0 + (bToWest ? 180.0 : 0.0);
+    double dRaTravel;
+    double dDecTravel;
+
+    dRaTravel = std::fabs(std::fmod(std::fmod(dToRa - dFromRa, 360.0) + 540.0, 360.0) - 180.0);
+    // a flip takes the Dec axis through the pole, the south one south of the equator
+    if(bFromWest == bToWest)
+        dDecTravel = std::fabs(dToDec - dFromDec);
+    else {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if(m_dLatitude >= 0.0)
+            dDecTravel = (90.0 - dFromDec) + (90.0 - dToDec);
+        else
+            dDecTravel = (90.0 + dFromDec) + (90.0 + dToDec);
+    }
+    return std::max(dRaTravel, dDecTravel);
+}
+
+double RSTSlewTimeModel::estimate(double dTravel) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return estimateLocked(dTravel);
+}
+
+double RSTSlewTimeModel::estimateLocked(double dTravel) const
+{
+    // full speed needs v^2 / 2a to get there and as much to stop
+    if(dTravel >= m_dSpeed * m_dSpeed / m_dAccel)
+        return m_dSettle + dTravel / m_dSpeed + m_dSpeed / m_dAccel;
+    return m_dSettle + 2.0 * std::sqrt(dTravel / m_dAccel);
+}
+
+void RSTSlewTimeModel::learn(double dTravel, double dSeconds, double dPredicted)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    double dMoving;
+
+    if(m_nSlews++) {
+        m_dAbsError = SLEW_ERROR_DECAY * m_dAbsError + (1.0 - SLEW_ERROR_DECAY) * std::fabs(dSeconds - dPredicted);
+        m_dError = SLEW_ERROR_DECAY * m_dError + (1.0 - SLEW_ERROR_DECAY) * (dSeconds - dPredicted);
+    }
+    else {
+        m_dAbsError = std::fabs(dSeconds - dPredicted);
+        m_dError = dSeconds - dPredicted;
+    }
+
+    if(dTravel >= m_dSpeed * m_dSpeed / m_dAccel) {
+        scale(m_Gotos, SLEW_MODEL_DECAY);
+        scale(m_Prior, SLEW_MODEL_PRIOR_DECAY);
+        addPoint(m_Gotos, dTravel, dSeconds, 1.0);
+        refit();
+        return;
+    }
+
+    // a short goto never reached full speed, it tells the acceleration (or that we settle faster than we thought)
+    dMoving = dSeconds - m_dSettle;
+    if(dMoving <= 0.0) {
+        m_dSettle = SLEW_MODEL_DECAY * m_dSettle + (1.0 - SLEW_MODEL_DECAY) * std::max(dSeconds - 2.0 * std::sqrt(dTravel / m_dAccel), 0.0);
+        return;
+    }
+    m_dAccel = SLEW_MODEL_DECAY * m_dAccel + (1.0 - SLEW_MODEL_DECAY) * (4.0 * dTravel / (dMoving * dMoving));
+    m_dAccel = std::min(std::max(m_dAccel, SLEW_MODEL_MIN_ACCEL), SLEW_MODEL_MAX_ACCEL);
+}
+
+void RSTSlewTimeModel::getFit(double &dSpeed, double &dAccel, double &dSettle) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    dSpeed = m_dSpeed;
+    dAccel = m_dAccel;
+    dSettle = m_dSettle;
+}
+
+void RSTSlewTimeModel::getStats(unsigned long &nSlews, double &dMeanAbsError, double &dMeanError) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    nSlews = m_nSlews;
+    dMeanAbsError = m_dAbsError;
+    dMeanError = m_dError;
+}
+
+void RSTSlewTimeModel::addPoint(FitSums &Sums, double dTravel, double dSeconds, double dWeight)
+{
+    Sums.dW += dWeight;
+    Sums.dD += dWeight * dTravel;
+    Sums.dT += dWeight * dSeconds;
+    Sums.dDD += dWeight * dTravel * dTravel;
+    Sums.dDT += dWeight * dTravel * dSeconds;
+}
+
+void RSTSlewTimeModel::scale(FitSums &Sums, double dFactor)
+{
+    Sums.dW *= dFactor;
+    Sums.dD *= dFactor;
+    Sums.dT *= dFactor;
+    Sums.dDD *= dFactor;
+    Sums.dDT *= dFactor;
+}
+
+// with m_Mutex held
+void RSTSlewTimeModel::refit()
+{
+    double dW = m_Gotos.dW + m_Prior.dW;
+    double dD = m_Gotos.dD + m_Prior.dD;
+    double dT = m_Gotos.dT + m_Prior.dT;
+    double dDet = dW * (m_Gotos.dDD + m_Prior.dDD) - dD * dD;
+    double dSlope = 0.0;
+    double dIntercept;
+
+    // the gotos all about the same length (or longer ones quicker), they say nothing about the speed
+    if(dDet > 1e-9 * dW * (m_Gotos.dDD + m_Prior.dDD))
+        dSlope = (dW * (m_Gotos.dDT + m_Prior.dDT) - dD * dT) / dDet;
+    if(dSlope > 0.0)
+        m_dSpeed = std::min(std::max(1.0 / dSlope, SLEW_MODEL_MIN_SPEED), SLEW_MODEL_MAX_SPEED);
+    dIntercept = (dT - dD / m_dSpeed) / dW;
+
+    // the intercept is the settling plus the time lost accelerating, the latter can't be more than all of it
+    if(dIntercept < m_dSpeed / m_dAccel)
+        m_dAccel = std::min(m_dSpeed / std::max(dIntercept, m_dSpeed / SLEW_MODEL_MAX_ACCEL), SLEW_MODEL_MAX_ACCEL);
+    m_dSettle = std::min(std::max(dIntercept - m_dSpeed / m_dAccel, 0.0), SLEW_MODEL_MAX_SETTLE);
+}
@@ -0,0 +1,72 @@
+#ifndef __RST_SLEW_MODEL__
+#define __RST_SLEW_MODEL__
+
+#pragma once
+
+// Slew time model. Both axes move at once, so a goto lasts as long as the longest axis travel d :
+// t = s + d / v + v / a once the axis reaches full speed v (after accelerating at a), t = s + 2 * sqrt(d / a) for
+// shorter gotos, s is the settling time at the end.
+// v starts from the max speed setting (:CU3#). The long gotos refit v and s + v / a with a weighted least squares of
+// duration against distance, the short ones refit a. Older gotos (and the starting guess) weigh less and less.
+
+#include <mutex>
+
+#define SLEW_DEFAULT_SPEED          600.0   // x sidereal, when :CU3# can't be read
+#define SLEW_DEFAULT_RAMP           2.0     // seconds to reach full speed, the starting guess for the acceleration
+#define SLEW_DEFAULT_SETTLE         1.0     // seconds
+#define SLEW_MODEL_DECAY            0.85    // weight left to the previous gotos after each new one
+#define SLEW_MODEL_PRIOR_WEIGHT     0.5     // of each of the two gotos the starting guess stands for
+#define SLEW_MODEL_PRIOR_DECAY      0.25    // and what is left of it after each real goto
+#define SLEW_MODEL_MIN_SPEED        0.1     // deg/s, what the fit is allowed to conclude
+#define SLEW_MODEL_MAX_SPEED        30.0
+#define SLEW_MODEL_MIN_ACCEL        0.05    // deg/s^2
+#define SLEW_MODEL_MAX_ACCEL        30.0
+#define SLEW_MODEL_MAX_SETTLE       30.0    // seconds
+#define SLEW_ERROR_DECAY            0.6     // the error statistics follow the recent gotos
+
+class RSTSlewTimeModel
+{
+public:
+    RSTSlewTimeModel();
+
+    // x sidereal, the starting guess. A new speed forgets what was learned, the same one again keeps it.
+    void    setMaxSpeed(double dSpeed);
+
+    // the site, a flip takes the Dec axis through the pole of its hemisphere. North until we know.
+    void    setLatitude(double dLatitude);
+    // longest axis travel in degrees. Hour angles in hours, bWest when the telescope is west of the pier
+    double  axisTravel(double dFromHa, double dFromDec, bool bFromWest, double dToHa, double dToDec, bool bToWest) const;
+    // seconds
+    double  estimate(double dTravel) const;
+    // a goto of dTravel degrees took dSeconds, dPredicted is what estimate() said before it
+    void    learn(double dTravel, double dSeconds, double dPredicted);
+
+    void    getFit(double &dSpeed, double &dAccel, double &dSettle) const;  // deg/s, deg/s^2, seconds
+    // gotos learned from, recent mean absolute and mean signed error (observed - predicted) of the predictions in seconds
+    void    getStats(unsigned long &nSlews, double &dMeanAbsError, double &dMeanError) const;
+
+private:
+    // weighted sums for t = (s + v / a) + d / v on the gotos long enough to reach full speed
+    typedef struct {
+        double  dW, dD, dT, dDD, dDT;
+    } FitSums;
+
+    double  estimateLocked(double dTravel) const;
+    static void addPoint(FitSums &Sums, double dTravel, double dSeconds, double dWeight);
+    static void scale(FitSums &Sums, double dFactor);
+    void    refit();
+
+    mutable std::mutex  m_Mutex;
+    double  m_dMaxSpeed;    // x sidereal, as set
+    double  m_dSpeed;       // deg/s
+    double  m_dAccel;       // deg/s^2
+    double  m_dSettle;      // s
+    double  m_dLatitude;
+    FitSums m_Prior;        // the starting guess, as two gotos
+    FitSums m_Gotos;
+    unsigned long   m_nSlews;
+    double  m_dAbsError;
+    double  m_dError;
+};
+
+#endif // __RST_SLEW_MODEL__
@@ -0,0 +1,233 @@
+#include "rststatus.h"
+
+#include <chrono>
+#include <cstring>
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+uint64_t RSTStatusPublisher::now()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#pragma mark - publisher
+
+RSTStatusPublisher::RSTStatusPublisher()
+{
+    m_pSegment = NULL;
+}
+
+RSTStatusPublisher::~RSTStatusPublisher()
+{
+    close();
+}
+
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+
+int RSTStatusPublisher::open(const std::string &sName)
+{
+    int nFd;
+    void *pMap;
+    struct stat st;
+
+    close();
+
+    nFd = shm_open(sName.c_str(), O_RDWR | O_CREAT, 0644);
+    if(nFd < 0)
+        return ERR_NOLINK;
+
+    // a segment left by a crashed driver is ours to take, one still written to by a live process isn't
+    if(fstat(nFd, &st) == 0 && st.st_size >= (off_t)sizeof(RSTStatusSegment)) {
+        pMap = mmap(NULL, sizeof(RSTStatusSegment), PROT_READ, MAP_SHARED, nFd, 0);
+        if(pMap != MAP_FAILED) {
+            const RSTStatusSegment *pOld = (const RSTStatusSegment *)pMap;
+            pid_t nPid = (pid_t)pOld->nWriterPid;
+            bool bInUse = pOld->nMagic == RST_STATUS_MAGIC && nPid > 0 && nPid != getpid() && (kill(nPid, 0) == 0 || errno == EPERM);
+            munmap(pMap, sizeof(RSTStatusSegment));
+            if(bInUse) {
+                ::close(nFd);
+                return ERR_CMDFAILED;
+            }
+        }
+    }
+
+    if(ftruncate(nFd, sizeof(RSTStatusSegment)) < 0) {
+        ::close(nFd);
+        return ERR_NOLINK;
+    }
+    pMap = mmap(NULL, sizeof(RSTStatusSegment), PROT_READ | PROT_WRITE, MAP_SHARED, nFd, 0);
+    ::close(nFd);
+    if(pMap == MAP_FAILED)
+        return ERR_NOLINK;
+
+    m_pSegment = (RSTStatusSegment *)pMap;
+    m_sName = sName;
+
+    // readers check the magic last, an odd sequence keeps them out while we reset the layout
+    m_pSegment->nSequence.store(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_pSegment->nLayoutVersion = RST_STATUS_LAYOUT_VERSION;
+    m_pSegment->nSnapshotSize = sizeof(RSTStatusSnapshot);
+    m_pSegment->nWriterPid = (uint32_t)getpid();
+    memset(&m_pSegment->Snapshot, 0, sizeof(RSTStatusSnapshot));
+    m_pSegment->Snapshot.nTrackingMode = STATUS_TRACKING_UNKNOWN;
+    m_pSegment->Snapshot.nPierSide = STATUS_PIER_UNKNOWN;
+    m_pSegment->nMagic = RST_STATUS_MAGIC;
+    m_pSegment->nSequence.store(2, std::memory_order_release);
+
+    return SB_OK;
+}
+
+void RSTStatusPublisher::close()
+{
+    if(!m_pSegment)
+        return;
+    // readers that still have it mapped keep the last snapshot, new ones won't find it
+    shm_unlink(m_sName.c_str());
+    munmap(m_pSegment, sizeof(RSTStatusSegment));
+    m_pSegment = NULL;
+}
+
+void RSTStatusPublisher::publish(const RSTStatusSnapshot &Snapshot)
+{
+    uint32_t nSeq;
+
+    if(!m_pSegment)
+        return;
+
+    nSeq = m_pSegment->nSequence.load(std::memory_order_relaxed);
+    m_pSegment->nSequence.store(nSeq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&m_pSegment->Snapshot, &Snapshot, sizeof(RSTStatusSnapshot));
+    m_pSegment->Snapshot.nPublishTime = now();
+    m_pSegment->nSequence.store(nSeq + 2, std::memory_order_release);
+}
+
+#pragma mark - reader
+
+RSTStatusReader::RSTStatusReader()
+{
+    m_pSegment = NULL;
+}
+
+RSTStatusReader::~RSTStatusReader()
+{
+    close();
+}
+
+int RSTStatusReader::open(const std::string &sName)
+{
+    int nFd;
+    void *pMap;
+    struct stat st;
+
+    close();
+
+    nFd = shm_open(sName.c_str(), O_RDONLY, 0);
+    if(nFd < 0)
+        return ERR_NOLINK;
+    if(fstat(nFd, &st) < 0 || st.st_size < (off_t)sizeof(RSTStatusSegment)) {
+        ::close(nFd);
+        return ERR_NOLINK;
+    }
+    pMap = mmap(NULL, sizeof(RSTStatusSegment), PROT_READ, MAP_SHARED, nFd, 0);
+    ::close(nFd);
+    if(pMap == MAP_FAILED)
+        return ERR_NOLINK;
+
+    m_pSegment = (const RSTStatusSegment *)pMap;
+    return SB_OK;
+}
+
+void RSTStatusReader::close()
+{
+    if(!m_pSegment)
+        return;
+    munmap((void *)m_pSegment, sizeof(RSTStatusSegment));
+    m_pSegment = NULL;
+}
+
+int RSTStatusReader::read(RSTStatusSnapshot &Snapshot)
+{
+    uint32_t nSeqBefore;
+    uint32_t nSeqAfter;
+    int nTries;
+
+    if(!m_pSegment)
+        return ERR_NOLINK;
+
+    for(nTries = 0; nTries < RST_STATUS_READ_RETRIES; nTries++) {
+        nSeqBefore = m_pSegment->nSequence.load(std::memory_order_acquire);
+        if(nSeqBefore & 1)
+            continue;
+        if(m_pSegment->nMagic != RST_STATUS_MAGIC || m_pSegment->nLayoutVersion != RST_STATUS_LAYOUT_VERSION)
+            return ERR_CMDFAILED;
+        memcpy(&Snapshot, (const void *)&m_pSegment->Snapshot, sizeof(RSTStatusSnapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        nSeqAfter = m_pSegment->nSequence.load(std::memory_order_relaxed);
+        if(nSeqBefore == nSeqAfter)
+            return SB_OK;
+    }
+    return ERR_CMDFAILED;
+}
+
+uint32_t RSTStatusReader::generation() const
+{
+    if(!m_pSegment)
+        return 0;
+    return m_pSegment->nSequence.load(std::memory_order_acquire) >> 1;
+}
+
+#else
+
+// no POSIX shared memory, the driver simply doesn't publish
+
+int RSTStatusPublisher::open(const std::string &sName)
+{
+    return ERR_NOT_IMPL;
+}
+
+void RSTStatusPublisher::close()
+{
+}
+
+void RSTStatusPublisher::publish(const RSTStatusSnapshot &Snapshot)
+{
+}
+
+RSTStatusReader::RSTStatusReader()
+{
+    m_pSegment = NULL;
+}
+
+RSTStatusReader::~RSTStatusReader()
+{
+}
+
+int RSTStatusReader::open(const std::string &sName)
+{
+    return ERR_NOT_IMPL;
+}
+
+void RSTStatusReader::close()
+{
+}
+
+int RSTStatusReader::read(RSTStatusSnapshot &Snapshot)
+{
+    return ERR_NOLINK;
+}
+
+uint32_t RSTStatusReader::generation() const
+{
+    return 0;
+}
+
+#endif
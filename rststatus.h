@@ -0,0 +1,99 @@
+#ifndef __RST_STATUS__
+#define __RST_STATUS__
+
+#pragma once
+
+// The driver publishes what it knows about the mount in a POSIX shared memory segment so other processes
+// (focus, safety scripts, ...) can read it at any rate without opening another link to the mount.
+// The segment is protected by a sequence lock : the writer makes the sequence odd while it updates the snapshot,
+// readers copy the snapshot and retry if the sequence was odd or changed under them. Readers never block the
+// writer and a read is a couple of memory copies, no system call.
+// There is one writer per segment (the RST instance that opened it), readers can be as many as needed.
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+#include "rsterrors.h"
+
+#define RST_STATUS_SHM_NAME         "/rststatus"
+#define RST_STATUS_MAGIC            0x53545352  // "RSTS"
+#define RST_STATUS_LAYOUT_VERSION   1
+#define RST_STATUS_READ_RETRIES     10000       // a torn read retries, after this many the writer is probably dead mid-update
+
+enum RSTStatusTracking  {STATUS_TRACKING_UNKNOWN=-1, STATUS_TRACKING_OFF=0, STATUS_TRACKING_SIDEREAL, STATUS_TRACKING_SOLAR, STATUS_TRACKING_LUNAR, STATUS_TRACKING_CUSTOM};
+enum RSTStatusPierSide  {STATUS_PIER_UNKNOWN=-1, STATUS_PIER_EAST=0, STATUS_PIER_WEST};   // west = beyond the pole
+enum RSTStatusFlags     {STATUS_CONNECTED=1, STATUS_SLEWING=2, STATUS_PARKED=4, STATUS_HOMED=8};
+
+// fixed size types only, the layout is shared with readers built separately (or not in C++ at all)
+typedef struct {
+    double      dRa;                // hours
+    double      dDec;               // degrees
+    double      dAlt;               // degrees
+    double      dAz;                // degrees
+    double      dRaRate;            // arcsec/s, TheSkyX convention (offset from sidereal)
+    double      dDecRate;           // arcsec/s
+    double      dVolts;
+    int32_t     nTrackingMode;      // RSTStatusTracking
+    int32_t     nPierSide;          // RSTStatusPierSide
+    uint32_t    nFlags;             // RSTStatusFlags
+    uint32_t    nReserved;
+    // steady clock (CLOCK_MONOTONIC on Linux) in ns when each group was last read from the mount, 0 = never
+    uint64_t    nRaDecTime;
+    uint64_t    nAltAzTime;
+    uint64_t    nTrackingTime;
+    uint64_t    nPierSideTime;
+    uint64_t    nFlagsTime;
+    uint64_t    nVoltageTime;
+    uint64_t    nPublishTime;
+} RSTStatusSnapshot;
+
+typedef struct {
+    uint32_t                nMagic;
+    uint32_t                nLayoutVersion;
+    uint32_t                nSnapshotSize;  // sizeof(RSTStatusSnapshot)
+    uint32_t                nWriterPid;
+    std::atomic<uint32_t>   nSequence;      // odd while the writer is updating the snapshot
+    uint32_t                nPad;
+    RSTStatusSnapshot       Snapshot;
+} RSTStatusSegment;
+
+class RSTStatusPublisher
+{
+public:
+    RSTStatusPublisher();
+    ~RSTStatusPublisher();
+
+    // fails if another live process already publishes under this name
+    int     open(const std::string &sName);
+    void    close();
+    bool    isOpen() const { return m_pSegment != NULL; }
+    // callers serialize publish(), there is only one writer
+    void    publish(const RSTStatusSnapshot &Snapshot);
+
+    static uint64_t now();
+
+private:
+    RSTStatusSegment    *m_pSegment;
+    std::string         m_sName;
+};
+
+class RSTStatusReader
+{
+public:
+    RSTStatusReader();
+    ~RSTStatusReader();
+
+    int     open(const std::string &sName = RST_STATUS_SHM_NAME);
+    void    close();
+    bool    isOpen() const { return m_pSegment != NULL; }
+    // consistent copy of the last published snapshot
+    int     read(RSTStatusSnapshot &Snapshot);
+    // number of snapshots published since the segment was created, to spot new data without copying it
+    uint32_t generation() const;
+
+private:
+    const RSTStatusSegment  *m_pSegment;
+};
+
+#endif // __RST_STATUS__
@@ -0,0 +1,44 @@
+#ifndef __RST_TRANSPORT__
+#define __RST_TRANSPORT__
+
+#pragma once
+
+// What the RST core needs from the outside : a byte link to the mount and, for the site and clock, a host.
+// In TheSkyX these are thin adapters over SerXInterface and the drivers facade (see x2adapters.h), the
+// command line tools give it a serial port or a TCP socket (tools/posixserx), the simulator (tools/simserx)
+// or the rstproxyd socket (rstproxy.h), and no host at all.
+// Nothing here comes from the X2 SDK, so the core builds without it (see rsterrors.h).
+
+#include "rsterrors.h"
+
+class RSTTransport
+{
+public:
+    virtual ~RSTTransport() {}
+
+    // always 8N1, pszSession is passed on to the port ("-DTR_CONTROL 1")
+    virtual int open(const char* pszPort, const unsigned long& dwBaudRate = 9600, const char* pszSession = 0) = 0;
+    virtual int close() = 0;
+    virtual bool isConnected() const = 0;
+
+    virtual int flushTx() = 0;
+    virtual int purgeTxRx() = 0;
+    virtual int readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut = 500) = 0;
+    virtual int writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten) = 0;
+    virtual int bytesWaitingRx(int &nBytesWaitingRx) = 0;
+};
+
+// the site and the computer clock. The tools pass none and leave the site and time sync off
+class RSTHost
+{
+public:
+    virtual ~RSTHost() {}
+
+    virtual double latitude() = 0;
+    virtual double longitude() = 0;
+    virtual double timeZone() = 0;
+    virtual double lst() = 0;
+    virtual int localDateTime(int& yy, int& mm, int& dd, int& h, int& min, double& sec, int& nIsDST) = 0;
+};
+
+#endif // __RST_TRANSPORT__
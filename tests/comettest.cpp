@@ -0,0 +1,101 @@
+// comettest : the non-sidereal tracking engine holds a comet on the simulated mount.
+//
+// usage : comettest [-d <seconds>] [-e <max error arcsec>] [-l <sim link latency ms>]
+//  The comet moves 0.3"/s in RA and 0.4"/s in Dec, 0.5"/s in all, too slow for a re-target so the engine guide
+//  pulses. Every second the simulated mount's position is compared to where the comet is, the test fails when
+//  the error on either axis goes past -e (3" by default) at any time. -d defaults to the hour the request asked for,
+//  "make test" runs a shorter one.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+
+#include "../RST.h"
+#include "../tools/simserx.h"
+
+#define COMET_RA_RATE       0.3     // arcsec/s
+#define COMET_DEC_RATE      0.4     // arcsec/s
+#define COMET_MAX_ERROR     3.0     // arcsec
+#define WARMUP_MAX_SECONDS  20
+
+typedef std::chrono::steady_clock Clock;
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    int nSeconds = 3600;
+    int nLatency = 20;
+    double dMaxError = COMET_MAX_ERROR;
+    double dRa0, dDec0, dRa, dDec;
+    double dElapsed;
+    double dErrRa, dErrDec;
+    double dEngineErrRa, dEngineErrDec;
+    double dWorstRa = 0.0;
+    double dWorstDec = 0.0;
+    char szPort[] = "sim";
+    int nErr;
+
+    while((nOpt = getopt(argc, argv, "d:e:l:h")) != -1) {
+        switch(nOpt) {
+            case 'd' :  nSeconds = std::max(1, atoi(optarg)); break;
+            case 'e' :  dMaxError = atof(optarg); break;
+            case 'l' :  nLatency = std::max(0, atoi(optarg)); break;
+            default :
+                fprintf(stderr, "usage : %s [-d <seconds>] [-e <max error arcsec>] [-l <sim link latency ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    RSTSimSerX simSerX(nLatency, 2.0);
+    RST mount;
+    mount.setTransport(&simSerX);
+    mount.setHost(NULL);
+    mount.setStopTrackingOnDisconnect(false);
+    nErr = mount.Connect(szPort);
+    if(nErr) {
+        fprintf(stderr, "can't connect to the simulator : %d\n", nErr);
+        return 1;
+    }
+    Clock::time_point tConnect = Clock::now();
+    while(!mount.isWarmupDone() && Clock::now() - tConnect < std::chrono::seconds(WARMUP_MAX_SECONDS))
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    simSerX.getPosition(dRa0, dDec0);
+    Clock::time_point tStart = Clock::now();
+    nErr = mount.setTrackingRates(true, false, COMET_RA_RATE, COMET_DEC_RATE);
+    if(nErr || !mount.isNonSiderealTrackingActive()) {
+        fprintf(stderr, "the tracking engine didn't start : %d\n", nErr);
+        return 1;
+    }
+    printf("comet at %.1f\"/s RA, %.1f\"/s Dec for %d s, max error %.1f\"\n", COMET_RA_RATE, COMET_DEC_RATE, nSeconds, dMaxError);
+
+    for(int i = 1; i <= nSeconds; i++) {
+        std::this_thread::sleep_until(tStart + std::chrono::seconds(i));
+        simSerX.getPosition(dRa, dDec);
+        dElapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tStart).count() / 1e6;
+        // arcsec the mount is behind the comet, on each axis
+        dErrRa = COMET_RA_RATE * dElapsed - (std::fmod(dRa - dRa0 + 36.0, 24.0) - 12.0) * 54000.0;
+        dErrDec = COMET_DEC_RATE * dElapsed - (dDec - dDec0) * 3600.0;
+        dWorstRa = std::max(dWorstRa, std::fabs(dErrRa));
+        dWorstDec = std::max(dWorstDec, std::fabs(dErrDec));
+        if(i % 60 == 0 || i == nSeconds) {
+            mount.getNonSiderealTrackingError(dEngineErrRa, dEngineErrDec);
+            printf("%5d s : error RA %+.2f\" Dec %+.2f\", worst RA %.2f\" Dec %.2f\", engine says RA %+.2f\" Dec %+.2f\"\n",
+                   i, dErrRa, dErrDec, dWorstRa, dWorstDec, dEngineErrRa, dEngineErrDec);
+            fflush(stdout);
+        }
+        if(std::fabs(dErrRa) > dMaxError || std::fabs(dErrDec) > dMaxError) {
+            printf("FAIL : at %d s the mount is %+.2f\" RA %+.2f\" Dec off the comet\n", i, dErrRa, dErrDec);
+            mount.Disconnect();
+            return 1;
+        }
+    }
+
+    mount.setTrackingRates(true, true, 0.0, 0.0);
+    mount.Disconnect();
+    printf("PASS : worst error RA %.2f\" Dec %.2f\" over %d s\n", dWorstRa, dWorstDec, nSeconds);
+    return 0;
+}
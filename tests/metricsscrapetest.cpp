@@ -0,0 +1,177 @@
+// metricsscrapetest : scraping the metrics endpoint doesn't perturb the command latency.
+//
+// usage : metricsscrapetest [-d <seconds per phase>] [-s <scrapes per second>] [-p <first port to try>]
+//  Polls the simulated mount (tools/simserx) for the voltage at 50 Hz, first alone then while a scraper GETs /metrics
+//  at -s Hz (20 by default, Prometheus usually comes every 15 s). The test fails when a scrape fails, when the
+//  scrapes alone send anything to the mount, or when the scrapes add more than 2 ms to the median command latency
+//  or 5 ms to the 99th percentile.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "../RST.h"
+#include "../tools/simserx.h"
+
+#define SCRAPE_SECONDS      10
+#define SCRAPE_RATE         20      // Hz
+#define SCRAPE_FIRST_PORT   19391
+#define SCRAPE_PORT_TRIES   20
+#define POLL_RATE           50      // Hz
+#define SIM_LATENCY         5       // ms
+#define MAX_P50_GROWTH      2.0     // ms
+#define MAX_P99_GROWTH      5.0     // ms
+#define WARMUP_MAX_SECONDS  20
+
+typedef std::chrono::steady_clock Clock;
+
+// one GET /metrics, true on a 200 with some of our families in it
+static bool scrape(int nPort)
+{
+    int nSocket;
+    struct sockaddr_in addr;
+    const char *pszRequest = "GET /metrics HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    char szBuf[4096];
+    ssize_t nRead;
+    std::string sResp;
+
+    nSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if(nSocket < 0)
+        return false;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(nPort);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if(connect(nSocket, (struct sockaddr *)&addr, sizeof(addr)) < 0 || send(nSocket, pszRequest, strlen(pszRequest), 0) < 0) {
+        close(nSocket);
+        return false;
+    }
+    while((nRead = recv(nSocket, szBuf, sizeof(szBuf), 0)) > 0)
+        sResp.append(szBuf, nRead);
+    close(nSocket);
+    return !sResp.compare(0, 12, "HTTP/1.1 200") && sResp.find("rst_") != std::string::npos;
+}
+
+// polls the voltage at POLL_RATE for nSeconds, returns the median and 99th percentile latency in ms
+static bool pollLatency(RST &Mount, int nSeconds, double &dP50, double &dP99)
+{
+    std::vector<double> dLatencies;
+    double dVolts;
+    int nPolls = POLL_RATE * nSeconds;
+
+    Clock::time_point tStart = Clock::now();
+    for(int i = 0; i < nPolls; i++) {
+        std::this_thread::sleep_until(tStart + std::chrono::microseconds(1000000L * i / POLL_RATE));
+        Clock::time_point tCall = Clock::now();
+        if(Mount.getInputVoltage(dVolts))
+            return false;
+        dLatencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tCall).count() / 1000.0);
+    }
+    std::sort(dLatencies.begin(), dLatencies.end());
+    dP50 = dLatencies[dLatencies.size() / 2];
+    dP99 = dLatencies[std::min(dLatencies.size() - 1, dLatencies.size() * 99 / 100)];
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    int nSeconds = SCRAPE_SECONDS;
+    int nScrapeRate = SCRAPE_RATE;
+    int nFirstPort = SCRAPE_FIRST_PORT;
+    int nPort = 0;
+    double dBaseP50, dBaseP99, dScrapedP50, dScrapedP99;
+    unsigned long nCommands;
+    std::atomic<bool> bScraping(true);
+    std::atomic<unsigned long> nScrapes(0);
+    std::atomic<unsigned long> nScrapeErrors(0);
+    char szPort[] = "sim";
+    bool bPass = true;
+
+    while((nOpt = getopt(argc, argv, "d:s:p:h")) != -1) {
+        switch(nOpt) {
+            case 'd' :  nSeconds = std::max(1, atoi(optarg)); break;
+            case 's' :  nScrapeRate = std::max(1, atoi(optarg)); break;
+            case 'p' :  nFirstPort = atoi(optarg); break;
+            default :
+                fprintf(stderr, "usage : %s [-d <seconds per phase>] [-s <scrapes per second>] [-p <first port to try>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    RSTSimSerX simSerX(SIM_LATENCY, 2.0);
+    RST mount;
+    mount.setTransport(&simSerX);
+    mount.setHost(NULL);
+    mount.setStopTrackingOnDisconnect(false);
+    mount.setQueryFreshness(-1);
+    for(int i = 0; i < SCRAPE_PORT_TRIES && !nPort; i++)
+        if(!mount.setMetricsPort(nFirstPort + i))
+            nPort = nFirstPort + i;
+    if(!nPort) {
+        fprintf(stderr, "no free port from %d\n", nFirstPort);
+        return 1;
+    }
+    if(mount.Connect(szPort)) {
+        fprintf(stderr, "can't connect to the simulator\n");
+        return 1;
+    }
+    Clock::time_point tConnect = Clock::now();
+    while(!mount.isWarmupDone() && Clock::now() - tConnect < std::chrono::seconds(WARMUP_MAX_SECONDS))
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    printf("voltage polls at %d Hz, scrapes on 127.0.0.1:%d at %d Hz, %d s per phase\n", POLL_RATE, nPort, nScrapeRate, nSeconds);
+
+    // the scrapes alone must not send anything to the mount
+    nCommands = simSerX.getCommandCount();
+    for(int i = 0; i < nScrapeRate; i++)
+        if(!scrape(nPort))
+            nScrapeErrors++;
+    if(simSerX.getCommandCount() != nCommands) {
+        printf("FAIL : %lu scrapes sent %lu commands to the mount\n", (unsigned long)nScrapeRate, simSerX.getCommandCount() - nCommands);
+        bPass = false;
+    }
+
+    if(!pollLatency(mount, nSeconds, dBaseP50, dBaseP99)) {
+        printf("FAIL : a voltage poll failed\n");
+        mount.Disconnect();
+        return 1;
+    }
+    printf("alone        : p50 %.2f ms p99 %.2f ms\n", dBaseP50, dBaseP99);
+
+    std::thread scraper([&]() {
+        Clock::time_point tStart = Clock::now();
+        for(unsigned long i = 1; bScraping; i++) {
+            if(scrape(nPort))
+                nScrapes++;
+            else
+                nScrapeErrors++;
+            std::this_thread::sleep_until(tStart + std::chrono::microseconds(1000000L * i / nScrapeRate));
+        }
+    });
+    if(!pollLatency(mount, nSeconds, dScrapedP50, dScrapedP99)) {
+        printf("FAIL : a voltage poll failed\n");
+        bPass = false;
+    }
+    bScraping = false;
+    scraper.join();
+    mount.Disconnect();
+    printf("with scrapes : p50 %.2f ms p99 %.2f ms, %lu scrapes, %lu failed\n", dScrapedP50, dScrapedP99, (unsigned long)nScrapes, (unsigned long)nScrapeErrors);
+
+    if(nScrapeErrors || !nScrapes) {
+        printf("FAIL : scrapes failed\n");
+        bPass = false;
+    }
+    if(dScrapedP50 > dBaseP50 + MAX_P50_GROWTH || dScrapedP99 > dBaseP99 + MAX_P99_GROWTH) {
+        printf("FAIL : the scrapes added %.2f ms to the median and %.2f ms to the p99\n", dScrapedP50 - dBaseP50, dScrapedP99 - dBaseP99);
+        bPass = false;
+    }
+    printf(bPass ? "PASS\n" : "FAIL\n");
+    return bPass ? 0 : 1;
+}
@@ -0,0 +1,166 @@
+// protocoltest : every entry of the command table (rstprotocol.h) against the simulated mount.
+//
+// usage : protocoltest [-l <sim link latency ms>]
+//  Writes each command of RSTCommands to the simulated mount (tools/simserx), a sample for the ones with an argument,
+//  and checks the answer is the one the entry describes : none, '#' framed, without a '#', or none while all is well
+//  for the ones that only answer on error. A '#' framed answer starts with the command's two letters and has a value
+//  past the prefix the driver strips, it comes within the entry's timeout, and rstFindCommand gives the sample back
+//  its entry. The test fails on any entry that doesn't.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+
+#include "../RST.h"
+#include "../tools/simserx.h"
+
+#define QUIET_WAIT      100     // ms past the latency, for the commands that don't answer
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct {
+    int         nCmd;
+    const char  *pszSample;
+} CommandSample;
+
+// the commands with an argument, as the driver (or a client of rstproxyd) writes them
+static const CommandSample g_Samples[] = {
+    {CMD_Sr,        ":Sr12:00:00#"},
+    {CMD_Sd,        ":Sd+45*00:00#"},
+    {CMD_Sz,        ":Sz180*00:00#"},
+    {CMD_Sa,        ":Sa+45*00:00#"},
+    {CMD_Ck,        ":Ck180.000+45.000#"},
+    {CMD_CN,        ":CN180.000+45.000#"},
+    {CMD_Cu,        ":Cu3=0500#"},
+    {CMD_SC,        ":SC01/01/25#"},
+    {CMD_SL,        ":SL12:00:00#"},
+    {CMD_Sg,        ":Sg+073*30#"},
+    {CMD_St,        ":St+45*30#"},
+    {CMD_SG,        ":SG+05#"},
+    {CMD_ANY_SET,   ":Sw4#"},
+    {CMD_ANY_MOVE,  ":MgE0500#"},
+    {CMD_ANY_STOP,  ":Qa#"},
+};
+
+static const char *sampleCommand(int nCmd)
+{
+    if(rstIsFixed(nCmd))
+        return RSTCommands[nCmd].pszOpcode;
+    for(const CommandSample &sample : g_Samples)
+        if(sample.nCmd == nCmd)
+            return sample.pszSample;
+    return NULL;
+}
+
+// what comes back within nWaitMs, up to the first '#'. dMs is when the last byte came
+static void readAnswer(RSTSimSerX &Link, int nWaitMs, std::string &sAnswer, double &dMs)
+{
+    char cByte;
+    unsigned long nRead;
+
+    sAnswer.clear();
+    dMs = 0.0;
+    Clock::time_point tStart = Clock::now();
+    Clock::time_point tEnd = tStart + std::chrono::milliseconds(nWaitMs);
+    while(Clock::now() < tEnd) {
+        if(Link.readFile(&cByte, 1, nRead) || !nRead) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+        sAnswer += cByte;
+        dMs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tStart).count() / 1000.0;
+        if(cByte == '#')
+            break;
+    }
+}
+
+// empty when the answer is the one the entry describes, else what's wrong with it
+static std::string checkAnswer(int nCmd, const std::string &sAnswer)
+{
+    const RSTCommandDesc &Desc = RSTCommands[nCmd];
+    std::string sValue;
+
+    switch(Desc.nReply) {
+        case REPLY_NONE :
+        case REPLY_ON_ERROR :
+            return sAnswer.empty() ? "" : "answered";
+        case REPLY_NO_HASH :
+            if(sAnswer.empty())
+                return "no answer";
+            return sAnswer.find('#') == std::string::npos ? "" : "answer framed with a '#'";
+        default :
+            break;
+    }
+    if(sAnswer.empty() || sAnswer.back() != '#')
+        return "no '#' framed answer";
+    sValue = sAnswer.substr(0, sAnswer.size() - 1);
+    if(sValue.compare(0, 2, Desc.pszOpcode + 1, 2))
+        return "answer for another command";
+    if(sValue.size() < (size_t)Desc.nPrefix || (Desc.bShared && rstReplyValue(nCmd, sValue).empty()))
+        return "nothing past the prefix";
+    return "";
+}
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    int nLatency = 20;
+    int nWaitMs;
+    int nFailed = 0;
+    const char *pszCmd;
+    unsigned long nWritten;
+    std::string sAnswer;
+    std::string sProblem;
+    double dMs;
+
+    while((nOpt = getopt(argc, argv, "l:h")) != -1) {
+        switch(nOpt) {
+            case 'l' :  nLatency = std::max(0, atoi(optarg)); break;
+            default :
+                fprintf(stderr, "usage : %s [-l <sim link latency ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    RSTSimSerX simSerX(nLatency, 1.0);
+    if(simSerX.open("sim")) {
+        fprintf(stderr, "can't open the simulator\n");
+        return 1;
+    }
+
+    for(int nCmd = 0; nCmd < CMD_COUNT; nCmd++) {
+        pszCmd = sampleCommand(nCmd);
+        if(!pszCmd) {
+            printf("  %-8s FAIL : no sample command\n", RSTCommands[nCmd].pszOpcode);
+            nFailed++;
+            continue;
+        }
+        // the commands that answer get their whole timeout, the check of the time comes after
+        nWaitMs = RSTCommands[nCmd].nReply == REPLY_HASH ? MAX_TIMEOUT : nLatency + QUIET_WAIT + rstTimeoutMs(RSTCommands[nCmd].nTimeout);
+        simSerX.purgeTxRx();
+        simSerX.writeFile((void *)pszCmd, strlen(pszCmd), nWritten);
+        readAnswer(simSerX, nWaitMs, sAnswer, dMs);
+
+        sProblem = checkAnswer(nCmd, sAnswer);
+        if(sProblem.empty() && !sAnswer.empty() && dMs > rstTimeoutMs(RSTCommands[nCmd].nTimeout))
+            sProblem = "answered after the timeout";
+        if(sProblem.empty() && rstFindCommand(pszCmd) != nCmd)
+            sProblem = "rstFindCommand gives another entry";
+        printf("  %-20s %-16s %6.1f ms %s%s\n", pszCmd, sAnswer.c_str(), dMs, sProblem.empty() ? "ok" : "FAIL : ", sProblem.c_str());
+        if(sProblem.size())
+            nFailed++;
+        if(rstPacingMs(RSTCommands[nCmd].nPacing))
+            std::this_thread::sleep_for(std::chrono::milliseconds(rstPacingMs(RSTCommands[nCmd].nPacing)));
+    }
+    simSerX.close();
+
+    if(nFailed) {
+        printf("FAIL : %d of %d commands\n", nFailed, (int)CMD_COUNT);
+        return 1;
+    }
+    printf("PASS : %d commands\n", (int)CMD_COUNT);
+    return 0;
+}
@@ -0,0 +1,190 @@
+// proxyloadtest : 10 clients polling rstproxyd at 10 Hz.
+//
+// usage : proxyloadtest [-x <rstproxyd binary>] [-c <clients>] [-r <Hz per client>] [-d <seconds>] [-e <max p99 latency ms>]
+//  Starts the proxy on the simulated mount ("rstproxyd -p sim") and has every client poll :GR#, :GD#, :GA# and :Gg#
+//  in turn over its own socket. The test fails when a query goes unanswered, when the 99th percentile latency goes past -e
+//  (200 ms by default) or when the proxy didn't save any wire queries (nothing coalesced or served from its status poll).
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../RST.h"
+#include "../rstproxy.h"
+
+#define LOAD_CLIENTS        10
+#define LOAD_RATE           10      // Hz per client
+#define LOAD_SECONDS        20
+#define LOAD_MAX_P99        200     // ms
+#define LOAD_REPLY_TIMEOUT  2000    // ms
+#define PROXY_START_TIMEOUT 10      // s
+
+typedef std::chrono::steady_clock Clock;
+
+static const char *g_pszCmds[] = {":GR#", ":GD#", ":GA#", ":Gg#"};
+
+typedef struct {
+    std::vector<double> dLatencies;     // ms
+    unsigned long       nMissing;
+} ClientResults;
+
+static bool readReply(RSTProxySerX &Link, std::string &sResp)
+{
+    char cByte;
+    unsigned long nRead;
+
+    sResp.clear();
+    while(true) {
+        if(Link.readFile(&cByte, 1, nRead, LOAD_REPLY_TIMEOUT) || !nRead)
+            return false;
+        sResp += cByte;
+        if(cByte == '#')
+            return true;
+    }
+}
+
+static void clientThread(const std::string sSocket, int nRate, int nSeconds, int nClient, ClientResults *pResults)
+{
+    RSTProxySerX link;
+    std::string sResp;
+    unsigned long nWritten;
+    const char *pszCmd;
+    int nPolls = nRate * nSeconds;
+
+    pResults->nMissing = 0;
+    if(link.open(sSocket.c_str())) {
+        pResults->nMissing = nPolls;
+        return;
+    }
+    Clock::time_point tStart = Clock::now();
+    for(int i = 0; i < nPolls; i++) {
+        std::this_thread::sleep_until(tStart + std::chrono::microseconds(1000000L * i / nRate));
+        pszCmd = g_pszCmds[(i + nClient) % (sizeof(g_pszCmds) / sizeof(g_pszCmds[0]))];
+        Clock::time_point tSend = Clock::now();
+        if(link.writeFile((void *)pszCmd, strlen(pszCmd), nWritten) || !readReply(link, sResp)) {
+            pResults->nMissing++;
+            link.purgeTxRx();
+            continue;
+        }
+        pResults->dLatencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tSend).count() / 1000.0);
+    }
+    link.close();
+}
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    std::string sProxy = "./rstproxyd";
+    std::string sSocket;
+    int nClients = LOAD_CLIENTS;
+    int nRate = LOAD_RATE;
+    int nSeconds = LOAD_SECONDS;
+    double dMaxP99 = LOAD_MAX_P99;
+    int pipeFds[2];
+    pid_t nProxy;
+    RSTProxySerX probe;
+    std::vector<ClientResults> results;
+    std::vector<std::thread> clients;
+    std::vector<double> dLatencies;
+    unsigned long nMissing = 0;
+    unsigned long nRequests = 0, nWire = 0, nCoalesced = 0, nCached = 0;
+    char szLine[256];
+    FILE *pProxyLog;
+    double dP50, dP99, dMax;
+
+    while((nOpt = getopt(argc, argv, "x:c:r:d:e:h")) != -1) {
+        switch(nOpt) {
+            case 'x' :  sProxy = optarg; break;
+            case 'c' :  nClients = std::max(1, atoi(optarg)); break;
+            case 'r' :  nRate = std::max(1, atoi(optarg)); break;
+            case 'd' :  nSeconds = std::max(1, atoi(optarg)); break;
+            case 'e' :  dMaxP99 = atof(optarg); break;
+            default :
+                fprintf(stderr, "usage : %s [-x <rstproxyd binary>] [-c <clients>] [-r <Hz per client>] [-d <seconds>] [-e <max p99 latency ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+    sSocket = "/tmp/rstproxyloadtest." + std::to_string(getpid()) + ".sock";
+
+    // the proxy's stderr comes back through a pipe, its last line has the wire stats
+    if(pipe(pipeFds) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    nProxy = fork();
+    if(nProxy < 0) {
+        perror("fork");
+        return 1;
+    }
+    if(!nProxy) {
+        dup2(pipeFds[1], STDERR_FILENO);
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        execl(sProxy.c_str(), sProxy.c_str(), "-p", "sim", "-s", sSocket.c_str(), (char *)NULL);
+        perror(sProxy.c_str());
+        _exit(1);
+    }
+    close(pipeFds[1]);
+
+    Clock::time_point tLaunch = Clock::now();
+    while(probe.open(sSocket.c_str()) && Clock::now() - tLaunch < std::chrono::seconds(PROXY_START_TIMEOUT))
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    if(!probe.isConnected()) {
+        fprintf(stderr, "rstproxyd didn't come up on %s\n", sSocket.c_str());
+        kill(nProxy, SIGKILL);
+        waitpid(nProxy, NULL, 0);
+        return 1;
+    }
+    probe.close();
+
+    printf("%d clients at %d Hz for %d s through %s\n", nClients, nRate, nSeconds, sProxy.c_str());
+    results.resize(nClients);
+    for(int i = 0; i < nClients; i++)
+        clients.push_back(std::thread(clientThread, sSocket, nRate, nSeconds, i, &results[i]));
+    for(auto &client : clients)
+        client.join();
+
+    kill(nProxy, SIGTERM);
+    pProxyLog = fdopen(pipeFds[0], "r");
+    while(pProxyLog && fgets(szLine, sizeof(szLine), pProxyLog))
+        sscanf(szLine, "requests %lu, wire %lu, coalesced %lu, from last poll %lu", &nRequests, &nWire, &nCoalesced, &nCached);
+    if(pProxyLog)
+        fclose(pProxyLog);
+    waitpid(nProxy, NULL, 0);
+
+    for(auto &result : results) {
+        nMissing += result.nMissing;
+        dLatencies.insert(dLatencies.end(), result.dLatencies.begin(), result.dLatencies.end());
+    }
+    if(dLatencies.empty()) {
+        printf("FAIL : no answers\n");
+        return 1;
+    }
+    std::sort(dLatencies.begin(), dLatencies.end());
+    dP50 = dLatencies[dLatencies.size() / 2];
+    dP99 = dLatencies[std::min(dLatencies.size() - 1, dLatencies.size() * 99 / 100)];
+    dMax = dLatencies.back();
+    printf("%lu answers, %lu missing, latency p50 %.1f ms p99 %.1f ms max %.1f ms\n", (unsigned long)dLatencies.size(), nMissing, dP50, dP99, dMax);
+    printf("proxy : requests %lu, wire %lu, coalesced %lu, from last poll %lu\n", nRequests, nWire, nCoalesced, nCached);
+
+    if(nMissing) {
+        printf("FAIL : %lu queries went unanswered\n", nMissing);
+        return 1;
+    }
+    if(dP99 > dMaxP99) {
+        printf("FAIL : p99 latency %.1f ms is over %.1f ms\n", dP99, dMaxP99);
+        return 1;
+    }
+    if(!nRequests || nWire >= nRequests) {
+        printf("FAIL : the proxy sent every query to the mount\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
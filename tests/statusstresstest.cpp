@@ -0,0 +1,219 @@
+// statusstresstest : readers of the shared memory status never see a torn snapshot under a 1 kHz writer.
+//
+// usage : statusstresstest [-d <seconds per phase>] [-t <reader threads>] [-r <writer Hz>]
+//  Phase 1 : a forked writer publishes at -r Hz (1 kHz by default) snapshots whose fields all come from one counter,
+//  the readers of this process check every copy they get is from a single publish.
+//  Phase 2 : the driver itself is the writer, polling the simulated mount (tools/simserx) for the voltage at -r Hz
+//  while another thread polls the position as fast as the :GR# pacing lets it. A consistent snapshot never has a
+//  group stamped after the publish and the publish stamps never go backwards, a torn copy can.
+//  The test fails on any torn read and when a read fails.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../RST.h"
+#include "../rststatus.h"
+#include "../tools/simserx.h"
+
+#define STRESS_SECONDS      10
+#define STRESS_READERS      4
+#define STRESS_WRITER_RATE  1000    // Hz
+#define WARMUP_MAX_SECONDS  20
+#define OPEN_MAX_SECONDS    5       // for the writer to create the segment
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct {
+    unsigned long   nReads;
+    unsigned long   nTorn;
+    unsigned long   nFailed;
+} ReaderResults;
+
+static void stampSnapshot(RSTStatusSnapshot &Snapshot, uint64_t nCount)
+{
+    Snapshot.dRa = Snapshot.dDec = Snapshot.dAlt = Snapshot.dAz = (double)nCount;
+    Snapshot.dRaRate = Snapshot.dDecRate = Snapshot.dVolts = (double)nCount;
+    Snapshot.nTrackingMode = Snapshot.nPierSide = (int32_t)nCount;
+    Snapshot.nFlags = Snapshot.nReserved = (uint32_t)nCount;
+    Snapshot.nRaDecTime = Snapshot.nAltAzTime = Snapshot.nTrackingTime = nCount;
+    Snapshot.nPierSideTime = Snapshot.nFlagsTime = Snapshot.nVoltageTime = nCount;
+}
+
+static bool isStamped(const RSTStatusSnapshot &Snapshot)
+{
+    uint64_t nCount = Snapshot.nRaDecTime;
+
+    return Snapshot.dRa == (double)nCount && Snapshot.dDec == (double)nCount && Snapshot.dAlt == (double)nCount
+        && Snapshot.dAz == (double)nCount && Snapshot.dRaRate == (double)nCount && Snapshot.dDecRate == (double)nCount
+        && Snapshot.dVolts == (double)nCount && Snapshot.nTrackingMode == (int32_t)nCount && Snapshot.nPierSide == (int32_t)nCount
+        && Snapshot.nFlags == (uint32_t)nCount && Snapshot.nReserved == (uint32_t)nCount && Snapshot.nAltAzTime == nCount
+        && Snapshot.nTrackingTime == nCount && Snapshot.nPierSideTime == nCount && Snapshot.nFlagsTime == nCount
+        && Snapshot.nVoltageTime == nCount;
+}
+
+static bool isConsistent(const RSTStatusSnapshot &Snapshot, uint64_t &nLastPublish)
+{
+    bool bOk = Snapshot.nPublishTime >= nLastPublish;
+
+    bOk = bOk && Snapshot.nRaDecTime <= Snapshot.nPublishTime && Snapshot.nAltAzTime <= Snapshot.nPublishTime;
+    bOk = bOk && Snapshot.nTrackingTime <= Snapshot.nPublishTime && Snapshot.nPierSideTime <= Snapshot.nPublishTime;
+    bOk = bOk && Snapshot.nFlagsTime <= Snapshot.nPublishTime && Snapshot.nVoltageTime <= Snapshot.nPublishTime;
+    nLastPublish = Snapshot.nPublishTime;
+    return bOk;
+}
+
+static void readerThread(const std::string sName, bool bStamped, std::atomic<bool> *pRunning, ReaderResults *pResults)
+{
+    RSTStatusReader reader;
+    RSTStatusSnapshot snapshot;
+    uint64_t nLastPublish = 0;
+
+    memset(pResults, 0, sizeof(ReaderResults));
+    Clock::time_point tOpen = Clock::now();
+    while(reader.open(sName)) {
+        if(Clock::now() - tOpen > std::chrono::seconds(OPEN_MAX_SECONDS)) {
+            pResults->nFailed++;
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    while(*pRunning) {
+        if(reader.read(snapshot)) {
+            pResults->nFailed++;
+            continue;
+        }
+        pResults->nReads++;
+        if(bStamped ? !isStamped(snapshot) : !isConsistent(snapshot, nLastPublish))
+            pResults->nTorn++;
+    }
+}
+
+// runs the readers until *pRunning goes false, returns true when none saw a torn or failed read
+static bool runReaders(const char *pszPhase, const std::string &sName, bool bStamped, int nReaders, std::atomic<bool> &bRunning, std::function<void()> waitForWriter)
+{
+    std::vector<ReaderResults> results(nReaders);
+    std::vector<std::thread> readers;
+    ReaderResults total;
+
+    memset(&total, 0, sizeof(total));
+    for(int i = 0; i < nReaders; i++)
+        readers.push_back(std::thread(readerThread, sName, bStamped, &bRunning, &results[i]));
+    waitForWriter();
+    bRunning = false;
+    for(auto &reader : readers)
+        reader.join();
+    for(auto &result : results) {
+        total.nReads += result.nReads;
+        total.nTorn += result.nTorn;
+        total.nFailed += result.nFailed;
+    }
+    printf("%s : %lu reads, %lu torn, %lu failed\n", pszPhase, total.nReads, total.nTorn, total.nFailed);
+    return total.nReads && !total.nTorn && !total.nFailed;
+}
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    int nSeconds = STRESS_SECONDS;
+    int nReaders = STRESS_READERS;
+    int nRate = STRESS_WRITER_RATE;
+    std::string sName = "/rststresstest." + std::to_string(getpid());
+    std::atomic<bool> bRunning;
+    bool bPass = true;
+    pid_t nWriter;
+    int nStatus;
+
+    while((nOpt = getopt(argc, argv, "d:t:r:h")) != -1) {
+        switch(nOpt) {
+            case 'd' :  nSeconds = std::max(1, atoi(optarg)); break;
+            case 't' :  nReaders = std::max(1, atoi(optarg)); break;
+            case 'r' :  nRate = std::max(1, atoi(optarg)); break;
+            default :
+                fprintf(stderr, "usage : %s [-d <seconds per phase>] [-t <reader threads>] [-r <writer Hz>]\n", argv[0]);
+                return 1;
+        }
+    }
+    printf("%d readers, writer at %d Hz, %d s per phase\n", nReaders, nRate, nSeconds);
+    fflush(stdout);     // the writer process would print it again
+
+    // phase 1 : the readers wait for the writer process to create the segment
+    nWriter = fork();
+    if(nWriter < 0) {
+        perror("fork");
+        return 1;
+    }
+    if(!nWriter) {
+        RSTStatusPublisher writer;
+        RSTStatusSnapshot snapshot;
+        uint64_t nCount = 0;
+        if(writer.open(sName))
+            _exit(1);
+        memset(&snapshot, 0, sizeof(snapshot));
+        Clock::time_point tStart = Clock::now();
+        while(Clock::now() - tStart < std::chrono::seconds(nSeconds)) {
+            stampSnapshot(snapshot, ++nCount);
+            writer.publish(snapshot);
+            std::this_thread::sleep_until(tStart + std::chrono::microseconds(1000000L * nCount / nRate));
+        }
+        printf("phase 1 : %lu publishes\n", (unsigned long)nCount);
+        fflush(stdout);
+        writer.close();
+        _exit(0);
+    }
+    bRunning = true;
+    bPass = runReaders("phase 1", sName, true, nReaders, bRunning, [&]() {
+        waitpid(nWriter, &nStatus, 0);
+    });
+    if(!WIFEXITED(nStatus) || WEXITSTATUS(nStatus)) {
+        printf("phase 1 : the writer failed\n");
+        bPass = false;
+    }
+
+    // phase 2 : the driver polls the simulated mount, every answer publishes
+    RSTSimSerX simSerX(0, 2.0);
+    RST mount;
+    char szPort[] = "sim";
+    double dRa, dDec, dVolts;
+    unsigned long nPolls = 0;
+    unsigned long nPositions = 0;
+    mount.setTransport(&simSerX);
+    mount.setHost(NULL);
+    mount.setStopTrackingOnDisconnect(false);
+    mount.setQueryFreshness(-1);
+    mount.setStatusPublishing(sName);
+    if(mount.Connect(szPort)) {
+        fprintf(stderr, "can't connect to the simulator\n");
+        return 1;
+    }
+    Clock::time_point tConnect = Clock::now();
+    while(!mount.isWarmupDone() && Clock::now() - tConnect < std::chrono::seconds(WARMUP_MAX_SECONDS))
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bRunning = true;
+    bPass = runReaders("phase 2", sName, false, nReaders, bRunning, [&]() {
+        Clock::time_point tStart = Clock::now();
+        std::thread position([&]() {
+            while(Clock::now() - tStart < std::chrono::seconds(nSeconds)) {
+                mount.getRaAndDec(dRa, dDec);
+                nPositions++;
+            }
+        });
+        while(Clock::now() - tStart < std::chrono::seconds(nSeconds)) {
+            mount.getInputVoltage(dVolts);
+            nPolls++;
+            std::this_thread::sleep_until(tStart + std::chrono::microseconds(1000000L * nPolls / nRate));
+        }
+        position.join();
+        printf("phase 2 : %lu voltage and %lu position polls\n", nPolls, nPositions);
+    }) && bPass;
+    mount.Disconnect();
+
+    printf(bPass ? "PASS\n" : "FAIL\n");
+    return bPass ? 0 : 1;
+}
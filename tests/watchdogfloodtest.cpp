@@ -0,0 +1,153 @@
+// watchdogfloodtest : every API call returns within its deadline while the mount floods async notices.
+//
+// usage : watchdogfloodtest [-l <sim link latency ms>]
+//  Runs the same set of status queries and actions on the simulated mount (tools/simserx) with no flood, with an
+//  "MM0#" every 5 ms, with the flood and a :GR# that is never answered, with a "CHO#" every 2 ms, with bytes trickling
+//  in without a '#' and after a caller deadline shorter than a slow answer. The test fails when a call takes longer
+//  than its RSTApiDeadline, when a case didn't trip the watchdog, or when the mount doesn't answer normally after.
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <unistd.h>
+
+#include "../RST.h"
+#include "../tools/simserx.h"
+
+#define CALLER_DEADLINE     1000    // ms, for the short caller deadline case
+#define SLOW_ANSWER         1500    // ms
+
+typedef std::chrono::steady_clock Clock;
+
+static int g_nOverDeadline = 0;
+
+static int timedCall(const char *pszName, int nDeadlineMs, std::function<int()> fCall)
+{
+    Clock::time_point tCall = Clock::now();
+    int nErr = fCall();
+    double dMs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tCall).count() / 1000.0;
+
+    printf("  %-18s err %4d %8.1f ms (deadline %d ms)%s\n", pszName, nErr, dMs, nDeadlineMs, dMs > nDeadlineMs ? " OVER" : "");
+    if(dMs > nDeadlineMs)
+        g_nOverDeadline++;
+    return nErr;
+}
+
+// the calls TheSkyX makes the most, returns the getRaAndDec error
+static int runCalls(RST &Mount)
+{
+    double dRa = 0.0, dDec = 0.0, dVolts;
+    bool bFlag;
+    int nErr;
+
+    nErr = timedCall("getRaAndDec", WATCHDOG_QUERY_DEADLINE, [&]() { return Mount.getRaAndDec(dRa, dDec); });
+    timedCall("isTrackingOn", WATCHDOG_QUERY_DEADLINE, [&]() { return Mount.isTrackingOn(bFlag); });
+    timedCall("getInputVoltage", WATCHDOG_QUERY_DEADLINE, [&]() { return Mount.getInputVoltage(dVolts); });
+    timedCall("IsBeyondThePole", WATCHDOG_QUERY_DEADLINE, [&]() { return Mount.IsBeyondThePole(bFlag); });
+    timedCall("startSlewTo", WATCHDOG_ACTION_DEADLINE, [&]() { return Mount.startSlewTo(dRa + 0.1, dDec); });
+    timedCall("isSlewToComplete", WATCHDOG_QUERY_DEADLINE, [&]() { return Mount.isSlewToComplete(bFlag); });
+    timedCall("Abort", WATCHDOG_ACTION_DEADLINE, [&]() { return Mount.Abort(); });
+    return nErr;
+}
+
+static unsigned long watchdogEvents(RST &Mount, int nEvent)
+{
+    unsigned long nEvents[WATCHDOG_EVENT_COUNT];
+    unsigned long nRecovered;
+    double dTotalMs, dMaxMs;
+
+    Mount.getWatchdogStats(nEvents, nRecovered, dTotalMs, dMaxMs);
+    printf("  watchdog : API deadline %lu, stalled %lu, notice flood %lu, re-synced %lu, recovery max %.1f ms\n",
+           nEvents[WATCHDOG_API_DEADLINE], nEvents[WATCHDOG_STALLED], nEvents[WATCHDOG_NOTICE_FLOOD], nRecovered, dMaxMs);
+    return nEvents[nEvent];
+}
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    int nLatency = 20;
+    char szPort[] = "sim";
+    double dRa, dDec;
+    bool bPass = true;
+
+    while((nOpt = getopt(argc, argv, "l:h")) != -1) {
+        switch(nOpt) {
+            case 'l' :  nLatency = std::max(0, atoi(optarg)); break;
+            default :
+                fprintf(stderr, "usage : %s [-l <sim link latency ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    RSTSimSerX simSerX(nLatency, 1.0);
+    RST mount;
+    mount.setTransport(&simSerX);
+    mount.setHost(NULL);
+    mount.setStopTrackingOnDisconnect(false);
+    if(mount.Connect(szPort)) {
+        fprintf(stderr, "can't connect to the simulator\n");
+        return 1;
+    }
+
+    printf("no flood\n");
+    if(runCalls(mount)) {
+        printf("FAIL : the mount doesn't answer without a flood\n");
+        bPass = false;
+    }
+    watchdogEvents(mount, WATCHDOG_NOTICE_FLOOD);
+
+    printf("MM0# every 5 ms, the answers still come\n");
+    simSerX.setNoticeFlood("MM0#", 5);
+    runCalls(mount);
+    watchdogEvents(mount, WATCHDOG_NOTICE_FLOOD);
+
+    printf("MM0# every 5 ms, :GR# never answered\n");
+    simSerX.setCommandDelay(":GR#", -1);
+    runCalls(mount);
+    if(!watchdogEvents(mount, WATCHDOG_NOTICE_FLOOD)) {
+        printf("FAIL : the flood didn't trip the watchdog\n");
+        bPass = false;
+    }
+
+    printf("CHO# every 2 ms, :GR# never answered\n");
+    simSerX.setNoticeFlood("CHO#", 2);
+    runCalls(mount);
+    watchdogEvents(mount, WATCHDOG_NOTICE_FLOOD);
+    simSerX.setCommandDelay(":GR#", 0);
+
+    printf("bytes trickling in without a '#' every 25 ms\n");
+    simSerX.setNoticeFlood("x", 25);
+    runCalls(mount);
+    if(!watchdogEvents(mount, WATCHDOG_STALLED)) {
+        printf("FAIL : the stalled reads didn't trip the watchdog\n");
+        bPass = false;
+    }
+    simSerX.setNoticeFlood("", 0);
+
+    printf("caller deadline %d ms, :GR# answered after %d ms\n", CALLER_DEADLINE, SLOW_ANSWER);
+    simSerX.setCommandDelay(":GR#", SLOW_ANSWER);
+    timedCall("getRaAndDec", CALLER_DEADLINE, [&]() {
+        RSTApiDeadline callerDeadline(CALLER_DEADLINE);
+        return mount.getRaAndDec(dRa, dDec);
+    });
+    if(!watchdogEvents(mount, WATCHDOG_API_DEADLINE)) {
+        printf("FAIL : the caller deadline didn't trip the watchdog\n");
+        bPass = false;
+    }
+    simSerX.setCommandDelay(":GR#", 0);
+
+    printf("flood over\n");
+    if(runCalls(mount)) {
+        printf("FAIL : the mount doesn't answer after the flood\n");
+        bPass = false;
+    }
+    watchdogEvents(mount, WATCHDOG_NOTICE_FLOOD);
+    mount.Disconnect();
+
+    if(g_nOverDeadline) {
+        printf("FAIL : %d calls went past their deadline\n", g_nOverDeadline);
+        bPass = false;
+    }
+    printf(bPass ? "PASS\n" : "FAIL\n");
+    return bPass ? 0 : 1;
+}
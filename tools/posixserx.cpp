@@ -0,0 +1,255 @@
+#include "posixserx.h"
+
+#include <cstring>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+
+
+#if defined(MSG_NOSIGNAL)
+#define SERX_SEND_FLAGS    MSG_NOSIGNAL
+#else
+#define SERX_SEND_FLAGS    0
+#endif
+
+PosixSerX::PosixSerX()
+{
+    m_nFd = -1;
+    m_bIsSocket = false;
+}
+
+PosixSerX::~PosixSerX()
+{
+    close();
+}
+
+int PosixSerX::open(const char* pszPort, const unsigned long& /*dwBaudRate*/, const char* /*pszSession*/)
+{
+    std::string sPort;
+    size_t nColon;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nFd >= 0) {
+        ::close(m_nFd);
+        m_nFd = -1;
+    }
+    if(!pszPort)
+        return ERR_COMMNOLINK;
+
+    sPort.assign(pszPort);
+    nColon = sPort.rfind(':');
+    if(sPort.size() && sPort[0] != '/' && nColon != std::string::npos)
+        return openTcp(sPort.substr(0, nColon), sPort.substr(nColon + 1));
+    // the RST only talks 115200 8N1, whatever we're told
+    return openSerial(sPort, 115200);
+}
+
+int PosixSerX::openSerial(const std::string &sDevice, unsigned long /*nBaudRate*/)
+{
+    struct termios tio;
+
+    m_nFd = ::open(sDevice.c_str(), O_RDWR | O_NOCTTY);
+    if(m_nFd < 0)
+        return ERR_COMMNOLINK;
+
+    if(tcgetattr(m_nFd, &tio) < 0) {
+        ::close(m_nFd);
+        m_nFd = -1;
+        return ERR_COMMNOLINK;
+    }
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tio.c_cflag |= (CLOCAL | CREAD);
+    tio.c_cflag &= ~(PARENB | CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if(tcsetattr(m_nFd, TCSANOW, &tio) < 0) {
+        ::close(m_nFd);
+        m_nFd = -1;
+        return ERR_COMMNOLINK;
+    }
+    tcflush(m_nFd, TCIOFLUSH);
+    m_bIsSocket = false;
+    return SB_OK;
+}
+
+int PosixSerX::openTcp(const std::string &sHost, const std::string &sPort)
+{
+    struct addrinfo hints;
+    struct addrinfo *pResult = NULL;
+    struct addrinfo *pAddr;
+    int nOn = 1;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if(getaddrinfo(sHost.c_str(), sPort.c_str(), &hints, &pResult))
+        return ERR_COMMNOLINK;
+
+    for(pAddr = pResult; pAddr; pAddr = pAddr->ai_next) {
+        m_nFd = socket(pAddr->ai_family, pAddr->ai_socktype, pAddr->ai_protocol);
+        if(m_nFd < 0)
+            continue;
+        if(connect(m_nFd, pAddr->ai_addr, pAddr->ai_addrlen) == 0)
+            break;
+        ::close(m_nFd);
+        m_nFd = -1;
+    }
+    freeaddrinfo(pResult);
+    if(m_nFd < 0)
+        return ERR_COMMNOLINK;
+
+    // short commands, we want them out now
+    setsockopt(m_nFd, IPPROTO_TCP, TCP_NODELAY, &nOn, sizeof(nOn));
+#if defined(SO_NOSIGPIPE)
+    setsockopt(m_nFd, SOL_SOCKET, SO_NOSIGPIPE, &nOn, sizeof(nOn));
+#endif
+    m_bIsSocket = true;
+    return SB_OK;
+}
+
+int PosixSerX::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nFd >= 0)
+        ::close(m_nFd);
+    m_nFd = -1;
+    return SB_OK;
+}
+
+bool PosixSerX::isConnected() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_nFd >= 0;
+}
+
+int PosixSerX::flushTx()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nFd >= 0 && !m_bIsSocket)
+        tcdrain(m_nFd);
+    return SB_OK;
+}
+
+int PosixSerX::purgeTxRx()
+{
+    char pszBuf[256];
+    ssize_t nRead;
+    int nWaiting = 0;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(m_nFd < 0)
+        return ERR_NOLINK;
+
+    if(!m_bIsSocket) {
+        tcflush(m_nFd, TCIOFLUSH);
+        return SB_OK;
+    }
+    while(ioctl(m_nFd, FIONREAD, &nWaiting) == 0 && nWaiting > 0) {
+        nRead = ::read(m_nFd, pszBuf, std::min<int>(nWaiting, sizeof(pszBuf)));
+        if(nRead <= 0)
+            break;
+    }
+    return SB_OK;
+}
+
+int PosixSerX::waitForBytesRx(const int& nNumber, const int& nTimeOutMilli)
+{
+    int nBytesWaiting = 0;
+    int nWaited = 0;
+
+    while(true) {
+        if(bytesWaitingRx(nBytesWaiting))
+            return ERR_NOLINK;
+        if(nBytesWaiting >= nNumber)
+            return SB_OK;
+        if(nWaited >= nTimeOutMilli)
+            return ERR_RXTIMEOUT;
+        usleep(10000);
+        nWaited += 10;
+    }
+}
+
+int PosixSerX::readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut)
+{
+    struct pollfd pfd;
+    ssize_t nRead;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    lpNumberOfBytesRead = 0;
+    if(m_nFd < 0)
+        return ERR_NOLINK;
+
+    while(lpNumberOfBytesRead < dwNumberOfBytesToRead) {
+        pfd.fd = m_nFd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd, 1, (int)dwTimeOut) <= 0)
+            break;
+        nRead = ::read(m_nFd, (char *)lpBuffer + lpNumberOfBytesRead, dwNumberOfBytesToRead - lpNumberOfBytesRead);
+        if(nRead < 0 && errno == EINTR)
+            continue;
+        if(nRead <= 0) {
+            // a closed socket is gone for good, a serial port just had nothing
+            if(m_bIsSocket) {
+                ::close(m_nFd);
+                m_nFd = -1;
+                return ERR_NOLINK;
+            }
+            break;
+        }
+        lpNumberOfBytesRead += nRead;
+    }
+    return SB_OK;
+}
+
+int PosixSerX::writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten)
+{
+    ssize_t nWritten;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    lpNumberOfBytesWritten = 0;
+    if(m_nFd < 0)
+        return ERR_NOLINK;
+
+    while(lpNumberOfBytesWritten < dwNumberOfBytesToWrite) {
+        if(m_bIsSocket)
+            nWritten = send(m_nFd, (char *)lpBuffer + lpNumberOfBytesWritten, dwNumberOfBytesToWrite - lpNumberOfBytesWritten, SERX_SEND_FLAGS);
+        else
+            nWritten = ::write(m_nFd, (char *)lpBuffer + lpNumberOfBytesWritten, dwNumberOfBytesToWrite - lpNumberOfBytesWritten);
+        if(nWritten < 0) {
+            if(errno == EINTR || errno == EAGAIN)
+                continue;
+            if(m_bIsSocket) {
+                ::close(m_nFd);
+                m_nFd = -1;
+            }
+            return ERR_NOLINK;
+        }
+        lpNumberOfBytesWritten += nWritten;
+    }
+    return SB_OK;
+}
+
+int PosixSerX::bytesWaitingRx(int &nBytesWaitingRx)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    nBytesWaitingRx = 0;
+    if(m_nFd < 0)
+        return ERR_NOLINK;
+    if(ioctl(m_nFd, FIONREAD, &nBytesWaitingRx) < 0)
+        return ERR_NOLINK;
+    return SB_OK;
+}
@@ -0,0 +1,39 @@
+#ifndef __POSIX_SERX__
+#define __POSIX_SERX__
+
+#pragma once
+
+#include <string>
+#include <mutex>
+
+#include "../rsttransport.h"
+
+// RST link for the command line tools, outside of TheSkyX.
+// The port is either a serial device (/dev/ttyUSB0, 115200 8N1) or host:port for the RST WiFi bridge.
+class PosixSerX : public RSTTransport
+{
+public:
+    PosixSerX();
+    virtual ~PosixSerX();
+
+    virtual int open(const char* pszPort, const unsigned long& dwBaudRate = 9600, const char* pszSession = 0);
+    virtual int close();
+    virtual bool isConnected() const;
+
+    virtual int flushTx();
+    virtual int purgeTxRx();
+    virtual int waitForBytesRx(const int& nNumber, const int& nTimeOutMilli);
+    virtual int readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut = 1000);
+    virtual int writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten);
+    virtual int bytesWaitingRx(int &nBytesWaitingRx);
+
+private:
+    int     openSerial(const std::string &sDevice, unsigned long nBaudRate);
+    int     openTcp(const std::string &sHost, const std::string &sPort);
+
+    int     m_nFd;
+    bool    m_bIsSocket;
+    mutable std::mutex m_Mutex;
+};
+
+#endif // __POSIX_SERX__
@@ -0,0 +1,335 @@
+// rstbench : scripted workloads against one mount through the headless RST core (librstcore.a), outside of TheSkyX.
+//
+// usage : rstbench [-p <port>] [-w poll|goto|park|all] [-d <poll seconds>] [-t <poll threads>] [-n <gotos, park cycles>]
+//                  [-r <seed>] [-f <query freshness ms>] [-l <sim link latency ms>] [-s <sim slew seconds>]
+//  <port> is "sim" (the default, the simulated mount of tools/simserx), a serial device (/dev/ttyUSB0) or host:port
+//  for the RST WiFi bridge.
+//  poll : -t threads call the status queries TheSkyX polls back to back for -d seconds.
+//  goto : -n gotos to targets drawn with the seed -r within 3 h of the current RA, each polled to completion
+//         every GOTO_POLL_INTERVAL ms like TheSkyX does.
+//  park : -n park / unpark cycles, polled to completion.
+//  For every operation : calls, calls per second, latency p50/p90/p99/max, round trips (writes to the link) per call
+//  and errors. Only the calling thread's writes count, the warm-up and telemetry threads' don't.
+//  A real mount moves for goto and park.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <memory>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "../RST.h"
+#include "posixserx.h"
+#include "simserx.h"
+
+#define GOTO_POLL_INTERVAL  500     // ms
+#define GOTO_MAX_SECONDS    300
+#define WARMUP_MAX_SECONDS  20
+#define CONNECT_TARGET_MS   300     // over USB
+
+typedef std::chrono::steady_clock Clock;
+
+// counts the writes of each thread, a write is one command (or one burst) and its answers
+class CountingTransport : public RSTTransport
+{
+public:
+    CountingTransport(RSTTransport *pLink) : m_pLink(pLink) {}
+
+    virtual int open(const char* pszPort, const unsigned long& dwBaudRate = 9600, const char* pszSession = 0) { return m_pLink->open(pszPort, dwBaudRate, pszSession); }
+    virtual int close() { return m_pLink->close(); }
+    virtual bool isConnected() const { return m_pLink->isConnected(); }
+
+    virtual int flushTx() { return m_pLink->flushTx(); }
+    virtual int purgeTxRx() { return m_pLink->purgeTxRx(); }
+    virtual int readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut = 500)
+        { return m_pLink->readFile(lpBuffer, dwNumberOfBytesToRead, lpNumberOfBytesRead, dwTimeOut); }
+    virtual int writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten)
+        { s_nWrites++; m_nTotalWrites++; return m_pLink->writeFile(lpBuffer, dwNumberOfBytesToWrite, lpNumberOfBytesWritten); }
+    virtual int bytesWaitingRx(int &nBytesWaitingRx) { return m_pLink->bytesWaitingRx(nBytesWaitingRx); }
+
+    static unsigned long threadWrites() { return s_nWrites; }
+    unsigned long totalWrites() const { return m_nTotalWrites; }
+
+private:
+    RSTTransport                        *m_pLink;
+    std::atomic<unsigned long>          m_nTotalWrites{0};
+    static thread_local unsigned long   s_nWrites;
+};
+
+thread_local unsigned long CountingTransport::s_nWrites = 0;
+
+typedef struct {
+    std::vector<double> vLatencyMs;
+    unsigned long       nWrites;
+    unsigned long       nErrors;
+} BenchOp;
+
+class BenchResults
+{
+public:
+    void add(const std::string &sName, double dLatencyMs, unsigned long nWrites, int nErr)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        BenchOp &Op = m_Ops[sName];
+        if(Op.vLatencyMs.empty()) {
+            Op.nWrites = 0;
+            Op.nErrors = 0;
+            m_vOrder.push_back(sName);
+        }
+        Op.vLatencyMs.push_back(dLatencyMs);
+        Op.nWrites += nWrites;
+        if(nErr)
+            Op.nErrors++;
+    }
+    void print(const char *pszTitle, double dSeconds);
+
+private:
+    std::mutex                      m_Mutex;
+    std::map<std::string, BenchOp>  m_Ops;
+    std::vector<std::string>        m_vOrder;
+};
+
+static double msSince(Clock::time_point tStart)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tStart).count() / 1000.0;
+}
+
+static double percentile(std::vector<double> v, double dPct)
+{
+    if(v.empty())
+        return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(dPct / 100.0 * v.size()))];
+}
+
+void BenchResults::print(const char *pszTitle, double dSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    printf("\n%s, %.1f s\n", pszTitle, dSeconds);
+    printf("%-22s %7s %9s %9s %9s %9s %9s %7s %6s\n", "operation", "calls", "calls/s", "p50 ms", "p90 ms", "p99 ms", "max ms", "trips", "errors");
+    for(size_t i = 0; i < m_vOrder.size(); i++) {
+        const BenchOp &Op = m_Ops[m_vOrder[i]];
+        printf("%-22s %7zu %9.1f %9.1f %9.1f %9.1f %9.1f %7.2f %6lu\n", m_vOrder[i].c_str(), Op.vLatencyMs.size(),
+               dSeconds > 0.0 ? Op.vLatencyMs.size() / dSeconds : 0.0,
+               percentile(Op.vLatencyMs, 50), percentile(Op.vLatencyMs, 90), percentile(Op.vLatencyMs, 99), percentile(Op.vLatencyMs, 100),
+               double(Op.nWrites) / Op.vLatencyMs.size(), Op.nErrors);
+    }
+}
+
+static int timeCall(BenchResults &Results, const char *pszName, std::function<int()> fCall)
+{
+    unsigned long nWrites = CountingTransport::threadWrites();
+    Clock::time_point tStart = Clock::now();
+    int nErr;
+
+    nErr = fCall();
+    Results.add(pszName, msSince(tStart), CountingTransport::threadWrites() - nWrites, nErr);
+    return nErr;
+}
+
+// what TheSkyX keeps asking, from as many threads as it has windows open
+static void runPollStorm(RST &mount, int nThreads, int nSeconds)
+{
+    BenchResults Results;
+    std::atomic<bool> bRunning(true);
+    std::vector<std::thread> vThreads;
+    Clock::time_point tStart = Clock::now();
+
+    for(int i = 0; i < nThreads; i++) {
+        vThreads.push_back(std::thread([&]() {
+            double dRa, dDec, dAlt, dAz;
+            bool bFlag;
+            while(bRunning) {
+                timeCall(Results, "getRaAndDec", [&]() { return mount.getRaAndDec(dRa, dDec); });
+                timeCall(Results, "getAltAndAz", [&]() { return mount.getAltAndAz(dAlt, dAz); });
+                timeCall(Results, "isTrackingOn", [&]() { return mount.isTrackingOn(bFlag); });
+                timeCall(Results, "getTrackRates", [&]() { return mount.getTrackRates(bFlag, dRa, dDec); });
+                timeCall(Results, "isSlewToComplete", [&]() { return mount.isSlewToComplete(bFlag); });
+                timeCall(Results, "IsBeyondThePole", [&]() { return mount.IsBeyondThePole(bFlag); });
+                timeCall(Results, "getAtPark", [&]() { return mount.getAtPark(bFlag); });
+            }
+        }));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(nSeconds));
+    bRunning = false;
+    for(size_t i = 0; i < vThreads.size(); i++)
+        vThreads[i].join();
+
+    char szTitle[64];
+    snprintf(szTitle, sizeof(szTitle), "poll storm, %d threads", nThreads);
+    Results.print(szTitle, msSince(tStart) / 1000.0);
+}
+
+// poll a start to its completion, the whole thing is one more operation
+static int pollToComplete(BenchResults &Results, const char *pszName, const char *pszPollName, std::function<int(bool &)> fPoll, Clock::time_point tStart, unsigned long nStartWrites)
+{
+    bool bComplete = false;
+    int nErr = PLUGIN_OK;
+
+    while(!bComplete && msSince(tStart) < GOTO_MAX_SECONDS * 1000.0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(GOTO_POLL_INTERVAL));
+        nErr = timeCall(Results, pszPollName, [&]() { return fPoll(bComplete); });
+        if(nErr)
+            break;
+    }
+    if(!bComplete && !nErr)
+        nErr = ERR_RXTIMEOUT;
+    Results.add(pszName, msSince(tStart), CountingTransport::threadWrites() - nStartWrites, nErr);
+    return nErr;
+}
+
+static void runGotos(RST &mount, int nGotos, unsigned int nSeed)
+{
+    BenchResults Results;
+    std::mt19937 Random(nSeed);
+    std::uniform_real_distribution<double> RaOffset(-3.0, 3.0);
+    std::uniform_real_distribution<double> Dec(0.0, 70.0);
+    Clock::time_point tRun = Clock::now();
+    Clock::time_point tStart;
+    unsigned long nWrites;
+    double dRa0, dDec0;
+    double dRa, dDec;
+    int nErr;
+
+    if(mount.getRaAndDec(dRa0, dDec0)) {
+        fprintf(stderr, "can't read the mount position\n");
+        return;
+    }
+    for(int i = 0; i < nGotos; i++) {
+        dRa = fmod(dRa0 + RaOffset(Random) + 24.0, 24.0);
+        dDec = Dec(Random);
+        nWrites = CountingTransport::threadWrites();
+        tStart = Clock::now();
+        nErr = timeCall(Results, "startSlewTo", [&]() { return mount.startSlewTo(dRa, dDec); });
+        if(nErr) {
+            fprintf(stderr, "goto %d to %.3f h %.2f deg refused : %d\n", i, dRa, dDec, nErr);
+            continue;
+        }
+        if(pollToComplete(Results, "goto (to complete)", "isSlewToComplete", [&](bool &bComplete) { return mount.isSlewToComplete(bComplete); }, tStart, nWrites))
+            mount.Abort();
+    }
+    Results.print("goto sequence", msSince(tRun) / 1000.0);
+}
+
+static void runParkCycles(RST &mount, int nCycles)
+{
+    BenchResults Results;
+    Clock::time_point tRun = Clock::now();
+    Clock::time_point tStart;
+    unsigned long nWrites;
+    int nErr;
+
+    for(int i = 0; i < nCycles; i++) {
+        nWrites = CountingTransport::threadWrites();
+        tStart = Clock::now();
+        nErr = timeCall(Results, "gotoParkPosition", [&]() { return mount.gotoParkPosition(); });
+        if(!nErr)
+            nErr = pollToComplete(Results, "park (to complete)", "isSlewToComplete", [&](bool &bComplete) { return mount.isSlewToComplete(bComplete); }, tStart, nWrites);
+        if(nErr) {
+            fprintf(stderr, "park %d failed : %d\n", i, nErr);
+            mount.Abort();
+            break;
+        }
+        mount.setMountIsParked(true);
+
+        nWrites = CountingTransport::threadWrites();
+        tStart = Clock::now();
+        nErr = timeCall(Results, "unPark", [&]() { return mount.unPark(); });
+        if(!nErr)
+            nErr = pollToComplete(Results, "unpark (to complete)", "isUnparkDone", [&](bool &bComplete) { return mount.isUnparkDone(bComplete); }, tStart, nWrites);
+        mount.setMountIsParked(false);
+        if(nErr) {
+            fprintf(stderr, "unpark %d failed : %d\n", i, nErr);
+            break;
+        }
+    }
+    Results.print("park / unpark cycles", msSince(tRun) / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+    std::string sPort = "sim";
+    std::string sWorkload = "all";
+    int nSeconds = 10;
+    int nThreads = 4;
+    int nCount = 5;
+    unsigned int nSeed = 1;
+    int nFreshness = QUERY_FRESHNESS_DEFAULT;
+    int nLatency = 20;
+    double dSlewSeconds = 3.0;
+    std::unique_ptr<RSTTransport> pLink;
+    char szPort[256];
+    int nErr;
+
+    while((nOpt = getopt(argc, argv, "p:w:d:t:n:r:f:l:s:h")) != -1) {
+        switch(nOpt) {
+            case 'p' :  sPort = optarg; break;
+            case 'w' :  sWorkload = optarg; break;
+            case 'd' :  nSeconds = std::max(1, atoi(optarg)); break;
+            case 't' :  nThreads = std::max(1, atoi(optarg)); break;
+            case 'n' :  nCount = std::max(1, atoi(optarg)); break;
+            case 'r' :  nSeed = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'f' :  nFreshness = atoi(optarg); break;
+            case 'l' :  nLatency = std::max(0, atoi(optarg)); break;
+            case 's' :  dSlewSeconds = atof(optarg); break;
+            default :
+                fprintf(stderr, "usage : %s [-p sim|<serial device>|<host:port>] [-w poll|goto|park|all] [-d <poll seconds>] [-t <poll threads>]\n"
+                                "        [-n <gotos, park cycles>] [-r <seed>] [-f <query freshness ms, -1 : off>] [-l <sim latency ms>] [-s <sim slew seconds>]\n", argv[0]);
+                return 1;
+        }
+    }
+    if(sWorkload != "poll" && sWorkload != "goto" && sWorkload != "park" && sWorkload != "all") {
+        fprintf(stderr, "unknown workload '%s'\n", sWorkload.c_str());
+        return 1;
+    }
+
+    if(sPort == "sim")
+        pLink.reset(new RSTSimSerX(nLatency, dSlewSeconds));
+    else
+        pLink.reset(new PosixSerX());
+    CountingTransport Link(pLink.get());
+
+    RST mount;
+    BenchResults Connect;
+    mount.setTransport(&Link);
+    mount.setHost(NULL);                        // no site, no time sync
+    mount.setStopTrackingOnDisconnect(false);
+    mount.setQueryFreshness(nFreshness);
+    snprintf(szPort, sizeof(szPort), "%s", sPort.c_str());
+    Clock::time_point tConnect = Clock::now();
+    nErr = timeCall(Connect, "Connect", [&]() { return mount.Connect(szPort); });
+    if(nErr) {
+        fprintf(stderr, "can't connect to %s : %d\n", szPort, nErr);
+        return 1;
+    }
+    // keep the warm-up queries out of the measurements
+    while(!mount.isWarmupDone() && msSince(tConnect) < WARMUP_MAX_SECONDS * 1000.0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Connect.print(("connect to " + sPort + " and warm-up").c_str(), msSince(tConnect) / 1000.0);
+    // what the driver measured itself, the USB target is CONNECT_TARGET_MS
+    printf("Connect as the driver timed it : %.1f ms (target %d ms)\n", mount.getLastConnectTime() * 1000.0, CONNECT_TARGET_MS);
+
+    if(sWorkload == "poll" || sWorkload == "all")
+        runPollStorm(mount, nThreads, nSeconds);
+    if(sWorkload == "goto" || sWorkload == "all")
+        runGotos(mount, nCount, nSeed);
+    if(sWorkload == "park" || sWorkload == "all")
+        runParkCycles(mount, nCount);
+
+    unsigned long nSent, nShared;
+    mount.getQuerySharingStats(nSent, nShared);
+    printf("\nlink : %lu writes in total, status queries %lu sent, %lu shared\n", Link.totalWrites(), nSent, nShared);
+    mount.Disconnect();
+    return 0;
+}
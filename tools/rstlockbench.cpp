@@ -0,0 +1,168 @@
+// rstlockbench : how long the X2 calls wait on each other while TheSkyX polls, one coarse X2 lock vs the split locks,
+// and how many queries reach the wire with and without the status query sharing.
+//
+// usage : rstlockbench [-d <seconds per mode>] [-l <link latency ms>] [-S <slow query delay ms>] [-f <query freshness ms>]
+//  The pollers mimic TheSkyX : position (from two windows), slew state, tracking, park and pier side polls from their
+//  own threads, a tracking change every few seconds and an abort now and then. The pier side query (:CY#) is made slow
+//  (-S) to play a WiFi link that stalls. In "coarse" mode every call takes one process wide mutex, like the
+//  X2 layer used to, in "split" mode the calls use the same locking as x2mount.cpp does now. Both run without
+//  query sharing, the last run is "split" again with identical queries sharing one answer (-f).
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "../RST.h"
+#include "simserx.h"
+
+typedef std::chrono::steady_clock Clock;
+
+typedef struct {
+    const char          *pszName;
+    int                 nPeriodMs;
+    bool                bLocked;        // takes the X2 lock in split mode too
+    std::function<int(RST &)>   fCall;
+    std::vector<double> vLockWaitMs;
+    std::vector<double> vLatencyMs;
+} BenchApi;
+
+static double msSince(Clock::time_point tStart)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tStart).count() / 1000.0;
+}
+
+static double percentile(std::vector<double> v, double dPct)
+{
+    if(v.empty())
+        return 0.0;
+    std::sort(v.begin(), v.end());
+    return v[std::min(v.size() - 1, (size_t)(dPct / 100.0 * v.size()))];
+}
+
+static void runMode(bool bCoarse, int nFreshness, int nSeconds, int nLatency, int nSlowDelay)
+{
+    RSTSimSerX simSerX(nLatency, 2.0);
+    RST mount;
+    std::mutex x2Mutex;
+    std::atomic<bool> bRunning(true);
+    std::vector<std::thread> vThreads;
+    std::vector<double> vAbortWireMs;
+    std::mutex abortMutex;
+    char szPort[] = "sim";
+    unsigned long nLocks, nContended;
+    double dTotalWaitMs, dMaxWaitMs;
+    unsigned long nCommands;
+    unsigned long nSent, nShared;
+    size_t i;
+
+    std::vector<BenchApi> vApis = {
+        {"raDec",            250,  false, [](RST &m) { double dRa, dDec; return m.getRaAndDec(dRa, dDec); }, {}, {}},
+        {"raDec (2nd view)", 300,  false, [](RST &m) { double dRa, dDec; return m.getRaAndDec(dRa, dDec); }, {}, {}},
+        {"raDec (cached)",   100,  false, [](RST &m) { RSTStatusSnapshot s; m.getStatusSnapshot(s); return 0; }, {}, {}},
+        {"isCompleteSlewTo", 500,  false, [](RST &m) { bool bDone; return m.isSlewToComplete(bDone); }, {}, {}},
+        {"trackingRates",    1000, false, [](RST &m) { bool bOn; double dRa, dDec; return m.getTrackRates(bOn, dRa, dDec); }, {}, {}},
+        {"beyondThePole",    2000, false, [](RST &m) { bool bYes; return m.IsBeyondThePole(bYes); }, {}, {}},
+        {"atPark",           1000, false, [](RST &m) { bool bParked; return m.getAtPark(bParked); }, {}, {}},
+        {"setTrackingRates", 3000, true,  [](RST &m) { return m.setTrackingRates(true, true, 0.0, 0.0); }, {}, {}},
+        {"abort",            1700, false, [](RST &m) { return m.Abort(); }, {}, {}},
+    };
+
+    mount.setTransport(&simSerX);
+    mount.setHost(NULL);
+    mount.setStopTrackingOnDisconnect(false);
+    mount.setQueryFreshness(nFreshness);
+    if(mount.Connect(szPort)) {
+        fprintf(stderr, "can't connect the simulated mount\n");
+        return;
+    }
+    simSerX.setCommandDelay(":CY#", nSlowDelay);
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));   // let the warm-up finish
+    nCommands = simSerX.getCommandCount();
+
+    for(i = 0; i < vApis.size(); i++) {
+        vThreads.push_back(std::thread([&, i]() {
+            BenchApi &api = vApis[i];
+            bool bAbort = (std::string(api.pszName) == "abort");
+            Clock::time_point tStart;
+            Clock::time_point tWrite;
+            double dWait;
+
+            while(bRunning) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(api.nPeriodMs));
+                if(bAbort)
+                    simSerX.resetCommandTime(":Q#");
+                tStart = Clock::now();
+                if(bCoarse || api.bLocked) {
+                    std::lock_guard<std::mutex> lock(x2Mutex);
+                    dWait = msSince(tStart);
+                    api.fCall(mount);
+                }
+                else {
+                    dWait = 0.0;
+                    api.fCall(mount);
+                }
+                api.vLatencyMs.push_back(msSince(tStart));
+                api.vLockWaitMs.push_back(dWait);
+                if(bAbort && simSerX.getCommandTime(":Q#", tWrite)) {
+                    std::lock_guard<std::mutex> lock(abortMutex);
+                    vAbortWireMs.push_back(std::chrono::duration_cast<std::chrono::microseconds>(tWrite - tStart).count() / 1000.0);
+                }
+            }
+        }));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(nSeconds));
+    bRunning = false;
+    for(i = 0; i < vThreads.size(); i++)
+        vThreads[i].join();
+    mount.getWireLockStats(nLocks, nContended, dTotalWaitMs, dMaxWaitMs);
+    mount.getQuerySharingStats(nSent, nShared);
+    nCommands = simSerX.getCommandCount() - nCommands;
+    mount.Disconnect();
+
+    printf("\n%s X2 lock, %d s, %d ms link, :CY# %d ms slower, ", bCoarse?"coarse":"split", nSeconds, nLatency, nSlowDelay);
+    if(nFreshness == QUERY_SHARING_OFF)
+        printf("no query sharing\n");
+    else
+        printf("query sharing, %d ms fresh\n", nFreshness);
+    printf("%-18s %6s %14s %14s %14s %14s\n", "call", "calls", "X2 wait p50", "X2 wait p99", "latency p50", "latency p99");
+    for(i = 0; i < vApis.size(); i++)
+        printf("%-18s %6zu %11.1f ms %11.1f ms %11.1f ms %11.1f ms\n", vApis[i].pszName, vApis[i].vLatencyMs.size(),
+               percentile(vApis[i].vLockWaitMs, 50), percentile(vApis[i].vLockWaitMs, 99),
+               percentile(vApis[i].vLatencyMs, 50), percentile(vApis[i].vLatencyMs, 99));
+    printf("abort -> :Q# on the wire : p50 %.1f ms, p99 %.1f ms, max %.1f ms\n", percentile(vAbortWireMs, 50), percentile(vAbortWireMs, 99), percentile(vAbortWireMs, 100));
+    printf("I/O lock : %lu locks, %lu contended, %.1f ms total wait, %.1f ms max wait\n", nLocks, nContended, dTotalWaitMs, dMaxWaitMs);
+    printf("wire : %.1f commands/s, status queries %lu sent, %lu shared\n", double(nCommands) / nSeconds, nSent, nShared);
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+    int nSeconds = 20;
+    int nLatency = 20;
+    int nSlowDelay = 1500;
+    int nFreshness = QUERY_FRESHNESS_DEFAULT;
+
+    while((nOpt = getopt(argc, argv, "d:l:S:f:h")) != -1) {
+        switch(nOpt) {
+            case 'd' :  nSeconds = std::max(1, atoi(optarg)); break;
+            case 'l' :  nLatency = atoi(optarg); break;
+            case 'S' :  nSlowDelay = atoi(optarg); break;
+            case 'f' :  nFreshness = std::max(0, atoi(optarg)); break;
+            default :
+                fprintf(stderr, "usage : %s [-d <seconds per mode>] [-l <link latency ms>] [-S <slow query delay ms>] [-f <query freshness ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    runMode(true, QUERY_SHARING_OFF, nSeconds, nLatency, nSlowDelay);
+    runMode(false, QUERY_SHARING_OFF, nSeconds, nLatency, nSlowDelay);
+    runMode(false, nFreshness, nSeconds, nLatency, nSlowDelay);
+    return 0;
+}
@@ -0,0 +1,381 @@
+// rstmicrobench : CPU cost of the RST core's hot paths, no link and no mount involved.
+// The coordinate converters, parseFields, the stringstream command builders as RST.cpp writes them and the
+// splitting of the :MM0# / :CHO# notices out of an answer, through the rstprotocol.h functions RST calls.
+//
+// usage : rstmicrobench [-r <seed>] [-m <min ms per run>] [-n <runs>] [-f <name filter>] [-i <captured replies>]
+//                       [-o <baseline out>] [-b <baseline in>] [-t <regression threshold %>]
+//  The inputs are drawn with the seed -r before anything is timed, the replies come from the built-in set captured
+//  on a RST-135 or from -i, a file with one reply per line or a PLUGIN_DEBUG >= 3 log ("[sendCommand] response : '...'").
+//  Each benchmark is run -n times for at least -m ms, the median ns/op is reported with the allocations per op.
+//  -o writes the results as a baseline, -b compares to one and exits with 1 when a benchmark got slower than
+//  -t percent or allocates more than it did.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <new>
+#include <vector>
+#include <string>
+#include <map>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <unistd.h>
+
+#include "../rstprotocol.h"
+
+#define INPUT_COUNT     1024        // power of 2, the loops index with & (INPUT_COUNT-1)
+#define DEFAULT_MIN_MS  200
+#define DEFAULT_RUNS    5
+#define DEFAULT_THRESHOLD   10.0    // %
+
+typedef std::chrono::steady_clock Clock;
+
+// every operator new in the process, the benchmarks run on the main thread only
+static unsigned long g_nAllocs = 0;
+
+void *operator new(size_t nSize)
+{
+    void *p;
+    g_nAllocs++;
+    p = malloc(nSize ? nSize : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+// keeps the compiler from dropping the work
+static volatile double g_dSink;
+static volatile size_t g_nSink;
+
+// replies as they leave readResponse (the final '#' is gone), notices mixed in the way the mount sends them
+static const char *g_szCapturedReplies[] = {
+    "GR:05:34:31.9", "GR:18:36:56.3", "GR:00:42:44.3", "GR:13:29:52.7", "GR:23:59:59.9", "GR:06:45:08.9",
+    "GD:+22*00:52.1", "GD:+38*47:01.3", "GD:-16*42:58.0", "GD:+47*11:43.0", "GD:-89*59:59.9", "GD:+00*00:00.0",
+    "GZ:180*00:00.0", "GZ:045*12:33.5", "GZ:312*07:41.2", "GZ:001*00:05.9",
+    "GA:+45*30:00.0", "GA:+12*05:17.8", "GA:-05*44:12.1", "GA:+88*59:03.4",
+    "Gg:+073*30'00", "Gt:+45*30'00", "GG:+05", "GL:21:14:07", "GC:10/19/26",
+    "CY:45/0", "CY:-44/1", "AT:1", "AT:0", "CL:0", "Ct1", "Ct?0",
+    "MM0#GR:05:34:31.9", "GR:05:34:31.9#MM0", "MM0#GD:+22*00:52.1", "CHO#GZ:180*00:00.0",
+    "MM0#CHO#GA:+45*30:00.0", "MM0", "CHO", "MM0#CHO",
+    "GR:05:34:31.9#GD:+22*00:52.1", "GZ:045*12:33.5#GA:+12*05:17.8",
+};
+
+typedef struct {
+    std::string sName;
+    std::function<void(size_t)> fLoop;      // runs the operation n times over the inputs
+    double      dNsPerOp;
+    double      dAllocsPerOp;
+} MicroBench;
+
+typedef struct {
+    double dNsPerOp;
+    double dAllocsPerOp;
+} BaselineEntry;
+
+static double nsPerOp(MicroBench &Bench, size_t nIters)
+{
+    Clock::time_point tStart = Clock::now();
+    Bench.fLoop(nIters);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - tStart).count() / double(nIters);
+}
+
+static void runBench(MicroBench &Bench, int nMinMs, int nRuns)
+{
+    size_t nIters = INPUT_COUNT;
+    std::vector<double> vRuns;
+    unsigned long nAllocs;
+
+    // warm the caches and size a run to at least nMinMs
+    while(nsPerOp(Bench, nIters) * nIters < nMinMs * 1e6 && nIters < (size_t(1) << 32))
+        nIters *= 2;
+    for(int i = 0; i < nRuns; i++)
+        vRuns.push_back(nsPerOp(Bench, nIters));
+    std::sort(vRuns.begin(), vRuns.end());
+    Bench.dNsPerOp = vRuns[vRuns.size() / 2];
+
+    nAllocs = g_nAllocs;
+    Bench.fLoop(INPUT_COUNT);
+    Bench.dAllocsPerOp = (g_nAllocs - nAllocs) / double(INPUT_COUNT);
+}
+
+// one reply per line, or the answers out of a PLUGIN_DEBUG >= 3 log
+static int loadReplies(const char *pszFile, std::vector<std::string> &vReplies)
+{
+    std::ifstream fIn(pszFile);
+    std::string sLine;
+    size_t nPos;
+
+    if(!fIn.is_open())
+        return 1;
+    while(std::getline(fIn, sLine)) {
+        sLine.erase(sLine.find_last_not_of("\r\n") + 1);
+        if(sLine.find(" [") != std::string::npos) {
+            nPos = sLine.find("[sendCommand] response : '");
+            if(nPos == std::string::npos)
+                continue;
+            sLine = sLine.substr(nPos + strlen("[sendCommand] response : '"));
+            sLine.erase(sLine.rfind('\''));
+        }
+        if(sLine.size() && sLine.back() == '#')
+            sLine.pop_back();
+        if(sLine.size())
+            vReplies.push_back(sLine);
+    }
+    return 0;
+}
+
+// INPUT_COUNT replies drawn from the ones with this prefix and no notice, without the prefix
+static std::vector<std::string> pickReplies(const std::vector<std::string> &vReplies, const std::vector<std::string> &vPrefixes, std::mt19937 &Rng)
+{
+    std::vector<std::string> vMatching;
+    std::vector<std::string> vPicked;
+
+    for(const std::string &sReply : vReplies)
+        for(const std::string &sPrefix : vPrefixes)
+            if(sReply.compare(0, sPrefix.size(), sPrefix) == 0 && sReply.find('#') == std::string::npos)
+                vMatching.push_back(sReply.substr(sPrefix.size()));
+    if(vMatching.empty())
+        return vPicked;
+    std::uniform_int_distribution<size_t> Pick(0, vMatching.size() - 1);
+    for(int i = 0; i < INPUT_COUNT; i++)
+        vPicked.push_back(vMatching[Pick(Rng)]);
+    return vPicked;
+}
+
+static int readBaseline(const char *pszFile, std::map<std::string, BaselineEntry> &mBaseline)
+{
+    std::ifstream fIn(pszFile);
+    std::string sLine;
+    std::string sName;
+    BaselineEntry Entry;
+
+    if(!fIn.is_open())
+        return 1;
+    while(std::getline(fIn, sLine)) {
+        if(sLine.empty() || sLine[0] == '#')
+            continue;
+        std::istringstream ssLine(sLine);
+        if(std::getline(ssLine, sName, '\t') && ssLine >> Entry.dNsPerOp >> Entry.dAllocsPerOp)
+            mBaseline[sName] = Entry;
+    }
+    return 0;
+}
+
+static int writeBaseline(const char *pszFile, const std::vector<MicroBench> &vBenches)
+{
+    FILE *fOut = fopen(pszFile, "w");
+
+    if(!fOut)
+        return 1;
+    fprintf(fOut, "# rstmicrobench baseline : name, ns/op, allocs/op\n");
+    for(const MicroBench &Bench : vBenches)
+        fprintf(fOut, "%s\t%.2f\t%.3f\n", Bench.sName.c_str(), Bench.dNsPerOp, Bench.dAllocsPerOp);
+    fclose(fOut);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int nOpt;
+    unsigned int nSeed = 1;
+    int nMinMs = DEFAULT_MIN_MS;
+    int nRuns = DEFAULT_RUNS;
+    double dThreshold = DEFAULT_THRESHOLD;
+    std::string sFilter;
+    const char *pszRepliesFile = NULL;
+    const char *pszBaselineOut = NULL;
+    const char *pszBaselineIn = NULL;
+    std::vector<std::string> vReplies;
+    std::map<std::string, BaselineEntry> mBaseline;
+    std::vector<MicroBench> vBenches;
+    int nRegressions = 0;
+
+    while((nOpt = getopt(argc, argv, "r:m:n:f:i:o:b:t:h")) != -1) {
+        switch(nOpt) {
+            case 'r' :  nSeed = (unsigned int)strtoul(optarg, NULL, 10); break;
+            case 'm' :  nMinMs = std::max(1, atoi(optarg)); break;
+            case 'n' :  nRuns = std::max(1, atoi(optarg)); break;
+            case 'f' :  sFilter = optarg; break;
+            case 'i' :  pszRepliesFile = optarg; break;
+            case 'o' :  pszBaselineOut = optarg; break;
+            case 'b' :  pszBaselineIn = optarg; break;
+            case 't' :  dThreshold = atof(optarg); break;
+            default :
+                fprintf(stderr, "usage : %s [-r <seed>] [-m <min ms per run>] [-n <runs>] [-f <name filter>] [-i <captured replies>]\n"
+                                "        [-o <baseline out>] [-b <baseline in>] [-t <regression threshold %%>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if(pszRepliesFile) {
+        if(loadReplies(pszRepliesFile, vReplies) || vReplies.empty()) {
+            fprintf(stderr, "no replies in %s\n", pszRepliesFile);
+            return 1;
+        }
+    }
+    else
+        vReplies.assign(std::begin(g_szCapturedReplies), std::end(g_szCapturedReplies));
+    if(pszBaselineIn && readBaseline(pszBaselineIn, mBaseline)) {
+        fprintf(stderr, "can't read baseline %s\n", pszBaselineIn);
+        return 1;
+    }
+
+    std::mt19937 Rng(nSeed);
+    std::uniform_real_distribution<double> RaDist(0.0, 24.0);
+    std::uniform_real_distribution<double> DecDist(-90.0, 90.0);
+    std::uniform_real_distribution<double> AzDist(0.0, 360.0);
+    std::uniform_real_distribution<double> LongDist(-180.0, 180.0);
+    std::uniform_int_distribution<int> SpeedDist(1, 1200);
+    std::uniform_int_distribution<int> DayDist(0, 3652);
+    std::uniform_int_distribution<size_t> ReplyDist(0, vReplies.size() - 1);
+    std::vector<double> vRa, vDec, vAz, vLong;
+    std::vector<int> vSpeed, vDay;
+    std::vector<std::string> vRawReplies;
+    std::vector<std::string> vRaReplies = pickReplies(vReplies, {"GR:"}, Rng);
+    std::vector<std::string> vDegReplies = pickReplies(vReplies, {"GD:", "GZ:", "GA:"}, Rng);
+
+    for(int i = 0; i < INPUT_COUNT; i++) {
+        vRa.push_back(RaDist(Rng));
+        vDec.push_back(DecDist(Rng));
+        vAz.push_back(AzDist(Rng));
+        vLong.push_back(LongDist(Rng));
+        vSpeed.push_back(SpeedDist(Rng));
+        vDay.push_back(DayDist(Rng));
+        vRawReplies.push_back(vReplies[ReplyDist(Rng)]);
+    }
+
+    const size_t nMask = INPUT_COUNT - 1;
+    std::string sOut;
+    std::string sResp;
+    std::vector<std::string> vFields;
+    double dValue;
+
+    vBenches.push_back({"convertRaToHHMMSSt", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) { rstFormatRa(vRa[i & nMask], sOut); g_nSink = sOut.size(); }
+    }, 0, 0});
+    vBenches.push_back({"convertDecDegToDDMMSS_ForDecl", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) { rstFormatDec(vDec[i & nMask], sOut); g_nSink = sOut.size(); }
+    }, 0, 0});
+    vBenches.push_back({"convertDecAzToDDMMSSs", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) { rstFormatAz(vAz[i & nMask], sOut); g_nSink = sOut.size(); }
+    }, 0, 0});
+    vBenches.push_back({"convertDecDegToDDMMSS", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) { rstFormatDeg(vLong[i & nMask], sOut); g_nSink = sOut.size(); }
+    }, 0, 0});
+    if(vRaReplies.size())
+        vBenches.push_back({"convertHHMMSStToRa", [&](size_t n) {
+            for(size_t i = 0; i < n; i++) { rstParseRa(vRaReplies[i & nMask], dValue); g_dSink = dValue; }
+        }, 0, 0});
+    if(vDegReplies.size())
+        vBenches.push_back({"convertDDMMSSToDecDeg", [&](size_t n) {
+            for(size_t i = 0; i < n; i++) { rstParseDeg(vDegReplies[i & nMask], dValue); g_dSink = dValue; }
+        }, 0, 0});
+    vBenches.push_back({"parseFields", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) { rstParseFields(vRawReplies[i & nMask], vFields, '#'); g_nSink = vFields.size(); }
+    }, 0, 0});
+    // sResp is reused like the one sendCommandOnWire reads into, assign() keeps its buffer
+    vBenches.push_back({"splitNotices", [&](size_t n) {
+        int nNotices = 0;
+        bool bSlewDone = false;
+        for(size_t i = 0; i < n; i++) { sResp.assign(vRawReplies[i & nMask]); g_nSink = rstSplitNotices(sResp, nNotices, bSlewDone); }
+        g_nSink = nNotices + bSlewDone;
+    }, 0, 0});
+
+    // the command builders, written the way RST.cpp builds them (setTarget, setSpeed, setTrackingRates, setDate)
+    vBenches.push_back({"build :Sr", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) {
+            std::stringstream ssTmp;
+            rstFormatRa(vRa[i & nMask], sOut);
+            ssTmp<<":Sr"<<sOut<<"#";
+            g_nSink = ssTmp.str().size();
+        }
+    }, 0, 0});
+    vBenches.push_back({"build :Sd", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) {
+            std::stringstream ssTmp;
+            rstFormatDec(vDec[i & nMask], sOut);
+            ssTmp<<":Sd"<<sOut<<"#";
+            g_nSink = ssTmp.str().size();
+        }
+    }, 0, 0});
+    vBenches.push_back({"build :Cu", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) {
+            std::stringstream ssTmp;
+            ssTmp << ":Cu" << int(i & 3) << "=" << std::setfill('0') << std::setw(4) << vSpeed[i & nMask] << "#";
+            g_nSink = ssTmp.str().size();
+        }
+    }, 0, 0});
+    vBenches.push_back({"build :Ck", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) {
+            std::stringstream ssTmp;
+            double dDec = vDec[i & nMask];
+            char cSign = dDec >= 0 ? '+' : '-';
+            ssTmp << ":Ck" << std::setfill('0') << std::setw(7) << std::fixed << std::setprecision(3) << vRa[i & nMask]*15.0 << cSign << std::setfill('0') << std::setw(6)<< std::fixed << std::setprecision(3) << std::fabs(dDec) << "#";
+            g_nSink = ssTmp.str().size();
+        }
+    }, 0, 0});
+    vBenches.push_back({"build :SC", [&](size_t n) {
+        for(size_t i = 0; i < n; i++) {
+            std::stringstream ssTmp;
+            int nDay = vDay[i & nMask];
+            ssTmp << ":SC" << std::setfill('0') << std::setw(2) << 1 + (nDay / 28) % 12 << "/" << std::setfill('0') << std::setw(2) << 1 + nDay % 28 << "/" << std::setfill('0') << std::setw(2) << 25 + nDay / 365 << "#";
+            g_nSink = ssTmp.str().size();
+        }
+    }, 0, 0});
+
+    if(sFilter.size())
+        vBenches.erase(std::remove_if(vBenches.begin(), vBenches.end(), [&](const MicroBench &Bench) { return Bench.sName.find(sFilter) == std::string::npos; }), vBenches.end());
+
+    printf("seed %u, %zu replies, %d runs of at least %d ms each\n\n", nSeed, vReplies.size(), nRuns, nMinMs);
+    printf("%-32s %10s %10s", "benchmark", "ns/op", "allocs/op");
+    if(pszBaselineIn)
+        printf(" %10s %10s %8s", "base ns", "base alc", "delta");
+    printf("\n");
+    for(MicroBench &Bench : vBenches) {
+        runBench(Bench, nMinMs, nRuns);
+        printf("%-32s %10.1f %10.2f", Bench.sName.c_str(), Bench.dNsPerOp, Bench.dAllocsPerOp);
+        if(pszBaselineIn) {
+            std::map<std::string, BaselineEntry>::iterator it = mBaseline.find(Bench.sName);
+            if(it == mBaseline.end())
+                printf(" %10s", "new");
+            else {
+                double dDelta = (Bench.dNsPerOp / it->second.dNsPerOp - 1.0) * 100.0;
+                bool bSlower = dDelta > dThreshold;
+                // allocations don't depend on the machine, any extra one counts
+                bool bMoreAllocs = Bench.dAllocsPerOp > it->second.dAllocsPerOp + 0.01;
+                printf(" %10.1f %10.2f %+7.1f%%%s", it->second.dNsPerOp, it->second.dAllocsPerOp, dDelta, (bSlower || bMoreAllocs) ? "  REGRESSION" : "");
+                if(bSlower || bMoreAllocs)
+                    nRegressions++;
+            }
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if(pszBaselineOut && writeBaseline(pszBaselineOut, vBenches)) {
+        fprintf(stderr, "can't write baseline %s\n", pszBaselineOut);
+        return 1;
+    }
+    if(pszBaselineIn) {
+        printf("\n%d regression%s over %.1f%%\n", nRegressions, nRegressions == 1 ? "" : "s", dThreshold);
+        if(nRegressions)
+            return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// rstmultibench : park all scaling with N simulated RST mounts, through RSTManager vs one mount after the other.
+//
+// usage : rstmultibench [-n <max mounts>] [-l <link latency ms>] [-s <slew seconds>] [-w <workers>] [-S <slow link latency ms>]
+//  -S gives mount 0 a slow link to show it doesn't hold the others back.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <memory>
+#include <unistd.h>
+
+#include "../rstmanager.h"
+#include "simserx.h"
+
+typedef struct {
+    std::unique_ptr<RSTSimSerX> pSerX;
+    std::unique_ptr<RST>        pMount;
+} SimMount;
+
+static int setupMounts(std::vector<SimMount> &vMounts, int nMounts, int nLatency, int nSlowLatency, double dSlewSeconds)
+{
+    char szPort[32];
+    int nErr;
+
+    vMounts.clear();
+    vMounts.resize(nMounts);
+    for(int i = 0; i < nMounts; i++) {
+        vMounts[i].pSerX.reset(new RSTSimSerX((i == 0 && nSlowLatency)?nSlowLatency:nLatency, dSlewSeconds));
+        vMounts[i].pMount.reset(new RST());
+        vMounts[i].pMount->setTransport(vMounts[i].pSerX.get());
+        vMounts[i].pMount->setHost(NULL);
+        vMounts[i].pMount->setStopTrackingOnDisconnect(false);
+        snprintf(szPort, sizeof(szPort), "sim%d", i);
+        nErr = vMounts[i].pMount->Connect(szPort);
+        if(nErr)
+            return nErr;
+    }
+    return PLUGIN_OK;
+}
+
+static void teardownMounts(std::vector<SimMount> &vMounts)
+{
+    for(size_t i = 0; i < vMounts.size(); i++) {
+        RSTManager::instance().unregisterMount(vMounts[i].pMount.get());
+        vMounts[i].pMount->Disconnect();
+    }
+    vMounts.clear();
+}
+
+// what N independent drivers polled from one thread would do
+static double parkSerial(std::vector<SimMount> &vMounts)
+{
+    CStopWatch timer;
+    bool bComplete;
+
+    for(size_t i = 0; i < vMounts.size(); i++) {
+        RST &mount = *vMounts[i].pMount;
+        mount.gotoParkPosition();
+        do {
+            std::this_thread::sleep_for(std::chrono::milliseconds(MANAGER_POLL_INTERVAL));
+            if(mount.isSlewToComplete(bComplete))
+                break;
+        } while(!bComplete);
+        mount.setTrackingRates(false, true, 0.0, 0.0);
+        mount.setMountIsParked(true);
+    }
+    return timer.GetElapsedSeconds();
+}
+
+static double parkManaged(std::vector<SimMount> &vMounts, int &nErr)
+{
+    CStopWatch timer;
+    std::vector<int> vErrors;
+
+    for(size_t i = 0; i < vMounts.size(); i++)
+        RSTManager::instance().registerMount(vMounts[i].pMount.get(), (int)i);
+    nErr = RSTManager::instance().parkAll(true, vErrors);
+    return timer.GetElapsedSeconds();
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+    int nMaxMounts = 8;
+    int nLatency = 20;
+    int nSlowLatency = 0;
+    int nWorkers = MANAGER_MAX_WORKERS;
+    double dSlewSeconds = 2.0;
+    double dSerial;
+    double dManaged;
+    int nErr;
+    std::vector<SimMount> vMounts;
+    std::vector<RSTManagedStatus> vStatus;
+
+    while((nOpt = getopt(argc, argv, "n:l:s:w:S:h")) != -1) {
+        switch(nOpt) {
+            case 'n' :  nMaxMounts = std::max(1, atoi(optarg)); break;
+            case 'l' :  nLatency = atoi(optarg); break;
+            case 's' :  dSlewSeconds = atof(optarg); break;
+            case 'w' :  nWorkers = atoi(optarg); break;
+            case 'S' :  nSlowLatency = atoi(optarg); break;
+            default :
+                fprintf(stderr, "usage : %s [-n <max mounts>] [-l <link latency ms>] [-s <slew seconds>] [-w <workers>] [-S <slow link latency ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+    RSTManager::instance().setMaxWorkers(nWorkers);
+
+    printf("park all, %d ms links%s, %.1f s slews, %d workers\n", nLatency, nSlowLatency?" (mount 0 slow)":"", dSlewSeconds, nWorkers);
+    printf("mounts   one by one (s)   manager (s)   speedup\n");
+    for(int nMounts = 1; nMounts <= nMaxMounts; nMounts *= 2) {
+        nErr = setupMounts(vMounts, nMounts, nLatency, nSlowLatency, dSlewSeconds);
+        if(nErr) {
+            fprintf(stderr, "can't connect the simulated mounts (%d)\n", nErr);
+            return 1;
+        }
+        dSerial = parkSerial(vMounts);
+        teardownMounts(vMounts);
+
+        setupMounts(vMounts, nMounts, nLatency, nSlowLatency, dSlewSeconds);
+        dManaged = parkManaged(vMounts, nErr);
+        RSTManager::instance().getStatusAll(vStatus);
+        int nParked = 0;
+        for(size_t i = 0; i < vStatus.size(); i++)
+            if(vStatus[i].Status.nFlags & STATUS_PARKED)
+                nParked++;
+        teardownMounts(vMounts);
+
+        printf("%6d   %16.2f   %11.2f   %6.1fx%s\n", nMounts, dSerial, dManaged, dSerial / dManaged,
+               (nErr || nParked != nMounts)?"  (not all parked)":"");
+    }
+    return 0;
+}
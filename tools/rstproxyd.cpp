@@ -0,0 +1,425 @@
+// rstproxyd : owns the RST link and shares it with local clients over a Unix socket.
+// See rstproxy.h for the protocol.
+//
+// usage : rstproxyd -p <serial device | host:port | sim> [-s <socket path>] [-i <status interval ms>] [-m <metrics port>] [-v]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <map>
+#include <list>
+#include <memory>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../RST.h"
+#include "../rstproxy.h"
+#include "posixserx.h"
+#include "simserx.h"
+
+#define PROXY_CONNECT_RETRY     5000    // ms between attempts to open the mount link
+#define PROXY_STATS_INTERVAL    60      // seconds between stats lines in verbose mode
+
+static std::atomic<bool> g_bRunning(true);
+static int g_nListenSocket = -1;
+
+static void onSignal(int /*nSignal*/)
+{
+    g_bRunning = false;
+    if(g_nListenSocket >= 0)
+        shutdown(g_nListenSocket, SHUT_RDWR);
+}
+
+#pragma mark - query coalescing
+// Queries without side effects can be shared : a client asking for something already in flight waits for that answer.
+// The status queries the proxy polls itself are also answered from the last poll while it's fresh.
+class RSTQueryCoalescer
+{
+public:
+    RSTQueryCoalescer(RST &Mount) : m_Mount(Mount) {}
+
+    int     query(const std::string &sCmd, std::string &sResp);
+    int     pollStatus(std::vector<std::string> &svResps, double &dAgeMs);
+    void    getStats(unsigned long &nRequests, unsigned long &nWire, unsigned long &nCoalesced, unsigned long &nCached);
+
+    static bool isQuery(const std::string &sCmd);
+    static const std::vector<std::string> m_svStatusCmds;
+
+private:
+    typedef struct {
+        bool        bDone;
+        int         nErr;
+        std::string sResp;
+        std::condition_variable cond;
+    } InFlight;
+
+    typedef struct {
+        std::string sResp;
+        CStopWatch  age;
+    } Cached;
+
+    RST         &m_Mount;
+    std::mutex  m_Mutex;
+    std::map<std::string, std::shared_ptr<InFlight>>    m_InFlight;
+    std::map<std::string, Cached>                       m_Cache;
+    unsigned long   m_nRequests = 0;
+    unsigned long   m_nWire = 0;
+    unsigned long   m_nCoalesced = 0;
+    unsigned long   m_nCached = 0;
+};
+
+const std::vector<std::string> RSTQueryCoalescer::m_svStatusCmds = {":GR#", ":GD#", ":GA#", ":GZ#", ":AT#", ":CL#"};
+
+bool RSTQueryCoalescer::isQuery(const std::string &sCmd)
+{
+    if(!sCmd.compare(0, 2, ":G"))
+        return true;
+    if(sCmd == ":AT#" || sCmd == ":AH#" || sCmd == ":AV#" || sCmd == ":CL#" || sCmd == ":Cv#" || sCmd == ":CY#" || sCmd == ":Ct?#")
+        return true;
+    if(!sCmd.compare(0, 3, ":CG") || !sCmd.compare(0, 3, ":CU"))
+        return true;
+    return false;
+}
+
+int RSTQueryCoalescer::query(const std::string &sCmd, std::string &sResp)
+{
+    int nErr = PLUGIN_OK;
+    std::shared_ptr<InFlight> pFlight;
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    m_nRequests++;
+    if(!isQuery(sCmd)) {
+        // anything else can change the mount state, the polled answers are stale now.
+        m_Cache.clear();
+        m_nWire++;
+        lock.unlock();
+        return m_Mount.forwardCommand(sCmd, sResp);
+    }
+
+    auto cached = m_Cache.find(sCmd);
+    if(cached != m_Cache.end() && cached->second.age.GetElapsedSeconds() * 1000.0 < RST_PROXY_STATUS_FRESHNESS) {
+        m_nCached++;
+        sResp.assign(cached->second.sResp);
+        return nErr;
+    }
+
+    auto flight = m_InFlight.find(sCmd);
+    if(flight != m_InFlight.end()) {
+        pFlight = flight->second;
+        m_nCoalesced++;
+        pFlight->cond.wait(lock, [pFlight] { return pFlight->bDone; });
+        sResp.assign(pFlight->sResp);
+        return pFlight->nErr;
+    }
+
+    pFlight = std::make_shared<InFlight>();
+    pFlight->bDone = false;
+    m_InFlight[sCmd] = pFlight;
+    m_nWire++;
+    lock.unlock();
+
+    nErr = m_Mount.forwardCommand(sCmd, sResp);
+
+    lock.lock();
+    pFlight->nErr = nErr;
+    pFlight->sResp.assign(sResp);
+    pFlight->bDone = true;
+    m_InFlight.erase(sCmd);
+    pFlight->cond.notify_all();
+    return nErr;
+}
+
+int RSTQueryCoalescer::pollStatus(std::vector<std::string> &svResps, double &dAgeMs)
+{
+    int nErr = PLUGIN_OK;
+    size_t i;
+    CStopWatch pollTimer;
+
+    nErr = m_Mount.forwardCommandBurst(m_svStatusCmds, svResps);
+    dAgeMs = pollTimer.GetElapsedSeconds() * 500.0;  // the answers are from the middle of the burst, give or take
+    if(nErr || svResps.size() < m_svStatusCmds.size())
+        return nErr?nErr:ERR_CMDFAILED;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_nWire += m_svStatusCmds.size();
+    for(i = 0; i < m_svStatusCmds.size(); i++) {
+        Cached &entry = m_Cache[m_svStatusCmds[i]];
+        entry.sResp.assign(svResps[i]);
+        entry.age.Reset();
+    }
+    return nErr;
+}
+
+void RSTQueryCoalescer::getStats(unsigned long &nRequests, unsigned long &nWire, unsigned long &nCoalesced, unsigned long &nCached)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    nRequests = m_nRequests;
+    nWire = m_nWire;
+    nCoalesced = m_nCoalesced;
+    nCached = m_nCached;
+}
+
+#pragma mark - clients
+typedef struct {
+    int                 nSocket;
+    std::mutex          writeMutex;     // the status pusher writes too
+    std::atomic<bool>   bSubscribed;
+    std::atomic<bool>   bClosed;
+} ProxyClient;
+
+static std::mutex g_ClientsMutex;
+static std::list<std::shared_ptr<ProxyClient>> g_Clients;
+
+static bool clientSend(ProxyClient &Client, const std::string &sData)
+{
+    size_t nSent = 0;
+    ssize_t nWritten;
+    std::lock_guard<std::mutex> lock(Client.writeMutex);
+
+    while(nSent < sData.size()) {
+        nWritten = send(Client.nSocket, sData.data() + nSent, sData.size() - nSent, 0);   // SIGPIPE is ignored
+        if(nWritten < 0) {
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        nSent += nWritten;
+    }
+    return true;
+}
+
+static void clientThread(std::shared_ptr<ProxyClient> pClient, RSTQueryCoalescer *pCoalescer, bool bVerbose)
+{
+    char pszBuf[SERIAL_BUFFER_SIZE];
+    ssize_t nRead;
+    std::string sPending;
+    std::string sCmd;
+    std::string sResp;
+    size_t nEnd;
+
+    while(g_bRunning) {
+        nRead = recv(pClient->nSocket, pszBuf, sizeof(pszBuf), 0);
+        if(nRead <= 0) {
+            if(nRead < 0 && errno == EINTR)
+                continue;
+            break;
+        }
+        sPending.append(pszBuf, nRead);
+        // a client can pipeline several commands in one write
+        while((nEnd = sPending.find('#')) != std::string::npos) {
+            sCmd = sPending.substr(0, nEnd + 1);
+            sPending.erase(0, nEnd + 1);
+            if(sCmd.size() && sCmd[0] != ':') // garbage before the command
+                sCmd.erase(0, sCmd.find(':') == std::string::npos ? sCmd.size() : sCmd.find(':'));
+            if(sCmd.empty())
+                continue;
+
+            if(sCmd == RST_PROXY_SUBSCRIBE) {
+                pClient->bSubscribed = true;
+                continue;
+            }
+            if(sCmd == RST_PROXY_UNSUBSCRIBE) {
+                pClient->bSubscribed = false;
+                continue;
+            }
+
+            sResp.clear();
+            pCoalescer->query(sCmd, sResp);
+            if(bVerbose)
+                fprintf(stderr, "[%d] %s -> %s\n", pClient->nSocket, sCmd.c_str(), sResp.c_str());
+            // no answer (or a timeout) : nothing to send, the client times out just like on the wire
+            if(sResp.size() && !clientSend(*pClient, sResp))
+                break;
+        }
+        if(sPending.size() > SERIAL_BUFFER_SIZE)
+            sPending.clear();
+    }
+
+    pClient->bClosed = true;
+    close(pClient->nSocket);
+    std::lock_guard<std::mutex> lock(g_ClientsMutex);
+    g_Clients.remove(pClient);
+}
+
+static void statusThread(RSTQueryCoalescer *pCoalescer, int nInterval)
+{
+    std::vector<std::string> svResps;
+    std::string sPush;
+    std::list<std::shared_ptr<ProxyClient>> subscribers;
+    double dAgeMs;
+    CStopWatch cycleTimer;
+    double dRemaining;
+
+    while(g_bRunning) {
+        cycleTimer.Reset();
+        if(!pCoalescer->pollStatus(svResps, dAgeMs)) {
+            std::stringstream ssTmp;
+            ssTmp << RST_PROXY_STATUS_PREFIX << int(dAgeMs);
+            for(const std::string &sResp : svResps)
+                ssTmp << ";" << sResp.substr(0, sResp.size() - 1);
+            ssTmp << "#";
+            sPush = ssTmp.str();
+
+            {
+                std::lock_guard<std::mutex> lock(g_ClientsMutex);
+                subscribers.clear();
+                for(auto &pClient : g_Clients)
+                    if(pClient->bSubscribed && !pClient->bClosed)
+                        subscribers.push_back(pClient);
+            }
+            for(auto &pClient : subscribers)
+                clientSend(*pClient, sPush);
+        }
+        dRemaining = nInterval / 1000.0 - cycleTimer.GetElapsedSeconds();
+        if(dRemaining > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(int(dRemaining * 1000.0)));
+    }
+}
+
+#pragma mark - main
+static void usage(const char *pszName)
+{
+    fprintf(stderr, "usage : %s -p <serial device | host:port | sim> [-s <socket path>] [-i <status interval ms>] [-m <metrics port>] [-v]\n", pszName);
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+    int nErr;
+    std::string sPort;
+    std::string sSocketPath = RST_PROXY_DEFAULT_SOCKET;
+    int nInterval = RST_PROXY_STATUS_INTERVAL;
+    int nMetricsPort = 0;
+    bool bVerbose = false;
+    struct sockaddr_un addr;
+    struct pollfd pfd;
+    int nClientSocket;
+    unsigned long nRequests, nWire, nCoalesced, nCached;
+    CStopWatch statsTimer;
+    std::unique_ptr<RSTTransport> pLink;
+
+    while((nOpt = getopt(argc, argv, "p:s:i:m:vh")) != -1) {
+        switch(nOpt) {
+            case 'p' :
+                sPort.assign(optarg);
+                break;
+            case 's' :
+                sSocketPath.assign(optarg);
+                break;
+            case 'i' :
+                nInterval = std::max(100, atoi(optarg));
+                break;
+            case 'm' :
+                nMetricsPort = atoi(optarg);
+                break;
+            case 'v' :
+                bVerbose = true;
+                break;
+            default :
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if(sPort.empty() || sSocketPath.size() >= sizeof(addr.sun_path)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+
+    // "sim" is the simulated mount of tools/simserx, for the clients' tests
+    if(sPort == "sim")
+        pLink.reset(new RSTSimSerX());
+    else
+        pLink.reset(new PosixSerX());
+    RST mount;
+    mount.setTransport(pLink.get());
+    mount.setHost(NULL);                        // site and time are TheSkyX's job, through the proxy
+    mount.setSyncLocationDataConnect(false);
+    mount.setStopTrackingOnDisconnect(false);   // the proxy going away must not stop the mount
+    if(nMetricsPort > 0 && mount.setMetricsPort(nMetricsPort))
+        fprintf(stderr, "can't serve the metrics on 127.0.0.1:%d\n", nMetricsPort);
+
+    while(g_bRunning) {
+        nErr = mount.Connect((char *)sPort.c_str());
+        if(!nErr)
+            break;
+        fprintf(stderr, "can't connect to the mount on %s (%d), retrying\n", sPort.c_str(), nErr);
+        std::this_thread::sleep_for(std::chrono::milliseconds(PROXY_CONNECT_RETRY));
+    }
+    if(!g_bRunning)
+        return 0;
+    fprintf(stderr, "connected to the mount on %s in %.3f s\n", sPort.c_str(), mount.getLastConnectTime());
+
+    g_nListenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(g_nListenSocket < 0) {
+        perror("socket");
+        return 1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, sSocketPath.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(sSocketPath.c_str());
+    if(bind(g_nListenSocket, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(g_nListenSocket, 16) < 0) {
+        perror(sSocketPath.c_str());
+        return 1;
+    }
+    fprintf(stderr, "listening on %s\n", sSocketPath.c_str());
+
+    RSTQueryCoalescer coalescer(mount);
+    std::thread status(statusThread, &coalescer, nInterval);
+
+    while(g_bRunning) {
+        pfd.fd = g_nListenSocket;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if(poll(&pfd, 1, 1000) > 0 && (pfd.revents & POLLIN)) {
+            nClientSocket = accept(g_nListenSocket, NULL, NULL);
+            if(nClientSocket >= 0) {
+                std::shared_ptr<ProxyClient> pClient = std::make_shared<ProxyClient>();
+                pClient->nSocket = nClientSocket;
+                pClient->bSubscribed = false;
+                pClient->bClosed = false;
+                {
+                    std::lock_guard<std::mutex> lock(g_ClientsMutex);
+                    g_Clients.push_back(pClient);
+                }
+                std::thread(clientThread, pClient, &coalescer, bVerbose).detach();
+            }
+        }
+        if(bVerbose && statsTimer.GetElapsedSeconds() > PROXY_STATS_INTERVAL) {
+            statsTimer.Reset();
+            coalescer.getStats(nRequests, nWire, nCoalesced, nCached);
+            fprintf(stderr, "requests %lu, wire %lu, coalesced %lu, from last poll %lu\n", nRequests, nWire, nCoalesced, nCached);
+        }
+    }
+
+    status.join();
+    {
+        std::lock_guard<std::mutex> lock(g_ClientsMutex);
+        for(auto &pClient : g_Clients)
+            shutdown(pClient->nSocket, SHUT_RDWR);
+    }
+    // give the client threads a chance to finish their current command and go away
+    statsTimer.Reset();
+    while(statsTimer.GetElapsedSeconds() < 3.0) {
+        {
+            std::lock_guard<std::mutex> lock(g_ClientsMutex);
+            if(g_Clients.empty())
+                break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    close(g_nListenSocket);
+    unlink(sSocketPath.c_str());
+    mount.Disconnect();
+
+    coalescer.getStats(nRequests, nWire, nCoalesced, nCached);
+    fprintf(stderr, "requests %lu, wire %lu, coalesced %lu, from last poll %lu\n", nRequests, nWire, nCoalesced, nCached);
+    return 0;
+}
@@ -0,0 +1,248 @@
+// rstrecexport : dumps the RST driver history file (rstrecorder.h) as CSV.
+//
+// usage : rstrecexport [-f <file> | -i <instance>] [-s <start>] [-e <end>] [-t <type>[,<type>...]] [-o <op>] [-b <minutes>]
+//  start and end are local times ("2026-10-19 22:30" or "2026-10-19 22:30:15") or relative to now ("-8h", "-90m").
+//  types : command, voltage, tracking, pierside, flag, breaker, abort, resume, watchdog.
+//  -o keeps the commands with that opcode ("GR", "CtA", ...).
+//  -b sums the records up per type and opcode every <minutes> : count, timeouts, errors, min/avg/max value.
+//  Values : command latency in us, voltage in mV, flag state 1/0, abort error code, resume and watchdog recovery duration in ms.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <unistd.h>
+
+#include "../rstrecorder.h"
+#include "../rststatus.h"
+#include "../RST.h"
+
+static const char *detail(const RSTRecordEntry &Entry)
+{
+    switch(Entry.nType) {
+        case REC_COMMAND :
+            switch(Entry.nCode & ~REC_CMD_BURST) {
+                case REC_CMD_OK :       return (Entry.nCode & REC_CMD_BURST)?"ok (burst)":"ok";
+                case REC_CMD_TIMEOUT :  return (Entry.nCode & REC_CMD_BURST)?"timeout (burst)":"timeout";
+                default :               return (Entry.nCode & REC_CMD_BURST)?"error (burst)":"error";
+            }
+        case REC_TRACKING :
+            switch(Entry.nCode) {
+                case STATUS_TRACKING_OFF :      return "off";
+                case STATUS_TRACKING_SIDEREAL : return "sidereal";
+                case STATUS_TRACKING_SOLAR :    return "solar";
+                case STATUS_TRACKING_LUNAR :    return "lunar";
+                case STATUS_TRACKING_CUSTOM :   return "custom";
+                default :                       return "unknown";
+            }
+        case REC_PIER_SIDE :
+            switch(Entry.nCode) {
+                case STATUS_PIER_EAST : return "east";
+                case STATUS_PIER_WEST : return "west";
+                default :               return "unknown";
+            }
+        case REC_FLAG :
+            switch(Entry.nCode) {
+                case STATUS_CONNECTED : return Entry.nValue?"connected":"disconnected";
+                case STATUS_SLEWING :   return Entry.nValue?"slewing":"slew done";
+                case STATUS_PARKED :    return Entry.nValue?"parked":"unparked";
+                case STATUS_HOMED :     return Entry.nValue?"homed":"not homed";
+                default :               return "";
+            }
+        case REC_BREAKER :
+            switch(Entry.nCode) {
+                case BREAKER_CLOSED :   return "closed";
+                case BREAKER_OPEN :     return "open";
+                default :               return "half open";
+            }
+        case REC_WATCHDOG :
+            switch(Entry.nCode) {
+                case WATCHDOG_API_DEADLINE :    return "api deadline";
+                case WATCHDOG_STALLED :         return "command deadline";
+                default :                       return "notice flood";
+            }
+        default :
+            return "";
+    }
+}
+
+// local time, absolute or relative to now
+static bool parseTime(const char *pszTime, uint64_t &nTimeMs)
+{
+    struct tm tmTime;
+    char *pszEnd;
+    long nAmount;
+
+    if(pszTime[0] == '-') {
+        nAmount = strtol(pszTime + 1, &pszEnd, 10);
+        if(pszEnd == pszTime + 1 || nAmount < 0)
+            return false;
+        switch(*pszEnd) {
+            case 'd' :  nAmount *= 24 * 3600; break;
+            case 'h' :  nAmount *= 3600; break;
+            case 'm' :  nAmount *= 60; break;
+            case 's' :
+            case 0 :    break;
+            default :   return false;
+        }
+        nTimeMs = RSTRecorder::nowMs() - (uint64_t)nAmount * 1000;
+        return true;
+    }
+
+    memset(&tmTime, 0, sizeof(tmTime));
+    pszEnd = strptime(pszTime, "%Y-%m-%d %H:%M:%S", &tmTime);
+    if(!pszEnd) {
+        memset(&tmTime, 0, sizeof(tmTime));
+        pszEnd = strptime(pszTime, "%Y-%m-%d %H:%M", &tmTime);
+    }
+    if(!pszEnd || *pszEnd)
+        return false;
+    tmTime.tm_isdst = -1;
+    nTimeMs = (uint64_t)mktime(&tmTime) * 1000;
+    return true;
+}
+
+static std::string formatTime(uint64_t nTimeMs)
+{
+    time_t nSeconds = (time_t)(nTimeMs / 1000);
+    struct tm tmTime;
+    char szTime[64];
+
+    localtime_r(&nSeconds, &tmTime);
+    strftime(szTime, sizeof(szTime), "%Y-%m-%d %H:%M:%S", &tmTime);
+    snprintf(szTime + strlen(szTime), sizeof(szTime) - strlen(szTime), ".%03d", (int)(nTimeMs % 1000));
+    return std::string(szTime);
+}
+
+static bool parseTypes(const char *pszTypes, std::vector<bool> &vTypes)
+{
+    std::string sTypes(pszTypes);
+    std::string sType;
+    size_t nPos = 0;
+    size_t nComma;
+    int nType;
+
+    vTypes.assign(REC_TYPE_COUNT, false);
+    while(nPos <= sTypes.size()) {
+        nComma = sTypes.find(',', nPos);
+        if(nComma == std::string::npos)
+            nComma = sTypes.size();
+        sType = sTypes.substr(nPos, nComma - nPos);
+        for(nType = REC_COMMAND; nType < REC_TYPE_COUNT; nType++)
+            if(sType == RSTRecordReader::typeName(nType))
+                break;
+        if(nType >= REC_TYPE_COUNT)
+            return false;
+        vTypes[nType] = true;
+        nPos = nComma + 1;
+    }
+    return true;
+}
+
+typedef struct {
+    uint64_t    nCount;
+    uint64_t    nTimeouts;
+    uint64_t    nErrors;
+    int32_t     nMin;
+    int32_t     nMax;
+    double      dSum;
+} Bucket;
+
+static void printBuckets(const std::vector<RSTRecordEntry> &vEntries, uint64_t nBucketMs)
+{
+    // (bucket start, type, op) in time order
+    std::map<std::pair<uint64_t, std::pair<int, std::string>>, Bucket> mBuckets;
+    std::map<std::pair<uint64_t, std::pair<int, std::string>>, Bucket>::iterator it;
+
+    for(const RSTRecordEntry &Entry : vEntries) {
+        Bucket &b = mBuckets[std::make_pair(Entry.nTimeMs / nBucketMs * nBucketMs, std::make_pair(Entry.nType, Entry.sOp))];
+        if(!b.nCount) {
+            b.nMin = Entry.nValue;
+            b.nMax = Entry.nValue;
+        }
+        b.nCount++;
+        if(Entry.nType == REC_COMMAND && (Entry.nCode & ~REC_CMD_BURST) == REC_CMD_TIMEOUT)
+            b.nTimeouts++;
+        if(Entry.nType == REC_COMMAND && (Entry.nCode & ~REC_CMD_BURST) == REC_CMD_ERROR)
+            b.nErrors++;
+        b.nMin = std::min(b.nMin, Entry.nValue);
+        b.nMax = std::max(b.nMax, Entry.nValue);
+        b.dSum += Entry.nValue;
+    }
+
+    printf("time,type,op,count,timeouts,errors,min,avg,max\n");
+    for(it = mBuckets.begin(); it != mBuckets.end(); ++it)
+        printf("%s,%s,%s,%llu,%llu,%llu,%d,%.1f,%d\n", formatTime(it->first.first).c_str(), RSTRecordReader::typeName(it->first.second.first),
+               it->first.second.second.c_str(), (unsigned long long)it->second.nCount, (unsigned long long)it->second.nTimeouts,
+               (unsigned long long)it->second.nErrors, it->second.nMin, it->second.dSum / it->second.nCount, it->second.nMax);
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+    int nErr;
+    std::string sPath = RSTRecorder::defaultPath(0);
+    std::string sOp;
+    uint64_t nFromMs = 0;
+    uint64_t nToMs = UINT64_MAX;
+    uint64_t nBucketMs = 0;
+    std::vector<bool> vTypes(REC_TYPE_COUNT, true);
+    std::vector<RSTRecordEntry> vEntries;
+    std::vector<RSTRecordEntry> vSelected;
+
+    while((nOpt = getopt(argc, argv, "f:i:s:e:t:o:b:h")) != -1) {
+        switch(nOpt) {
+            case 'f' :  sPath.assign(optarg); break;
+            case 'i' :  sPath = RSTRecorder::defaultPath(atoi(optarg)); break;
+            case 's' :
+                if(!parseTime(optarg, nFromMs)) {
+                    fprintf(stderr, "can't parse start time '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'e' :
+                if(!parseTime(optarg, nToMs)) {
+                    fprintf(stderr, "can't parse end time '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't' :
+                if(!parseTypes(optarg, vTypes)) {
+                    fprintf(stderr, "unknown record type in '%s'\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o' :  sOp.assign(optarg); break;
+            case 'b' :  nBucketMs = (uint64_t)std::max(1, atoi(optarg)) * 60000; break;
+            default :
+                fprintf(stderr, "usage : %s [-f <file> | -i <instance>] [-s <start>] [-e <end>] [-t <type>[,<type>...]] [-o <op>] [-b <minutes>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    nErr = RSTRecordReader::read(sPath, nFromMs, nToMs, vEntries);
+    if(nErr) {
+        fprintf(stderr, "can't read %s (%d)\n", sPath.c_str(), nErr);
+        return 1;
+    }
+    for(const RSTRecordEntry &Entry : vEntries) {
+        if(Entry.nType < 0 || Entry.nType >= (int)vTypes.size() || !vTypes[Entry.nType])
+            continue;
+        if(!sOp.empty() && Entry.sOp != sOp)
+            continue;
+        vSelected.push_back(Entry);
+    }
+
+    if(nBucketMs) {
+        printBuckets(vSelected, nBucketMs);
+        return 0;
+    }
+    printf("time,type,op,code,value,detail\n");
+    for(const RSTRecordEntry &Entry : vSelected)
+        printf("%s,%s,%s,%d,%d,%s\n", formatTime(Entry.nTimeMs).c_str(), RSTRecordReader::typeName(Entry.nType), Entry.sOp.c_str(), Entry.nCode, Entry.nValue, detail(Entry));
+    return 0;
+}
@@ -0,0 +1,99 @@
+// rststat : prints the status the RST driver publishes in shared memory, and doubles as an example reader.
+//
+// usage : rststat [-n <segment name>] [-i <interval ms>]
+//  without -i the status is printed once.
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <unistd.h>
+
+#include "../rststatus.h"
+
+static const char *trackingName(int nMode)
+{
+    switch(nMode) {
+        case STATUS_TRACKING_OFF :      return "off";
+        case STATUS_TRACKING_SIDEREAL : return "sidereal";
+        case STATUS_TRACKING_SOLAR :    return "solar";
+        case STATUS_TRACKING_LUNAR :    return "lunar";
+        case STATUS_TRACKING_CUSTOM :   return "custom";
+        default :                       return "unknown";
+    }
+}
+
+static const char *pierSideName(int nSide)
+{
+    switch(nSide) {
+        case STATUS_PIER_EAST : return "east";
+        case STATUS_PIER_WEST : return "west";
+        default :               return "unknown";
+    }
+}
+
+// age in ms of a sample, -1 if it was never taken
+static double ageMs(uint64_t nNow, uint64_t nSampleTime)
+{
+    if(!nSampleTime)
+        return -1.0;
+    return (nNow - nSampleTime) / 1e6;
+}
+
+static void printSnapshot(const RSTStatusSnapshot &Snap)
+{
+    uint64_t nNow = RSTStatusPublisher::now();
+
+    printf("connected=%d slewing=%d parked=%d homed=%d ra=%.6f dec=%.5f alt=%.4f az=%.4f tracking=%s rates=%.4f/%.4f pier=%s volts=%.2f age_ms=%.0f/%.0f/%.0f/%.0f\n",
+           (Snap.nFlags & STATUS_CONNECTED)?1:0, (Snap.nFlags & STATUS_SLEWING)?1:0,
+           (Snap.nFlags & STATUS_PARKED)?1:0, (Snap.nFlags & STATUS_HOMED)?1:0,
+           Snap.dRa, Snap.dDec, Snap.dAlt, Snap.dAz,
+           trackingName(Snap.nTrackingMode), Snap.dRaRate, Snap.dDecRate,
+           pierSideName(Snap.nPierSide), Snap.dVolts,
+           ageMs(nNow, Snap.nRaDecTime), ageMs(nNow, Snap.nAltAzTime), ageMs(nNow, Snap.nTrackingTime), ageMs(nNow, Snap.nPublishTime));
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    int nOpt;
+    int nErr;
+    int nInterval = 0;
+    std::string sName = RST_STATUS_SHM_NAME;
+    RSTStatusReader reader;
+    RSTStatusSnapshot Snap;
+
+    while((nOpt = getopt(argc, argv, "n:i:h")) != -1) {
+        switch(nOpt) {
+            case 'n' :
+                sName.assign(optarg);
+                break;
+            case 'i' :
+                nInterval = atoi(optarg);
+                break;
+            default :
+                fprintf(stderr, "usage : %s [-n <segment name>] [-i <interval ms>]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    nErr = reader.open(sName);
+    if(nErr) {
+        fprintf(stderr, "no status published as %s (%d)\n", sName.c_str(), nErr);
+        return 1;
+    }
+
+    do {
+        nErr = reader.read(Snap);
+        if(nErr) {
+            fprintf(stderr, "can't read the status (%d)\n", nErr);
+            return 1;
+        }
+        printSnapshot(Snap);
+        if(nInterval > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(nInterval));
+    } while(nInterval > 0);
+
+    return 0;
+}
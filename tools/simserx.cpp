@@ -0,0 +1,401 @@
+#include "simserx.h"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+
+#define SIDEREAL_ARCSEC_PER_SEC 15.0410681
+#define SIM_GUIDE_SPEED         0.5     // x sidereal, what :CU0# answers
+#define SIM_MOVE_SPEED          100     // x sidereal, what :CU1# .. :CU3# answer
+
+// "HH:MM:SS.S" or "+DD*MM:SS"
+static double sexagesimal(const std::string &sValue)
+{
+    double dSign = (sValue.size() && sValue[0] == '-') ? -1.0 : 1.0;
+    const char *p = sValue.c_str() + ((sValue.size() && (sValue[0] == '-' || sValue[0] == '+')) ? 1 : 0);
+    char *pEnd;
+    double dValue = strtod(p, &pEnd);
+
+    if(*pEnd) {
+        dValue += strtod(pEnd + 1, &pEnd) / 60.0;
+        if(*pEnd)
+            dValue += strtod(pEnd + 1, &pEnd) / 3600.0;
+    }
+    return dSign * dValue;
+}
+
+RSTSimSerX::RSTSimSerX(int nLatencyMs, double dSlewSeconds)
+{
+    m_bOpen = false;
+    m_nLatencyMs = nLatencyMs;
+    m_dSlewSeconds = dSlewSeconds;
+    m_nCommands = 0;
+    m_nFloodIntervalMs = 0;
+
+    m_bTracking = true;
+    m_bSlewing = false;
+    m_dSlewRate = 0.0;
+    m_dSlewSettle = 0.0;
+    m_bSlewDoneNotice = false;
+    m_bSlewNoticePending = false;
+    m_dRa = sexagesimal("10:20:30.0");
+    m_dDec = sexagesimal("+45*30:00");
+    m_dMoveRate = SIM_GUIDE_SPEED * SIDEREAL_ARCSEC_PER_SEC;
+    m_nRaMove = 0;
+    m_nDecMove = 0;
+    m_tMovesUpdated = Clock::now();
+    m_sAz = "180*00:00";
+    m_sAlt = "+45*00:00";
+    m_sTargetRa = formatRa(m_dRa);
+    m_sTargetDec = formatDec(m_dDec);
+    m_sTargetAz = m_sAz;
+    m_sTargetAlt = m_sAlt;
+}
+
+RSTSimSerX::~RSTSimSerX()
+{
+}
+
+int RSTSimSerX::open(const char* /*pszPort*/, const unsigned long& /*dwBaudRate*/, const char* /*pszSession*/)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_bOpen = true;
+    m_Pending.clear();
+    m_sRx.clear();
+    return SB_OK;
+}
+
+int RSTSimSerX::close()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    m_bOpen = false;
+    return SB_OK;
+}
+
+bool RSTSimSerX::isConnected() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_bOpen;
+}
+
+int RSTSimSerX::flushTx()
+{
+    return SB_OK;
+}
+
+int RSTSimSerX::purgeTxRx()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    releaseReady();
+    m_sRx.clear();
+    return SB_OK;
+}
+
+int RSTSimSerX::waitForBytesRx(const int& nNumber, const int& nTimeOutMilli)
+{
+    int nWaiting = 0;
+    Clock::time_point tEnd = Clock::now() + std::chrono::milliseconds(nTimeOutMilli);
+
+    while(true) {
+        bytesWaitingRx(nWaiting);
+        if(nWaiting >= nNumber)
+            return SB_OK;
+        if(Clock::now() >= tEnd)
+            return ERR_RXTIMEOUT;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+int RSTSimSerX::readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& /*dwTimeOut*/)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(!m_bOpen)
+        return ERR_NOLINK;
+    releaseReady();
+    lpNumberOfBytesRead = std::min<unsigned long>(dwNumberOfBytesToRead, m_sRx.size());
+    memcpy(lpBuffer, m_sRx.data(), lpNumberOfBytesRead);
+    m_sRx.erase(0, lpNumberOfBytesRead);
+    return SB_OK;
+}
+
+int RSTSimSerX::bytesWaitingRx(int &nBytesWaitingRx)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    if(!m_bOpen)
+        return ERR_NOLINK;
+    releaseReady();
+    nBytesWaitingRx = (int)m_sRx.size();
+    return SB_OK;
+}
+
+int RSTSimSerX::writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten)
+{
+    std::string sIn((const char *)lpBuffer, dwNumberOfBytesToWrite);
+    std::string sCmd;
+    std::string sAnswer;
+    Pending answerEntry;
+    size_t nStart = 0;
+    size_t nEnd;
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    lpNumberOfBytesWritten = dwNumberOfBytesToWrite;
+    if(!m_bOpen)
+        return ERR_NOLINK;
+
+    while((nEnd = sIn.find('#', nStart)) != std::string::npos) {
+        sCmd = sIn.substr(nStart, nEnd - nStart + 1);
+        nStart = nEnd + 1;
+        m_nCommands++;
+        if(m_CommandTimes.count(sCmd) == 0)
+            m_CommandTimes[sCmd] = Clock::now();
+        sAnswer = answer(sCmd);
+        if(sAnswer.empty() || (m_CommandDelays.count(sCmd) && m_CommandDelays[sCmd] < 0))
+            continue;
+        answerEntry.tReady = Clock::now() + std::chrono::milliseconds(m_nLatencyMs);
+        if(m_CommandDelays.count(sCmd))
+            answerEntry.tReady += std::chrono::milliseconds(m_CommandDelays[sCmd]);
+        answerEntry.sData = sAnswer;
+        m_Pending.push_back(answerEntry);
+    }
+    return SB_OK;
+}
+
+void RSTSimSerX::setCommandDelay(const std::string &sCmd, int nDelayMs)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_CommandDelays[sCmd] = nDelayMs;
+}
+
+void RSTSimSerX::resetCommandTime(const std::string &sCmd)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_CommandTimes.erase(sCmd);
+}
+
+bool RSTSimSerX::getCommandTime(const std::string &sCmd, Clock::time_point &tWrite)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::map<std::string, Clock::time_point>::iterator it = m_CommandTimes.find(sCmd);
+
+    if(it == m_CommandTimes.end())
+        return false;
+    tWrite = it->second;
+    return true;
+}
+
+void RSTSimSerX::setNoticeFlood(const std::string &sNotice, int nIntervalMs)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_sFloodNotice = sNotice;
+    m_nFloodIntervalMs = nIntervalMs;
+    m_tNextFlood = Clock::now();
+}
+
+void RSTSimSerX::setSlewSeconds(double dSlewSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_dSlewSeconds = dSlewSeconds;
+}
+
+void RSTSimSerX::setSlewRate(double dDegPerSec, double dSettleSeconds)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_dSlewRate = dDegPerSec;
+    m_dSlewSettle = dSettleSeconds;
+}
+
+void RSTSimSerX::getPosition(double &dRa, double &dDec)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    updateMoves();
+    dRa = m_dRa;
+    dDec = m_dDec;
+}
+
+void RSTSimSerX::updateMoves()
+{
+    Clock::time_point tNow = Clock::now();
+    double dSeconds = std::chrono::duration_cast<std::chrono::microseconds>(tNow - m_tMovesUpdated).count() / 1e6;
+
+    m_tMovesUpdated = tNow;
+    m_dRa = std::fmod(m_dRa + m_nRaMove * m_dMoveRate * dSeconds / 54000.0 + 24.0, 24.0);
+    m_dDec = std::min(std::max(m_dDec + m_nDecMove * m_dMoveRate * dSeconds / 3600.0, -90.0), 90.0);
+}
+
+std::string RSTSimSerX::formatRa(double dRa)
+{
+    char szRa[32];
+    int nTenths = (int)std::round(dRa * 36000.0) % 864000;
+
+    snprintf(szRa, sizeof(szRa), "%02d:%02d:%02d.%d", nTenths / 36000, (nTenths / 600) % 60, (nTenths / 10) % 60, nTenths % 10);
+    return szRa;
+}
+
+std::string RSTSimSerX::formatDec(double dDec)
+{
+    char szDec[32];
+    int nSeconds = (int)std::round(std::fabs(dDec) * 3600.0);
+
+    snprintf(szDec, sizeof(szDec), "%c%02d*%02d:%02d", dDec < 0 ? '-' : '+', nSeconds / 3600, (nSeconds / 60) % 60, nSeconds % 60);
+    return szDec;
+}
+
+void RSTSimSerX::releaseReady()
+{
+    Clock::time_point tNow = Clock::now();
+
+    if(m_bSlewNoticePending && m_tSlewEnd <= tNow) {
+        m_sRx += "MM0#";
+        m_bSlewNoticePending = false;
+    }
+    // notices and answers interleave in time order
+    while(true) {
+        bool bFlood = m_nFloodIntervalMs > 0 && m_tNextFlood <= tNow;
+        bool bAnswer = !m_Pending.empty() && m_Pending.front().tReady <= tNow;
+        if(bFlood && (!bAnswer || m_tNextFlood <= m_Pending.front().tReady)) {
+            m_sRx += m_sFloodNotice;
+            m_tNextFlood += std::chrono::milliseconds(m_nFloodIntervalMs);
+        }
+        else if(bAnswer) {
+            m_sRx += m_Pending.front().sData;
+            m_Pending.pop_front();
+        }
+        else
+            break;
+    }
+}
+
+std::string RSTSimSerX::answer(const std::string &sCmd)
+{
+    updateMoves();
+    if(m_bSlewing && Clock::now() >= m_tSlewEnd) {
+        m_bSlewing = false;
+        m_dRa = sexagesimal(m_sTargetRa);
+        m_dDec = sexagesimal(m_sTargetDec);
+        m_sAz = m_sTargetAz;
+        m_sAlt = m_sTargetAlt;
+    }
+
+    // targets and gotos
+    if(sCmd.compare(0, 3, ":Sr") == 0) {
+        m_sTargetRa = sCmd.substr(3, sCmd.size() - 4);
+        return "1";
+    }
+    if(sCmd.compare(0, 3, ":Sd") == 0) {
+        m_sTargetDec = sCmd.substr(3, sCmd.size() - 4);
+        return "1";
+    }
+    if(sCmd.compare(0, 3, ":Sz") == 0) {
+        m_sTargetAz = sCmd.substr(3, sCmd.size() - 4);
+        return "";
+    }
+    if(sCmd.compare(0, 3, ":Sa") == 0) {
+        m_sTargetAlt = sCmd.substr(3, sCmd.size() - 4);
+        return "";
+    }
+    if(sCmd == ":MS#" || sCmd == ":MA#") {
+        m_bSlewing = true;
+        double dSeconds = m_dSlewSeconds;
+        if(m_dSlewRate > 0.0 && sCmd == ":MS#") {
+            double dRaMove = std::fabs(std::fmod(std::fmod((sexagesimal(m_sTargetRa) - m_dRa) * 15.0, 360.0) + 540.0, 360.0) - 180.0);
+            double dDecMove = std::fabs(sexagesimal(m_sTargetDec) - m_dDec);
+            dSeconds = m_dSlewSettle + std::max(dRaMove, dDecMove) / m_dSlewRate;
+        }
+        m_tSlewEnd = Clock::now() + std::chrono::milliseconds((int)(dSeconds * 1000));
+        m_bSlewNoticePending = m_bSlewDoneNotice;
+        return "";
+    }
+    if(sCmd.compare(0, 2, ":Q") == 0) {
+        if(sCmd == ":Qe#" || sCmd == ":Qw#")
+            m_nRaMove = 0;
+        else if(sCmd == ":Qn#" || sCmd == ":Qs#")
+            m_nDecMove = 0;
+        else {
+            m_nRaMove = 0;
+            m_nDecMove = 0;
+            m_bSlewing = false;
+            m_bSlewNoticePending = false;
+        }
+        return "";
+    }
+
+    // open loop moves
+    if(sCmd == ":RG#" || sCmd == ":RC#" || sCmd == ":RM#" || sCmd == ":RS#") {
+        m_dMoveRate = (sCmd == ":RG#" ? SIM_GUIDE_SPEED : SIM_MOVE_SPEED) * SIDEREAL_ARCSEC_PER_SEC;
+        return "";
+    }
+    if(sCmd == ":Me#" || sCmd == ":Mw#") {
+        m_nRaMove = (sCmd == ":Me#") ? 1 : -1;
+        return "";
+    }
+    if(sCmd == ":Mn#" || sCmd == ":Ms#") {
+        m_nDecMove = (sCmd == ":Mn#") ? 1 : -1;
+        return "";
+    }
+
+    // tracking
+    if(sCmd == ":CtA#") {
+        m_bTracking = true;
+        return "Ct1#";
+    }
+    if(sCmd == ":CtL#") {
+        m_bTracking = false;
+        return "Ct1#";
+    }
+    if(sCmd == ":Ct?#")
+        return "Ct?0#";
+    if(sCmd.compare(0, 3, ":Ct") == 0)
+        return "Ct1#";
+    if(sCmd == ":AT#")
+        return m_bTracking?"AT:1#":"AT:0#";
+
+    // status
+    if(sCmd == ":GR#")
+        return "GR:" + formatRa(m_dRa) + "#";
+    if(sCmd == ":GD#")
+        return "GD:" + formatDec(m_dDec) + "#";
+    if(sCmd == ":GZ#")
+        return "GZ:" + m_sAz + "#";
+    if(sCmd == ":GA#")
+        return "GA:" + m_sAlt + "#";
+    if(sCmd == ":CL#")
+        return m_bSlewing?"CL:1#":"CL:0#";
+    if(sCmd == ":AV#")
+        return "AV:SIM#";
+    if(sCmd == ":AH#")
+        return "AH:0#";
+    if(sCmd == ":GH#")
+        return "GH:O#";
+    if(sCmd == ":Cv#")
+        return "Cv:12.3#";
+    if(sCmd == ":CG3#")
+        return "CG3:0.0#";
+    if(sCmd == ":CY#")
+        return "CY:45/0#";
+    if(sCmd == ":CU3#" && m_dSlewRate > 0.0)
+        return "CU3=" + std::to_string((int)(m_dSlewRate * 3600.0 / 15.0410681)) + "#";
+    if(sCmd.compare(0, 3, ":CU") == 0 && sCmd.size() == 5)
+        return std::string("CU") + sCmd[3] + "=" + (sCmd[3] == '0'?"0.5":"100") + "#";
+    if(sCmd == ":GL#")
+        return "GL:12:00:00#";
+    if(sCmd == ":GC#")
+        return "GC:01/01/25#";
+    if(sCmd == ":Gg#")
+        return "Gg:+073*30'00#";
+    if(sCmd == ":Gt#")
+        return "Gt:+45*30'00#";
+    if(sCmd == ":GG#")
+        return "GG:+05#";
+
+    // :AR#, :AU#, moves, site writes, ... don't answer
+    return "";
+}
@@ -0,0 +1,104 @@
+#ifndef __RST_SIM_SERX__
+#define __RST_SIM_SERX__
+
+#pragma once
+
+// Simulated RST mount behind an RSTTransport, for the benchmark tools and the tests.
+// It answers the commands the driver uses with plausible values, every answer becomes readable
+// nLatencyMs after the command was written (link + firmware time) and gotos take dSlewSeconds.
+// The open loop moves (:Mn# .. :Mw# at the :RG# .. :RS# rate, until the matching :Q) move the position it reports,
+// east and north make RA and Dec grow. Tracking is perfect, the RA stays put.
+
+#include <string>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+#include "../rsttransport.h"
+
+class RSTSimSerX : public RSTTransport
+{
+public:
+    RSTSimSerX(int nLatencyMs = 10, double dSlewSeconds = 2.0);
+    virtual ~RSTSimSerX();
+
+    virtual int open(const char* pszPort, const unsigned long& dwBaudRate = 9600, const char* pszSession = 0);
+    virtual int close();
+    virtual bool isConnected() const;
+
+    virtual int flushTx();
+    virtual int purgeTxRx();
+    virtual int waitForBytesRx(const int& nNumber, const int& nTimeOutMilli);
+    virtual int readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut = 1000);
+    virtual int writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten);
+    virtual int bytesWaitingRx(int &nBytesWaitingRx);
+
+    typedef std::chrono::steady_clock Clock;
+
+    void    setLatency(int nLatencyMs) { m_nLatencyMs = nLatencyMs; }
+    // extra answer delay for one command, to play a mount that is slow on some queries. Negative : never answered
+    void    setCommandDelay(const std::string &sCmd, int nDelayMs);
+    unsigned long getCommandCount() const { return m_nCommands; }
+    // when sCmd was first written since the last reset, false if it wasn't
+    void    resetCommandTime(const std::string &sCmd);
+    bool    getCommandTime(const std::string &sCmd, Clock::time_point &tWrite);
+    // a mount (or a link) repeating an async notice ("MM0#") every nIntervalMs, 0 stops it
+    void    setNoticeFlood(const std::string &sNotice, int nIntervalMs);
+    // length of the next gotos, and whether the end of one comes as an async "MM0#" like on the real mount.
+    // With a rate the length comes from the distance instead : dSettleSeconds + the longest of the RA and Dec moves.
+    void    setSlewSeconds(double dSlewSeconds);
+    void    setSlewRate(double dDegPerSec, double dSettleSeconds);
+    void    setSlewDoneNotice(bool bNotice) { m_bSlewDoneNotice = bNotice; }
+    // where the mount points now, moves included. RA in hours, Dec in degrees
+    void    getPosition(double &dRa, double &dDec);
+
+private:
+    typedef struct {
+        Clock::time_point   tReady;
+        std::string         sData;
+    } Pending;
+
+    std::string answer(const std::string &sCmd);
+    void        releaseReady();    // with m_Mutex held
+    void        updateMoves();     // with m_Mutex held, m_dRa/m_dDec to now
+    static std::string formatRa(double dRa);
+    static std::string formatDec(double dDec);
+
+    mutable std::mutex  m_Mutex;
+    bool                m_bOpen;
+    int                 m_nLatencyMs;
+    double              m_dSlewSeconds;
+    std::deque<Pending> m_Pending;
+    std::string         m_sRx;
+    std::atomic<unsigned long>  m_nCommands;
+    std::map<std::string, int>                  m_CommandDelays;
+    std::map<std::string, Clock::time_point>    m_CommandTimes;
+    std::string         m_sFloodNotice;
+    int                 m_nFloodIntervalMs;
+    Clock::time_point   m_tNextFlood;
+
+    // mount state
+    bool                m_bTracking;
+    bool                m_bSlewing;
+    Clock::time_point   m_tSlewEnd;
+    double              m_dSlewRate;
+    double              m_dSlewSettle;
+    bool                m_bSlewDoneNotice;
+    bool                m_bSlewNoticePending;
+    double              m_dRa;
+    double              m_dDec;
+    double              m_dMoveRate;        // arcsec/s, the last :R?# rate
+    int                 m_nRaMove;          // 1 east, -1 west, 0 not moving
+    int                 m_nDecMove;         // 1 north, -1 south
+    Clock::time_point   m_tMovesUpdated;
+    std::string         m_sAz;
+    std::string         m_sAlt;
+    std::string         m_sTargetRa;
+    std::string         m_sTargetDec;
+    std::string         m_sTargetAz;
+    std::string         m_sTargetAlt;
+};
+
+#endif // __RST_SIM_SERX__
@@ -0,0 +1,51 @@
+#ifndef __X2_ADAPTERS__
+#define __X2_ADAPTERS__
+
+#pragma once
+
+// The RST core only knows RSTTransport and RSTHost (rsttransport.h), these hand it what TheSkyX gives the plugin.
+
+#include "../../licensedinterfaces/serxinterface.h"
+#include "../../licensedinterfaces/theskyxfacadefordriversinterface.h"
+
+#include "rsttransport.h"
+
+class X2SerXTransport : public RSTTransport
+{
+public:
+    X2SerXTransport(SerXInterface *pSerX = NULL) : m_pSerX(pSerX) {}
+
+    virtual int open(const char* pszPort, const unsigned long& dwBaudRate = 9600, const char* pszSession = 0)
+        { return m_pSerX->open(pszPort, dwBaudRate, SerXInterface::B_NOPARITY, pszSession); }
+    virtual int close() { return m_pSerX->close(); }
+    virtual bool isConnected() const { return m_pSerX->isConnected(); }
+
+    virtual int flushTx() { return m_pSerX->flushTx(); }
+    virtual int purgeTxRx() { return m_pSerX->purgeTxRx(); }
+    virtual int readFile(void* lpBuffer, const unsigned long dwNumberOfBytesToRead, unsigned long& lpNumberOfBytesRead, const unsigned long& dwTimeOut = 500)
+        { return m_pSerX->readFile(lpBuffer, dwNumberOfBytesToRead, lpNumberOfBytesRead, dwTimeOut); }
+    virtual int writeFile(void* lpBuffer, const unsigned long& dwNumberOfBytesToWrite, unsigned long& lpNumberOfBytesWritten)
+        { return m_pSerX->writeFile(lpBuffer, dwNumberOfBytesToWrite, lpNumberOfBytesWritten); }
+    virtual int bytesWaitingRx(int &nBytesWaitingRx) { return m_pSerX->bytesWaitingRx(nBytesWaitingRx); }
+
+private:
+    SerXInterface   *m_pSerX;
+};
+
+class X2SkyXHost : public RSTHost
+{
+public:
+    X2SkyXHost(TheSkyXFacadeForDriversInterface *pTheSkyX = NULL) : m_pTheSkyX(pTheSkyX) {}
+
+    virtual double latitude() { return m_pTheSkyX->latitude(); }
+    virtual double longitude() { return m_pTheSkyX->longitude(); }
+    virtual double timeZone() { return m_pTheSkyX->timeZone(); }
+    virtual double lst() { return m_pTheSkyX->lst(); }
+    virtual int localDateTime(int& yy, int& mm, int& dd, int& h, int& min, double& sec, int& nIsDST)
+        { return m_pTheSkyX->localDateTime(yy, mm, dd, h, min, sec, nIsDST); }
+
+private:
+    TheSkyXFacadeForDriversInterface    *m_pTheSkyX;
+};
+
+#endif // __X2_ADAPTERS__
@@ -10,6 +10,8 @@ X2Mount::X2Mount(const char* pszDriverSelection,
 				 MutexInterface					* pIOMutex,
 				 TickCountInterface				* pTickCount)
 {
+    char szHorizon[LIMITS_MAX_HORIZON_STRING];
+    char szCapabilities[CAPS_MAX_STRING];
 
 	m_nPrivateMulitInstanceIndex	= nInstanceIndex;
 	m_pSerX							= pSerX;
@@ -25,11 +27,19 @@ X2Mount::X2Mount(const char* pszDriverSelection,
     m_bLinked = false;
     m_bSyncOnConnect = false;
     m_bStopTrackingOnDisconnect = false;
+    m_bUseProxy = false;
+    m_bPublishStatus = true;
+    snprintf(m_szProxySocket, MAX_PORT_NAME_SIZE, RST_PROXY_DEFAULT_SOCKET);
     
     m_nParkingPosition = 1;
+    m_bRecordHistory = true;
+    m_nRecordSizeMB = RST_RECORDER_DEFAULT_SIZE;
+    m_nMetricsPort = 0;
 
-    mRST.setSerxPointer(m_pSerX);
-    mRST.setTSX(m_pTheSkyXForMounts);
+    m_SerXTransport = X2SerXTransport(m_pSerX);
+    m_SkyXHost = X2SkyXHost(m_pTheSkyXForMounts);
+    mRST.setTransport(&m_SerXTransport);
+    mRST.setHost(m_pTheSkyXForMounts ? &m_SkyXHost : NULL);
 
     m_CurrentRateIndex = 0;
 
@@ -39,17 +49,47 @@ X2Mount::X2Mount(const char* pszDriverSelection,
         m_bSyncOnConnect = (m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_SYNC_TIME, 0) == 0 ? false : true);
         m_nParkingPosition = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_PARK_POS, 1);
         m_bStopTrackingOnDisconnect = (m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_STOP_TRK, 1) == 0 ? false : true);
+        m_bUseProxy = (m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_USE_PROXY, 0) == 0 ? false : true);
+        m_bPublishStatus = (m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_PUBLISH_STATUS, 1) == 0 ? false : true);
+        m_pIniUtil->readString(PARENT_KEY, CHILD_KEY_PROXY_SOCKET, m_szProxySocket, m_szProxySocket, MAX_PORT_NAME_SIZE);
+        mRST.setTelemetryInterval(m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_TELEMETRY_INTERVAL, TELEMETRY_DEFAULT_INTERVAL));
+        m_bRecordHistory = (m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_RECORD_HISTORY, 1) == 0 ? false : true);
+        m_nRecordSizeMB = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_RECORD_SIZE, RST_RECORDER_DEFAULT_SIZE);
+        m_nMetricsPort = m_pIniUtil->readInt(PARENT_KEY, CHILD_KEY_METRICS_PORT, 0);
+        // slew limits checked locally before a goto, the horizon is "az:alt,az:alt,..." in degrees
+        mRST.setLimits(m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_HOURS_EAST, LIMITS_DEFAULT_HOURS_EAST),
+                       m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_HOURS_WEST, LIMITS_DEFAULT_HOURS_WEST),
+                       m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_MIN_ALTITUDE, LIMITS_DEFAULT_MIN_ALTITUDE));
+        m_pIniUtil->readString(PARENT_KEY, CHILD_KEY_HORIZON, "", szHorizon, LIMITS_MAX_HORIZON_STRING);
+        mRST.setHorizon(szHorizon);
+        // where the pier side model starts, it learns from the gotos
+        mRST.setFlipHourAngle(m_pIniUtil->readDouble(PARENT_KEY, CHILD_KEY_FLIP_HOUR_ANGLE, PIER_DEFAULT_FLIP_HOUR_ANGLE));
+        // the optional commands the last firmware we saw answers, "<firmware>|CG3=1,CY=0,Cv=1"
+        m_pIniUtil->readString(PARENT_KEY, CHILD_KEY_CAPABILITIES, "", szCapabilities, CAPS_MAX_STRING);
+        mRST.setCapabilityCache(szCapabilities);
 	}
 
     mRST.setSyncLocationDataConnect(m_bSyncOnConnect);
     mRST.setParkPosition(m_nParkingPosition);
     mRST.setStopTrackingOnDisconnect(m_bStopTrackingOnDisconnect);
+    // other processes on this machine can read the mount status from shared memory, one segment per instance
+    if(m_bPublishStatus)
+        mRST.setStatusPublishing(std::string(RST_STATUS_SHM_NAME) + (m_nPrivateMulitInstanceIndex?std::to_string(m_nPrivateMulitInstanceIndex):""));
+    // what happened during the night, see tools/rstrecexport
+    if(m_bRecordHistory)
+        mRST.setRecording(RSTRecorder::defaultPath(m_nPrivateMulitInstanceIndex), m_nRecordSizeMB);
+    // for the observatory monitoring, one port per instance starting at MetricsPort
+    if(m_nMetricsPort > 0)
+        mRST.setMetricsPort(m_nMetricsPort + m_nPrivateMulitInstanceIndex);
+    // all the RST instances share one I/O pool for the coordinated operations (park all, abort all)
+    RSTManager::instance().registerMount(&mRST, m_nPrivateMulitInstanceIndex);
 }
 
 X2Mount::~X2Mount()
 {
 	// Write the stored values
 
+    RSTManager::instance().unregisterMount(&mRST);
     if(m_bLinked)
         mRST.Disconnect();
     
@@ -107,6 +147,10 @@ int X2Mount::queryAbstraction(const char* pszName, void** ppVal)
 
 #pragma mark - OpenLoopMoveInterface
 
+// RST takes TheSkyX's direction as is
+static_assert(int(MountDriverInterface::MD_NORTH) == MOVE_NORTH && int(MountDriverInterface::MD_SOUTH) == MOVE_SOUTH &&
+              int(MountDriverInterface::MD_EAST) == MOVE_EAST && int(MountDriverInterface::MD_WEST) == MOVE_WEST, "RSTMoveDir doesn't match MountDriverInterface::MoveDir");
+
 int X2Mount::startOpenLoopMove(const MountDriverInterface::MoveDir& Dir, const int& nRateIndex)
 {
     int nErr = SB_OK;
@@ -117,7 +161,7 @@ int X2Mount::startOpenLoopMove(const MountDriverInterface::MoveDir& Dir, const i
 
 
 	m_CurrentRateIndex = nRateIndex;
-    nErr = mRST.startOpenLoopMove(Dir, nRateIndex);
+    nErr = mRST.startOpenLoopMove(RSTMoveDir(Dir), nRateIndex);
     if(nErr) {
         return ERR_CMDFAILED;
     }
@@ -143,7 +187,6 @@ int X2Mount::rateCountOpenLoopMove(void) const
 {
     X2Mount* pMe = (X2Mount*)this;
 
-    X2MutexLocker ml(pMe->GetMutex());
 	return pMe->mRST.getNbSlewRates();
 }
 
@@ -152,8 +195,6 @@ int X2Mount::rateNameFromIndexOpenLoopMove(const int& nZeroBasedIndex, char* psz
     int nErr = SB_OK;
     std::string sTmp;
 
-    X2MutexLocker ml(GetMutex());
-
     nErr = mRST.getRateName(nZeroBasedIndex, sTmp);
     if(nErr) {
         return ERR_CMDFAILED;
@@ -176,13 +217,6 @@ int X2Mount::execModalSettingsDialog(void)
 	X2GUIInterface*					ui = uiutil.X2UI();
 	X2GUIExchangeInterface*			dx = NULL;//Comes after ui is loaded
 	bool bPressedOK = false;
-    std::string sTmp;
-    std::string sTime;
-    std::string sDate;
-    std::string sLongitude;
-    std::string sLatitude;
-    std::string sTimeZone;
-    double dVolts;
 
 	if (NULL == ui) return ERR_POINTER;
 	
@@ -193,29 +227,14 @@ int X2Mount::execModalSettingsDialog(void)
 		return ERR_POINTER;
 	}
 
-    X2MutexLocker ml(GetMutex());
-
-	// Set values in the userinterface
+	// Set values in the userinterface, everything comes from the telemetry cache so opening the dialog doesn't touch the link
     if(m_bLinked) {
         dx->setEnabled("pushButton",true);
         dx->setEnabled("pushButton_3",true);
-
-        nErr = mRST.getLocalTime(sTime);
-        nErr |= mRST.getLocalDate(sDate);
-        if(!nErr) {
-            sTmp =sDate + " - " + sTime;
-            dx->setText("time_date", sTmp.c_str());
-        }
-        mRST.getSiteData(sLongitude, sLatitude, sTimeZone);
-        sTimeZone = std::string("GMT ") + sTimeZone;
-
-        dx->setText("longitude", sLongitude.c_str());
-        dx->setText("latitude", sLatitude.c_str());
-        dx->setText("timezone", sTimeZone.c_str());
+        dx->setEnabled("pushButton_4",!RSTManager::instance().isParkAllRunning());
+        dx->setEnabled("pushButton_5",true);
         dx->setCurrentIndex("comboBox", m_nParkingPosition-1);
-
-        mRST.getInputVoltage(dVolts);
-        dx->setText("voltage", (std::string("Input volatage : ") + std::to_string(dVolts)).c_str());
+        showTelemetry(dx);
     }
     else {
         dx->setText("time_date", "");
@@ -223,25 +242,44 @@ int X2Mount::execModalSettingsDialog(void)
         dx->setText("longitude", "");
         dx->setText("latitude", "");
         dx->setText("timezone", "");
+        dx->setText("linkStatus", "");
+        dx->setText("features", "");
         dx->setEnabled("pushButton",false);
         dx->setEnabled("pushButton_3",false);
+        dx->setEnabled("pushButton_4",false);
+        dx->setEnabled("pushButton_5",false);
     }
 
     dx->setChecked("checkBox", (m_bSyncOnConnect?1:0));
     dx->setChecked("checkBox_2", (m_bStopTrackingOnDisconnect?1:0));
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+    dx->setChecked("checkBox_3", (m_bUseProxy?1:0));
+    dx->setEnabled("checkBox_3", !m_bLinked);
+#else
+    dx->setChecked("checkBox_3", 0);
+    dx->setEnabled("checkBox_3", false);
+#endif
 
     //Display the user interface
 	if ((nErr = ui->exec(bPressedOK)))
 		return nErr;
+
+    saveCapabilities();
 	
 	//Retreive values from the user interface
 	if (bPressedOK) {
+        X2MutexLocker ml(GetMutex());
         m_bSyncOnConnect = (dx->isChecked("checkBox")==1?true:false);
         m_bStopTrackingOnDisconnect = (dx->isChecked("checkBox_2")==1?true:false);
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+        if(!m_bLinked)
+            m_bUseProxy = (dx->isChecked("checkBox_3")==1?true:false);
+#endif
         m_nParkingPosition = dx->currentIndex("comboBox") + 1;
         nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_SYNC_TIME, (m_bSyncOnConnect?1:0));
         nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_PARK_POS, m_nParkingPosition);
         nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_STOP_TRK, (m_bStopTrackingOnDisconnect?1:0));
+        nErr |= m_pIniUtil->writeInt(PARENT_KEY, CHILD_KEY_USE_PROXY, (m_bUseProxy?1:0));
         mRST.setParkPosition(m_nParkingPosition);
         mRST.setStopTrackingOnDisconnect(m_bStopTrackingOnDisconnect);
 	}
@@ -250,56 +288,105 @@ int X2Mount::execModalSettingsDialog(void)
 
 void X2Mount::uiEvent(X2GUIExchangeInterface* uiex, const char* pszEvent)
 {
-    int nErr = SB_OK;
-    std::string sLongitude;
-    std::string sLatitude;
-    std::string sTimeZone;
-    std::string sTime;
-    std::string sDate;
-    std::string sTmp;
-    double dVolts;
-
     if(!m_bLinked)
         return ; 
 
 	if (!strcmp(pszEvent, "on_timer")) {
-        nErr = mRST.getLocalTime(sTime);
-        nErr |= mRST.getLocalDate(sDate);
-        if(!nErr) {
-            sTmp =sDate + " - " + sTime;
-            uiex->setText("time_date", sTmp.c_str());
-        }
-        mRST.getInputVoltage(dVolts);
-        uiex->setText("voltage", (std::string("Input volatage : ") + std::to_string(dVolts)).c_str());
+        showTelemetry(uiex);
+        uiex->setEnabled("pushButton_4", !RSTManager::instance().isParkAllRunning());
 	}
 
     if (!strcmp(pszEvent, "on_pushButton_clicked")) {
         mRST.syncDate();
         mRST.syncTime();
-        nErr = mRST.getLocalTime(sTime);
-        nErr |= mRST.getLocalDate(sDate);
-        if(!nErr) {
-            sTmp =sDate + " - " + sTime;
-            uiex->setText("time_date", sTmp.c_str());
-        }
-
         mRST.setSiteData( m_pTheSkyXForMounts->longitude(),
                           m_pTheSkyXForMounts->latitude(),
                           m_pTheSkyXForMounts->timeZone());
-        mRST.getSiteData(sLongitude, sLatitude, sTimeZone);
-        sTimeZone = std::string("GMT ") + sTimeZone;
-
-        uiex->setText("longitude", sLongitude.c_str());
-        uiex->setText("latitude", sLatitude.c_str());
-        uiex->setText("timezone", sTimeZone.c_str());
+        // the next timer tick shows what the mount has now
+        mRST.refreshTelemetry(true);
     }
 
     if (!strcmp(pszEvent, "on_pushButton_3_clicked")) {
     }
 
+    // park / abort every RST mount of this TheSkyX, in parallel
+    if (!strcmp(pszEvent, "on_pushButton_4_clicked")) {
+        if(RSTManager::instance().startParkAll())
+            uiex->setEnabled("pushButton_4", false);
+    }
+
+    if (!strcmp(pszEvent, "on_pushButton_5_clicked")) {
+        std::vector<int> vErrors;
+        RSTManager::instance().abortAll(vErrors);
+    }
+
 	return;
 }
 
+void X2Mount::showTelemetry(X2GUIExchangeInterface *dx)
+{
+    std::string sTime;
+    std::string sDate;
+    std::string sLongitude;
+    std::string sLatitude;
+    std::string sTimeZone;
+    std::string sTmp;
+    double dVolts;
+
+    if(!mRST.getTelemetry(sDate, sTime, dVolts)) {
+        sTmp = sDate + " - " + sTime;
+        dx->setText("time_date", sTmp.c_str());
+        if(mRST.isCapabilityUnsupported(CAP_VOLTAGE))
+            dx->setText("voltage", "Input voltage : not available");
+        else
+            dx->setText("voltage", (std::string("Input volatage : ") + std::to_string(dVolts)).c_str());
+    }
+    else {
+        dx->setText("time_date", "waiting for the mount");
+        dx->setText("voltage", "");
+    }
+    if(!mRST.getTelemetrySite(sLongitude, sLatitude, sTimeZone)) {
+        sTimeZone = std::string("GMT ") + sTimeZone;
+        dx->setText("longitude", sLongitude.c_str());
+        dx->setText("latitude", sLatitude.c_str());
+        dx->setText("timezone", sTimeZone.c_str());
+    }
+    linkStatusText(sTmp);
+    dx->setText("linkStatus", sTmp.c_str());
+    mRST.getCapabilityText(sTmp);
+    dx->setText("features", sTmp.c_str());
+}
+
+void X2Mount::saveCapabilities()
+{
+    std::string sCapabilities;
+
+    if(m_pIniUtil && mRST.getCapabilityCache(sCapabilities))
+        m_pIniUtil->writeString(PARENT_KEY, CHILD_KEY_CAPABILITIES, sCapabilities.c_str());
+}
+
+void X2Mount::linkStatusText(std::string &sStatus)
+{
+    int nState;
+    int nTripCount;
+    int nTimeouts;
+
+    mRST.getLinkBreakerStatus(nState, nTripCount, nTimeouts);
+    switch(nState) {
+        case BREAKER_OPEN :
+            sStatus = "Link : no answer, retrying";
+            break;
+        case BREAKER_HALF_OPEN :
+            sStatus = "Link : recovering";
+            break;
+        default :
+            sStatus = "Link : OK";
+            break;
+    }
+    if(nTripCount)
+        sStatus += " (" + std::to_string(nTripCount) + " drop" + (nTripCount>1?"s":"") + ")";
+}
+
 #pragma mark - LinkInterface
 int X2Mount::establishLink(void)
 {
@@ -311,6 +398,16 @@ int X2Mount::establishLink(void)
     // get serial port device name
     portNameOnToCharPtr(szPort,DRIVER_MAX_STRING);
 
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+    // when rstproxyd owns the serial port we talk to it through its socket instead
+    if(m_bUseProxy) {
+        mRST.setTransport(&m_ProxySerX);
+        snprintf(szPort, DRIVER_MAX_STRING, "%s", m_szProxySocket);
+    }
+    else
+        mRST.setTransport(&m_SerXTransport);
+#endif
+
 	nErr =  mRST.Connect(szPort);
     if(nErr) {
         m_bLinked = false;
@@ -329,6 +426,7 @@ int X2Mount::terminateLink(void)
 
     nErr = mRST.Disconnect();
     m_bLinked = false;
+    saveCapabilities();
 
     return nErr;
 }
@@ -401,11 +499,20 @@ void X2Mount::deviceInfoModel(BasicStringInterface& str)
 int X2Mount::raDec(double& ra, double& dec, const bool& bCached)
 {
 	int nErr = 0;
+    RSTStatusSnapshot Snapshot;
 
     if(!m_bLinked)
         return ERR_NOLINK;
 
-    X2MutexLocker ml(GetMutex());
+    // the status snapshot is kept up to date by every read, no need to wait for the link
+    if(bCached) {
+        mRST.getStatusSnapshot(Snapshot);
+        if(Snapshot.nRaDecTime && RSTStatusPublisher::now() - Snapshot.nRaDecTime < RADEC_CACHE_MAX_AGE) {
+            ra = Snapshot.dRa;
+            dec = Snapshot.dDec;
+            return SB_OK;
+        }
+    }
 
 	// Get the RA and DEC from the mount
 	nErr = mRST.getRaAndDec(ra, dec);
@@ -421,8 +528,7 @@ int X2Mount::abort()
     if(!m_bLinked)
         return ERR_NOLINK;
 
-    X2MutexLocker ml(GetMutex());
-
+    // no X2 lock, the abort must not wait behind a poll or a slew in progress
     nErr = mRST.Abort();
     if(nErr) {
         nErr = ERR_CMDFAILED;
@@ -453,7 +559,6 @@ int X2Mount::isCompleteSlewTo(bool& bComplete) const
         return ERR_NOLINK;
 
     X2Mount* pMe = (X2Mount*)this;
-    X2MutexLocker ml(pMe->GetMutex());
     nErr = pMe->mRST.isSlewToComplete(bComplete);
 	return nErr;
 }
@@ -486,8 +591,6 @@ bool X2Mount::isSynced(void)
     if(!m_bLinked)
         return false;
 
-    X2MutexLocker ml(GetMutex());
-
     nErr = mRST.isAligned(m_bSynced);
 
     return m_bSynced;
@@ -514,8 +617,6 @@ int X2Mount::trackingRates(bool& bSiderialTrackingOn, double& dRaRateArcSecPerSe
     if(!m_bLinked)
         return ERR_NOLINK;
 
-    X2MutexLocker ml(GetMutex());
-    
     nErr = mRST.getTrackRates(bSiderialTrackingOn, dRaRateArcSecPerSec, dDecRateArcSecPerSec);
     if(nErr) {
         return ERR_CMDFAILED;
@@ -564,7 +665,6 @@ bool X2Mount::isParked(void)
     if(!m_bLinked)
         return false;
 
-    X2MutexLocker ml(GetMutex());
     nErr = mRST.getAtPark(m_bParked);
     if(nErr) {
         return false;
@@ -695,13 +795,11 @@ int X2Mount::endUnpark(void)
 
 bool X2Mount::knowsBeyondThePole()
 {
-    X2MutexLocker ml(GetMutex());
    return true;
 }
 
 int X2Mount::beyondThePole(bool& bYes) {
     int nErr = SB_OK;
-    X2MutexLocker ml(GetMutex());
     // “beyond the pole” =  “telescope west of the pier”,
     nErr = mRST.IsBeyondThePole(bYes);
 	return nErr;
@@ -710,8 +808,7 @@ int X2Mount::beyondThePole(bool& bYes) {
 
 double X2Mount::flipHourAngle()
 {
-    X2MutexLocker ml(GetMutex());
-	return 0.0;
+    return mRST.getFlipHourAngle();
 }
 
 MountTypeInterface::Type X2Mount::mountType()
@@ -725,13 +822,8 @@ int X2Mount::gemLimits(double& dHoursEast, double& dHoursWest)
     if(!m_bLinked)
         return ERR_NOLINK;
 
-    X2MutexLocker ml(GetMutex());
     nErr = mRST.getLimits(dHoursEast, dHoursWest);
-
-    // temp debugging.
-	dHoursEast = 0.0;
-	dHoursWest = 0.0;
-    return SB_OK;
+    return nErr;
 }
 
 #pragma mark - SerialPortParams2Interface
@@ -29,6 +29,9 @@
 
 // Include files for RST mount
 #include "RST.h"
+#include "x2adapters.h"
+#include "rstproxy.h"
+#include "rstmanager.h"
 
 
 #define PARENT_KEY			"RSTMount"
@@ -36,8 +39,22 @@
 #define CHILD_KEY_SYNC_TIME "SyncTime"
 #define CHILD_KEY_PARK_POS  "ParkPos"
 #define CHILD_KEY_STOP_TRK  "StopTrackingOnDisconnect"
+#define CHILD_KEY_USE_PROXY "UseProxy"
+#define CHILD_KEY_PROXY_SOCKET "ProxySocket"
+#define CHILD_KEY_PUBLISH_STATUS "PublishStatus"
+#define CHILD_KEY_TELEMETRY_INTERVAL "TelemetryInterval"
+#define CHILD_KEY_RECORD_HISTORY "RecordHistory"
+#define CHILD_KEY_RECORD_SIZE "RecordSizeMB"
+#define CHILD_KEY_METRICS_PORT "MetricsPort"
+#define CHILD_KEY_HOURS_EAST "LimitHoursEast"
+#define CHILD_KEY_HOURS_WEST "LimitHoursWest"
+#define CHILD_KEY_MIN_ALTITUDE "LimitMinAltitude"
+#define CHILD_KEY_HORIZON "Horizon"
+#define CHILD_KEY_FLIP_HOUR_ANGLE "FlipHourAngle"
+#define CHILD_KEY_CAPABILITIES "Capabilities"
 
 #define MAX_PORT_NAME_SIZE 120
+#define RADEC_CACHE_MAX_AGE 1000000000ULL  // ns, raDec(bCached) answers from the status snapshot if it's newer than this
 
 
 // #define RST_X2_DEBUG    // Define this to have log files
@@ -211,6 +228,8 @@ private:
 	
 	// Variables for RST
 	RST mRST;
+	X2SerXTransport m_SerXTransport;
+	X2SkyXHost m_SkyXHost;
 
     bool m_bLinked;
 
@@ -223,10 +242,25 @@ private:
     bool m_bStopTrackingOnDisconnect;
     
     char m_PortName[MAX_PORT_NAME_SIZE];
+
+    bool m_bUseProxy;
+    bool m_bPublishStatus;
+    bool m_bRecordHistory;
+    int  m_nRecordSizeMB;
+    int  m_nMetricsPort;
+    char m_szProxySocket[MAX_PORT_NAME_SIZE];
+#if defined(SB_LINUX_BUILD) || defined(SB_MAC_BUILD)
+    RSTProxySerX m_ProxySerX;
+#endif
 	
 	int m_CurrentRateIndex;
 
     void portNameOnToCharPtr(char* pszPort, const unsigned int& nMaxSize) const;
+    void linkStatusText(std::string &sStatus);
+    // time, date, voltage and site from the telemetry cache, no I/O
+    void showTelemetry(X2GUIExchangeInterface *dx);
+    // what the firmware answers, written when it changed so the next connect doesn't probe
+    void saveCapabilities();
 	
 };
 